@@ -0,0 +1,778 @@
+#include "account_store.hpp"
+#include "utils/crc32.hpp"
+#include "utils/file_sync.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr uint32_t RUN_MAGIC = 0x52434341;  // "ACCR"
+constexpr size_t RUN_FOOTER_SIZE = 28;      // u64 index offset, u64 bloom offset, u64 entries, u32 magic
+constexpr size_t WAL_HEADER_SIZE = 8;       // u32 length + u32 crc32
+constexpr unsigned BLOOM_BITS_PER_KEY = 10;
+constexpr unsigned BLOOM_PROBES = 7;
+
+constexpr uint8_t FLAG_BALANCE = 0x01;
+constexpr uint8_t FLAG_NONCE = 0x02;
+
+// Stable across builds: bloom filters are stored on disk
+uint64_t fnv1a(const std::string& s) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : s) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void put_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void put_u64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+uint32_t get_u32(const char* in) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) v = (v << 8) | static_cast<uint8_t>(in[i]);
+    return v;
+}
+
+uint64_t get_u64(const char* in) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | static_cast<uint8_t>(in[i]);
+    return v;
+}
+
+// [u32 length][address][u8 flags][f64 balance][u64 nonce]
+void put_entry(std::string& out, const std::string& address, const AccountRecord& record) {
+    put_u32(out, static_cast<uint32_t>(address.size()));
+    out += address;
+    out.push_back(static_cast<char>((record.has_balance ? FLAG_BALANCE : 0) | (record.has_nonce ? FLAG_NONCE : 0)));
+    uint64_t bits;
+    std::memcpy(&bits, &record.balance, sizeof(bits));
+    put_u64(out, bits);
+    put_u64(out, record.nonce);
+}
+
+// Parses one entry at `pos`, advancing it; false on truncation
+bool get_entry(const std::string& in, size_t& pos, std::string& address, AccountRecord& record) {
+    if (in.size() - pos < 4) return false;
+    uint32_t length = get_u32(in.data() + pos);
+    if (in.size() - pos - 4 < static_cast<size_t>(length) + 17) return false;
+    address.assign(in, pos + 4, length);
+    const char* p = in.data() + pos + 4 + length;
+    uint8_t flags = static_cast<uint8_t>(p[0]);
+    record.has_balance = (flags & FLAG_BALANCE) != 0;
+    record.has_nonce = (flags & FLAG_NONCE) != 0;
+    uint64_t bits = get_u64(p + 1);
+    std::memcpy(&record.balance, &bits, sizeof(bits));
+    record.nonce = get_u64(p + 9);
+    pos += 4 + length + 17;
+    return true;
+}
+
+bool read_range(std::ifstream& in, uint64_t offset, uint64_t length, std::string& out) {
+    out.resize(length);
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(&out[0], static_cast<std::streamsize>(length));
+    return static_cast<bool>(in);
+}
+
+}  // namespace
+
+// ============= MEMORY STORE =============
+
+MemoryAccountStore::MemoryAccountStore(size_t expected_accounts) {
+    size_t capacity = 16;
+    while (capacity * 7 < expected_accounts * 10) {
+        capacity *= 2;
+    }
+    slots_.resize(capacity);
+}
+
+uint64_t MemoryAccountStore::hash_of(const std::string& address) {
+    uint64_t hash = fnv1a(address);
+    return hash == 0 ? 1 : hash;
+}
+
+size_t MemoryAccountStore::find(const std::string& address, uint64_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots_[i];
+        if (slot.hash == 0) {
+            return slots_.size();
+        }
+        if (slot.hash == hash && slot.address == address) {
+            return i;
+        }
+    }
+}
+
+bool MemoryAccountStore::get(const std::string& address, AccountRecord& record) const {
+    size_t index = find(address, hash_of(address));
+    if (index == slots_.size()) {
+        return false;
+    }
+    record = slots_[index].record;
+    return true;
+}
+
+void MemoryAccountStore::put(const std::string& address, const AccountRecord& record) {
+    uint64_t hash = hash_of(address);
+    size_t index = find(address, hash);
+    if (index != slots_.size()) {
+        with_balance_ -= slots_[index].record.has_balance ? 1 : 0;
+        if (record.empty()) {
+            erase_slot(index);
+            return;
+        }
+        slots_[index].record = record;
+        with_balance_ += record.has_balance ? 1 : 0;
+        return;
+    }
+    if (record.empty()) {
+        return;
+    }
+
+    if ((used_ + 1) * 10 > slots_.size() * 7) {
+        grow();
+    }
+    size_t mask = slots_.size() - 1;
+    index = hash & mask;
+    while (slots_[index].hash != 0) {
+        index = (index + 1) & mask;
+    }
+    slots_[index].hash = hash;
+    slots_[index].address = address;
+    slots_[index].record = record;
+    ++used_;
+    with_balance_ += record.has_balance ? 1 : 0;
+}
+
+void MemoryAccountStore::erase_slot(size_t index) {
+    // Shift later members of the probe run back so lookups never stop early
+    size_t mask = slots_.size() - 1;
+    size_t hole = index;
+    for (size_t next = (hole + 1) & mask; slots_[next].hash != 0; next = (next + 1) & mask) {
+        size_t home = slots_[next].hash & mask;
+        bool movable = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (movable) {
+            slots_[hole] = std::move(slots_[next]);
+            hole = next;
+        }
+    }
+    slots_[hole] = Slot();
+    --used_;
+}
+
+void MemoryAccountStore::grow() {
+    std::vector<Slot> old(slots_.size() * 2);
+    old.swap(slots_);
+    size_t mask = slots_.size() - 1;
+    for (auto& slot : old) {
+        if (slot.hash == 0) {
+            continue;
+        }
+        size_t index = slot.hash & mask;
+        while (slots_[index].hash != 0) {
+            index = (index + 1) & mask;
+        }
+        slots_[index] = std::move(slot);
+    }
+}
+
+void MemoryAccountStore::write(const AccountBatch& batch) {
+    for (const auto& [address, record] : batch) {
+        put(address, record);
+    }
+}
+
+void MemoryAccountStore::for_each(const Visitor& visit) const {
+    for (const auto& slot : slots_) {
+        if (slot.hash != 0) {
+            visit(slot.address, slot.record);
+        }
+    }
+}
+
+void MemoryAccountStore::clear() {
+    slots_.assign(16, Slot());
+    used_ = 0;
+    with_balance_ = 0;
+}
+
+// ============= DISK STORE: RUNS =============
+
+struct DiskAccountStore::Run {
+    uint64_t id = 0;
+    std::string path;
+    uint64_t entries = 0;
+    uint64_t data_end = 0;                                 // Entries occupy [0, data_end)
+    std::vector<std::pair<std::string, uint64_t>> index;  // Every INDEX_INTERVAL-th key and its offset
+    std::vector<uint8_t> bloom;
+    mutable std::ifstream in;
+
+    bool load() {
+        in.open(path, std::ios::binary);
+        if (!in) return false;
+        in.seekg(0, std::ios::end);
+        uint64_t size = static_cast<uint64_t>(in.tellg());
+        std::string footer;
+        if (size < RUN_FOOTER_SIZE || !read_range(in, size - RUN_FOOTER_SIZE, RUN_FOOTER_SIZE, footer) ||
+            get_u32(footer.data() + 24) != RUN_MAGIC) {
+            return false;
+        }
+        data_end = get_u64(footer.data());
+        uint64_t bloom_offset = get_u64(footer.data() + 8);
+        entries = get_u64(footer.data() + 16);
+        if (data_end > bloom_offset || bloom_offset > size - RUN_FOOTER_SIZE) {
+            return false;
+        }
+
+        std::string raw;
+        if (!read_range(in, data_end, bloom_offset - data_end, raw)) return false;
+        size_t pos = 0;
+        while (pos < raw.size()) {
+            if (raw.size() - pos < 4) return false;
+            uint32_t length = get_u32(raw.data() + pos);
+            if (raw.size() - pos - 4 < static_cast<size_t>(length) + 8) return false;
+            index.emplace_back(raw.substr(pos + 4, length), get_u64(raw.data() + pos + 4 + length));
+            pos += 4 + length + 8;
+        }
+        if (!read_range(in, bloom_offset, size - RUN_FOOTER_SIZE - bloom_offset, raw)) return false;
+        bloom.assign(raw.begin(), raw.end());
+        return !bloom.empty();
+    }
+
+    bool may_contain(const std::string& address) const {
+        uint64_t hash = fnv1a(address);
+        uint64_t step = (hash >> 33) | 1;
+        uint64_t bits = bloom.size() * 8;
+        for (unsigned i = 0; i < BLOOM_PROBES; ++i) {
+            uint64_t bit = (hash + i * step) % bits;
+            if (!(bloom[bit / 8] & (1u << (bit % 8)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // True if the run holds an entry (possibly empty) for the address
+    bool find(const std::string& address, AccountRecord& record) const {
+        if (index.empty() || !may_contain(address)) {
+            return false;
+        }
+        auto it = std::upper_bound(index.begin(), index.end(), address,
+            [](const std::string& key, const std::pair<std::string, uint64_t>& point) { return key < point.first; });
+        if (it == index.begin()) {
+            return false;
+        }
+        uint64_t begin = std::prev(it)->second;
+        uint64_t end = it == index.end() ? data_end : it->second;
+        std::string block;
+        if (!read_range(in, begin, end - begin, block)) {
+            LOG_ERROR("AccountStore", "Failed to read " + path);
+            return false;
+        }
+        size_t pos = 0;
+        std::string key;
+        while (get_entry(block, pos, key, record)) {
+            if (key == address) return true;
+            if (key > address) return false;
+        }
+        return false;
+    }
+};
+
+// Sequential reader over one run's entries
+class DiskAccountStore::RunCursor {
+public:
+    explicit RunCursor(const Run& run) : run_(run), in_(run.path, std::ios::binary) { advance(); }
+
+    bool valid() const { return valid_; }
+    const std::string& key() const { return key_; }
+    const AccountRecord& record() const { return record_; }
+
+    void advance() {
+        while (!(valid_ = get_entry(buffer_, pos_, key_, record_)) && offset_ < run_.data_end) {
+            refill();
+        }
+    }
+
+private:
+    const Run& run_;
+    std::ifstream in_;
+    std::string buffer_;
+    size_t pos_ = 0;
+    uint64_t offset_ = 0;  // File offset of the end of buffer_
+    bool valid_ = false;
+    std::string key_;
+    AccountRecord record_;
+
+    void refill() {
+        buffer_.erase(0, pos_);
+        pos_ = 0;
+        uint64_t chunk = std::min<uint64_t>(run_.data_end - offset_, 1 << 20);
+        std::string more;
+        if (!read_range(in_, offset_, chunk, more)) {
+            LOG_ERROR("AccountStore", "Failed to read " + run_.path);
+            offset_ = run_.data_end;
+            return;
+        }
+        buffer_ += more;
+        offset_ += chunk;
+    }
+};
+
+// ============= DISK STORE =============
+
+DiskAccountStore::DiskAccountStore(const std::string& directory, size_t cache_accounts, size_t memtable_limit)
+    : directory_(directory),
+      cache_capacity_(cache_accounts),
+      memtable_limit_(memtable_limit == 0 ? 1 : memtable_limit) {
+    open();
+}
+
+DiskAccountStore::~DiskAccountStore() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (wal_.is_open()) {
+        wal_.close();
+    }
+}
+
+std::string DiskAccountStore::path(const std::string& name) const {
+    return directory_ + "/" + name;
+}
+
+std::string DiskAccountStore::run_path(uint64_t id) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "run_%06llu.dat", static_cast<unsigned long long>(id));
+    return path(name);
+}
+
+void DiskAccountStore::open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::filesystem::create_directories(directory_);
+
+    std::vector<uint64_t> live;
+    std::ifstream manifest(path("MANIFEST"));
+    if (manifest) {
+        json j = json::parse(manifest);
+        live = j.at("runs").get<std::vector<uint64_t>>();
+        next_run_ = j.at("next_run").get<uint64_t>();
+        with_balance_ = j.at("accounts").get<size_t>();
+    }
+    for (uint64_t id : live) {
+        auto run = std::make_unique<Run>();
+        run->id = id;
+        run->path = run_path(id);
+        if (!run->load()) {
+            throw std::runtime_error("Account store run is missing or corrupt: " + run->path);
+        }
+        runs_.push_back(std::move(run));
+    }
+
+    // Runs written by a flush or compaction that never reached the manifest
+    for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+        std::string name = entry.path().filename().string();
+        bool is_run = name.rfind("run_", 0) == 0;
+        bool listed = std::any_of(runs_.begin(), runs_.end(),
+                                  [&](const std::unique_ptr<Run>& run) { return run->path == entry.path().string(); });
+        if (is_run && !listed) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+
+    replay_wal();
+}
+
+void DiskAccountStore::replay_wal() {
+    std::string wal_path = path("wal.log");
+    std::string contents;
+    {
+        std::ifstream in(wal_path, std::ios::binary);
+        if (in) {
+            contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+    }
+
+    size_t pos = 0;
+    size_t batches = 0;
+    while (contents.size() - pos >= WAL_HEADER_SIZE) {
+        uint32_t length = get_u32(contents.data() + pos);
+        uint32_t crc = get_u32(contents.data() + pos + 4);
+        if (contents.size() - pos - WAL_HEADER_SIZE < length) break;
+        std::string payload = contents.substr(pos + WAL_HEADER_SIZE, length);
+        if (crc32(reinterpret_cast<const uint8_t*>(payload.data()), payload.size()) != crc) break;
+
+        AccountBatch batch;
+        size_t at = 0;
+        std::string address;
+        AccountRecord record;
+        while (get_entry(payload, at, address, record)) {
+            batch.emplace_back(address, record);
+        }
+        apply(batch);
+        pos += WAL_HEADER_SIZE + length;
+        ++batches;
+    }
+
+    wal_.open(wal_path, std::ios::binary | std::ios::app);
+    if (batches > 0) {
+        LOG_INFO("AccountStore", "Replayed " + std::to_string(batches) + " batches from " + wal_path);
+    }
+    // A torn tail would hide every later append from the next replay; start a clean log
+    if (pos != contents.size() || memtable_.size() >= memtable_limit_) {
+        if (pos != contents.size()) {
+            LOG_WARN("AccountStore", "Discarding torn tail of " + wal_path);
+        }
+        flush_memtable();
+    }
+}
+
+bool DiskAccountStore::save_manifest() const {
+    json j;
+    j["runs"] = json::array();
+    for (const auto& run : runs_) {
+        j["runs"].push_back(run->id);
+    }
+    j["next_run"] = next_run_;
+    j["accounts"] = with_balance_;
+
+    std::string tmp = path("MANIFEST.tmp");
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << j.dump();
+        out.close();
+        if (!out || !sync_path(tmp)) {
+            LOG_ERROR("AccountStore", "Failed to write " + tmp);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp, path("MANIFEST"), error);
+    if (error || !sync_path(directory_)) {
+        LOG_ERROR("AccountStore", "Failed to replace " + path("MANIFEST"));
+        return false;
+    }
+    return true;
+}
+
+bool DiskAccountStore::get(const std::string& address, AccountRecord& record) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lookup(address, record);
+}
+
+bool DiskAccountStore::lookup(const std::string& address, AccountRecord& record) const {
+    auto pending = memtable_.find(address);
+    if (pending != memtable_.end()) {
+        record = pending->second;
+        return !record.empty();
+    }
+    auto cached = cache_.find(address);
+    if (cached != cache_.end()) {
+        lru_.splice(lru_.begin(), lru_, cached->second);
+        record = cached->second->second;
+        return !record.empty();
+    }
+    if (!lookup_runs(address, record)) {
+        record = AccountRecord();
+    }
+    remember(address, record);  // Misses too, so new accounts skip the runs next time
+    return !record.empty();
+}
+
+bool DiskAccountStore::lookup_runs(const std::string& address, AccountRecord& record) const {
+    for (auto it = runs_.rbegin(); it != runs_.rend(); ++it) {
+        if ((*it)->find(address, record)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DiskAccountStore::remember(const std::string& address, const AccountRecord& record) const {
+    if (cache_capacity_ == 0) {
+        return;
+    }
+    lru_.emplace_front(address, record);
+    cache_[address] = lru_.begin();
+    if (lru_.size() > cache_capacity_) {
+        cache_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+void DiskAccountStore::apply(const AccountBatch& batch) {
+    for (const auto& [address, record] : batch) {
+        AccountRecord previous;
+        lookup(address, previous);
+        with_balance_ -= previous.has_balance ? 1 : 0;
+        with_balance_ += record.has_balance ? 1 : 0;
+
+        auto cached = cache_.find(address);
+        if (cached != cache_.end()) {
+            lru_.erase(cached->second);
+            cache_.erase(cached);
+        }
+        if (record.empty() && runs_.empty()) {
+            memtable_.erase(address);
+        } else {
+            memtable_[address] = record;
+        }
+    }
+}
+
+void DiskAccountStore::write(const AccountBatch& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    std::string payload;
+    for (const auto& [address, record] : batch) {
+        put_entry(payload, address, record);
+    }
+    std::string header;
+    put_u32(header, static_cast<uint32_t>(payload.size()));
+    put_u32(header, crc32(reinterpret_cast<const uint8_t*>(payload.data()), payload.size()));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    wal_.write(header.data(), header.size());
+    wal_.write(payload.data(), payload.size());
+    wal_.flush();
+    if (!wal_ || (sync_writes_ && !sync_path(path("wal.log")))) {
+        LOG_ERROR("AccountStore", "Failed to append to " + path("wal.log"));
+    }
+    apply(batch);
+    if (memtable_.size() >= memtable_limit_) {
+        flush_memtable();
+    }
+}
+
+bool DiskAccountStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wal_.flush();
+    return static_cast<bool>(wal_);
+}
+
+void DiskAccountStore::set_sync_writes(bool sync) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sync_writes_ = sync;
+}
+
+std::unique_ptr<DiskAccountStore::Run> DiskAccountStore::write_run(
+    uint64_t id, size_t expected, const std::function<void(const Visitor&)>& produce) const {
+    auto run = std::make_unique<Run>();
+    run->id = id;
+    run->path = run_path(id);
+    std::string tmp = run->path + ".tmp";
+
+    std::vector<uint8_t> bloom(std::max<size_t>(8, (expected * BLOOM_BITS_PER_KEY + 7) / 8));
+    std::string index;
+    uint64_t offset = 0;
+    uint64_t entries = 0;
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    std::string buffer;
+    produce([&](const std::string& address, const AccountRecord& record) {
+        if (entries % INDEX_INTERVAL == 0) {
+            put_u32(index, static_cast<uint32_t>(address.size()));
+            index += address;
+            put_u64(index, offset + buffer.size());
+        }
+        uint64_t hash = fnv1a(address);
+        uint64_t step = (hash >> 33) | 1;
+        for (unsigned i = 0; i < BLOOM_PROBES; ++i) {
+            uint64_t bit = (hash + i * step) % (bloom.size() * 8);
+            bloom[bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+        }
+        put_entry(buffer, address, record);
+        ++entries;
+        if (buffer.size() >= (1 << 20)) {
+            out.write(buffer.data(), buffer.size());
+            offset += buffer.size();
+            buffer.clear();
+        }
+    });
+    out.write(buffer.data(), buffer.size());
+    offset += buffer.size();
+
+    std::string footer;
+    put_u64(footer, offset);
+    put_u64(footer, offset + index.size());
+    put_u64(footer, entries);
+    put_u32(footer, RUN_MAGIC);
+    out.write(index.data(), index.size());
+    out.write(reinterpret_cast<const char*>(bloom.data()), bloom.size());
+    out.write(footer.data(), footer.size());
+    out.close();
+
+    // On disk before the MANIFEST can name it
+    std::error_code error;
+    bool written = out && sync_path(tmp);
+    if (written) {
+        std::filesystem::rename(tmp, run->path, error);
+    }
+    if (!written || error || !run->load()) {
+        LOG_ERROR("AccountStore", "Failed to write " + run->path);
+        std::filesystem::remove(tmp, error);
+        return nullptr;
+    }
+    return run;
+}
+
+bool DiskAccountStore::flush_memtable() {
+    if (!memtable_.empty()) {
+        // Removals only matter while an older run may still hold the account
+        bool keep_removals = !runs_.empty();
+        auto run = write_run(next_run_, memtable_.size(), [&](const Visitor& emit) {
+            for (const auto& [address, record] : memtable_) {
+                if (keep_removals || !record.empty()) {
+                    emit(address, record);
+                }
+            }
+        });
+        if (!run) {
+            return false;  // Keep the log; the table is replayed on the next open
+        }
+        ++next_run_;
+        runs_.push_back(std::move(run));
+    }
+    if (!save_manifest()) {
+        return false;
+    }
+    memtable_.clear();
+    wal_.close();
+    wal_.open(path("wal.log"), std::ios::binary | std::ios::trunc);
+
+    if (runs_.size() > MAX_RUNS) {
+        return compact();
+    }
+    return true;
+}
+
+bool DiskAccountStore::compact() {
+    std::vector<const Run*> all;
+    size_t expected = 0;
+    for (const auto& run : runs_) {
+        all.push_back(run.get());
+        expected += run->entries;
+    }
+    auto merged = write_run(next_run_, expected, [&](const Visitor& emit) {
+        merge(all, false, [&](const std::string& address, const AccountRecord& record) {
+            if (!record.empty()) {
+                emit(address, record);
+            }
+        });
+    });
+    if (!merged) {
+        return false;
+    }
+    ++next_run_;
+
+    std::vector<std::unique_ptr<Run>> old;
+    old.swap(runs_);
+    runs_.push_back(std::move(merged));
+    if (!save_manifest()) {
+        return false;
+    }
+    for (const auto& run : old) {
+        std::error_code error;
+        run->in.close();
+        std::filesystem::remove(run->path, error);
+    }
+    LOG_DEBUG("AccountStore", "Compacted " + std::to_string(old.size()) + " runs into " + runs_.back()->path);
+    return true;
+}
+
+void DiskAccountStore::merge(const std::vector<const Run*>& runs, bool include_memtable,
+                             const Visitor& visit) const {
+    std::vector<std::unique_ptr<RunCursor>> cursors;  // Oldest first, like runs_
+    for (const Run* run : runs) {
+        cursors.push_back(std::make_unique<RunCursor>(*run));
+    }
+    auto pending = memtable_.begin();
+    bool use_memtable = include_memtable;
+
+    while (true) {
+        const std::string* smallest = nullptr;
+        for (const auto& cursor : cursors) {
+            if (cursor->valid() && (!smallest || cursor->key() < *smallest)) {
+                smallest = &cursor->key();
+            }
+        }
+        if (use_memtable && pending != memtable_.end() && (!smallest || pending->first < *smallest)) {
+            smallest = &pending->first;
+        }
+        if (!smallest) {
+            break;
+        }
+
+        // The newest source holding the key wins
+        std::string address = *smallest;
+        AccountRecord record;
+        bool found = false;
+        if (use_memtable && pending != memtable_.end() && pending->first == address) {
+            record = pending->second;
+            found = true;
+            ++pending;
+        }
+        for (auto it = cursors.rbegin(); it != cursors.rend(); ++it) {
+            if ((*it)->valid() && (*it)->key() == address) {
+                if (!found) {
+                    record = (*it)->record();
+                    found = true;
+                }
+                (*it)->advance();
+            }
+        }
+        visit(address, record);
+    }
+}
+
+void DiskAccountStore::for_each(const Visitor& visit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<const Run*> all;
+    for (const auto& run : runs_) {
+        all.push_back(run.get());
+    }
+    merge(all, true, [&](const std::string& address, const AccountRecord& record) {
+        if (!record.empty()) {
+            visit(address, record);
+        }
+    });
+}
+
+size_t DiskAccountStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return with_balance_;
+}
+
+size_t DiskAccountStore::run_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return runs_.size();
+}
+
+void DiskAccountStore::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& run : runs_) {
+        std::error_code error;
+        run->in.close();
+        std::filesystem::remove(run->path, error);
+    }
+    runs_.clear();
+    memtable_.clear();
+    lru_.clear();
+    cache_.clear();
+    with_balance_ = 0;
+    save_manifest();
+    wal_.close();
+    wal_.open(path("wal.log"), std::ios::binary | std::ios::trunc);
+}
@@ -0,0 +1,178 @@
+#ifndef ACCOUNT_STORE_HPP
+#define ACCOUNT_STORE_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Balance and nonce of one account; either may be absent
+struct AccountRecord {
+    double balance = 0.0;
+    uint64_t nonce = 0;         // Last nonce the account used
+    bool has_balance = false;   // The account exists
+    bool has_nonce = false;     // The account has sent at least one transaction
+
+    bool empty() const { return !has_balance && !has_nonce; }
+};
+
+// Upserts applied together; an empty record removes the account
+using AccountBatch = std::vector<std::pair<std::string, AccountRecord>>;
+
+/**
+ * AccountStore - Backend holding every account's balance and nonce
+ *
+ * Blockchain reads single accounts while validating and executing, writes
+ * one batch per block (or contract call), and walks every account only to
+ * rebuild derived state after a load or a snapshot install.
+ *
+ *   MemoryAccountStore  flat open-addressing hash table (the default)
+ *   DiskAccountStore    log-structured merge tree on disk, behind a bounded
+ *                       LRU cache of hot accounts
+ *
+ * All access happens under Blockchain's chain_mutex. get() may be called
+ * from several threads at once (parallel block execution); write(),
+ * clear() and for_each() never overlap anything else. Mempool admission
+ * reads the published ChainSnapshot instead.
+ */
+class AccountStore {
+public:
+    using Visitor = std::function<void(const std::string& address, const AccountRecord& record)>;
+
+    virtual ~AccountStore() = default;
+
+    // False if the account has neither a balance nor a nonce
+    virtual bool get(const std::string& address, AccountRecord& record) const = 0;
+    virtual void write(const AccountBatch& batch) = 0;
+    // Every stored account, in no particular order
+    virtual void for_each(const Visitor& visit) const = 0;
+    virtual size_t size() const = 0;  // Accounts with a balance
+    virtual void clear() = 0;
+
+    // Durable stores keep their own files and need no state.json copy
+    virtual bool durable() const { return false; }
+    virtual bool flush() { return true; }
+    // Have each write() reach stable storage before returning (PersistDurability::FSYNC_BATCH)
+    virtual void set_sync_writes(bool) {}
+};
+
+class MemoryAccountStore : public AccountStore {
+public:
+    explicit MemoryAccountStore(size_t expected_accounts = 0);
+
+    bool get(const std::string& address, AccountRecord& record) const override;
+    void write(const AccountBatch& batch) override;
+    void for_each(const Visitor& visit) const override;
+    size_t size() const override { return with_balance_; }
+    void clear() override;
+
+private:
+    // One cache line per slot: probing compares hashes before touching keys
+    struct Slot {
+        uint64_t hash = 0;  // 0 marks an empty slot
+        std::string address;
+        AccountRecord record;
+    };
+
+    std::vector<Slot> slots_;  // Power-of-two size; linear probing, backward-shift deletion
+    size_t used_ = 0;
+    size_t with_balance_ = 0;
+
+    static uint64_t hash_of(const std::string& address);
+    size_t find(const std::string& address, uint64_t hash) const;  // Slot index, or slots_.size()
+    void put(const std::string& address, const AccountRecord& record);
+    void erase_slot(size_t index);
+    void grow();
+};
+
+/**
+ * DiskAccountStore - Account state that does not have to fit in memory
+ *
+ * Layout on disk (inside `directory`):
+ *   MANIFEST          live runs and the account count, replaced atomically
+ *   wal.log           batches since the last flush, [u32 length][u32 crc32][payload]
+ *   run_000001.dat    immutable sorted runs: entries, sparse index, bloom filter, footer
+ *
+ * Writes go to the write-ahead log and an in-memory table. When the table
+ * reaches memtable_limit accounts it is written out as a new run; once
+ * there are more than MAX_RUNS runs they are merged into one. Runs and the
+ * MANIFEST are fsynced (with the directory) before the log is emptied, so a
+ * listed run is always on disk; log appends are fsynced only with
+ * set_sync_writes(). A lookup
+ * checks the table, then the LRU cache, then the runs newest first; each
+ * run costs a bloom probe and at most one read of INDEX_INTERVAL entries.
+ */
+class DiskAccountStore : public AccountStore {
+public:
+    static constexpr size_t DEFAULT_CACHE_ACCOUNTS = 65536;
+    static constexpr size_t DEFAULT_MEMTABLE_ACCOUNTS = 65536;
+    static constexpr size_t MAX_RUNS = 4;
+    static constexpr size_t INDEX_INTERVAL = 64;  // Entries per sparse index point
+
+    explicit DiskAccountStore(const std::string& directory,
+                              size_t cache_accounts = DEFAULT_CACHE_ACCOUNTS,
+                              size_t memtable_limit = DEFAULT_MEMTABLE_ACCOUNTS);
+    ~DiskAccountStore() override;
+
+    DiskAccountStore(const DiskAccountStore&) = delete;
+    DiskAccountStore& operator=(const DiskAccountStore&) = delete;
+
+    bool get(const std::string& address, AccountRecord& record) const override;
+    void write(const AccountBatch& batch) override;
+    void for_each(const Visitor& visit) const override;
+    size_t size() const override;
+    void clear() override;
+
+    bool durable() const override { return true; }
+    bool flush() override;  // Pushes the log to the OS; the table stays in memory
+    void set_sync_writes(bool sync) override;
+
+    size_t run_count() const;
+
+private:
+    struct Run;
+    class RunCursor;
+
+    std::string directory_;
+    size_t cache_capacity_;
+    size_t memtable_limit_;
+
+    std::map<std::string, AccountRecord> memtable_;  // Newest values, empty records included
+    std::vector<std::unique_ptr<Run>> runs_;         // Oldest first
+    uint64_t next_run_ = 1;
+    size_t with_balance_ = 0;
+    std::ofstream wal_;
+    bool sync_writes_ = false;  // fsync the log after every write()
+
+    // Hot accounts read from the runs; never holds a key that is in memtable_
+    mutable std::list<std::pair<std::string, AccountRecord>> lru_;
+    mutable std::unordered_map<std::string, std::list<std::pair<std::string, AccountRecord>>::iterator> cache_;
+    mutable std::mutex mutex_;
+
+    std::string path(const std::string& name) const;
+    std::string run_path(uint64_t id) const;
+    void open();
+    void replay_wal();
+    bool save_manifest() const;
+
+    bool lookup(const std::string& address, AccountRecord& record) const;  // Caller holds mutex_
+    bool lookup_runs(const std::string& address, AccountRecord& record) const;
+    void remember(const std::string& address, const AccountRecord& record) const;
+    void apply(const AccountBatch& batch);
+
+    bool flush_memtable();
+    bool compact();
+    // `produce` emits the run's entries in address order
+    std::unique_ptr<Run> write_run(uint64_t id, size_t expected, const std::function<void(const Visitor&)>& produce) const;
+    // Entries of `runs` (and the table) in address order, newest version only, removals included
+    void merge(const std::vector<const Run*>& runs, bool include_memtable, const Visitor& visit) const;
+};
+
+#endif // ACCOUNT_STORE_HPP
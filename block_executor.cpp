@@ -0,0 +1,149 @@
+#include "block_executor.hpp"
+#include <unordered_map>
+
+// ============= View =============
+
+BlockExecutor::Value* BlockExecutor::View::find_write(const Key& key) {
+    for (auto& [written, value] : writes_) {
+        if (written == key) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
+
+BlockExecutor::Value BlockExecutor::View::read(const Key& key, const std::string& account) {
+    // Read-your-writes inside one transaction; nothing to validate then
+    if (Value* own = find_write(key)) {
+        return *own;
+    }
+    reads_.push_back(key);
+    if (committed_) {
+        auto it = committed_->find(key);
+        if (it != committed_->end()) {
+            return it->second;
+        }
+    }
+    return executor_->read_base(key.field, account);
+}
+
+void BlockExecutor::View::write(const Key& key, Value value) {
+    if (Value* own = find_write(key)) {
+        *own = value;
+    } else {
+        writes_.emplace_back(key, value);
+    }
+}
+
+void BlockExecutor::View::reset(const CommittedMap* committed) {
+    committed_ = committed;
+    reads_.clear();
+    writes_.clear();
+}
+
+double BlockExecutor::View::get_balance(const std::string& account) {
+    return read(Key{Field::BALANCE, account}, account).balance;
+}
+
+void BlockExecutor::View::set_balance(const std::string& account, double balance) {
+    Value value;
+    value.balance = balance;
+    write(Key{Field::BALANCE, account}, value);
+}
+
+void BlockExecutor::View::set_nonce(const std::string& account, uint64_t nonce) {
+    Value value;
+    value.nonce = nonce;
+    write(Key{Field::NONCE, account}, value);
+}
+
+// ============= BlockExecutor =============
+
+BlockExecutor::Value BlockExecutor::read_base(Field field, const std::string& account) const {
+    Value value;
+    AccountRecord record;
+    accounts_.get(account, record);
+    if (field == Field::BALANCE) {
+        value.balance = record.has_balance ? record.balance : 0.0;
+    } else {
+        value.nonce = record.has_nonce ? record.nonce : 0;
+    }
+    return value;
+}
+
+void BlockExecutor::commit(const View& view) {
+    for (const auto& [key, value] : view.writes_) {
+        auto [it, inserted] = committed_.emplace(key, value);
+        if (inserted) {
+            write_order_.push_back(key);
+        } else {
+            it->second = value;
+        }
+    }
+}
+
+BlockExecutor::Stats BlockExecutor::run(size_t count, const Task& task, ThreadPool& pool, size_t min_chunk) {
+    Stats stats;
+    committed_.clear();
+    write_order_.clear();
+    if (count == 0) {
+        return stats;
+    }
+
+    // Speculative pass: everything reads the pre-block state
+    std::pmr::vector<View> views(resource_);
+    views.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        views.emplace_back(resource_);
+    }
+    pool.parallel_for(count, [&](size_t i) {
+        views[i].executor_ = this;
+        task(i, views[i]);
+    }, min_chunk);
+    stats.executed = count;
+
+    // Commit in block order; a read of anything already committed is stale
+    for (size_t i = 0; i < count; ++i) {
+        View& view = views[i];
+        bool conflict = false;
+        for (const auto& key : view.reads_) {
+            if (committed_.count(key)) {
+                conflict = true;
+                break;
+            }
+        }
+        if (conflict) {
+            view.reset(&committed_);
+            task(i, view);
+            ++stats.executed;
+            ++stats.reexecuted;
+        }
+        commit(view);
+    }
+    return stats;
+}
+
+void BlockExecutor::apply(AccountStore& accounts, std::vector<std::string>& touched) const {
+    // Both fields of an account land in one record, on top of what the store holds
+    AccountBatch batch;
+    std::pmr::unordered_map<std::string_view, size_t> position(resource_);
+    for (const auto& key : write_order_) {
+        auto [it, inserted] = position.emplace(key.account, batch.size());
+        if (inserted) {
+            AccountRecord record;
+            accounts.get(std::string(key.account), record);
+            batch.emplace_back(std::string(key.account), record);
+            touched.emplace_back(key.account);
+        }
+        AccountRecord& record = batch[it->second].second;
+        const Value& value = committed_.at(key);
+        if (key.field == Field::BALANCE) {
+            record.balance = value.balance;
+            record.has_balance = true;
+        } else {
+            record.nonce = value.nonce;
+            record.has_nonce = true;
+        }
+    }
+    accounts.write(batch);
+}
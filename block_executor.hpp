@@ -0,0 +1,106 @@
+#ifndef BLOCK_EXECUTOR_HPP
+#define BLOCK_EXECUTOR_HPP
+
+#include "account_store.hpp"
+#include "utils/thread_pool.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * BlockExecutor - Optimistic parallel execution of a block's state transitions
+ *
+ * Every transaction first runs speculatively on the worker pool against the
+ * pre-block state, recording the keys it read and the values it wrote. Then
+ * the transactions are committed one by one in block order. A transaction
+ * whose reads do not overlap anything an earlier transaction wrote saw the
+ * same state serial execution would have shown it, so its writes are kept.
+ * Any other transaction is re-executed against the committed state. The final
+ * state therefore matches serial execution bit for bit, and only conflicting
+ * transactions pay for a second run.
+ *
+ * Account strings are referenced, not copied: they must outlive run() and apply().
+ * Read/write sets and the committed map live in the resource passed to the
+ * constructor (the block arena), and must not outlive it either.
+ */
+class BlockExecutor {
+public:
+    enum class Field : uint8_t { BALANCE, NONCE };
+
+    struct Key {
+        Field field;
+        std::string_view account;
+
+        bool operator==(const Key& other) const {
+            return field == other.field && account == other.account;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<std::string_view>()(key.account) * 2 + static_cast<size_t>(key.field);
+        }
+    };
+
+    union Value {
+        double balance;
+        uint64_t nonce;
+    };
+
+    using CommittedMap = std::pmr::unordered_map<Key, Value, KeyHash>;
+
+    // What a transaction sees while it executes
+    class View {
+    public:
+        explicit View(std::pmr::memory_resource* resource) : reads_(resource), writes_(resource) {}
+
+        double get_balance(const std::string& account);
+        void set_balance(const std::string& account, double balance);
+        void set_nonce(const std::string& account, uint64_t nonce);
+
+    private:
+        friend class BlockExecutor;
+
+        const BlockExecutor* executor_ = nullptr;
+        const CommittedMap* committed_ = nullptr;  // Set on re-execution
+        std::pmr::vector<Key> reads_;
+        std::pmr::vector<std::pair<Key, Value>> writes_;
+
+        Value* find_write(const Key& key);
+        Value read(const Key& key, const std::string& account);
+        void write(const Key& key, Value value);
+        void reset(const CommittedMap* committed);
+    };
+
+    using Task = std::function<void(size_t index, View& view)>;
+
+    struct Stats {
+        size_t executed = 0;     // Transactions run
+        size_t reexecuted = 0;   // Transactions that conflicted and ran a second time
+    };
+
+    explicit BlockExecutor(const AccountStore& accounts,
+                           std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : accounts_(accounts), resource_(resource), committed_(resource), write_order_(resource) {}
+
+    // Execute `count` transactions; small blocks run inline on the caller
+    Stats run(size_t count, const Task& task, ThreadPool& pool, size_t min_chunk);
+
+    // Write the committed state back as one batch; `touched` receives every written account once
+    void apply(AccountStore& accounts, std::vector<std::string>& touched) const;
+
+private:
+    const AccountStore& accounts_;
+    std::pmr::memory_resource* resource_;
+    CommittedMap committed_;
+    std::pmr::vector<Key> write_order_;  // Committed keys in first-write order
+
+    Value read_base(Field field, const std::string& account) const;
+    void commit(const View& view);
+};
+
+#endif // BLOCK_EXECUTOR_HPP
@@ -0,0 +1,609 @@
+#include "block_log.hpp"
+#include "utils/logger.hpp"
+#include "utils/crc32.hpp"
+#include "utils/metrics.hpp"
+#include "utils/file_sync.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+constexpr size_t RECORD_HEADER_SIZE = 8;   // u32 length + u32 crc32
+constexpr size_t INDEX_ENTRY_SIZE = 16;    // u32 segment + u32 length + u64 offset
+
+void put_u32(uint8_t* out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+void put_u64(uint8_t* out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint32_t get_u32(const uint8_t* in) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(in[i]) << (8 * i);
+    return v;
+}
+
+uint64_t get_u64(const uint8_t* in) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(in[i]) << (8 * i);
+    return v;
+}
+
+uint64_t file_size(const std::string& path) {
+    struct stat st = {};
+    if (stat(path.c_str(), &st) != 0) return 0;
+    return static_cast<uint64_t>(st.st_size);
+}
+
+// Replace `path` with a copy of its first `length` bytes. Readers may still map
+// the old file, which stays intact until they drop it; shrinking it in place
+// would fault their reads past the new end.
+bool replace_with_prefix(const std::string& path, uint64_t length, const std::string& directory) {
+    std::string temp_path = path + ".tmp";
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        std::vector<char> buffer(1 << 20);
+        uint64_t left = length;
+        while (left > 0 && in && out) {
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(left, buffer.size()));
+            in.read(buffer.data(), chunk);
+            out.write(buffer.data(), in.gcount());
+            left -= static_cast<uint64_t>(in.gcount());
+        }
+        out.flush();
+        if (left > 0 || !out) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    return sync_path(temp_path) && std::rename(temp_path.c_str(), path.c_str()) == 0 && sync_path(directory);
+}
+
+} // namespace
+
+// Read-only view of one segment as it was when mapped; readers keep it alive
+struct BlockLog::Mapping {
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+
+    ~Mapping() {
+        if (data) munmap(const_cast<uint8_t*>(data), length);
+    }
+};
+
+BlockLog::BlockLog(const std::string& directory, uint64_t max_segment_size)
+    : directory_(directory), max_segment_size_(max_segment_size) {
+    index_file_ = directory_ + "/blocks.idx";
+    load_index();
+    open_writers();
+}
+
+BlockLog::~BlockLog() {
+    close_writers();
+}
+
+std::string BlockLog::segment_path(uint32_t segment) const {
+    char name[32];
+    if (segment & PRUNED_SEGMENT) {
+        std::snprintf(name, sizeof(name), "/pruned_%06u.seg", segment & ~PRUNED_SEGMENT);
+    } else {
+        std::snprintf(name, sizeof(name), "/blocks_%06u.seg", segment);
+    }
+    return directory_ + name;
+}
+
+void BlockLog::resume_after_last_record() {
+    active_segment_ = 0;
+    active_size_ = 0;
+    if (index_.empty()) {
+        return;
+    }
+    const IndexEntry& last = index_.back();
+    if (last.segment & PRUNED_SEGMENT) {
+        // Rewritten segments are never appended to; continue in the next plain one
+        active_segment_ = (last.segment & ~PRUNED_SEGMENT) + 1;
+    } else {
+        active_segment_ = last.segment;
+        active_size_ = last.offset + RECORD_HEADER_SIZE + last.length;
+    }
+}
+
+void BlockLog::load_index() {
+    index_.clear();
+    active_segment_ = 0;
+    active_size_ = 0;
+    payload_total_ = 0;
+
+    uint64_t idx_size = file_size(index_file_);
+    size_t entries = idx_size / INDEX_ENTRY_SIZE;
+
+    if (entries > 0) {
+        std::ifstream in(index_file_, std::ios::binary);
+        std::vector<uint8_t> raw(entries * INDEX_ENTRY_SIZE);
+        in.read(reinterpret_cast<char*>(raw.data()), raw.size());
+        entries = static_cast<size_t>(in.gcount()) / INDEX_ENTRY_SIZE;
+
+        index_.reserve(entries);
+        for (size_t i = 0; i < entries; ++i) {
+            const uint8_t* p = raw.data() + i * INDEX_ENTRY_SIZE;
+            index_.push_back({get_u32(p), get_u32(p + 4), get_u64(p + 8)});
+        }
+    }
+
+    // Drop index entries whose record did not fully reach the segment (torn write)
+    size_t valid = index_.size();
+    while (valid > 0) {
+        const IndexEntry& e = index_[valid - 1];
+        if (file_size(segment_path(e.segment)) >= e.offset + RECORD_HEADER_SIZE + e.length) {
+            break;
+        }
+        --valid;
+    }
+    if (valid != index_.size()) {
+        LOG_WARN("BlockLog", "Discarding " + std::to_string(index_.size() - valid) +
+                 " torn index entries");
+        index_.resize(valid);
+    }
+
+    uint32_t previous_segment = UINT32_MAX;
+    for (const auto& entry : index_) {
+        payload_total_ += entry.length;
+        if ((entry.segment & PRUNED_SEGMENT) && entry.segment != previous_segment) {
+            // A crash after the index switched to the rewrite can leave the original behind
+            std::remove(segment_path(entry.segment & ~PRUNED_SEGMENT).c_str());
+        }
+        previous_segment = entry.segment;
+    }
+    resume_after_last_record();
+
+    // Keep both files aligned with the last complete record so appends start cleanly
+    if (file_size(index_file_) != index_.size() * INDEX_ENTRY_SIZE && file_size(index_file_) > 0) {
+        if (::truncate(index_file_.c_str(), index_.size() * INDEX_ENTRY_SIZE) != 0) {
+            LOG_WARN("BlockLog", "Failed to truncate index file: " + index_file_);
+        }
+    }
+    std::string active_path = segment_path(active_segment_);
+    if (file_size(active_path) > active_size_) {
+        if (::truncate(active_path.c_str(), active_size_) != 0) {
+            LOG_WARN("BlockLog", "Failed to truncate segment: " + active_path);
+        }
+    }
+    // A crash just after a rollover leaves records no index entry points at
+    for (uint32_t s = active_segment_ + 1; ::access(segment_path(s).c_str(), F_OK) == 0; ++s) {
+        LOG_WARN("BlockLog", "Removing unindexed segment: " + segment_path(s));
+        std::remove(segment_path(s).c_str());
+    }
+
+    LOG_DEBUG("BlockLog", "Opened block log with " + std::to_string(index_.size()) + " records");
+}
+
+bool BlockLog::open_writers() {
+    close_writers();
+    segment_out_.open(segment_path(active_segment_), std::ios::binary | std::ios::app);
+    index_out_.open(index_file_, std::ios::binary | std::ios::app);
+    return segment_out_.is_open() && index_out_.is_open();
+}
+
+void BlockLog::close_writers() {
+    if (segment_out_.is_open()) segment_out_.close();
+    if (index_out_.is_open()) index_out_.close();
+}
+
+bool BlockLog::append(const std::vector<uint8_t>& payload) {
+    static metrics::Histogram& latency = metrics::histogram("storage_write_seconds",
+        "Latency of durable writes", {{"kind", "block"}});
+    metrics::ScopedTimer timer(latency);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return append_records({&payload}, false);
+}
+
+bool BlockLog::append_batch(const std::vector<std::vector<uint8_t>>& payloads, bool sync) {
+    static metrics::Histogram& latency = metrics::histogram("storage_write_seconds",
+        "Latency of durable writes", {{"kind", "block_batch"}});
+    metrics::ScopedTimer timer(latency);
+    std::vector<const std::vector<uint8_t>*> records;
+    records.reserve(payloads.size());
+    for (const auto& payload : payloads) {
+        records.push_back(&payload);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return append_records(records, sync);
+}
+
+bool BlockLog::append_records(const std::vector<const std::vector<uint8_t>*>& payloads, bool sync) {
+    if (!segment_out_.is_open() || !index_out_.is_open()) {
+        LOG_ERROR("BlockLog", "Block log is not writable");
+        return false;
+    }
+
+    // Records go out (and with `sync` reach the disk) before their index entries,
+    // so a crash never indexes a partial record
+    std::vector<IndexEntry> entries;
+    entries.reserve(payloads.size());
+    uint32_t segment = active_segment_;
+    uint64_t size = active_size_;
+    for (const auto* payload : payloads) {
+        uint64_t record_size = RECORD_HEADER_SIZE + payload->size();
+        if (size > 0 && size + record_size > max_segment_size_) {
+            // Roll over to a fresh segment
+            segment_out_.flush();
+            if (!segment_out_ || (sync && !sync_path(segment_path(segment)))) {
+                active_size_ = size;
+                LOG_ERROR("BlockLog", "Failed to write records to segment " + std::to_string(segment));
+                return false;
+            }
+            segment_out_.close();
+            active_segment_ = ++segment;
+            active_size_ = size = 0;
+            // Nothing indexed lives past the active segment, so any bytes found there are stale
+            segment_out_.open(segment_path(segment), std::ios::binary | std::ios::trunc);
+            if (!segment_out_.is_open()) {
+                LOG_ERROR("BlockLog", "Failed to open new segment: " + segment_path(segment));
+                return false;
+            }
+        }
+
+        uint8_t header[RECORD_HEADER_SIZE];
+        put_u32(header, static_cast<uint32_t>(payload->size()));
+        put_u32(header + 4, crc32(payload->data(), payload->size()));
+        segment_out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+        segment_out_.write(reinterpret_cast<const char*>(payload->data()), payload->size());
+        entries.push_back({segment, static_cast<uint32_t>(payload->size()), size});
+        size += record_size;
+    }
+    segment_out_.flush();
+    // Appends continue after whatever reached the segment; unindexed bytes are trimmed on open
+    active_segment_ = segment;
+    active_size_ = size;
+    if (!segment_out_ || (sync && !sync_path(segment_path(segment)))) {
+        LOG_ERROR("BlockLog", "Failed to write records to segment " + std::to_string(segment));
+        return false;
+    }
+
+    std::vector<uint8_t> raw(entries.size() * INDEX_ENTRY_SIZE);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        uint8_t* p = raw.data() + i * INDEX_ENTRY_SIZE;
+        put_u32(p, entries[i].segment);
+        put_u32(p + 4, entries[i].length);
+        put_u64(p + 8, entries[i].offset);
+    }
+    index_out_.write(reinterpret_cast<const char*>(raw.data()), raw.size());
+    index_out_.flush();
+    if (!index_out_ || (sync && !sync_path(index_file_))) {
+        LOG_ERROR("BlockLog", "Failed to write index entry");
+        return false;
+    }
+
+    for (const auto& entry : entries) {
+        index_.push_back(entry);
+        payload_total_ += entry.length;
+    }
+    return true;
+}
+
+std::shared_ptr<const BlockLog::Mapping> BlockLog::map_segment(uint32_t segment, uint64_t end) const {
+    std::shared_ptr<const Mapping>& current = mappings_[segment];
+    if (current && current->length >= end) {
+        return current;
+    }
+
+    // The segment has grown past the old map (or was never mapped); map it again at its current size
+    int fd = ::open(segment_path(segment).c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    auto mapping = std::make_shared<Mapping>();
+    struct stat st = {};
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && static_cast<uint64_t>(st.st_size) >= end) {
+        void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            mapping->data = static_cast<const uint8_t*>(data);
+            mapping->length = static_cast<size_t>(st.st_size);
+        }
+    }
+    ::close(fd);
+    if (!mapping->data) {
+        return nullptr;
+    }
+    current = std::move(mapping);
+    return current;
+}
+
+bool BlockLog::verify_record(const IndexEntry& entry, const Mapping& mapping,
+                             std::vector<uint8_t>& payload) const {
+    if (entry.offset + RECORD_HEADER_SIZE + entry.length > mapping.length) {
+        return false;
+    }
+    const uint8_t* header = mapping.data + entry.offset;
+    const uint8_t* body = header + RECORD_HEADER_SIZE;
+    if (get_u32(header) != entry.length || crc32(body, entry.length) != get_u32(header + 4)) {
+        return false;
+    }
+    payload.assign(body, body + entry.length);
+    return true;
+}
+
+bool BlockLog::read(size_t record, std::vector<uint8_t>& payload) const {
+    IndexEntry entry;
+    std::shared_ptr<const Mapping> mapping;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (record >= index_.size()) return false;
+        entry = index_[record];
+        mapping = map_segment(entry.segment, entry.offset + RECORD_HEADER_SIZE + entry.length);
+    }
+
+    if (!mapping || !verify_record(entry, *mapping, payload)) {
+        LOG_WARN("BlockLog", "Corrupt or missing record #" + std::to_string(record));
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::vector<uint8_t>> BlockLog::read_all() const {
+    return read_range(0, SIZE_MAX);
+}
+
+std::vector<std::vector<uint8_t>> BlockLog::read_range(size_t first, size_t count) const {
+    std::vector<IndexEntry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (first < index_.size()) {
+            size_t end = first + std::min(count, index_.size() - first);
+            entries.assign(index_.begin() + first, index_.begin() + end);
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> records;
+    records.reserve(entries.size());
+
+    // Records are laid out sequentially, so each segment is mapped once
+    std::shared_ptr<const Mapping> mapping;
+    uint32_t mapped_segment = UINT32_MAX;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const IndexEntry& entry = entries[i];
+        if (entry.segment != mapped_segment) {
+            // The last record of the segment sets how much of it must be mapped
+            size_t last = i;
+            while (last + 1 < entries.size() && entries[last + 1].segment == entry.segment) {
+                ++last;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            mapping = map_segment(entry.segment, entries[last].offset + RECORD_HEADER_SIZE + entries[last].length);
+            mapped_segment = entry.segment;
+        }
+
+        std::vector<uint8_t> payload;
+        if (!mapping || !verify_record(entry, *mapping, payload)) {
+            LOG_WARN("BlockLog", "Corrupt record #" + std::to_string(first + i) + " - stopping load");
+            break;
+        }
+        records.push_back(std::move(payload));
+    }
+    return records;
+}
+
+bool BlockLog::truncate(size_t records) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (records >= index_.size()) {
+        return true;
+    }
+    close_writers();
+    mappings_.clear();
+
+    // Segments are contiguous runs of records, so only the boundary one can be shared
+    uint32_t last_plain = active_segment_;
+    std::vector<uint32_t> dropped;
+    for (size_t i = records; i < index_.size(); ++i) {
+        if (dropped.empty() || dropped.back() != index_[i].segment) {
+            dropped.push_back(index_[i].segment);
+        }
+    }
+    index_.resize(records);
+    payload_total_ = 0;
+    for (const auto& entry : index_) {
+        payload_total_ += entry.length;
+    }
+    resume_after_last_record();
+
+    bool ok = ::truncate(index_file_.c_str(), index_.size() * INDEX_ENTRY_SIZE) == 0;
+    for (uint32_t segment : dropped) {
+        bool kept = !index_.empty() && index_.back().segment == segment;
+        if (!kept && segment != active_segment_) {
+            std::remove(segment_path(segment).c_str());
+        }
+    }
+    for (uint32_t s = active_segment_ + 1; s <= last_plain; ++s) {
+        std::remove(segment_path(s).c_str());
+    }
+    std::string active_path = segment_path(active_segment_);
+    if (file_size(active_path) > active_size_) {
+        ok = replace_with_prefix(active_path, active_size_, directory_) && ok;
+    }
+    if (!ok) {
+        LOG_WARN("BlockLog", "Failed to truncate block log to " + std::to_string(records) + " records");
+    }
+    return open_writers() && ok;
+}
+
+size_t BlockLog::rewrite_sealed(size_t first, size_t end, const Transform& transform) {
+    std::vector<IndexEntry> entries;
+    uint32_t active = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries = index_;
+        active = active_segment_;
+    }
+
+    end = std::min(end, entries.size());
+    size_t done = first;
+    size_t begin = 0;
+    while (begin < end) {
+        uint32_t segment = entries[begin].segment;
+        size_t stop = begin;
+        while (stop < entries.size() && entries[stop].segment == segment) {
+            ++stop;
+        }
+        if (segment == active || stop > end) {
+            break;  // Only whole segments that no longer take appends
+        }
+        if (stop > first && !rewrite_segment(begin, stop, entries, transform)) {
+            break;
+        }
+        done = std::max(done, stop);
+        begin = stop;
+    }
+    return done;
+}
+
+bool BlockLog::rewrite_segment(size_t begin, size_t stop, const std::vector<IndexEntry>& entries,
+                               const Transform& transform) {
+    uint32_t segment = entries[begin].segment;
+    uint32_t target = segment | PRUNED_SEGMENT;
+    std::string target_path = segment_path(target);
+
+    // Build the replacement off the lock; sealed segments no longer change
+    std::vector<IndexEntry> rewritten;
+    rewritten.reserve(stop - begin);
+    {
+        std::ofstream out(target_path, std::ios::binary | std::ios::trunc);
+        uint64_t offset = 0;
+        std::vector<uint8_t> payload;
+        std::vector<uint8_t> replacement;
+        for (size_t record = begin; record < stop; ++record) {
+            replacement.clear();
+            if (!read(record, payload) || !transform(record, payload, replacement)) {
+                out.close();
+                std::remove(target_path.c_str());
+                return false;
+            }
+            uint8_t header[RECORD_HEADER_SIZE];
+            put_u32(header, static_cast<uint32_t>(replacement.size()));
+            put_u32(header + 4, crc32(replacement.data(), replacement.size()));
+            out.write(reinterpret_cast<const char*>(header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(replacement.data()), replacement.size());
+            rewritten.push_back({target, static_cast<uint32_t>(replacement.size()), offset});
+            offset += RECORD_HEADER_SIZE + replacement.size();
+        }
+        out.flush();
+        if (!out) {
+            out.close();
+            std::remove(target_path.c_str());
+            LOG_WARN("BlockLog", "Failed to write rewritten segment " + target_path);
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A truncate or reset in the meantime invalidates the rewrite
+    bool unchanged = index_.size() >= stop;
+    for (size_t record = begin; unchanged && record < stop; ++record) {
+        unchanged = index_[record].segment == entries[record].segment &&
+                    index_[record].offset == entries[record].offset;
+    }
+    if (!unchanged) {
+        std::remove(target_path.c_str());
+        return false;
+    }
+
+    // The index rename is the commit point; the original goes only after it
+    std::vector<IndexEntry> updated = index_;
+    std::copy(rewritten.begin(), rewritten.end(), updated.begin() + begin);
+    if (!write_index(updated)) {
+        std::remove(target_path.c_str());
+        return false;
+    }
+    for (size_t record = begin; record < stop; ++record) {
+        payload_total_ = payload_total_ - index_[record].length + updated[record].length;
+    }
+    index_ = std::move(updated);
+    mappings_.erase(segment);
+    std::remove(segment_path(segment).c_str());
+    return true;
+}
+
+bool BlockLog::write_index(const std::vector<IndexEntry>& entries) {
+    // Caller holds mutex_
+    std::string temp_file = index_file_ + ".tmp";
+    {
+        std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+        std::vector<uint8_t> raw(entries.size() * INDEX_ENTRY_SIZE);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            uint8_t* p = raw.data() + i * INDEX_ENTRY_SIZE;
+            put_u32(p, entries[i].segment);
+            put_u32(p + 4, entries[i].length);
+            put_u64(p + 8, entries[i].offset);
+        }
+        out.write(reinterpret_cast<const char*>(raw.data()), raw.size());
+        out.flush();
+        if (!out) {
+            std::remove(temp_file.c_str());
+            return false;
+        }
+    }
+    if (index_out_.is_open()) index_out_.close();
+    bool renamed = std::rename(temp_file.c_str(), index_file_.c_str()) == 0;
+    index_out_.open(index_file_, std::ios::binary | std::ios::app);
+    if (!renamed) {
+        LOG_WARN("BlockLog", "Failed to replace index file: " + index_file_);
+    }
+    return renamed && index_out_.is_open();
+}
+
+void BlockLog::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close_writers();
+    mappings_.clear();
+
+    for (uint32_t s = 0; s <= active_segment_; ++s) {
+        std::remove(segment_path(s).c_str());
+    }
+    uint32_t previous_segment = UINT32_MAX;
+    for (const auto& entry : index_) {
+        if ((entry.segment & PRUNED_SEGMENT) && entry.segment != previous_segment) {
+            std::remove(segment_path(entry.segment).c_str());
+        }
+        previous_segment = entry.segment;
+    }
+    std::remove(index_file_.c_str());
+
+    index_.clear();
+    active_segment_ = 0;
+    active_size_ = 0;
+    payload_total_ = 0;
+    open_writers();
+}
+
+size_t BlockLog::count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.size();
+}
+
+uint64_t BlockLog::payload_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return payload_total_;
+}
+
+uint64_t BlockLog::disk_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t total = file_size(index_file_);
+    for (uint32_t s = 0; s <= active_segment_; ++s) {
+        total += file_size(segment_path(s));
+    }
+    uint32_t previous_segment = UINT32_MAX;
+    for (const auto& entry : index_) {
+        if ((entry.segment & PRUNED_SEGMENT) && entry.segment != previous_segment) {
+            total += file_size(segment_path(entry.segment));
+        }
+        previous_segment = entry.segment;
+    }
+    return total;
+}
@@ -0,0 +1,106 @@
+#ifndef BLOCK_LOG_HPP
+#define BLOCK_LOG_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+/**
+ * BlockLog - Segmented, append-only log of length-prefixed binary records
+ *
+ * Layout on disk (inside the storage directory):
+ *   blocks_000000.seg, blocks_000001.seg, ...   record segments
+ *   pruned_000000.seg, ...                      sealed segments rewritten by rewrite_sealed()
+ *   blocks.idx                                  fixed-size offset index
+ *
+ * Each record in a segment is [u32 length][u32 crc32][payload], little endian.
+ * The index holds one 16-byte entry per record so that appends, counts and
+ * random reads never need to scan the segments. Reads go through read-only
+ * memory maps of the segments, remapped when a record lies past the mapped
+ * end, so loading the chain costs one pass over the page cache.
+ */
+class BlockLog {
+public:
+    struct IndexEntry {
+        uint32_t segment;   // Segment number holding the record, PRUNED_SEGMENT set once rewritten
+        uint32_t length;    // Payload length in bytes
+        uint64_t offset;    // Offset of the record header within the segment
+    };
+
+    static constexpr uint64_t DEFAULT_SEGMENT_SIZE = 64ull * 1024 * 1024;  // 64 MB per segment
+    static constexpr uint32_t PRUNED_SEGMENT = 0x80000000u;
+
+    // Replacement payload for `record`; false abandons the rewrite
+    using Transform = std::function<bool(size_t record, const std::vector<uint8_t>& payload,
+                                         std::vector<uint8_t>& replacement)>;
+
+    explicit BlockLog(const std::string& directory, uint64_t max_segment_size = DEFAULT_SEGMENT_SIZE);
+    ~BlockLog();
+
+    BlockLog(const BlockLog&) = delete;
+    BlockLog& operator=(const BlockLog&) = delete;
+
+    // Append one record; O(1) regardless of log length
+    bool append(const std::vector<uint8_t>& payload);
+    // Append several records with one write to the segment and one to the index;
+    // `sync` fsyncs the records before their index entries are written
+    bool append_batch(const std::vector<std::vector<uint8_t>>& payloads, bool sync);
+
+    // Random access by record number (0-based)
+    bool read(size_t record, std::vector<uint8_t>& payload) const;
+    std::vector<std::vector<uint8_t>> read_all() const;
+    std::vector<std::vector<uint8_t>> read_range(size_t first, size_t count) const;
+
+    // Pass every sealed segment holding only records below `end` (and any at or
+    // above `first`) through `transform`, one segment at a time. The new segment
+    // is written beside the old one and switched in by an atomic index rewrite.
+    // Returns the record count below which every segment has been rewritten.
+    size_t rewrite_sealed(size_t first, size_t end, const Transform& transform);
+
+    // Keep the first `records` records and drop the rest. The boundary segment is
+    // replaced by a shorter copy, never shrunk, as readers may still map it.
+    bool truncate(size_t records);
+    // Drop every segment and the index
+    void reset();
+
+    size_t count() const;
+    uint64_t payload_bytes() const;  // Sum of payload lengths from the index
+    uint64_t disk_bytes() const;     // Segments + index as stored on disk
+    bool empty() const { return count() == 0; }
+
+private:
+    struct Mapping;
+
+    std::string directory_;
+    std::string index_file_;
+    uint64_t max_segment_size_;
+
+    std::vector<IndexEntry> index_;
+    uint32_t active_segment_ = 0;
+    uint64_t active_size_ = 0;
+    uint64_t payload_total_ = 0;
+    std::ofstream segment_out_;
+    std::ofstream index_out_;
+    mutable std::unordered_map<uint32_t, std::shared_ptr<const Mapping>> mappings_;  // Replaced as a segment grows
+    mutable std::mutex mutex_;
+
+    std::string segment_path(uint32_t segment) const;
+    void resume_after_last_record();  // Set the append position from index_
+    bool append_records(const std::vector<const std::vector<uint8_t>*>& payloads, bool sync);  // Caller holds mutex_
+    bool rewrite_segment(size_t begin, size_t stop, const std::vector<IndexEntry>& entries,
+                         const Transform& transform);
+    bool write_index(const std::vector<IndexEntry>& entries);
+    // Map of `segment` covering at least `end` bytes (caller holds mutex_)
+    std::shared_ptr<const Mapping> map_segment(uint32_t segment, uint64_t end) const;
+    void load_index();
+    bool open_writers();
+    void close_writers();
+    bool verify_record(const IndexEntry& entry, const Mapping& mapping, std::vector<uint8_t>& payload) const;
+};
+
+#endif // BLOCK_LOG_HPP
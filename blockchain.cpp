@@ -1,4 +1,6 @@
 #include "blockchain.hpp"
+#include "block_executor.hpp"
+#include "utils/metrics.hpp"
 #include <chrono>
 #include <algorithm>
 #include <cstring>
@@ -78,6 +80,7 @@ std::string Transaction::calculate_hash() const {
     j["gas_price"] = gas_price;
     j["timestamp"] = timestamp;
     j["public_key"] = public_key;
+    j["nonce"] = nonce;  // Distinguishes same-second transactions in a sender's lane
     
     // Hash without signature
     unsigned char hash[SHA256_DIGEST_LENGTH];
@@ -94,6 +97,119 @@ std::string Transaction::calculate_hash() const {
     return ss.str();
 }
 
+Transaction Transaction::from_json(const json& j) {
+    Transaction tx;
+    tx.from = j.at("from").get<std::string>();
+    tx.to = j.at("to").get<std::string>();
+    tx.amount = j.at("amount").get<double>();
+    tx.gas_price = j.at("gas_price").get<double>();
+    tx.timestamp = j.value("timestamp", "");
+    tx.signature = j.value("signature", "");
+    tx.public_key = j.value("public_key", "");
+    tx.transaction_id = j.value("transaction_id", "");
+    tx.nonce = j.value("nonce", static_cast<uint64_t>(0));
+    tx.data = j.value("data", "");
+    tx.contract_address = j.value("contract_address", "");
+    tx.is_contract_deployment = j.value("is_contract_deployment", false);
+    tx.set_deployment(j.value("contract_bytecode", ""), j.value("contract_name", ""),
+                      j.value("contract_language", ""));
+    return tx;
+}
+
+void Transaction::set_deployment(std::string bytecode, std::string name, std::string language) {
+    if (bytecode.empty() && name.empty() && language.empty()) {
+        deployment.reset();
+        return;
+    }
+    deployment = std::make_shared<const ContractDeployment>(
+        ContractDeployment{std::move(bytecode), std::move(name), std::move(language)});
+}
+
+const ContractDeployment& Transaction::deployment_or_empty() const {
+    static const ContractDeployment empty;
+    return deployment ? *deployment : empty;
+}
+
+// ============= BLOCK =============
+int64_t parse_block_timestamp(const std::string& timestamp) {
+    std::tm tm = {};
+    if (sscanf(timestamp.c_str(), "%d-%d-%d %d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+        return -1;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    return static_cast<int64_t>(std::mktime(&tm));
+}
+
+Block Block::from_json(const json& j) {
+    Block block;
+    block.index = j.at("index").get<int>();
+    block.timestamp = j.at("timestamp").get<std::string>();
+    block.time_seconds = parse_block_timestamp(block.timestamp);
+    block.merkle_root = j.at("merkle_root").get<std::string>();
+    block.state_root = j.value("state_root", "");
+    block.proof = j.at("proof").get<long long>();
+    block.previous_hash = j.at("previous_hash").get<std::string>();
+    block.pow_version = j.value("pow_version", POW_VERSION_LEGACY);
+    if (j.contains("transactions")) {
+        block.transactions.reserve(j["transactions"].size());
+        for (const auto& tx_json : j["transactions"]) {
+            block.transactions.push_back(Transaction::from_json(tx_json));
+        }
+    }
+    return block;
+}
+
+Block Block::from_stored_json(const json& j) {
+    Block block = from_json(j);
+    block.header_hash = j.value("header_hash", "");
+    return block;
+}
+
+BlockHeader BlockHeader::from_json(const json& j) {
+    BlockHeader header;
+    header.index = j.at("index").get<int>();
+    header.timestamp = j.at("timestamp").get<std::string>();
+    header.merkle_root = j.at("merkle_root").get<std::string>();
+    header.state_root = j.value("state_root", "");
+    header.proof = j.at("proof").get<long long>();
+    header.previous_hash = j.at("previous_hash").get<std::string>();
+    header.pow_version = j.value("pow_version", POW_VERSION_LEGACY);
+    header.hash = j.at("hash").get<std::string>();
+    header.transaction_count = j.value("transaction_count", static_cast<size_t>(0));
+    return header;
+}
+
+BlockHeader BlockHeader::from_block(const Block& block, const std::string& hash) {
+    BlockHeader header;
+    header.index = block.index;
+    header.timestamp = block.timestamp;
+    header.merkle_root = block.merkle_root;
+    header.state_root = block.state_root;
+    header.proof = block.proof;
+    header.previous_hash = block.previous_hash;
+    header.pow_version = block.pow_version;
+    header.hash = hash;
+    header.transaction_count = block.transactions.size();
+    return header;
+}
+
+Block BlockHeader::to_header_only_block() const {
+    Block block;
+    block.index = index;
+    block.timestamp = timestamp;
+    block.time_seconds = parse_block_timestamp(timestamp);
+    block.merkle_root = merkle_root;
+    block.state_root = state_root;
+    block.proof = proof;
+    block.previous_hash = previous_hash;
+    block.pow_version = pow_version;
+    block.header_hash = hash;
+    return block;
+}
+
 // ============= SHA256 =============
 std::string Blockchain::sha256(const std::string& str) const {
     unsigned char hash[SHA256_DIGEST_LENGTH];
@@ -110,11 +226,42 @@ std::string Blockchain::sha256(const std::string& str) const {
 }
 
 // ============= MERKLE TREE =============
-std::string Blockchain::_calculate_merkle_root(const std::vector<Transaction>& transactions) const {
+MerkleTree::Hash Transaction::merkle_leaf() const {
+    return merkle_leaf_cached ? merkle_leaf_cache : MerkleTree::hash_bytes(to_json().dump());
+}
+
+void Transaction::cache_merkle_leaf() {
+    merkle_leaf_cache = MerkleTree::hash_bytes(to_json().dump());
+    merkle_leaf_cached = true;
+}
+
+std::vector<MerkleTree::Hash> Blockchain::_merkle_leaves(const std::vector<Transaction>& transactions) const {
+    std::vector<MerkleTree::Hash> leaves(transactions.size());
+    _fill_merkle_leaves(transactions, leaves.data());
+    return leaves;
+}
+
+void Blockchain::_fill_merkle_leaves(const std::vector<Transaction>& transactions, MerkleTree::Hash* leaves) const {
+    // Transactions admitted through the mempool are already hashed; peers' blocks are not
+    _worker_pool().parallel_for(transactions.size(), [&](size_t i) {
+        leaves[i] = transactions[i].merkle_leaf();
+    }, PARALLEL_MERKLE_MIN_CHUNK);
+}
+
+std::string Blockchain::_calculate_merkle_root(const std::vector<Transaction>& transactions, int pow_version) const {
     if (transactions.empty()) {
         return sha256("");
     }
 
+    if (pow_version >= POW_VERSION_MIDSTATE) {
+        // Only the root is needed, so the levels are folded in one arena buffer
+        memory_utils::MonotonicArena::Scope scope(block_arena_);
+        std::pmr::vector<MerkleTree::Hash> nodes(transactions.size(), scope.resource());
+        _fill_merkle_leaves(transactions, nodes.data());
+        return MerkleTree::to_hex(MerkleTree::root_in_place(nodes.data(), nodes.size()));
+    }
+
+    // Legacy layout: hex digests concatenated as strings at every level
     std::vector<std::string> hashes;
     for (const auto& tx : transactions) {
         hashes.push_back(sha256(tx.to_json().dump()));
@@ -134,32 +281,327 @@ std::string Blockchain::_calculate_merkle_root(const std::vector<Transaction>& t
 
 // ============= ACCOUNT STATE SYNCHRONIZATION =============
 std::string Blockchain::_calculate_state_root() const {
-    // Create deterministic hash of current account state
-    json state_json = json::object();
-    
-    // Sort accounts by address for deterministic ordering
-    std::vector<std::string> sorted_addresses;
-    for (const auto& [addr, _] : account_balances) {
-        sorted_addresses.push_back(addr);
+    static metrics::Histogram& latency = metrics::histogram("state_root_seconds", "Time to bring the state root up to date");
+    metrics::ScopedTimer timer(latency);
+    // Only buckets touched since the last call are rehashed
+    memory_utils::MonotonicArena::Scope scope(block_arena_);
+    return state_tree_.root_hex(scope.resource());
+}
+
+void Blockchain::_touch_account(const std::string& address) {
+    AccountRecord record;
+    if (!accounts_->get(address, record) || !record.has_balance) {
+        state_tree_.erase(address);
+        snapshot_dirty_.push_back(address);
+        return;
     }
-    std::sort(sorted_addresses.begin(), sorted_addresses.end());
-    
-    // Build state snapshot
-    for (const auto& addr : sorted_addresses) {
-        json account_data = json::object();
-        account_data["balance"] = account_balances.at(addr);
-        account_data["nonce"] = account_nonces.count(addr) ? account_nonces.at(addr) : 0;
-        state_json[addr] = account_data;
+    state_tree_.set(address, record.balance, record.has_nonce ? record.nonce : 0);
+    snapshot_dirty_.push_back(address);
+}
+
+void Blockchain::_rebuild_state_tree() {
+    state_tree_.clear();
+    accounts_->for_each([this](const std::string& address, const AccountRecord& record) {
+        if (record.has_balance) {
+            state_tree_.set(address, record.balance, record.has_nonce ? record.nonce : 0);
+        }
+    });
+    snapshot_dirty_.clear();
+    snapshot_rebuild_ = true;
+}
+
+void Blockchain::_publish_snapshot() {
+    // Caller holds chain_mutex
+    std::shared_ptr<const ChainSnapshot> previous = std::atomic_load(&snapshot_);
+    auto next = std::make_shared<ChainSnapshot>();
+    next->version = previous ? previous->version + 1 : 1;
+    next->chain_epoch = chain_epoch_;
+    next->height = chain.size();
+    next->total_transactions = total_transactions_;
+    next->difficulty = difficulty;
+    next->state_root = _calculate_state_root();
+    next->account_count = accounts_->size();
+    if (!chain.empty()) {
+        next->tip_hash = block_hashes_.back();
+        next->tip = previous && previous->tip_hash == next->tip_hash
+            ? previous->tip : std::make_shared<const Block>(chain.back());
+    }
+
+    auto account_of = [this](const std::string& address, ChainSnapshot::Account& account) {
+        AccountRecord record;
+        if (!accounts_->get(address, record) || !record.has_balance) {
+            return false;
+        }
+        account.balance = record.balance;
+        account.nonce = record.has_nonce ? record.nonce : 0;
+        account.has_nonce = record.has_nonce;
+        return true;
+    };
+
+    if (!previous || snapshot_rebuild_) {
+        std::array<ChainSnapshot::Shard, ChainSnapshot::SHARD_COUNT> shards;
+        accounts_->for_each([&shards](const std::string& address, const AccountRecord& record) {
+            if (record.has_balance) {
+                shards[ChainSnapshot::shard_of(address)][address] =
+                    {record.balance, record.has_nonce ? record.nonce : 0, record.has_nonce};
+            }
+        });
+        for (size_t i = 0; i < shards.size(); ++i) {
+            next->shards[i] = std::make_shared<const ChainSnapshot::Shard>(std::move(shards[i]));
+        }
+    } else {
+        // Copy-on-write: untouched shards are shared with the previous snapshot
+        next->shards = previous->shards;
+        std::array<std::unique_ptr<ChainSnapshot::Shard>, ChainSnapshot::SHARD_COUNT> copies;
+        for (const auto& address : snapshot_dirty_) {
+            size_t index = ChainSnapshot::shard_of(address);
+            if (!copies[index]) {
+                copies[index] = std::make_unique<ChainSnapshot::Shard>(*previous->shards[index]);
+            }
+            ChainSnapshot::Account account;
+            if (account_of(address, account)) {
+                (*copies[index])[address] = account;
+            } else {
+                copies[index]->erase(address);
+            }
+        }
+        for (size_t i = 0; i < copies.size(); ++i) {
+            if (copies[i]) {
+                next->shards[i] = std::shared_ptr<const ChainSnapshot::Shard>(std::move(copies[i]));
+            }
+        }
     }
-    
-    // Hash the entire state
-    std::string state_dump = state_json.dump();
-    return sha256(state_dump);
+    snapshot_dirty_.clear();
+    snapshot_rebuild_ = false;
+
+    // The next block commits to the last state published at its parent's height
+    if (previous && next->height == previous->height + 1 &&
+        previous->height > 1 && previous->height % state_snapshot_interval_ == 0) {
+        state_checkpoint_ = previous;
+        _persist_checkpoint(previous);
+    }
+
+    bool tip_moved = !previous || previous->tip_hash != next->tip_hash;
+    std::shared_ptr<const ChainSnapshot> published(std::move(next));
+    std::atomic_store(&snapshot_, published);
+    if (tip_moved && tip_listener_) {
+        tip_listener_(*published);
+    }
+}
+
+void Blockchain::set_tip_listener(std::function<void(const ChainSnapshot&)> listener) {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    tip_listener_ = std::move(listener);
+}
+
+void Blockchain::_persist_checkpoint(const std::shared_ptr<const ChainSnapshot>& snapshot) {
+    // Caller holds chain_mutex. A durable account store is its own checkpoint.
+    bool durable = accounts_->durable();
+    // Bodies may go once the checkpoint (and the retention window) is past them
+    size_t prune_to = 0;
+    if (storage_config_.prune_window > 0 && chain.size() > storage_config_.prune_window) {
+        prune_to = std::min({snapshot->height, chain.size() - storage_config_.prune_window, stored_blocks_});
+    }
+    if (!durable) {
+        // A checkpoint still queued is superseded by this one
+        persistence_writer_.enqueue_checkpoint([snapshot]() { return _checkpoint_json(*snapshot); });
+    }
+    if (prune_to > pruned_height_) {
+        persistence_writer_.enqueue_task([this, prune_to]() { _prune_stored_bodies(prune_to); });
+    }
+}
+
+void Blockchain::_prune_stored_bodies(size_t end) {
+    size_t before = pruned_height_;
+    size_t pruned = persistent_store_.rewrite_blocks(before, end, [this](size_t, json& block_json) {
+        if (block_json.contains("header_hash")) {
+            return true;  // Already without a body
+        }
+        std::string hash = block_json.value("hash", "");
+        if (hash.empty()) {
+            hash = _hash(Block::from_stored_json(block_json));
+        }
+        block_json["transaction_count"] = block_json["transactions"].size();
+        block_json["transactions"] = json::array();
+        block_json["header_hash"] = hash;
+        block_json["hash"] = hash;
+        return true;
+    });
+    pruned_height_ = std::max(before, pruned);
+    if (pruned > before) {
+        LOG_INFO("Blockchain", "Pruned stored block bodies below #" + std::to_string(pruned));
+    }
+}
+
+json Blockchain::_checkpoint_json(const ChainSnapshot& snapshot) {
+    // Accounts as [address, balance, nonce, has_nonce] rows
+    json accounts = json::array();
+    for (const auto& shard : snapshot.shards) {
+        for (const auto& [address, account] : *shard) {
+            accounts.push_back({address, account.balance, account.nonce, account.has_nonce});
+        }
+    }
+    json checkpoint;
+    checkpoint["height"] = snapshot.height;
+    checkpoint["tip_hash"] = snapshot.tip_hash;
+    checkpoint["state_root"] = snapshot.state_root;
+    checkpoint["difficulty"] = snapshot.difficulty;
+    checkpoint["accounts"] = std::move(accounts);
+    return checkpoint;
+}
+
+json Blockchain::_stored_block_json(const Block& block, const std::string& hash, uint32_t transaction_count) {
+    json block_json = block.to_json();
+    block_json["hash"] = hash;
+    if (block.is_header_only()) {
+        block_json["transaction_count"] = transaction_count;
+    }
+    return block_json;
+}
+
+json Blockchain::_stored_block_json(size_t position) const {
+    return _stored_block_json(chain[position], block_hashes_[position], transaction_counts_[position]);
+}
+
+void Blockchain::_store_new_blocks() {
+    // Caller holds chain_mutex. The writer serialises a copy, so a later eviction cannot race it.
+    for (; stored_blocks_ < chain.size(); ++stored_blocks_) {
+        persistence_writer_.enqueue_block(stored_blocks_,
+            [block = chain[stored_blocks_], hash = block_hashes_[stored_blocks_],
+             count = transaction_counts_[stored_blocks_]]() {
+                return _stored_block_json(block, hash, count);
+            });
+    }
+}
+
+void Blockchain::_evict_bodies() {
+    // Caller holds chain_mutex. Only bodies already written can be dropped from memory.
+    size_t resident = storage_config_.resident_blocks;
+    if (resident == 0 || chain.size() <= resident) {
+        return;
+    }
+    size_t limit = std::min({stored_blocks_, persistence_writer_.committed_blocks(), chain.size() - resident});
+    for (; resident_from_ < limit; ++resident_from_) {
+        Block& block = chain[resident_from_];
+        if (!block.is_header_only()) {
+            block.header_hash = block_hashes_[resident_from_];
+            std::vector<Transaction>().swap(block.transactions);
+        }
+    }
+}
+
+const Block& Blockchain::_block_at(size_t position, Block& scratch) const {
+    const Block& block = chain[position];
+    if (position >= resident_from_ || !block.is_header_only() || position < pruned_height_) {
+        return block;
+    }
+    json block_json;
+    if (persistent_store_.load_block(position, block_json)) {
+        scratch = Block::from_stored_json(block_json);
+        if (scratch.index == block.index && scratch.previous_hash == block.previous_hash) {
+            return scratch;
+        }
+    }
+    LOG_WARN("Blockchain", "Body of block " + std::to_string(block.index) + " is not in the block store");
+    return block;
+}
+
+BlockHeader Blockchain::_header_at(size_t position) const {
+    BlockHeader header = BlockHeader::from_block(chain[position], block_hashes_[position]);
+    header.transaction_count = transaction_counts_[position];
+    return header;
+}
+
+void Blockchain::set_storage_config(const ChainStorageConfig& config) {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    storage_config_ = config;
+    persistence_writer_.set_durability(config.durability);
+    accounts_->set_sync_writes(config.durability == PersistDurability::FSYNC_BATCH);
+    _evict_bodies();
+}
+
+ChainStorageConfig Blockchain::get_storage_config() const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    return storage_config_;
+}
+
+size_t Blockchain::get_resident_bodies() const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    size_t resident = 0;
+    for (size_t i = 0; i < chain.size(); ++i) {
+        resident += chain[i].is_header_only() ? 0 : 1;
+    }
+    return resident;
+}
+
+std::shared_ptr<const ChainSnapshot> Blockchain::get_state_checkpoint() const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    return state_checkpoint_;
+}
+
+bool Blockchain::install_state_snapshot(const std::vector<BlockHeader>& headers,
+                                        const std::vector<StateTree::Account>& accounts,
+                                        const std::string& state_root) {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    if (headers.empty() || chain.empty() || catching_up_) {
+        return false;
+    }
+
+    // Proof of work was checked as the headers arrived; here they must still continue our tip
+    std::string parent_hash = block_hashes_.back();
+    int parent_index = chain.back().index;
+    for (const auto& header : headers) {
+        if (header.index != parent_index + 1 || header.previous_hash != parent_hash) {
+            LOG_WARN("Blockchain", "Snapshot headers do not extend the tip at #" + std::to_string(parent_index));
+            return false;
+        }
+        parent_hash = header.hash;
+        parent_index = header.index;
+    }
+
+    // Check the root on a scratch tree first: a disk-backed store cannot cheaply keep the old state around
+    StateTree installed;
+    for (const auto& account : accounts) {
+        installed.set(account.address, account.balance, account.nonce);
+    }
+    if (installed.root_hex() != state_root) {
+        LOG_WARN("Blockchain", "Snapshot state does not match root " + state_root.substr(0, 16));
+        return false;
+    }
+    AccountBatch batch;
+    batch.reserve(accounts.size());
+    for (const auto& account : accounts) {
+        batch.emplace_back(account.address, AccountRecord{account.balance, account.nonce, true, account.nonce > 0});
+    }
+    accounts_->clear();
+    accounts_->write(batch);
+    state_tree_ = std::move(installed);
+    snapshot_dirty_.clear();
+    snapshot_rebuild_ = true;
+
+    for (const auto& header : headers) {
+        _append_block(header.to_header_only_block(), header.hash);
+        transaction_counts_.back() = static_cast<uint32_t>(header.transaction_count);
+        total_transactions_ += header.transaction_count;
+    }
+    // Headers carry their proof of work and the state its root, so the whole chain counts as checked
+    validated_height_ = chain.size();
+    _publish_snapshot();
+    _store_new_blocks();
+    _evict_bodies();
+    // Blocks before the new tip cannot be replayed onto an older checkpoint, so queue one now
+    if (!accounts_->durable()) {
+        persistence_writer_.enqueue_checkpoint([snapshot = snapshot_]() { return _checkpoint_json(*snapshot); });
+    }
+
+    LOG_INFO("Blockchain", "Installed state snapshot at #" + std::to_string(parent_index) + " (" +
+             std::to_string(accounts.size()) + " accounts, root " + state_root.substr(0, 16) + ")");
+    return true;
 }
 
 // ============= DIFFICULTY TARGETING =============
 int Blockchain::_calculate_difficulty() const {
-    std::lock_guard<std::mutex> lock(chain_mutex);
+    // Caller (mine_block) already holds chain_mutex
     
     // Not enough blocks for retargeting
     if (chain.size() < DIFFICULTY_RETARGET_INTERVAL + 1) {
@@ -183,35 +625,13 @@ int Blockchain::_calculate_difficulty() const {
     const Block& start_block = chain[start_block_index];
     const Block& end_block = chain[end_block_index];
     
-    // Parse timestamps to get actual time difference
-    std::tm start_tm = {};
-    std::tm end_tm = {};
-    
-    int result1 = sscanf(start_block.timestamp.c_str(), "%d-%d-%d %d:%d:%d",
-                        &start_tm.tm_year, &start_tm.tm_mon, &start_tm.tm_mday,
-                        &start_tm.tm_hour, &start_tm.tm_min, &start_tm.tm_sec);
-    
-    int result2 = sscanf(end_block.timestamp.c_str(), "%d-%d-%d %d:%d:%d",
-                        &end_tm.tm_year, &end_tm.tm_mon, &end_tm.tm_mday,
-                        &end_tm.tm_hour, &end_tm.tm_min, &end_tm.tm_sec);
-    
-    if (result1 != 6 || result2 != 6) {
+    int64_t start_time = start_block.unix_time();
+    int64_t end_time = end_block.unix_time();
+    if (start_time < 0 || end_time < 0) {
         LOG_WARN("Blockchain", "Could not parse block timestamps for difficulty adjustment");
         return difficulty;
     }
     
-    // Normalize for mktime
-    start_tm.tm_year -= 1900;
-    start_tm.tm_mon -= 1;
-    start_tm.tm_isdst = -1;
-    
-    end_tm.tm_year -= 1900;
-    end_tm.tm_mon -= 1;
-    end_tm.tm_isdst = -1;
-    
-    time_t start_time = std::mktime(&start_tm);
-    time_t end_time = std::mktime(&end_tm);
-    
     int64_t actual_time = end_time - start_time;
     int64_t target_time = DIFFICULTY_RETARGET_INTERVAL * TARGET_BLOCK_TIME;  // Desired total time
     
@@ -258,13 +678,65 @@ int Blockchain::_calculate_difficulty() const {
 Blockchain::Blockchain() : difficulty(4) {
     std::vector<Transaction> genesis_txs;
     Block genesis_block = _create_block(genesis_txs, 1, "0", 1);
-    chain.push_back(genesis_block);
+    _append_block(genesis_block);
+    _publish_snapshot();
+}
+
+Blockchain::~Blockchain() {
+    _stop_catch_up();
+    stop_chain_audit();
+    persistence_writer_.stop();
+}
+
+void Blockchain::_append_block(const Block& block, std::string hash) {
+    // Callers have validated the block against its parent (or mined it), so a
+    // checkpoint that reached the old tip now covers the new one
+    if (validated_height_ == chain.size()) {
+        ++validated_height_;
+    }
+
+    if (hash.empty()) {
+        hash = _hash(block);
+    }
+    hash_index_[hash] = chain.size();
+    block_hashes_.push_back(std::move(hash));
+    transaction_counts_.push_back(static_cast<uint32_t>(block.transactions.size()));
+    total_transactions_ += block.transactions.size();
+    chain.push_back(block);
+}
+
+void Blockchain::_rebuild_block_index(const std::vector<std::string>& stored_hashes,
+                                      const std::vector<uint32_t>& stored_counts) {
+    // A freshly loaded chain is trusted only up to genesis until audited
+    validated_height_ = chain.empty() ? 0 : 1;
+    audit_failed_ = false;
+    ++chain_epoch_;  // Positions may now hold different blocks
+
+    block_hashes_.clear();
+    hash_index_.clear();
+    transaction_counts_.clear();
+    total_transactions_ = 0;
+    block_hashes_.resize(chain.size());
+    transaction_counts_.resize(chain.size());
+    hash_index_.reserve(chain.size());
+    
+    _worker_pool().parallel_for(chain.size(), [&](size_t i) {
+        bool stored = i < stored_hashes.size() && !stored_hashes[i].empty();
+        block_hashes_[i] = stored ? stored_hashes[i] : _hash(chain[i]);
+    }, PARALLEL_VALIDATION_MIN_CHUNK);
+    for (size_t i = 0; i < chain.size(); ++i) {
+        hash_index_[block_hashes_[i]] = i;
+        transaction_counts_[i] = i < stored_counts.size()
+            ? stored_counts[i] : static_cast<uint32_t>(chain[i].transactions.size());
+        total_transactions_ += transaction_counts_[i];
+    }
 }
 
 Block Blockchain::_create_block(const std::vector<Transaction>& transactions, 
                                 long long proof,
                                 const std::string& previous_hash, 
-                                int index) {
+                                int index,
+                                const std::string& merkle_root) {
     // Calculate state root BEFORE transactions execute (for consistent verification)
     std::string state_root_value = _calculate_state_root();
     
@@ -278,8 +750,10 @@ Block Blockchain::_create_block(const std::vector<Transaction>& transactions,
     Block block;
     block.index = index;
     block.timestamp = std::string(buffer);
+    block.time_seconds = static_cast<int64_t>(time);
     block.transactions = transactions;
-    block.merkle_root = _calculate_merkle_root(transactions);
+    block.pow_version = pow_version_;
+    block.merkle_root = merkle_root.empty() ? _calculate_merkle_root(transactions, block.pow_version) : merkle_root;
     block.state_root = state_root_value;  // Add state root (Account state sync)
     block.proof = proof;
     block.previous_hash = previous_hash;
@@ -288,11 +762,11 @@ Block Blockchain::_create_block(const std::vector<Transaction>& transactions,
 }
 
 Block Blockchain::get_previous_block() const {
-    std::lock_guard<std::mutex> lock(chain_mutex);
-    if (chain.empty()) {
+    std::shared_ptr<const ChainSnapshot> snapshot = get_snapshot();
+    if (!snapshot->tip) {
         throw BlockchainException("Chain is empty");
     }
-    return chain.back();
+    return *snapshot->tip;
 }
 
 // ============= SIGNATURE VERIFICATION =============
@@ -327,22 +801,35 @@ bool Blockchain::_verify_ecdsa_signature(const Transaction& tx) const {
 }
 
 // ============= ACCOUNT VALIDATION =============
-bool Blockchain::_has_sufficient_balance(const std::string& address, double amount) const {
-    auto it = account_balances.find(address);
-    if (it == account_balances.end()) {
-        return false;
-    }
-    return it->second >= amount;
+bool Blockchain::_has_sufficient_balance(const ChainSnapshot& snapshot, const std::string& address,
+                                         double amount) const {
+    const ChainSnapshot::Account* account = snapshot.find_account(address);
+    return account && account->balance >= amount;
+}
+
+uint64_t Blockchain::_next_confirmed_nonce(const std::string& address) const {
+    AccountRecord record;
+    // New accounts start at nonce 0; otherwise one more than the last used nonce
+    return accounts_->get(address, record) && record.has_nonce ? record.nonce + 1 : 0;
 }
 
-bool Blockchain::_check_replay_protection(const Transaction& tx) const {
-    auto it = account_nonces.find(tx.from);
-    if (it == account_nonces.end()) {
-        // New account, nonce should be 0
-        return tx.nonce == 0;
+uint64_t Blockchain::_next_unreserved_nonce(const ChainSnapshot& snapshot, const std::string& address) const {
+    // Nonces taken by the block being mined are as good as confirmed until it commits or is cancelled
+    const ChainSnapshot::Account* account = snapshot.find_account(address);
+    uint64_t next = account && account->has_nonce ? account->nonce + 1 : 0;
+    auto reserved = mining_reserved_.find(address);
+    return reserved != mining_reserved_.end() ? std::max(next, reserved->second) : next;
+}
+
+bool Blockchain::_check_replay_protection(const ChainSnapshot& snapshot, const Transaction& tx) const {
+    // Caller holds mempool_mutex. The nonce must extend the sender's pending lane
+    // or replace a pending nonce (replace-by-fee); anything older is a replay.
+    uint64_t confirmed_next = _next_unreserved_nonce(snapshot, tx.from);
+    if (tx.nonce < confirmed_next) {
+        return false;
     }
-    // Nonce must be exactly one more than the last used nonce
-    return tx.nonce == it->second + 1;
+    return tx.nonce == mempool_.next_pending_nonce(tx.from, confirmed_next) ||
+           mempool_.has_pending_nonce(tx.from, tx.nonce);
 }
 
 bool Blockchain::_verify_state_root(const std::string& calculated_root, const std::string& block_root) const {
@@ -358,132 +845,187 @@ bool Blockchain::_verify_state_root(const std::string& calculated_root, const st
 // Note: Implementation functions are defined below (see _verify_block_merkle_root, etc.)
 
 void Blockchain::_update_balances(const std::vector<Transaction>& transactions) {
-    for (const auto& tx : transactions) {
-        account_balances[tx.from] -= (tx.amount + tx.gas_price);
-        account_balances[tx.to] += tx.amount;
-        // Update nonce for replay protection (Account state sync)
-        account_nonces[tx.from] = tx.nonce;
+    // Transfers between unrelated accounts run in parallel; only transactions
+    // that read an account written earlier in the block are re-executed
+    memory_utils::MonotonicArena::Scope scope(block_arena_);
+    BlockExecutor executor(*accounts_, scope.resource());
+    BlockExecutor::Stats stats = executor.run(transactions.size(),
+        [&transactions](size_t i, BlockExecutor::View& view) {
+            const Transaction& tx = transactions[i];
+            view.set_balance(tx.from, view.get_balance(tx.from) - (tx.amount + tx.gas_price));
+            view.set_balance(tx.to, view.get_balance(tx.to) + tx.amount);
+            // Update nonce for replay protection (Account state sync)
+            view.set_nonce(tx.from, tx.nonce);
+        }, _worker_pool(), PARALLEL_EXECUTION_MIN_CHUNK);
+    
+    std::vector<std::string> touched;
+    executor.apply(*accounts_, touched);  // One batched write per block
+    for (const auto& address : touched) {
+        _touch_account(address);
+    }
+    if (stats.reexecuted > 0) {
+        LOG_DEBUG("Blockchain", "Block execution: " + std::to_string(stats.reexecuted) + "/" +
+                  std::to_string(transactions.size()) + " transactions re-executed after conflicts");
     }
-    
-    // Update state snapshot after balances change
-    std::lock_guard<std::mutex> lock(state_mutex);
-    account_state_snapshot = account_balances;  // Snapshot current state
 }
 
 // ============= TRANSACTION VALIDATION =============
-bool Blockchain::_validate_transaction(const Transaction& tx) const {
-    LOG_DEBUG("Blockchain", "Validating transaction: " + tx.transaction_id.substr(0, 16) + 
-              "... from " + tx.from + " to " + tx.to + " amount: " + std::to_string(tx.amount));
-    
+bool Blockchain::_check_transaction_stateless(const Transaction& tx, std::string& error) const {
     // 1. Verify signature
     if (!_verify_ecdsa_signature(tx)) {
-        LOG_WARN("Blockchain", "Transaction failed signature verification: " + tx.transaction_id.substr(0, 16));
-        throw BlockchainException("Invalid transaction signature");
-    }
-
-    // 2. Verify replay protection (nonce)
-    if (!_check_replay_protection(tx)) {
-        LOG_WARN("Blockchain", "Transaction failed replay protection check (nonce): " + tx.transaction_id.substr(0, 16));
-        throw BlockchainException("Invalid transaction nonce - replay attack detected");
-    }
-
-    // 3. Verify sender has sufficient balance
-    if (!_has_sufficient_balance(tx.from, tx.amount + tx.gas_price)) {
-        LOG_WARN("Blockchain", "Transaction failed balance check: " + tx.from + 
-                 " insufficient funds for " + std::to_string(tx.amount + tx.gas_price));
-        throw BlockchainException("Insufficient balance for transaction");
+        error = "Invalid transaction signature";
+        return false;
     }
 
-    // 4. Verify amounts are positive
+    // 2. Verify amounts are positive
     if (tx.amount <= 0 || tx.gas_price < 0) {
-        LOG_WARN("Blockchain", "Transaction has invalid amounts");
-        throw BlockchainException("Invalid transaction amounts");
+        error = "Invalid transaction amounts";
+        return false;
     }
 
-    // 5. Verify addresses are valid and non-empty
+    // 3. Verify addresses are valid and non-empty
     if (tx.from.empty() || tx.to.empty()) {
-        LOG_WARN("Blockchain", "Transaction has invalid addresses");
-        throw BlockchainException("Invalid transaction addresses");
+        error = "Invalid transaction addresses";
+        return false;
     }
 
-    // 6. Verify sender and receiver are different
+    // 4. Verify sender and receiver are different
     if (tx.from == tx.to) {
-        LOG_WARN("Blockchain", "Transaction sender equals receiver");
-        throw BlockchainException("Sender and receiver cannot be the same");
+        error = "Sender and receiver cannot be the same";
+        return false;
     }
 
-    // 7. Verify transaction ID is correctly calculated
+    // 5. Verify transaction ID is correctly calculated
     if (tx.transaction_id != tx.calculate_hash()) {
-        LOG_WARN("Blockchain", "Transaction ID mismatch");
-        throw BlockchainException("Transaction ID does not match hash");
+        error = "Transaction ID does not match hash";
+        return false;
+    }
+
+    return true;
+}
+
+bool Blockchain::_check_transaction_stateful(const Transaction& tx, std::string& error) const {
+    // Admission holds only mempool_mutex; the store itself is written under chain_mutex
+    std::shared_ptr<const ChainSnapshot> snapshot = get_snapshot();
+
+    // 1. Verify replay protection (nonce)
+    if (!_check_replay_protection(*snapshot, tx)) {
+        error = "Invalid transaction nonce - replay attack detected";
+        return false;
+    }
+
+    // 2. Verify sender has sufficient balance
+    if (!_has_sufficient_balance(*snapshot, tx.from, tx.amount + tx.gas_price)) {
+        error = "Insufficient balance for transaction";
+        return false;
+    }
+
+    return true;
+}
+
+bool Blockchain::_validate_transaction(const Transaction& tx) const {
+    LOG_DEBUG("Blockchain", "Validating transaction: " + tx.transaction_id.substr(0, 16) + 
+              "... from " + tx.from + " to " + tx.to + " amount: " + std::to_string(tx.amount));
+
+    std::string error;
+    if (!_check_transaction_stateless(tx, error) || !_check_transaction_stateful(tx, error)) {
+        LOG_WARN("Blockchain", "Transaction " + tx.transaction_id.substr(0, 16) + " rejected: " + error);
+        throw BlockchainException(error);
     }
 
     LOG_DEBUG("Blockchain", "Transaction validation passed: " + tx.transaction_id.substr(0, 16));
     return true;
 }
 
+ThreadPool& Blockchain::_worker_pool() const {
+    std::call_once(worker_pool_once_, [this]() {
+        worker_pool_ = std::make_unique<ThreadPool>();
+    });
+    return *worker_pool_;
+}
+
 // ============= ACCOUNT MANAGEMENT =============
 void Blockchain::create_account(const std::string& address, double initial_balance) {
     std::lock_guard<std::mutex> lock(chain_mutex);
     
-    if (account_balances.find(address) != account_balances.end()) {
+    AccountRecord record;
+    if (accounts_->get(address, record) && record.has_balance) {
         throw BlockchainException("Account already exists");
     }
     
-    account_balances[address] = initial_balance;
+    record.balance = initial_balance;
+    record.has_balance = true;
+    accounts_->write({{address, record}});
+    _touch_account(address);
+    _publish_snapshot();
+}
+
+// Readers below work on the published snapshot and never take chain_mutex
+std::shared_ptr<const ChainSnapshot> Blockchain::get_snapshot() const {
+    return std::atomic_load(&snapshot_);
 }
 
 double Blockchain::get_balance(const std::string& address) const {
-    std::lock_guard<std::mutex> lock(chain_mutex);
-    
-    auto it = account_balances.find(address);
-    if (it == account_balances.end()) {
-        return 0.0;
-    }
-    return it->second;
+    const ChainSnapshot::Account* account = get_snapshot()->find_account(address);
+    return account ? account->balance : 0.0;
 }
 
 uint64_t Blockchain::get_account_nonce(const std::string& address) const {
-    std::lock_guard<std::mutex> lock(chain_mutex);
-    
-    auto it = account_nonces.find(address);
-    if (it == account_nonces.end()) {
-        return 0;
-    }
-    return it->second;
+    std::shared_ptr<const ChainSnapshot> snapshot = get_snapshot();
+    const ChainSnapshot::Account* account = snapshot->find_account(address);
+    return account ? account->nonce : 0;
 }
 
 std::map<std::string, double> Blockchain::get_all_balances() const {
-    std::lock_guard<std::mutex> lock(chain_mutex);
-    return account_balances;
+    std::shared_ptr<const ChainSnapshot> snapshot = get_snapshot();
+    std::map<std::string, double> balances;
+    for (const auto& shard : snapshot->shards) {
+        for (const auto& [address, account] : *shard) {
+            balances.emplace(address, account.balance);
+        }
+    }
+    return balances;
 }
 
 // Account State Synchronization Methods (NEW)
 std::map<std::string, std::pair<double, uint64_t>> Blockchain::get_account_state() const {
-    std::lock_guard<std::mutex> lock(chain_mutex);
+    std::shared_ptr<const ChainSnapshot> snapshot = get_snapshot();
     std::map<std::string, std::pair<double, uint64_t>> state;
     
     // Combine balances and nonces
-    for (const auto& [addr, balance] : account_balances) {
-        uint64_t nonce = 0;
-        if (account_nonces.count(addr)) {
-            nonce = account_nonces.at(addr);
+    for (const auto& shard : snapshot->shards) {
+        for (const auto& [address, account] : *shard) {
+            state.emplace(address, std::make_pair(account.balance, account.nonce));
         }
-        state[addr] = {balance, nonce};
     }
     
     return state;
 }
 
 std::string Blockchain::get_state_root() const {
+    return get_snapshot()->state_root;
+}
+
+int Blockchain::get_difficulty() const {
+    return get_snapshot()->difficulty;
+}
+
+bool Blockchain::get_state_proof(const std::string& address, StateTree::Proof& proof,
+                                 std::string& state_root) const {
     std::lock_guard<std::mutex> lock(chain_mutex);
-    return _calculate_state_root();
+    AccountRecord record;
+    if (!accounts_->get(address, record) || !record.has_balance) {
+        return false;
+    }
+    if (!state_tree_.prove(address, record.balance, record.has_nonce ? record.nonce : 0, proof)) {
+        return false;
+    }
+    state_root = _calculate_state_root();
+    return true;
 }
 
 bool Blockchain::sync_state(const std::map<std::string, std::pair<double, uint64_t>>& remote_state) {
-    std::lock_guard<std::mutex> lock(chain_mutex);
-    
-    // Compare local state with remote state
+    // Compare local state with remote state (one consistent snapshot)
     auto local_state = get_account_state();
     
     if (local_state.size() != remote_state.size()) {
@@ -520,11 +1062,11 @@ Transaction Blockchain::create_transaction(const std::string& from, const std::s
                                           const std::string& private_key) {
     std::lock_guard<std::mutex> lock(chain_mutex);
     
-    // Get next nonce for this account
-    uint64_t nonce = 0;
-    auto it = account_nonces.find(from);
-    if (it != account_nonces.end()) {
-        nonce = it->second + 1;
+    // Next nonce for this account, after any transactions already pending
+    uint64_t nonce;
+    {
+        std::lock_guard<std::mutex> mempool_lock(mempool_mutex);
+        nonce = mempool_.next_pending_nonce(from, _next_unreserved_nonce(*get_snapshot(), from));
     }
     
     return create_transaction_with_nonce(from, to, amount, gas_price, nonce, private_key);
@@ -566,24 +1108,108 @@ Transaction Blockchain::create_transaction_with_nonce(const std::string& from,
 // ============= TRANSACTION POOL =============
 void Blockchain::add_transaction(const Transaction& tx) {
     std::lock_guard<std::mutex> mempool_lock(mempool_mutex);
+
+    // Cheap duplicate rejection before signature verification
+    if (mempool_.contains(tx.transaction_id)) {
+        throw BlockchainException(Mempool::describe(Mempool::AddResult::DUPLICATE));
+    }
     
     if (!_validate_transaction(tx)) {
         throw BlockchainException("Transaction validation failed");
     }
     
-    // Check mempool capacity and evict oldest transactions if needed
-    if (mempool.size() >= MAX_MEMPOOL_SIZE) {
-        LOG_WARN("Blockchain", "Mempool at capacity (" + std::to_string(MAX_MEMPOOL_SIZE) + 
-                 "), evicting " + std::to_string(MEMPOOL_EVICT_SIZE) + " oldest transactions");
-        
-        // Remove oldest MEMPOOL_EVICT_SIZE transactions (FIFO)
-        for (size_t i = 0; i < MEMPOOL_EVICT_SIZE && !mempool.empty(); ++i) {
-            mempool.pop();
+    // Hash the merkle leaf once here rather than at every block build/validation
+    Transaction admitted = tx;
+    admitted.cache_merkle_leaf();
+
+    Mempool::AddResult result = mempool_.add(std::move(admitted));
+    switch (result) {
+        case Mempool::AddResult::ADDED:
+            break;
+        case Mempool::AddResult::REPLACED:
+            LOG_DEBUG("Blockchain", "Transaction " + tx.transaction_id.substr(0, 16) +
+                      " replaced pending nonce " + std::to_string(tx.nonce) + " from " + tx.from);
+            break;
+        case Mempool::AddResult::UNDERPRICED:
+            LOG_WARN("Blockchain", "Mempool at capacity (" + std::to_string(MAX_MEMPOOL_SIZE) +
+                     "), rejecting transaction below lowest fee " + std::to_string(mempool_.lowest_fee()));
+            throw BlockchainException(Mempool::describe(result));
+        default:
+            throw BlockchainException(Mempool::describe(result));
+    }
+
+    LOG_DEBUG("Blockchain", "Transaction added to mempool (size: " + std::to_string(mempool_.size()) + ")");
+}
+
+std::vector<TransactionVerdict> Blockchain::add_transactions(const std::vector<Transaction>& transactions) {
+    std::vector<TransactionVerdict> verdicts(transactions.size());
+
+    // Stage 1: signature, hash and field checks in parallel, no locks held.
+    // Merkle leaves are hashed here too so admission only copies them.
+    std::vector<uint8_t> stateless_ok(transactions.size(), 0);
+    std::vector<MerkleTree::Hash> leaves(transactions.size());
+    _worker_pool().parallel_for(transactions.size(), [&](size_t i) {
+        verdicts[i].transaction_id = transactions[i].transaction_id;
+        if (_check_transaction_stateless(transactions[i], verdicts[i].error)) {
+            stateless_ok[i] = 1;
+            leaves[i] = transactions[i].merkle_leaf();
+        } else {
+            // Fields the id commits to fail for every copy; a bad signature or id may be one corrupt copy
+            verdicts[i].permanent = transactions[i].transaction_id == transactions[i].calculate_hash() &&
+                                    _verify_ecdsa_signature(transactions[i]);
+        }
+    }, PARALLEL_VALIDATION_MIN_CHUNK);
+
+    // Stage 2: nonce/balance checks and admission under a single lock. Visit each
+    // sender's transactions in nonce order so a batch may carry a whole lane.
+    std::vector<size_t> order;
+    order.reserve(transactions.size());
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        if (stateless_ok[i]) {
+            order.push_back(i);
         }
     }
-    
-    mempool.push(tx);
-    LOG_DEBUG("Blockchain", "Transaction added to mempool (size: " + std::to_string(mempool.size()) + ")");
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const Transaction& ta = transactions[a];
+        const Transaction& tb = transactions[b];
+        if (ta.from != tb.from) return ta.from < tb.from;
+        return ta.nonce < tb.nonce;
+    });
+
+    size_t accepted = 0;
+    {
+        std::lock_guard<std::mutex> mempool_lock(mempool_mutex);
+        for (size_t i : order) {
+            const Transaction& tx = transactions[i];
+            TransactionVerdict& verdict = verdicts[i];
+
+            if (mempool_.contains(tx.transaction_id)) {
+                verdict.error = Mempool::describe(Mempool::AddResult::DUPLICATE);
+                verdict.permanent = true;
+                continue;
+            }
+            if (!_check_transaction_stateful(tx, verdict.error)) {
+                continue;
+            }
+
+            Transaction admitted = tx;
+            admitted.merkle_leaf_cache = leaves[i];
+            admitted.merkle_leaf_cached = true;
+
+            Mempool::AddResult result = mempool_.add(std::move(admitted));
+            if (result == Mempool::AddResult::ADDED || result == Mempool::AddResult::REPLACED) {
+                verdict.accepted = true;
+                ++accepted;
+            } else {
+                verdict.error = Mempool::describe(result);
+            }
+        }
+    }
+
+    LOG_DEBUG("Blockchain", "Batch validation accepted " + std::to_string(accepted) + "/" +
+              std::to_string(transactions.size()) + " transactions (" +
+              std::to_string(_worker_pool().size()) + " workers)");
+    return verdicts;
 }
 
 // ============= POW & HASHING =============
@@ -593,27 +1219,51 @@ std::string Blockchain::_to_digest(long long new_proof, long long previous_proof
     return std::to_string(calculation) + data;
 }
 
-long long Blockchain::_proof_of_work(long long previous_proof, int index,
-                                     const std::string& data, int diff) const {
-    long long nonce = 0;
-    bool check_proof = false;
+ParallelMiner::Result Blockchain::_proof_of_work(long long previous_proof, int index,
+                                                 const std::string& data, int diff) const {
+    if (pow_version_ == POW_VERSION_MIDSTATE) {
+        // Constant header hashed once; workers only compress the nonce block
+        PowKernel pow_kernel(previous_proof, index, data);
+        return miner_.search([&](long long begin, long long end, long long& found_nonce) {
+            return pow_kernel.search(begin, end, diff, found_nonce);
+        });
+    }
+
     std::string target(diff, '0');
 
-    while (!check_proof) {
-        std::string to_digest = _to_digest(nonce, previous_proof, index, data);
-        std::string hash_operation = sha256(to_digest);
+    // Each worker scans its claimed nonce range independently
+    auto kernel = [&](long long begin, long long end, long long& found_nonce) {
+        for (long long nonce = begin; nonce < end; ++nonce) {
+            std::string to_digest = _to_digest(nonce, previous_proof, index, data);
+            std::string hash_operation = sha256(to_digest);
 
-        if (hash_operation.substr(0, diff) == target) {
-            check_proof = true;
-        } else {
-            nonce++;
+            if (hash_operation.compare(0, diff, target) == 0) {
+                found_nonce = nonce;
+                return true;
+            }
         }
-    }
+        return false;
+    };
 
-    return nonce;
+    return miner_.search(kernel);
+}
+
+void Blockchain::cancel_mining(int competing_index) {
+    int mining = mining_index_.load();
+    if (mining == 0) {
+        return;
+    }
+    if (competing_index <= 0 || competing_index >= mining) {
+        LOG_INFO("Blockchain", "Cancelling mining of block #" + std::to_string(mining) + 
+                 " (competing block #" + std::to_string(competing_index) + ")");
+        miner_.cancel();
+    }
 }
 
 std::string Blockchain::_hash(const Block& block) const {
+    if (block.is_header_only()) {
+        return block.header_hash;  // The body it was computed over is not kept
+    }
     json j = block.to_json();
     std::string encoded_block = j.dump();
     return sha256(encoded_block);
@@ -621,48 +1271,117 @@ std::string Blockchain::_hash(const Block& block) const {
 
 // ============= MINING =============
 Block Blockchain::mine_block(int max_transactions) {
-    std::lock_guard<std::mutex> lock(chain_mutex);
+    // Template under chain_mutex, proof-of-work without it, then commit if the tip held
+    std::lock_guard<std::mutex> mining_lock(mining_mutex_);
     
-    if (chain.empty()) {
-        throw BlockchainException("Chain is empty");
-    }
-
-    LOG_INFO("Blockchain", "Starting mining block #" + std::to_string(chain.size() + 1));
-
-    Block previous_block = chain.back();
-    long long previous_proof = previous_block.proof;
-    int index = chain.size() + 1;
-
+    long long previous_proof;
+    int index;
+    std::string previous_hash;
     std::vector<Transaction> block_transactions;
-    int tx_count = 0;
-    while (!mempool.empty() && tx_count < max_transactions) {
-        block_transactions.push_back(mempool.front());
-        mempool.pop();
-        tx_count++;
-    }
+    std::string merkle_root;
+    std::string pow_data;
+    int block_difficulty;
+    {
+        std::lock_guard<std::mutex> lock(chain_mutex);
+        memory_utils::MonotonicArena::Scope scope(block_arena_);  // Not held across the search
+        
+        if (chain.empty()) {
+            throw BlockchainException("Chain is empty");
+        }
+        if (catching_up_) {
+            throw BlockchainException("Replaying stored blocks - mining resumes once caught up");
+        }
+
+        LOG_INFO("Blockchain", "Starting mining block #" + std::to_string(chain.size() + 1));
+
+        previous_proof = chain.back().proof;
+        index = chain.size() + 1;
+        previous_hash = block_hashes_.back();
+
+        if (max_transactions > 0) {
+            std::lock_guard<std::mutex> mempool_lock(mempool_mutex);
+            block_transactions = mempool_.take_best(static_cast<size_t>(max_transactions),
+                [this](const std::string& sender) { return _next_confirmed_nonce(sender); });
+            for (const auto& tx : block_transactions) {
+                uint64_t& reserved = mining_reserved_[tx.from];
+                reserved = std::max(reserved, tx.nonce + 1);
+            }
+        }
 
-    LOG_DEBUG("Blockchain", "Mining with " + std::to_string(block_transactions.size()) + " transactions");
+        LOG_DEBUG("Blockchain", "Mining with " + std::to_string(block_transactions.size()) + " transactions");
 
-    difficulty = _calculate_difficulty();
-    LOG_DEBUG("Blockchain", "Difficulty: " + std::to_string(difficulty));
+        difficulty = _calculate_difficulty();
+        block_difficulty = difficulty;
+        LOG_DEBUG("Blockchain", "Difficulty: " + std::to_string(difficulty));
+        _publish_snapshot();
 
-    std::string tx_data;
-    for (const auto& tx : block_transactions) {
-        tx_data += tx.to_json().dump();
+        // Midstate PoW commits to the merkle root so validators can recompute it from the block
+        if (pow_version_ == POW_VERSION_MIDSTATE) {
+            merkle_root = _calculate_merkle_root(block_transactions, pow_version_);
+            pow_data = merkle_root;
+        } else {
+            for (const auto& tx : block_transactions) {
+                pow_data += tx.to_json().dump();
+            }
+        }
     }
 
-    long long proof = _proof_of_work(previous_proof, index, tx_data, difficulty);
-    std::string previous_hash = _hash(previous_block);
+    miner_.arm();
+    mining_index_ = index;
+    ParallelMiner::Result pow = _proof_of_work(previous_proof, index, pow_data, block_difficulty);
+    mining_index_ = 0;
+    {
+        static metrics::Counter& hashes = metrics::counter("pow_hashes_total", "Proof-of-work hashes tried");
+        static metrics::Gauge& hashrate = metrics::gauge("pow_hashes_per_second", "Hash rate of the last proof-of-work search");
+        hashes.inc(pow.hashes);
+        hashrate.set(pow.hashes_per_second());
+    }
 
-    Block block = _create_block(block_transactions, proof, previous_hash, index);
+    std::lock_guard<std::mutex> lock(chain_mutex);
+
+    // A block accepted while we searched makes this proof worthless
+    bool tip_moved = static_cast<int>(chain.size()) + 1 != index || block_hashes_.back() != previous_hash;
+    if (!pow.found || tip_moved) {
+        // Return the transactions to the pool; a block that filled the gap will
+        // have consumed their nonces and take_best() drops them as stale
+        {
+            std::lock_guard<std::mutex> mempool_lock(mempool_mutex);
+            mining_reserved_.clear();
+            for (const auto& tx : block_transactions) {
+                mempool_.add(tx);
+            }
+        }
+        
+        LOG_WARN("Blockchain", "Mining of block #" + std::to_string(index) + " cancelled after " +
+                 std::to_string(pow.hashes) + " hashes");
+        throw BlockchainException("Mining cancelled: competing block received");
+    }
+
+    // Block scratch is released in one go once the block is committed
+    memory_utils::MonotonicArena::Scope scope(block_arena_);
+    long long proof = pow.nonce;
+    last_hashrate_ = pow.hashes_per_second();
+    LOG_INFO("Blockchain", "Proof found after " + std::to_string(pow.hashes) + " hashes in " +
+             std::to_string(pow.seconds) + "s (" + std::to_string(static_cast<long long>(pow.hashes_per_second())) +
+             " H/s on " + std::to_string(pow.threads) + " threads, " +
+             (pow_version_ == POW_VERSION_MIDSTATE ? PowKernel::backend_name() : "legacy") + ")");
+
+    Block block = _create_block(block_transactions, proof, previous_hash, index, merkle_root);
     
     // Update balances after mining
     _update_balances(block_transactions);
     
-    chain.push_back(block);
+    _append_block(block);
+    _publish_snapshot();
+    {
+        // The committed nonces now cover what was reserved
+        std::lock_guard<std::mutex> mempool_lock(mempool_mutex);
+        mining_reserved_.clear();
+    }
     
     // Save to persistent storage
-    persistent_store_.save_block(block.to_json());
+    _store_new_blocks();
+    _evict_bodies();
     
     LOG_INFO("Blockchain", "Block #" + std::to_string(index) + " mined successfully with proof: " + std::to_string(proof));
 
@@ -672,7 +1391,10 @@ Block Blockchain::mine_block(int max_transactions) {
 // ============= ADVANCED BLOCK VALIDATION (PHASE 5) =============
 
 bool Blockchain::_verify_block_merkle_root(const Block& block) const {
-    std::string calculated_merkle = _calculate_merkle_root(block.transactions);
+    if (block.is_header_only()) {
+        return true;  // No transactions to check; the header was verified when installed
+    }
+    std::string calculated_merkle = _calculate_merkle_root(block.transactions, block.pow_version);
     if (block.merkle_root != calculated_merkle) {
         LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
                  " merkle root mismatch: expected " + calculated_merkle.substr(0, 16) +
@@ -683,47 +1405,37 @@ bool Blockchain::_verify_block_merkle_root(const Block& block) const {
 }
 
 bool Blockchain::_verify_block_timestamp(const Block& block, const Block& previous_block) const {
-    // Parse timestamps
-    auto parse_time = [](const std::string& timestamp_str) -> int64_t {
-        // Format: "2026-02-06 03:30:09"
-        std::tm tm = {};
-        std::istringstream ss(timestamp_str);
-        ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
-        return std::mktime(&tm);
-    };
-    
-    try {
-        int64_t prev_time = parse_time(previous_block.timestamp);
-        int64_t block_time = parse_time(block.timestamp);
-        int64_t current_time = std::time(nullptr);
-        
-        // 1. Block timestamp must be after previous block
-        if (block_time <= prev_time) {
-            LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
-                     " timestamp not after previous block");
-            return false;
-        }
-        
-        // 2. Block timestamp must not be too far in the future
-        if (block_time > current_time + MAX_BLOCK_FUTURE_TIME) {
-            LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
-                     " timestamp too far in future");
-            return false;
-        }
-        
-        // 3. Block must respect minimum time between blocks
-        if (block_time - prev_time < MIN_BLOCK_TIME) {
-            LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
-                     " time delta too small (" + std::to_string(block_time - prev_time) + "s)");
-            return false;
-        }
-        
-        return true;
-    } catch (...) {
+    int64_t prev_time = previous_block.unix_time();
+    int64_t block_time = block.unix_time();
+    int64_t current_time = std::time(nullptr);
+    if (prev_time < 0 || block_time < 0) {
         LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
                  " timestamp parsing failed");
         return false;
     }
+    
+    // 1. Block timestamp must be after previous block
+    if (block_time <= prev_time) {
+        LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
+                 " timestamp not after previous block");
+        return false;
+    }
+    
+    // 2. Block timestamp must not be too far in the future
+    if (block_time > current_time + MAX_BLOCK_FUTURE_TIME) {
+        LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
+                 " timestamp too far in future");
+        return false;
+    }
+    
+    // 3. Block must respect minimum time between blocks
+    if (block_time - prev_time < MIN_BLOCK_TIME) {
+        LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
+                 " time delta too small (" + std::to_string(block_time - prev_time) + "s)");
+        return false;
+    }
+    
+    return true;
 }
 
 bool Blockchain::_verify_transaction_nonce_ordering(const Block& block) const {
@@ -736,8 +1448,7 @@ bool Blockchain::_verify_transaction_nonce_ordering(const Block& block) const {
         auto it = expected_nonces.find(tx.from);
         if (it == expected_nonces.end()) {
             // First transaction from this sender must have nonce 0 or account's current nonce
-            auto account_it = account_nonces.find(tx.from);
-            uint64_t expected = account_it == account_nonces.end() ? 0 : account_it->second + 1;
+            uint64_t expected = _next_confirmed_nonce(tx.from);
             
             if (tx.nonce != expected) {
                 LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
@@ -761,41 +1472,31 @@ bool Blockchain::_verify_transaction_nonce_ordering(const Block& block) const {
     return true;
 }
 
-bool Blockchain::_verify_block_difficulty(const Block& block) const {
-    // Check if this is a retarget block
-    if (block.index > 1 && block.index % DIFFICULTY_RETARGET_INTERVAL == 0) {
-        // This block should have adjusted difficulty
-        // For now, just verify the proof meets some minimum difficulty
-        std::string target(4, '0');  // Minimum: 4 leading zeros
-        long long prev_proof = (block.index > 1) ? chain[block.index - 1].proof : 1;
-        std::string to_digest = _to_digest(block.proof, prev_proof, block.index, block.merkle_root);
-        std::string hash_result = sha256(to_digest);
-        
-        if (hash_result.substr(0, 4) != target) {
-            LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
-                     " does not meet minimum difficulty");
-            return false;
-        }
+bool Blockchain::_verify_block_difficulty(const Block& block, const Block& previous_block) const {
+    // Minimum accepted difficulty: 4 leading zero hex digits
+    const int min_difficulty = 4;
+    bool meets_target = false;
+    
+    if (block.pow_version == POW_VERSION_MIDSTATE) {
+        PowKernel pow_kernel(previous_block.proof, block.index, block.merkle_root);
+        meets_target = pow_kernel.meets_difficulty(block.proof, min_difficulty);
     } else {
-        // Regular block: verify proof meets difficulty
-        long long prev_proof = (block.index > 1) ? chain[block.index - 1].proof : 1;
-        std::string to_digest = _to_digest(block.proof, prev_proof, block.index, block.merkle_root);
-        std::string hash_result = sha256(to_digest);
-        
-        std::string target(4, '0');
-        if (hash_result.substr(0, 4) != target) {
-            LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
-                     " proof of work invalid");
-            return false;
-        }
+        std::string target(min_difficulty, '0');
+        std::string to_digest = _to_digest(block.proof, previous_block.proof, block.index, block.merkle_root);
+        meets_target = sha256(to_digest).compare(0, min_difficulty, target) == 0;
+    }
+    
+    if (!meets_target) {
+        bool retarget = block.index > 1 && block.index % DIFFICULTY_RETARGET_INTERVAL == 0;
+        LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + 
+                 (retarget ? " does not meet minimum difficulty" : " proof of work invalid"));
+        return false;
     }
     
     return true;
 }
 
-bool Blockchain::_validate_block_advanced(const Block& block, const Block& previous_block) const {
-    // Comprehensive block validation (Phase 5)
-    
+bool Blockchain::_verify_block_standalone(const Block& block, const Block& previous_block) const {
     // 1. Verify merkle root
     if (!_verify_block_merkle_root(block)) {
         LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + " failed merkle verification");
@@ -808,15 +1509,26 @@ bool Blockchain::_validate_block_advanced(const Block& block, const Block& previ
         return false;
     }
     
-    // 3. Verify transaction nonce ordering
-    if (!_verify_transaction_nonce_ordering(block)) {
-        LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + " failed nonce ordering verification");
+    // 3. Verify difficulty
+    if (!_verify_block_difficulty(block, previous_block)) {
+        LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + " failed difficulty verification");
         return false;
     }
     
-    // 4. Verify difficulty
-    if (!_verify_block_difficulty(block)) {
-        LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + " failed difficulty verification");
+    return true;
+}
+
+bool Blockchain::_validate_block_advanced(const Block& block, const Block& previous_block) const {
+    // Comprehensive block validation (Phase 5). Nonce ordering and the state root
+    // are checked against the current account state, so `block` must extend the tip.
+    
+    if (!_verify_block_standalone(block, previous_block)) {
+        return false;
+    }
+    
+    // 4. Verify transaction nonce ordering
+    if (!_verify_transaction_nonce_ordering(block)) {
+        LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + " failed nonce ordering verification");
         return false;
     }
     
@@ -839,32 +1551,189 @@ bool Blockchain::is_chain_valid() const {
     
     if (chain.empty()) return false;
 
-    Block previous_block = chain[0];
-    size_t block_index = 1;
+    size_t failed_at = 0;
+    if (!_audit_range(1, chain.size(), true, failed_at)) {
+        LOG_WARN("Blockchain", "Chain validation FAILED at position " + std::to_string(failed_at));
+        return false;
+    }
 
-    while (block_index < chain.size()) {
-        Block block = chain[block_index];
+    LOG_INFO("Blockchain", "Chain validation PASSED ✓ - All " + std::to_string(chain.size()) + " blocks valid");
+    return true;
+}
 
-        // Check hash linkage
-        if (block.previous_hash != _hash(previous_block)) {
+bool Blockchain::_audit_range(size_t begin, size_t end, bool parallel, size_t& failed_at) const {
+    // Caller holds chain_mutex. Genesis (position 0) has no parent and is trusted.
+    begin = std::max<size_t>(begin, 1);
+    if (begin >= end) {
+        return true;
+    }
+
+    // Stage 1: per-block work that reads only the block and its parent
+    size_t count = end - begin;
+    std::vector<std::string> hashes(count + 1);
+    std::vector<uint8_t> standalone_ok(count, 0);
+    // Evicted bodies are read back so their hashes are recomputed, not taken from the shell
+    auto check_block = [&](size_t i) {
+        size_t position = begin + i;
+        Block scratch;
+        const Block& block = _block_at(position, scratch);
+        hashes[i + 1] = _hash(block);
+        standalone_ok[i] = _verify_block_standalone(block, chain[position - 1]) ? 1 : 0;
+    };
+    Block first_parent;
+    hashes[0] = _hash(_block_at(begin - 1, first_parent));
+    if (parallel) {
+        _worker_pool().parallel_for(count, check_block);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            check_block(i);
+        }
+    }
+
+    // Stage 2: linkage, in order, against the freshly computed hashes
+    for (size_t i = 0; i < count; ++i) {
+        size_t position = begin + i;
+        const Block& block = chain[position];
+        if (block.previous_hash != hashes[i]) {
             LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + " previous hash mismatch");
+            failed_at = position;
             return false;
         }
-
-        // Use advanced validation (Phase 5)
-        if (!_validate_block_advanced(block, previous_block)) {
-            LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + " failed advanced validation");
+        if (hashes[i + 1] != block_hashes_[position]) {
+            LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + " hash index out of date");
+            failed_at = position;
             return false;
         }
+        if (!standalone_ok[i]) {
+            failed_at = position;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Blockchain::accept_block(const Block& block) {
+    static metrics::Histogram& validation = metrics::histogram("block_accept_seconds",
+        "Time to validate and apply a network block, whether accepted or not");
+    metrics::ScopedTimer timer(validation);
+    std::lock_guard<std::mutex> lock(chain_mutex);
 
-        previous_block = block;
-        block_index++;
+    if (chain.empty() || block.is_header_only()) {
+        return false;
+    }
+    if (catching_up_) {
+        // Our tip is behind the stored chain; sync fetches the block again afterwards
+        LOG_DEBUG("Blockchain", "Catching up - block " + std::to_string(block.index) + " not accepted");
+        return false;
     }
 
-    LOG_INFO("Blockchain", "Chain validation PASSED ✓ - All " + std::to_string(chain.size()) + " blocks valid");
+    // Only the parent is consulted; history behind the checkpoint is not revisited
+    const Block& parent = chain.back();
+    if (block.index != parent.index + 1 || block.previous_hash != block_hashes_.back()) {
+        LOG_WARN("Blockchain", "Block " + std::to_string(block.index) + " does not extend tip #" +
+                 std::to_string(parent.index));
+        return false;
+    }
+
+    memory_utils::MonotonicArena::Scope scope(block_arena_);
+    if (!_validate_block_advanced(block, parent)) {
+        return false;
+    }
+
+    _update_balances(block.transactions);
+    _append_block(block);
+    _publish_snapshot();
+    _store_new_blocks();
+    _evict_bodies();
+
+    // Drop what the block confirmed; stale nonces are pruned at the next take_best()
+    {
+        std::lock_guard<std::mutex> mempool_lock(mempool_mutex);
+        for (const auto& tx : block.transactions) {
+            mempool_.remove(tx.transaction_id);
+        }
+    }
+
+    LOG_INFO("Blockchain", "Accepted block #" + std::to_string(block.index) + " with " +
+             std::to_string(block.transactions.size()) + " transactions");
+    return true;
+}
+
+// ============= CHAIN AUDIT =============
+bool Blockchain::audit_chain(size_t max_blocks, bool parallel) {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+
+    if (audit_failed_) {
+        return false;
+    }
+
+    size_t begin = validated_height_;
+    size_t end = chain.size();
+    if (max_blocks > 0) {
+        end = std::min(end, begin + max_blocks);
+    }
+
+    size_t failed_at = 0;
+    if (!_audit_range(begin, end, parallel, failed_at)) {
+        audit_failed_ = true;
+        audit_failed_position_ = failed_at;
+        validated_height_ = failed_at;
+        LOG_ERROR("Blockchain", "Chain audit failed at position " + std::to_string(failed_at));
+        return false;
+    }
+
+    validated_height_ = std::max(validated_height_, end);
     return true;
 }
 
+void Blockchain::start_chain_audit(bool parallel, bool from_genesis) {
+    stop_chain_audit();
+
+    if (from_genesis) {
+        std::lock_guard<std::mutex> lock(chain_mutex);
+        validated_height_ = chain.empty() ? 0 : 1;
+        audit_failed_ = false;
+    }
+
+    audit_stop_ = false;
+    audit_running_ = true;
+    audit_thread_ = std::thread([this, parallel]() {
+        LOG_INFO("Blockchain", "Chain audit started");
+        while (!audit_stop_) {
+            if (!audit_chain(AUDIT_BATCH_SIZE, parallel)) {
+                break;
+            }
+            ChainAuditStatus status = get_audit_status();
+            if (status.validated_height >= status.chain_height) {
+                LOG_INFO("Blockchain", "Chain audit complete: " + std::to_string(status.validated_height) +
+                         " blocks valid");
+                break;
+            }
+        }
+        audit_running_ = false;
+    });
+}
+
+void Blockchain::stop_chain_audit() {
+    // The checkpoint is kept, so a later start_chain_audit() resumes from it
+    audit_stop_ = true;
+    if (audit_thread_.joinable()) {
+        audit_thread_.join();
+    }
+    audit_running_ = false;
+}
+
+ChainAuditStatus Blockchain::get_audit_status() const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    ChainAuditStatus status;
+    status.validated_height = validated_height_;
+    status.chain_height = chain.size();
+    status.running = audit_running_;
+    status.failed = audit_failed_;
+    status.failed_position = audit_failed_position_;
+    return status;
+}
+
 bool Blockchain::is_chain_valid_with_state() const {
     // Verify both chain integrity and state roots (NEW: Account state sync)
     if (!is_chain_valid()) {
@@ -889,14 +1758,179 @@ bool Blockchain::is_chain_valid_with_state() const {
 
 std::vector<Block> Blockchain::get_chain() const {
     std::lock_guard<std::mutex> lock(chain_mutex);
-    return chain;
+    std::vector<Block> blocks;
+    blocks.reserve(chain.size());
+    for (size_t i = 0; i < chain.size(); ++i) {
+        Block scratch;
+        blocks.push_back(_block_at(i, scratch));
+    }
+    return blocks;
+}
+
+size_t Blockchain::get_chain_height() const {
+    return get_snapshot()->height;
+}
+
+size_t Blockchain::get_total_transactions() const {
+    return get_snapshot()->total_transactions;
+}
+
+bool Blockchain::get_block(size_t position, Block& block) const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    if (position >= chain.size()) {
+        return false;
+    }
+    Block scratch;
+    block = _block_at(position, scratch);
+    return true;
+}
+
+bool Blockchain::get_header(size_t position, BlockHeader& header) const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    if (position >= chain.size()) {
+        return false;
+    }
+    header = _header_at(position);
+    return true;
+}
+
+bool Blockchain::get_transaction_proof(size_t position, const std::string& transaction_id,
+                                       MerkleProof& proof, std::string& merkle_root) const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    if (position >= chain.size()) {
+        return false;
+    }
+
+    Block scratch;
+    const Block& block = _block_at(position, scratch);
+    if (block.pow_version < POW_VERSION_MIDSTATE) {
+        return false;  // Legacy merkle layout hashes hex strings; no binary proofs
+    }
+
+    auto it = std::find_if(block.transactions.begin(), block.transactions.end(),
+                           [&](const Transaction& tx) { return tx.transaction_id == transaction_id; });
+    if (it == block.transactions.end()) {
+        return false;
+    }
+
+    MerkleTree tree(_merkle_leaves(block.transactions));
+    if (!tree.prove(static_cast<size_t>(it - block.transactions.begin()), proof)) {
+        return false;
+    }
+    merkle_root = block.merkle_root;
+    return true;
+}
+
+bool Blockchain::get_block_by_hash(const std::string& hash, Block& block, size_t* position) const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    
+    size_t found = chain.size();
+    auto it = hash_index_.find(hash);
+    if (it != hash_index_.end()) {
+        found = it->second;
+    } else if (!hash.empty() && hash.length() < 64) {
+        // Prefix lookups compare against cached hashes; no re-hashing
+        for (size_t i = 0; i < block_hashes_.size(); ++i) {
+            if (block_hashes_[i].compare(0, hash.length(), hash) == 0) {
+                found = i;
+                break;
+            }
+        }
+    }
+    
+    if (found >= chain.size()) {
+        return false;
+    }
+    Block scratch;
+    block = _block_at(found, scratch);
+    if (position) {
+        *position = found;
+    }
+    return true;
+}
+
+std::string Blockchain::get_block_hash(size_t position) const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    return position < block_hashes_.size() ? block_hashes_[position] : std::string();
+}
+
+std::vector<Block> Blockchain::get_blocks(size_t start, size_t count) const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    if (start >= chain.size()) {
+        return {};
+    }
+    size_t end = std::min(chain.size(), start + count);
+    std::vector<Block> blocks;
+    blocks.reserve(end - start);
+    for (size_t position = start; position < end; ++position) {
+        Block scratch;
+        blocks.push_back(_block_at(position, scratch));
+    }
+    return blocks;
+}
+
+std::vector<std::string> Blockchain::get_block_locator() const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    std::vector<std::string> locator;
+    if (block_hashes_.empty()) {
+        return locator;
+    }
+    size_t step = 1;
+    for (size_t position = block_hashes_.size() - 1; ; ) {
+        locator.push_back(block_hashes_[position]);
+        if (position == 0) {
+            break;
+        }
+        if (locator.size() >= 10) {
+            step *= 2;
+        }
+        position = position > step ? position - step : 0;
+    }
+    return locator;
+}
+
+std::vector<BlockHeader> Blockchain::get_headers_after(const std::vector<std::string>& locator,
+                                                       size_t max_count) const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    std::vector<BlockHeader> headers;
+    for (const auto& hash : locator) {
+        auto it = hash_index_.find(hash);
+        if (it == hash_index_.end()) {
+            continue;
+        }
+        size_t end = std::min(chain.size(), it->second + 1 + max_count);
+        headers.reserve(end - it->second - 1);
+        for (size_t position = it->second + 1; position < end; ++position) {
+            headers.push_back(_header_at(position));
+        }
+        break;
+    }
+    return headers;
+}
+
+bool Blockchain::verify_header(const BlockHeader& header, const BlockHeader& parent) const {
+    if (header.index != parent.index + 1 || header.previous_hash != parent.hash) {
+        LOG_WARN("Blockchain", "Header " + std::to_string(header.index) + " does not extend #" +
+                 std::to_string(parent.index));
+        return false;
+    }
+    // The proof commits to index, parent proof and merkle root, all carried by the header
+    Block shell;
+    shell.index = header.index;
+    shell.merkle_root = header.merkle_root;
+    shell.proof = header.proof;
+    shell.pow_version = header.pow_version;
+    Block parent_shell;
+    parent_shell.proof = parent.proof;
+    return _verify_block_difficulty(shell, parent_shell);
 }
 
 json Blockchain::get_chain_json() const {
     std::lock_guard<std::mutex> lock(chain_mutex);
     json j = json::array();
-    for (const auto& block : chain) {
-        j.push_back(block.to_json());
+    for (size_t i = 0; i < chain.size(); ++i) {
+        Block scratch;
+        j.push_back(_block_at(i, scratch).to_json());
     }
     return j;
 }
@@ -912,14 +1946,17 @@ void Blockchain::save_to_file(const std::string& filename) const {
 
     json j = json::object();
     j["chain"] = json::array();
-    for (const auto& block : chain) {
-        j["chain"].push_back(block.to_json());
+    for (size_t i = 0; i < chain.size(); ++i) {
+        Block scratch;
+        j["chain"].push_back(_block_at(i, scratch).to_json());
     }
     
     j["balances"] = json::object();
-    for (const auto& [address, balance] : account_balances) {
-        j["balances"][address] = balance;
-    }
+    accounts_->for_each([&j](const std::string& address, const AccountRecord& record) {
+        if (record.has_balance) {
+            j["balances"][address] = record.balance;
+        }
+    });
 
     file << j.dump(2);
     file.close();
@@ -938,40 +1975,41 @@ void Blockchain::load_from_file(const std::string& filename) {
     file.close();
 
     chain.clear();
-    account_balances.clear();
+    accounts_->clear();
     
     for (const auto& block_json : j["chain"]) {
-        Block block;
-        block.index = block_json["index"];
-        block.timestamp = block_json["timestamp"];
-        block.merkle_root = block_json["merkle_root"];
-        block.proof = block_json["proof"];
-        block.previous_hash = block_json["previous_hash"];
-
-        for (const auto& tx_json : block_json["transactions"]) {
-            Transaction tx;
-            tx.from = tx_json["from"];
-            tx.to = tx_json["to"];
-            tx.amount = tx_json["amount"];
-            tx.gas_price = tx_json["gas_price"];
-            tx.timestamp = tx_json["timestamp"];
-            tx.signature = tx_json["signature"];
-            tx.public_key = tx_json["public_key"];
-            tx.transaction_id = tx_json["transaction_id"];
-            block.transactions.push_back(tx);
-        }
-
-        chain.push_back(block);
+        chain.push_back(Block::from_stored_json(block_json));
     }
 
+    AccountBatch batch;
     for (const auto& [address, balance] : j["balances"].items()) {
-        account_balances[address] = balance;
-    }
+        batch.emplace_back(address, AccountRecord{balance.get<double>(), 0, true, false});
+    }
+    accounts_->write(batch);
+    
+    // The block log still holds whatever chain was there; nothing is read back from it
+    persistence_writer_.flush();
+    persistence_writer_.set_committed_blocks(0);
+    resident_from_ = 0;
+    stored_blocks_ = 0;
+    _rebuild_block_index();
+    _rebuild_state_tree();
+    _publish_snapshot();
 }
 
 size_t Blockchain::get_mempool_size() const {
-    std::lock_guard<std::mutex> lock(chain_mutex);
-    return mempool.size();
+    std::lock_guard<std::mutex> lock(mempool_mutex);
+    return mempool_.size();
+}
+
+bool Blockchain::has_pending_transaction(const std::string& transaction_id) const {
+    std::lock_guard<std::mutex> lock(mempool_mutex);
+    return mempool_.contains(transaction_id);
+}
+
+bool Blockchain::get_pending_transaction(const std::string& transaction_id, Transaction& tx) const {
+    std::lock_guard<std::mutex> lock(mempool_mutex);
+    return mempool_.get(transaction_id, tx);
 }
 
 // ============= CONTRACT MANAGEMENT =============
@@ -986,10 +2024,10 @@ std::string Blockchain::deploy_contract(const std::string& creator, const std::s
     
     LOG_INFO("Blockchain", "Contract deployed successfully at address: " + address);
     
-    // Save to persistent storage
-    SmartContract* contract = contract_manager_.get_contract(address);
-    if (contract) {
-        persistent_store_.save_contract(contract->to_json());
+    // Save to persistent storage, compiled program included
+    json contract_json = contract_manager_.export_contract(address);
+    if (!contract_json.is_null()) {
+        persistence_writer_.enqueue_contract(std::move(contract_json));
     }
     
     return address;
@@ -1007,23 +2045,28 @@ bool Blockchain::call_contract(const std::string& contract_address, const std::s
         throw BlockchainException("Contract not found: " + contract_address);
     }
     
-    // Create execution context
+    // Reads go straight to the committed state; writes are buffered until the call succeeds
+    memory_utils::MonotonicArena::Scope scope(block_arena_);
+    StateOverlay overlay(*accounts_, contract->get_all_storage(), scope.resource());
+    
     ExecutionContext ctx;
     ctx.caller = caller;
     ctx.contract_address = contract_address;
     ctx.origin = caller;
     ctx.timestamp = std::time(nullptr);
     ctx.block_number = chain.size();
-    ctx.balances = account_balances;
     ctx.gas_remaining = 1000000;
+    ctx.gas_cost = 0;
+    ctx.state = &overlay;
     
-    // Execute contract
-    if (!contract_vm_.execute(contract, ctx)) {
+    // Execute contract with its cached compiled program
+    if (!contract_vm_.execute(contract, ctx, contract_manager_.get_program(*contract))) {
         throw BlockchainException("Contract execution failed: " + contract_vm_.get_error());
     }
     
-    // Update balances from execution
-    account_balances = ctx.balances;
+    // Only storage is kept. No block records a direct call, so balance changes
+    // (TRANSFER) stay inside the call until contract calls become transactions
+    overlay.apply_storage(*contract);
     
     return true;
 }
@@ -1037,27 +2080,55 @@ SmartContract* Blockchain::get_contract(const std::string& address) {
 bool Blockchain::save_blockchain_state() {
     try {
         std::lock_guard<std::mutex> lock(chain_mutex);
+        if (catching_up_) {
+            // The stored chain is longer than ours until the replay finishes
+            LOG_WARN("Blockchain", "Still catching up - state not saved");
+            return false;
+        }
         
-        json blocks_json = json::array();
-        for (const auto& block : chain) {
-            blocks_json.push_back(block.to_json());
+        // Blocks are appended as they commit; the log is rewritten only if it holds another chain
+        _store_new_blocks();
+        bool sync = storage_config_.durability == PersistDurability::FSYNC_BATCH;
+        persistence_writer_.flush();
+        if (persistence_writer_.committed_blocks() != chain.size() ||
+            static_cast<size_t>(persistent_store_.get_block_count()) != chain.size()) {
+            std::vector<json> blocks_json;
+            blocks_json.reserve(chain.size());
+            Block scratch;
+            for (size_t i = 0; i < chain.size(); ++i) {
+                blocks_json.push_back(_stored_block_json(_block_at(i, scratch), block_hashes_[i], transaction_counts_[i]));
+            }
+            // Through the writer, so it cannot interleave with a retried append
+            persistence_writer_.enqueue_rewrite(std::move(blocks_json));
+            stored_blocks_ = chain.size();
+            pruned_height_ = 0;
+            if (!persistence_writer_.flush()) {
+                // A checkpoint must not name blocks the log does not hold yet
+                LOG_WARN("Blockchain", "Block log rewrite failed - retrying in the background, state not saved");
+                return false;
+            }
         }
-        persistent_store_.save_blocks(blocks_json);
         
         json contracts_json = json::array();
         auto contract_addresses = contract_manager_.get_all_contracts();
         for (const auto& address : contract_addresses) {
-            SmartContract* contract = contract_manager_.get_contract(address);
-            if (contract) {
-                contracts_json.push_back(contract->to_json());
+            json contract_json = contract_manager_.export_contract(address);
+            if (!contract_json.is_null()) {
+                contracts_json.push_back(contract_json);
             }
         }
         persistent_store_.save_contracts(contracts_json);
         
+        // Accounts go to a checkpoint at the tip; a durable store already has them on disk
+        if (accounts_->durable()) {
+            accounts_->flush();
+        } else {
+            persistent_store_.save_state_checkpoint(_checkpoint_json(*std::atomic_load(&snapshot_)), sync);
+        }
         json state_json;
-        state_json["balances"] = account_balances;
-        state_json["nonces"] = account_nonces;
         state_json["difficulty"] = difficulty;
+        state_json["validated_height"] = validated_height_;
+        state_json["height"] = chain.size();
         persistent_store_.save_account_state(state_json);
         
         LOG_INFO("Blockchain", "State saved to persistent storage");
@@ -1068,60 +2139,294 @@ bool Blockchain::save_blockchain_state() {
     }
 }
 
-bool Blockchain::load_blockchain_state() {
+void Blockchain::_load_accounts_json(const json& balances, const json& nonces) {
+    std::map<std::string, AccountRecord> records;
+    for (const auto& [address, balance] : balances.items()) {
+        records[address].balance = balance.get<double>();
+        records[address].has_balance = true;
+    }
+    for (const auto& [address, nonce] : nonces.items()) {
+        records[address].nonce = nonce.get<uint64_t>();
+        records[address].has_nonce = true;
+    }
+    accounts_->clear();
+    accounts_->write(AccountBatch(records.begin(), records.end()));
+}
+
+void Blockchain::set_account_store(std::unique_ptr<AccountStore> store) {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    if (store->size() == 0) {
+        AccountBatch batch;
+        accounts_->for_each([&batch](const std::string& address, const AccountRecord& record) {
+            batch.emplace_back(address, record);
+        });
+        store->write(batch);
+    }
+    store->set_sync_writes(storage_config_.durability == PersistDurability::FSYNC_BATCH);
+    accounts_ = std::move(store);
+    _rebuild_state_tree();
+    _publish_snapshot();
+    LOG_INFO("Blockchain", "Account store replaced (" + std::to_string(accounts_->size()) + " accounts)");
+}
+
+bool Blockchain::load_blockchain_state(bool background_replay) {
+    _stop_catch_up();
+    catch_up_failed_ = false;
     try {
         if (!persistent_store_.has_saved_data()) {
             LOG_INFO("Blockchain", "No saved state found - starting with fresh chain");
             return true;
         }
         
-        std::lock_guard<std::mutex> lock(chain_mutex);
+        std::unique_lock<std::mutex> lock(chain_mutex);
+        persistence_writer_.flush();
+        catch_up_set_aside_ = 0;
+        catch_up_side_file_.clear();
         
-        // Load blocks
-        auto blocks_json = persistent_store_.load_blocks();
-        chain.clear();
-        for (const auto& block_json : blocks_json) {
-            Block block;
-            block.index = block_json["index"];
-            block.timestamp = block_json["timestamp"];
-            block.merkle_root = block_json["merkle_root"];
-            block.proof = block_json["proof"];
-            block.previous_hash = block_json["previous_hash"];
-            
-            for (const auto& tx_json : block_json["transactions"]) {
-                Transaction tx;
-                tx.from = tx_json["from"];
-                tx.to = tx_json["to"];
-                tx.amount = tx_json["amount"];
-                tx.gas_price = tx_json["gas_price"];
-                tx.timestamp = tx_json["timestamp"];
-                tx.nonce = tx_json["nonce"];
-                block.transactions.push_back(tx);
+        // The checkpoint height decides which bodies the replay needs
+        json checkpoint;
+        bool have_checkpoint = !accounts_->durable() && persistent_store_.load_state_checkpoint(checkpoint);
+        AccountBatch checkpoint_accounts;
+        if (have_checkpoint) {
+            // Checked against its own root before any loaded state is replaced
+            StateTree checkpoint_tree;
+            checkpoint_accounts.reserve(checkpoint["accounts"].size());
+            for (const auto& row : checkpoint["accounts"]) {
+                AccountRecord record{row[1].get<double>(), row[2].get<uint64_t>(), true, row[3].get<bool>()};
+                checkpoint_tree.set(row[0].get<std::string>(), record.balance, record.has_nonce ? record.nonce : 0);
+                checkpoint_accounts.emplace_back(row[0].get<std::string>(), record);
+            }
+            if (checkpoint_tree.root_hex() != checkpoint.value("state_root", "")) {
+                LOG_ERROR("Blockchain", "State checkpoint does not match its state root");
+                return false;
+            }
+        }
+        size_t total = static_cast<size_t>(persistent_store_.get_block_count());
+        size_t keep_from = 0;  // Bodies from here on stay in memory
+        if (storage_config_.resident_blocks > 0 && total > storage_config_.resident_blocks) {
+            keep_from = total - storage_config_.resident_blocks;
+            if (have_checkpoint) {
+                keep_from = std::min(keep_from, checkpoint.value("height", static_cast<size_t>(0)));
+            }
+        }
+        
+        // Decode the mapped block records in parallel, a batch at a time so evicted
+        // bodies never accumulate; a bad record ends the chain there
+        std::vector<Block> blocks(total);
+        std::vector<std::string> hashes(total);
+        std::vector<uint32_t> counts(total, 0);
+        std::vector<uint8_t> stored_header_only(total, 0);
+        size_t usable = 0;
+        while (usable < total) {
+            std::vector<std::vector<uint8_t>> records = persistent_store_.load_block_records(usable, LOAD_BATCH_BLOCKS);
+            std::vector<uint8_t> decoded(records.size(), 0);
+            _worker_pool().parallel_for(records.size(), [&](size_t i) {
+                size_t position = usable + i;
+                try {
+                    json block_json = json::from_cbor(records[i]);
+                    std::string hash = block_json.value("hash", "");
+                    bool header_only = block_json.contains("header_hash");
+                    counts[position] = static_cast<uint32_t>(header_only
+                        ? block_json.value("transaction_count", static_cast<size_t>(0))
+                        : block_json["transactions"].size());
+                    if (position < keep_from && !header_only) {
+                        // Keep the header only; transactions are not even decoded
+                        if (hash.empty()) {
+                            hash = _hash(Block::from_stored_json(block_json));
+                        }
+                        block_json["transactions"] = json::array();
+                        blocks[position] = Block::from_stored_json(block_json);
+                        blocks[position].header_hash = hash;
+                    } else {
+                        blocks[position] = Block::from_stored_json(block_json);
+                    }
+                    hashes[position] = hash;
+                    stored_header_only[position] = header_only ? 1 : 0;
+                    decoded[i] = 1;
+                } catch (const std::exception&) {
+                }
+            }, PARALLEL_VALIDATION_MIN_CHUNK);
+            size_t good = std::find(decoded.begin(), decoded.end(), 0) - decoded.begin();
+            usable += good;
+            if (records.empty() || good < records.size()) {
+                break;
+            }
+        }
+        if (usable != total) {
+            LOG_WARN("Blockchain", "Stored block #" + std::to_string(usable) + " does not decode - loading " +
+                     std::to_string(usable) + " blocks");
+            blocks.resize(usable);
+            hashes.resize(usable);
+            counts.resize(usable);
+        }
+        
+        // Load contracts; their compiled programs go straight into the cache
+        size_t restored = 0;
+        for (const auto& contract_json : persistent_store_.load_contracts()) {
+            restored += contract_manager_.restore_contract(contract_json) ? 1 : 0;
+        }
+        if (restored > 0) {
+            LOG_INFO("Blockchain", "Loaded " + std::to_string(restored) + " contracts");
+        }
+        
+        // Account state: the checkpoint names the block it belongs to, so only
+        // later blocks need replaying. Legacy state.json balances describe the tip.
+        size_t state_height = blocks.size();
+        if (have_checkpoint) {
+            size_t height = checkpoint.value("height", static_cast<size_t>(0));
+            if (height == 0 || height > blocks.size() ||
+                (hashes[height - 1].empty() ? _hash(blocks[height - 1]) : hashes[height - 1]) !=
+                    checkpoint.value("tip_hash", "")) {
+                LOG_WARN("Blockchain", "State checkpoint at #" + std::to_string(height) +
+                         " is not on the stored chain - ignoring it");
+                have_checkpoint = false;
+            } else {
+                state_height = height;
+                accounts_->clear();
+                accounts_->write(checkpoint_accounts);
+                difficulty = checkpoint.value("difficulty", difficulty);
             }
-            
-            chain.push_back(block);
         }
-        LOG_INFO("Blockchain", "Loaded " + std::to_string(chain.size()) + " blocks");
         
-        // Load account state
         auto state_json = persistent_store_.load_account_state();
         if (!state_json.empty()) {
-            account_balances = state_json["balances"].get<std::map<std::string, double>>();
-            account_nonces = state_json["nonces"].get<std::map<std::string, uint64_t>>();
-            if (state_json.contains("difficulty")) {
+            // A durable store holds its own state; state.json balances only seed an empty one
+            if (!have_checkpoint && state_json.contains("balances") &&
+                (!accounts_->durable() || accounts_->size() == 0)) {
+                _load_accounts_json(state_json["balances"], state_json.value("nonces", json::object()));
+            }
+            if (!have_checkpoint && state_json.contains("difficulty")) {
                 difficulty = state_json["difficulty"];
             }
         }
+        if (!have_checkpoint && !accounts_->durable() && !state_json.contains("balances") && !blocks.empty()) {
+            LOG_WARN("Blockchain", "No usable state checkpoint - starting with empty account state");
+        }
+        
+        // Blocks past the checkpoint wait in catch_up_blocks_ until replayed
+        catch_up_blocks_.assign(std::make_move_iterator(blocks.begin() + state_height),
+                                std::make_move_iterator(blocks.end()));
+        catch_up_hashes_.assign(hashes.begin() + state_height, hashes.end());
+        blocks.resize(state_height);
+        hashes.resize(state_height);
+        counts.resize(state_height);
+        chain = std::move(blocks);
+        _rebuild_block_index(hashes, counts);
+        stored_blocks_ = usable;
+        persistence_writer_.set_committed_blocks(usable);
+        resident_from_ = std::min(keep_from, chain.size());
+        pruned_height_ = std::find(stored_header_only.begin(), stored_header_only.begin() + usable, 0) -
+                         stored_header_only.begin();
+        LOG_INFO("Blockchain", "Loaded " + std::to_string(chain.size() + catch_up_blocks_.size()) + " blocks");
+        
+        // Resume the audit checkpoint saved with this chain
+        if (state_json.contains("validated_height")) {
+            validated_height_ = std::min(state_json["validated_height"].get<size_t>(), chain.size());
+        }
+        
+        _rebuild_state_tree();
+        _publish_snapshot();
         LOG_INFO("Blockchain", "Loaded account state with " + 
-                 std::to_string(account_balances.size()) + " accounts");
+                 std::to_string(accounts_->size()) + " accounts at #" + std::to_string(chain.size()));
         
-        return true;
+        catch_up_next_ = 0;
+        catch_up_start_ = chain.size();
+        if (catch_up_blocks_.empty()) {
+            return true;
+        }
+        catching_up_ = true;
+        LOG_INFO("Blockchain", "Catching up: replaying " + std::to_string(catch_up_blocks_.size()) +
+                 " blocks stored after the checkpoint");
+        lock.unlock();
+        
+        auto replay = [this]() {
+            while (!catch_up_stop_) {
+                std::lock_guard<std::mutex> replay_lock(chain_mutex);
+                if (!_replay_next_block()) {
+                    break;
+                }
+            }
+        };
+        if (background_replay) {
+            catch_up_thread_ = std::thread(replay);
+            return true;
+        }
+        replay();
+        return !catching_up_;  // Still set only if blocks that did not replay could not be set aside
     } catch (const std::exception& e) {
         LOG_ERROR("Blockchain", "Failed to load state: " + std::string(e.what()));
         return false;
     }
 }
 
+bool Blockchain::_replay_next_block() {
+    if (catch_up_next_ < catch_up_blocks_.size()) {
+        const Block& block = catch_up_blocks_[catch_up_next_];
+        const std::string& hash = catch_up_hashes_[catch_up_next_];
+        // Checked when first accepted; here the block must still continue the replayed state
+        bool links = block.index == chain.back().index + 1 && block.previous_hash == block_hashes_.back();
+        bool state_matches = block.state_root.empty() || block.state_root == _calculate_state_root();
+        if (links && state_matches && !block.is_header_only()) {
+            _update_balances(block.transactions);
+            _append_block(block, hash);
+            _publish_snapshot();
+            _evict_bodies();
+            ++catch_up_next_;
+            return true;
+        }
+        // State changed outside the stored blocks (e.g. after the checkpoint, then a
+        // crash). They may exist nowhere else, so they go to a side file before the
+        // log is cut back to the replayed tip and the node carries on from there.
+        size_t remaining = catch_up_blocks_.size() - catch_up_next_;
+        catch_up_failed_ = true;
+        persistence_writer_.flush();
+        std::string side_file = persistent_store_.set_aside_blocks(chain.size());
+        if (side_file.empty()) {
+            // Nothing is built over blocks that could not be saved elsewhere
+            LOG_ERROR("Blockchain", "Stored block " + std::to_string(block.index) +
+                      " does not replay onto the checkpoint and the " + std::to_string(remaining) +
+                      " blocks from it could not be set aside - replay stopped at #" + std::to_string(chain.size()));
+            return false;
+        }
+        stored_blocks_ = chain.size();
+        persistence_writer_.set_committed_blocks(chain.size());
+        catch_up_set_aside_ = remaining;
+        catch_up_side_file_ = side_file;
+        LOG_ERROR("Blockchain", "Stored block " + std::to_string(block.index) +
+                  " does not replay onto the checkpoint - continuing from #" + std::to_string(chain.size()) +
+                  " with " + std::to_string(remaining) + " stored blocks moved to " + side_file);
+    } else {
+        LOG_INFO("Blockchain", "Caught up: replayed " + std::to_string(catch_up_next_) + " blocks to #" +
+                 std::to_string(chain.size()));
+    }
+    catch_up_blocks_.clear();
+    catch_up_hashes_.clear();
+    catch_up_next_ = 0;
+    catching_up_ = false;
+    return false;
+}
+
+void Blockchain::_stop_catch_up() {
+    catch_up_stop_ = true;
+    if (catch_up_thread_.joinable()) {
+        catch_up_thread_.join();
+    }
+    catch_up_stop_ = false;
+}
+
+CatchUpStatus Blockchain::get_catch_up_status() const {
+    std::lock_guard<std::mutex> lock(chain_mutex);
+    CatchUpStatus status;
+    status.catching_up = catching_up_;
+    status.failed = catch_up_failed_;
+    status.set_aside_blocks = catch_up_set_aside_;
+    status.set_aside_file = catch_up_side_file_;
+    status.start_height = catch_up_start_;
+    status.current_height = chain.size();
+    status.target_height = catching_up_ ? catch_up_start_ + catch_up_blocks_.size() : chain.size();
+    return status;
+}
+
 // ============= RPC INTERFACE (Phase 6) =============
 
 std::string Blockchain::hash_block(const Block& block) const {
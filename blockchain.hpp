@@ -13,9 +13,25 @@
 #include <iomanip>
 #include <nlohmann/json.hpp>
 #include <map>
+#include <array>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <future>
+#include "account_store.hpp"
 #include "contract.hpp"
 #include "persistent_store.hpp"
+#include "persistence_writer.hpp"
+#include "mempool.hpp"
+#include "merkle.hpp"
+#include "miner.hpp"
+#include "pow_kernel.hpp"
+#include "state_tree.hpp"
 #include "utils/logger.hpp"
+#include "utils/memory_utils.hpp"
+#include "utils/thread_pool.hpp"
 
 using json = nlohmann::json;
 
@@ -35,6 +51,13 @@ struct KeyPair {
     static std::string public_key_to_address(const std::string& public_key);
 };
 
+// Deployment payload, kept out of line: most transactions are plain transfers
+struct ContractDeployment {
+    std::string bytecode;
+    std::string name;
+    std::string language;
+};
+
 struct Transaction {
     std::string from;
     std::string to;
@@ -47,10 +70,19 @@ struct Transaction {
     uint64_t nonce = 0;  // Replay attack protection
     std::string data;    // Optional transaction data
     std::string contract_address;  // If calling a contract
+    // Shared between copies, never modified in place; null when there is no payload
+    std::shared_ptr<const ContractDeployment> deployment;
+
+    // Merkle leaf digest, cached at mempool admission (not serialized)
+    MerkleTree::Hash merkle_leaf_cache{};
+    bool merkle_leaf_cached = false;
     bool is_contract_deployment = false;  // Deploy new contract
-    std::string contract_bytecode;  // For deployments
-    std::string contract_name;      // For deployments
-    std::string contract_language;  // For deployments
+
+    const std::string& contract_bytecode() const { return deployment_or_empty().bytecode; }
+    const std::string& contract_name() const { return deployment_or_empty().name; }
+    const std::string& contract_language() const { return deployment_or_empty().language; }
+    // Leaves `deployment` null when all three are empty
+    void set_deployment(std::string bytecode, std::string name, std::string language);
 
     json to_json() const {
         json j;
@@ -66,12 +98,28 @@ struct Transaction {
         j["data"] = data;
         j["contract_address"] = contract_address;
         j["is_contract_deployment"] = is_contract_deployment;
-        j["contract_bytecode"] = contract_bytecode;
-        j["contract_name"] = contract_name;
-        j["contract_language"] = contract_language;
+        j["contract_bytecode"] = contract_bytecode();
+        j["contract_name"] = contract_name();
+        j["contract_language"] = contract_language();
         return j;
     }
     std::string calculate_hash() const;
+
+    MerkleTree::Hash merkle_leaf() const;
+    void cache_merkle_leaf();
+
+    static Transaction from_json(const json& j);
+
+private:
+    const ContractDeployment& deployment_or_empty() const;
+};
+
+// Per-transaction outcome of Blockchain::add_transactions()
+struct TransactionVerdict {
+    std::string transaction_id;
+    bool accepted = false;
+    bool permanent = false;  // Rejected for good, or already pending: no later copy is admitted
+    std::string error;       // Rejection reason when !accepted
 };
 
 const double BLOCK_REWARD = 50.0;
@@ -97,14 +145,26 @@ struct MinerStats {
     }
 };
 
+// Seconds since the epoch of a "%Y-%m-%d %H:%M:%S" local time, or -1 if malformed
+int64_t parse_block_timestamp(const std::string& timestamp);
+
 struct Block {
     int index;
-    std::string timestamp;
+    int pow_version = POW_VERSION_LEGACY;  // Digest layout the proof was mined against
+    std::string timestamp;                 // Hashed form; validation uses time_seconds
+    int64_t time_seconds = 0;              // `timestamp` parsed once where the block is built or decoded
     std::vector<Transaction> transactions;
     std::string merkle_root;           // Merkle root of transactions
     std::string state_root;            // Merkle root of account state (NEW: Account sync)
     long long proof;
     std::string previous_hash;
+    std::string header_hash;           // Set on header-only blocks below an installed state snapshot
+
+    // Falls back to parsing for blocks assembled field by field
+    int64_t unix_time() const { return time_seconds != 0 ? time_seconds : parse_block_timestamp(timestamp); }
+
+    // History skipped by snapshot sync keeps its headers but not its transactions
+    bool is_header_only() const { return !header_hash.empty(); }
 
     json to_json() const {
         json j;
@@ -118,53 +178,289 @@ struct Block {
         j["state_root"] = state_root;
         j["proof"] = proof;
         j["previous_hash"] = previous_hash;
+        // Legacy blocks keep their original encoding, and so their hash
+        if (pow_version != POW_VERSION_LEGACY) {
+            j["pow_version"] = pow_version;
+        }
+        if (is_header_only()) {
+            j["header_hash"] = header_hash;
+        }
+        return j;
+    }
+
+    // Wire decoders use from_json; only trusted local storage may mark a block header-only
+    static Block from_json(const json& j);
+    static Block from_stored_json(const json& j);
+};
+
+// A block without its transactions, exchanged during headers-first sync
+struct BlockHeader {
+    int index = 0;
+    std::string timestamp;
+    std::string merkle_root;
+    std::string state_root;
+    long long proof = 0;
+    std::string previous_hash;
+    int pow_version = POW_VERSION_LEGACY;
+    std::string hash;               // Hash of the full block, as the next block's previous_hash
+    size_t transaction_count = 0;
+
+    json to_json() const {
+        json j;
+        j["index"] = index;
+        j["timestamp"] = timestamp;
+        j["merkle_root"] = merkle_root;
+        j["state_root"] = state_root;
+        j["proof"] = proof;
+        j["previous_hash"] = previous_hash;
+        j["pow_version"] = pow_version;
+        j["hash"] = hash;
+        j["transaction_count"] = transaction_count;
+        return j;
+    }
+
+    static BlockHeader from_json(const json& j);
+    static BlockHeader from_block(const Block& block, const std::string& hash);
+    // Header-only block standing in for this header in the local chain
+    Block to_header_only_block() const;
+};
+
+// Progress of the resumable full-chain audit
+struct ChainAuditStatus {
+    size_t validated_height = 0;  // Blocks from genesis known to be valid
+    size_t chain_height = 0;
+    bool running = false;
+    bool failed = false;
+    size_t failed_position = 0;   // Chain position of the first invalid block
+
+    json to_json() const {
+        json j;
+        j["validated_height"] = validated_height;
+        j["chain_height"] = chain_height;
+        j["running"] = running;
+        j["failed"] = failed;
+        if (failed) {
+            j["failed_position"] = failed_position;
+        }
+        return j;
+    }
+};
+
+// Progress of the startup replay of blocks stored after the state checkpoint
+struct CatchUpStatus {
+    bool catching_up = false;
+    bool failed = false;        // Replay stopped at a stored block that does not continue the state
+    size_t start_height = 0;    // Height of the checkpoint the replay started from
+    size_t current_height = 0;
+    size_t target_height = 0;   // Height of the stored chain
+    size_t set_aside_blocks = 0;  // Stored blocks past the failure, moved out of the log
+    std::string set_aside_file;   // Where they went; empty while they are still in the log
+
+    json to_json() const {
+        json j;
+        j["catching_up"] = catching_up;
+        j["failed"] = failed;
+        if (failed) {
+            j["set_aside_blocks"] = set_aside_blocks;
+            j["set_aside_file"] = set_aside_file;
+        }
+        j["start_height"] = start_height;
+        j["current_height"] = current_height;
+        j["target_height"] = target_height;
         return j;
     }
 };
 
+// How much block history is kept in memory and in the block store
+struct ChainStorageConfig {
+    size_t resident_blocks = 0;  // Full blocks kept in memory behind the tip; 0 keeps every body
+    size_t prune_window = 0;     // Stored bodies kept behind the tip once checkpointed; 0 keeps all
+    PersistDurability durability = PersistDurability::NONE;  // fsync each persistence batch or not
+};
+
+/**
+ * ChainSnapshot - Immutable view of the tip and account state
+ *
+ * Published under chain_mutex after every committed state change and swapped
+ * in atomically; readers load the current pointer and never take chain_mutex.
+ * Accounts are split into hash shards so a new snapshot copies only the
+ * shards holding accounts that changed and shares the rest with its
+ * predecessor.
+ */
+struct ChainSnapshot {
+    struct Account {
+        double balance = 0.0;
+        uint64_t nonce = 0;
+        bool has_nonce = false;  // Nonce 0 has been used
+    };
+    using Shard = std::map<std::string, Account>;
+    static constexpr size_t SHARD_COUNT = 64;
+
+    uint64_t version = 0;           // Increments with every publish
+    uint64_t chain_epoch = 0;       // Increments when chain positions are rewritten rather than appended
+    size_t height = 0;
+    size_t total_transactions = 0;
+    int difficulty = 0;
+    std::string tip_hash;
+    std::string state_root;
+    std::shared_ptr<const Block> tip;
+    size_t account_count = 0;
+    std::array<std::shared_ptr<const Shard>, SHARD_COUNT> shards;
+
+    static size_t shard_of(const std::string& address) {
+        return std::hash<std::string>()(address) % SHARD_COUNT;
+    }
+
+    const Account* find_account(const std::string& address) const {
+        const Shard& shard = *shards[shard_of(address)];
+        auto it = shard.find(address);
+        return it == shard.end() ? nullptr : &it->second;
+    }
+};
+
 class Blockchain {
 private:
+    friend class BlockchainBench;  // blockchain_bench.cpp measures the private hot paths
+
     // Blockchain state
     std::vector<Block> chain;
     mutable std::mutex chain_mutex;
     int difficulty;
+    
+    // Block lookup index (kept in step with `chain`, guarded by chain_mutex)
+    std::vector<std::string> block_hashes_;                // Cached hash per chain position
+    std::unordered_map<std::string, size_t> hash_index_;   // Block hash -> chain position
+    uint64_t chain_epoch_ = 0;                             // Bumped by _rebuild_block_index
+    size_t total_transactions_ = 0;
 
-    // Memory-managed transaction pool with capacity limits
-    std::queue<Transaction> mempool;
-    mutable std::mutex mempool_mutex;
+    // Fee-priority transaction pool with per-sender nonce lanes (guarded by mempool_mutex)
     static constexpr size_t MAX_MEMPOOL_SIZE = 10000;  // Max transactions in mempool
-    static constexpr size_t MEMPOOL_EVICT_SIZE = 1000; // Evict this many when full
-
-    // Account state with efficient storage
-    std::map<std::string, double> account_balances;
-    std::map<std::string, uint64_t> account_nonces;  // Track nonce per account
+    Mempool mempool_{MAX_MEMPOOL_SIZE};
+    mutable std::mutex mempool_mutex;
+    // Sender -> nonce after its transactions in the block being mined (guarded by mempool_mutex).
+    // take_best() has removed them from the pool, so they must still count as pending.
+    std::unordered_map<std::string, uint64_t> mining_reserved_;
+
+    // Workers for signature verification, merkle hashing and block execution, started on first use
+    static constexpr size_t PARALLEL_VALIDATION_MIN_CHUNK = 32;  // Smaller batches validate inline
+    static constexpr size_t PARALLEL_MERKLE_MIN_CHUNK = 128;     // Leaves per worker for large blocks
+    static constexpr size_t PARALLEL_EXECUTION_MIN_CHUNK = 64;   // Transactions per worker in _update_balances
+    mutable std::once_flag worker_pool_once_;
+    mutable std::unique_ptr<ThreadPool> worker_pool_;
+
+    // Balances and nonces of every account (chain_mutex); in memory unless set_account_store() swaps it
+    std::unique_ptr<AccountStore> accounts_ = std::make_unique<MemoryAccountStore>();
+    mutable StateTree state_tree_;                  // Authenticated view of accounts_ (chain_mutex)
+    // Scratch for one block's merkle/state roots and execution; reset when the last scope closes
+    mutable memory_utils::MonotonicArena block_arena_;
     std::map<std::string, MinerStats> miner_stats;
     
     ContractManager contract_manager_;  // Smart contract management
     ContractVM contract_vm_;            // Contract execution engine
     PersistentStore persistent_store_;  // Blockchain state persistence
+    // Blocks, contracts and checkpoints are written from here, off chain_mutex
+    PersistenceWriter persistence_writer_{persistent_store_};
+    
+    // Parallel proof-of-work (nonce ranges split across worker threads)
+    mutable ParallelMiner miner_;
+    std::mutex mining_mutex_;               // One mine_block() at a time; chain_mutex is released during PoW
+    std::atomic<int> mining_index_{0};      // Block index being mined, 0 when idle
+    std::atomic<double> last_hashrate_{0.0};
+    int pow_version_ = POW_VERSION_MIDSTATE;  // Layout used for newly mined blocks
+
+    // Validated-tip checkpoint: chain[0, validated_height_) is known valid, so
+    // new blocks are checked against their parent only (guarded by chain_mutex)
+    size_t validated_height_ = 0;
+    bool audit_failed_ = false;
+    size_t audit_failed_position_ = 0;
+
+    // Background audit re-proving history in batches, releasing chain_mutex between them
+    static constexpr size_t AUDIT_BATCH_SIZE = 256;
+    std::thread audit_thread_;
+    std::atomic<bool> audit_running_{false};
+    std::atomic<bool> audit_stop_{false};
 
     Block _create_block(const std::vector<Transaction>& transactions, 
                        long long proof,
                        const std::string& previous_hash, 
-                       int index);
+                       int index,
+                       const std::string& merkle_root = "");
 
     std::string _to_digest(long long new_proof, long long previous_proof,
                           int index, const std::string& data) const;
 
-    long long _proof_of_work(long long previous_proof, int index,
-                            const std::string& data, int difficulty) const;
+    ParallelMiner::Result _proof_of_work(long long previous_proof, int index,
+                                         const std::string& data, int difficulty) const;
 
     std::string _hash(const Block& block) const;
 
     std::string sha256(const std::string& str) const;
 
-    std::string _calculate_merkle_root(const std::vector<Transaction>& transactions) const;
+    std::string _calculate_merkle_root(const std::vector<Transaction>& transactions, int pow_version) const;
+    std::vector<MerkleTree::Hash> _merkle_leaves(const std::vector<Transaction>& transactions) const;
+    void _fill_merkle_leaves(const std::vector<Transaction>& transactions, MerkleTree::Hash* leaves) const;
     
     // Account state synchronization (NEW)
     std::string _calculate_state_root() const;
-    std::map<std::string, double> account_state_snapshot;  // State snapshot for verification
-    mutable std::mutex state_mutex;  // Protect state operations
+    // Keep state_tree_ in step with accounts_ (caller holds chain_mutex)
+    void _touch_account(const std::string& address);
+    void _rebuild_state_tree();
+    // Replace accounts_ with the balances/nonces objects of state.json
+    void _load_accounts_json(const json& balances, const json& nonces);
+
+    // Reader snapshot; swapped with std::atomic_load/atomic_store, rebuilt under chain_mutex
+    std::shared_ptr<const ChainSnapshot> snapshot_;
+    std::vector<std::string> snapshot_dirty_;  // Accounts touched since the last publish
+    bool snapshot_rebuild_ = true;             // Account maps replaced wholesale
+    void _publish_snapshot();
+
+    // Last state at a multiple of state_snapshot_interval_, kept once the next
+    // block has committed to it as its state_root; served to bootstrapping peers
+    size_t state_snapshot_interval_ = DEFAULT_STATE_SNAPSHOT_INTERVAL;
+    std::shared_ptr<const ChainSnapshot> state_checkpoint_;  // chain_mutex
+
+    std::function<void(const ChainSnapshot&)> tip_listener_;  // chain_mutex
+
+    // Each state_checkpoint_ is also queued for the persistence writer, which
+    // serialises the immutable snapshot off chain_mutex
+    void _persist_checkpoint(const std::shared_ptr<const ChainSnapshot>& snapshot);  // Then prunes
+    static json _checkpoint_json(const ChainSnapshot& snapshot);
+    // Block record as stored: the block plus its hash, so loading need not rehash
+    static json _stored_block_json(const Block& block, const std::string& hash, uint32_t transaction_count);
+    json _stored_block_json(size_t position) const;
+
+    // Startup catch-up: blocks stored after the checkpoint, replayed onto it one
+    // at a time with chain_mutex released in between (see load_blockchain_state)
+    std::vector<Block> catch_up_blocks_;          // chain_mutex
+    std::vector<std::string> catch_up_hashes_;    // Stored hash of each, empty if none
+    size_t catch_up_next_ = 0;
+    size_t catch_up_start_ = 0;
+    std::atomic<bool> catching_up_{false};
+    std::atomic<bool> catch_up_failed_{false};    // A stored block did not replay
+    size_t catch_up_set_aside_ = 0;               // chain_mutex; blocks moved to catch_up_side_file_
+    std::string catch_up_side_file_;              // chain_mutex
+    std::atomic<bool> catch_up_stop_{false};
+    std::thread catch_up_thread_;
+    bool _replay_next_block();  // Caller holds chain_mutex; false once done or failed
+    void _stop_catch_up();
+
+    // Bounded history: chain[0, resident_from_) keep only their headers, marked
+    // header-only with their own hash, and their bodies are read back from the
+    // block store on demand. Stored records below pruned_height_ have no bodies.
+    static constexpr size_t LOAD_BATCH_BLOCKS = 4096;  // Records decoded per step at startup
+    ChainStorageConfig storage_config_;             // chain_mutex
+    std::vector<uint32_t> transaction_counts_;      // Per chain position, survives eviction
+    size_t resident_from_ = 0;
+    size_t stored_blocks_ = 0;                      // chain[0, stored_blocks_) are in or queued for the block log
+    std::atomic<size_t> pruned_height_{0};
+    // Queue chain[stored_blocks_, end) for the persistence writer
+    void _store_new_blocks();
+    void _evict_bodies();
+    // chain[position], or its body read back into `scratch` if evicted (caller holds chain_mutex)
+    const Block& _block_at(size_t position, Block& scratch) const;
+    BlockHeader _header_at(size_t position) const;
+    // Worker side of pruning: strip stored bodies below `end` (no chain_mutex)
+    void _prune_stored_bodies(size_t end);
 
     int _calculate_difficulty() const;
 
@@ -173,26 +469,48 @@ private:
     bool _verify_ecdsa_signature(const Transaction& tx) const;
 
     bool _validate_transaction(const Transaction& tx) const;
+
+    // Split validation: stateless checks are thread-safe and touch no shared state;
+    // stateful checks read balances/nonces from the published snapshot and require mempool_mutex
+    bool _check_transaction_stateless(const Transaction& tx, std::string& error) const;
+    bool _check_transaction_stateful(const Transaction& tx, std::string& error) const;
+    ThreadPool& _worker_pool() const;
     
     bool _verify_state_root(const std::string& calculated_root, const std::string& block_root) const;
 
-    bool _has_sufficient_balance(const std::string& address, double amount) const;
+    bool _has_sufficient_balance(const ChainSnapshot& snapshot, const std::string& address, double amount) const;
 
-    bool _check_replay_protection(const Transaction& tx) const;
+    bool _check_replay_protection(const ChainSnapshot& snapshot, const Transaction& tx) const;
+    uint64_t _next_confirmed_nonce(const std::string& address) const;  // Caller holds chain_mutex
+    // Caller holds mempool_mutex; reads the snapshot, not accounts_, so chain_mutex is not needed
+    uint64_t _next_unreserved_nonce(const ChainSnapshot& snapshot, const std::string& address) const;
     
     // Advanced Block Validation (Phase 5)
     bool _verify_block_merkle_root(const Block& block) const;
     bool _verify_block_timestamp(const Block& block, const Block& previous_block) const;
     bool _verify_transaction_nonce_ordering(const Block& block) const;
-    bool _verify_block_difficulty(const Block& block) const;
+    bool _verify_block_difficulty(const Block& block, const Block& previous_block) const;
     bool _validate_block_advanced(const Block& block, const Block& previous_block) const;
+    // Checks that need no account state: merkle root, timestamps, proof of work
+    bool _verify_block_standalone(const Block& block, const Block& previous_block) const;
+    // Re-prove chain[begin, end); returns false with failed_at set on the first bad block
+    bool _audit_range(size_t begin, size_t end, bool parallel, size_t& failed_at) const;
 
     void _update_balances(const std::vector<Transaction>& transactions);
+    
+    // Block index maintenance (caller holds chain_mutex)
+    void _append_block(const Block& block, std::string hash = "");
+    // Hashes (and counts of evicted bodies) stored with the blocks are used where
+    // present; the audit re-proves the hashes
+    void _rebuild_block_index(const std::vector<std::string>& stored_hashes = {},
+                              const std::vector<uint32_t>& stored_counts = {});
 
 public:
     Blockchain();
+    ~Blockchain();
 
     static constexpr double INITIAL_BALANCE = 100.0;
+    static constexpr size_t DEFAULT_STATE_SNAPSHOT_INTERVAL = 1000;
 
     void create_account(const std::string& address, double initial_balance = INITIAL_BALANCE);
 
@@ -203,12 +521,29 @@ public:
     // Get complete account state for synchronization (NEW)
     std::map<std::string, std::pair<double, uint64_t>> get_account_state() const;
     std::string get_state_root() const;
+    // Proof and root are taken under one lock so they always match
+    bool get_state_proof(const std::string& address, StateTree::Proof& proof, std::string& state_root) const;
     bool sync_state(const std::map<std::string, std::pair<double, uint64_t>>& remote_state);
 
+    // Snapshot sync (see state_snapshot.hpp): the newest checkpointed state, or null
+    std::shared_ptr<const ChainSnapshot> get_state_checkpoint() const;
+    void set_state_snapshot_interval(size_t interval) { state_snapshot_interval_ = interval > 0 ? interval : 1; }
+    size_t get_state_snapshot_interval() const { return state_snapshot_interval_; }
+    // Append `headers` (which must extend our tip) as header-only blocks and
+    // replace the account state with `accounts`, whose root must equal
+    // `state_root`. Nothing changes if either check fails.
+    bool install_state_snapshot(const std::vector<BlockHeader>& headers,
+                                const std::vector<StateTree::Account>& accounts,
+                                const std::string& state_root);
+
     uint64_t get_account_nonce(const std::string& address) const;
 
     void add_transaction(const Transaction& tx);
 
+    // Validate a batch (signatures in parallel, then one locked stateful pass)
+    // and admit the valid ones; verdicts are returned in input order
+    std::vector<TransactionVerdict> add_transactions(const std::vector<Transaction>& transactions);
+
     Transaction create_transaction(const std::string& from,
                                   const std::string& to,
                                   double amount,
@@ -229,15 +564,59 @@ public:
     double get_miner_total_rewards(const std::string& miner_address) const;
 
     Block mine_block(int max_transactions = 10);
+    
+    // Mining control
+    void set_mining_threads(unsigned threads) { miner_.set_threads(threads); }
+    unsigned get_mining_threads() const { return miner_.get_threads(); }
+    void cancel_mining(int competing_index = 0);  // Abort PoW if a block at/above our height arrived
+    bool is_mining() const { return mining_index_.load() != 0; }
+    double get_last_hashrate() const { return last_hashrate_.load(); }
+    void set_pow_version(int version) { pow_version_ = version; }
+    int get_pow_version() const { return pow_version_; }
 
     Block get_previous_block() const;
 
-    bool is_chain_valid() const;
+    bool is_chain_valid() const;  // Full audit from genesis (stateless checks, parallel)
+
+    // Validate a block against the current tip and append it; false if rejected
+    bool accept_block(const Block& block);
+
+    // Resumable audit: advance the checkpoint by up to max_blocks (0 = to the tip)
+    bool audit_chain(size_t max_blocks = 0, bool parallel = false);
+    void start_chain_audit(bool parallel = true, bool from_genesis = false);
+    void stop_chain_audit();
+    ChainAuditStatus get_audit_status() const;
     
     bool is_chain_valid_with_state() const;  // Verify both chain and state roots
 
+    // Every block, with evicted bodies read back from the store; prefer get_blocks()
     std::vector<Block> get_chain() const;
 
+    // Consistent tip + account state for readers; lock-free against writers
+    std::shared_ptr<const ChainSnapshot> get_snapshot() const;
+    // Called under chain_mutex with each snapshot that moves the tip; it must
+    // return quickly and must not call back into this Blockchain
+    void set_tip_listener(std::function<void(const ChainSnapshot&)> listener);
+    
+    // Indexed access without copying the chain
+    size_t get_chain_height() const;
+    size_t get_total_transactions() const;
+    bool get_block(size_t position, Block& block) const;
+    bool get_header(size_t position, BlockHeader& header) const;
+    // Inclusion proof for a transaction in the block at chain position `position`
+    bool get_transaction_proof(size_t position, const std::string& transaction_id,
+                               MerkleProof& proof, std::string& merkle_root) const;
+    bool get_block_by_hash(const std::string& hash, Block& block, size_t* position = nullptr) const;
+    std::string get_block_hash(size_t position) const;
+    std::vector<Block> get_blocks(size_t start, size_t count) const;
+
+    // Headers-first sync: tip-first hashes, dense near the tip and exponentially sparser behind
+    std::vector<std::string> get_block_locator() const;
+    // Headers after the newest locator hash we know; empty when none is on our chain
+    std::vector<BlockHeader> get_headers_after(const std::vector<std::string>& locator, size_t max_count) const;
+    // Link and proof-of-work checks that need no transactions
+    bool verify_header(const BlockHeader& header, const BlockHeader& parent) const;
+
     std::map<std::string, MinerStats> get_all_miner_stats() const;
 
     json get_chain_json() const;
@@ -246,9 +625,11 @@ public:
     void load_from_file(const std::string& filename);
 
     size_t get_mempool_size() const;
+    bool has_pending_transaction(const std::string& transaction_id) const;
+    bool get_pending_transaction(const std::string& transaction_id, Transaction& tx) const;
     
     // RPC Interface methods (Phase 6)
-    int get_difficulty() const { return difficulty; }
+    int get_difficulty() const;
     std::string hash_block(const Block& block) const;
     
     // Contract management
@@ -265,8 +646,23 @@ public:
     
     // Persistence
     PersistentStore& get_persistent_store() { return persistent_store_; }
+    // Replace the account state backend, e.g. with a DiskAccountStore; call before
+    // load_blockchain_state(). An empty store is filled from the current state, a
+    // non-empty one is taken as the state of the chain about to be loaded.
+    void set_account_store(std::unique_ptr<AccountStore> store);
     bool save_blockchain_state();
-    bool load_blockchain_state();
+    // Restores the chain and the newest state checkpoint, then replays the blocks
+    // stored after it. With background_replay the replay runs on its own thread
+    // and this returns once the checkpoint is live: readers see the chain grow
+    // to the stored tip while new blocks and mining are refused.
+    bool load_blockchain_state(bool background_replay = false);
+    bool is_catching_up() const { return catching_up_.load(); }
+    CatchUpStatus get_catch_up_status() const;
+    // Takes effect from the next block; bodies already evicted stay on disk
+    void set_storage_config(const ChainStorageConfig& config);
+    ChainStorageConfig get_storage_config() const;
+    size_t get_resident_bodies() const;  // Chain positions whose body is in memory
+    size_t get_pruned_height() const { return pruned_height_.load(); }
 };
 
 #endif // BLOCKCHAIN_H
@@ -0,0 +1,632 @@
+/**
+ * blockchain_bench - Microbenchmarks of the node's hot paths
+ *
+ * Every benchmark uses fixed seeds and fixed inputs, so two builds measured
+ * on the same machine differ only by the code under test. Results are
+ * written as one JSON document (stdout, or --output=FILE) for comparison
+ * between releases; progress goes to stderr.
+ *
+ *   blockchain_bench [--quick] [--filter=SUBSTRING] [--min-time=SECONDS] [--output=FILE]
+ *
+ * --quick drops the largest input sizes. The benchmark runs in a scratch
+ * directory under /tmp, which is removed afterwards.
+ */
+#include "blockchain.hpp"
+#include "mempool.hpp"
+#include "network_manager.hpp"
+#include "persistent_store.hpp"
+#include "pow_kernel.hpp"
+#include "rpc_server.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    bool quick = false;
+    std::string filter;
+    double min_time = 0.5;  // Seconds each measurement runs for, at least
+    std::string output;
+};
+
+Options options;
+json results = json::array();
+
+bool selected(const std::string& name) {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Runs `body` (which returns the operations it performed) until min_time has passed
+template <typename Body>
+void measure(const std::string& name, const json& params, Body&& body, json extra = json::object()) {
+    body();  // Warm-up: caches, lazy initialisation, first-touch allocations
+
+    uint64_t ops = 0;
+    uint64_t calls = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    do {
+        ops += body();
+        ++calls;
+        elapsed = seconds_since(start);
+    } while (elapsed < options.min_time);
+
+    json result = {
+        {"name", name},
+        {"params", params},
+        {"calls", calls},
+        {"operations", ops},
+        {"seconds", elapsed},
+        {"ns_per_op", ops ? elapsed * 1e9 / static_cast<double>(ops) : 0.0},
+        {"ops_per_second", elapsed > 0 ? static_cast<double>(ops) / elapsed : 0.0}
+    };
+    for (auto& [key, value] : extra.items()) {
+        result[key] = value;
+    }
+    std::cerr << "  " << name << " " << params.dump() << ": " << result["ns_per_op"].get<double>()
+              << " ns/op" << std::endl;
+    results.push_back(std::move(result));
+}
+
+// For scenarios measured once rather than repeated
+void record(const std::string& name, const json& params, json values) {
+    std::cerr << "  " << name << " " << params.dump() << ": " << values.dump() << std::endl;
+    values["name"] = name;
+    values["params"] = params;
+    results.push_back(std::move(values));
+}
+
+std::string format_time(time_t t) {
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
+    return buffer;
+}
+
+std::string hex_id(std::mt19937_64& rng) {
+    static const char* digits = "0123456789abcdef";
+    std::string id(64, '0');
+    for (char& c : id) {
+        c = digits[rng() & 15];
+    }
+    return id;
+}
+
+// Structurally complete, unsigned transactions; enough for hashing and pool ordering
+std::vector<Transaction> make_transactions(size_t count, size_t senders, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> nonces(senders, 0);
+    std::vector<Transaction> transactions;
+    transactions.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t sender = i % senders;
+        Transaction tx;
+        tx.from = "0xsender" + std::to_string(sender);
+        tx.to = "0xrecipient" + std::to_string(rng() % 1000);
+        tx.amount = 1.0 + static_cast<double>(rng() % 1000);
+        tx.gas_price = 0.01 * static_cast<double>(1 + rng() % 500);
+        tx.timestamp = "2026-01-01 00:00:00";
+        tx.signature = hex_id(rng) + hex_id(rng);
+        tx.public_key = hex_id(rng) + hex_id(rng);
+        tx.nonce = nonces[sender]++;
+        tx.transaction_id = hex_id(rng);
+        transactions.push_back(std::move(tx));
+    }
+    return transactions;
+}
+
+}  // namespace
+
+// Friend of Blockchain: reaches the private hot paths being measured
+class BlockchainBench {
+public:
+    static void sha256() {
+        Blockchain chain;
+        for (size_t size : {64, 1024, 16384}) {
+            std::string input(size, 'x');
+            measure("sha256", {{"bytes", size}}, [&]() {
+                for (int i = 0; i < 256; ++i) {
+                    input[0] = static_cast<char>(i);
+                    volatile size_t sink = chain.sha256(input).size();
+                    (void)sink;
+                }
+                return 256;
+            });
+            results.back()["mb_per_second"] = results.back()["ops_per_second"].get<double>() * size / 1e6;
+        }
+    }
+
+    static void proof_of_work() {
+        Blockchain chain;
+        for (int difficulty : {3, 4}) {
+            // The same sequence of headers every run, so total hashes are identical
+            uint64_t hashes = 0;
+            double search_seconds = 0.0;
+            long long index = 0;
+            measure("proof_of_work", {{"difficulty", difficulty}}, [&]() {
+                ParallelMiner::Result pow = chain._proof_of_work(12345, static_cast<int>(++index % 64) + 2,
+                                                                 "bench-merkle-root", difficulty);
+                hashes += pow.hashes;
+                search_seconds += pow.seconds;
+                return 1;
+            });
+            results.back()["hashes_per_second"] = search_seconds > 0 ? hashes / search_seconds : 0.0;
+            results.back()["threads"] = chain.miner_.get_threads();
+            results.back()["backend"] = PowKernel::backend_name();
+        }
+    }
+
+    static void merkle_root() {
+        Blockchain chain;
+        std::vector<size_t> sizes = {100, 1000, 10000};
+        for (size_t size : sizes) {
+            std::vector<Transaction> transactions = make_transactions(size, 100, 1);
+            measure("merkle_root", {{"transactions", size}, {"leaves", "uncached"}}, [&]() {
+                volatile size_t sink = chain._calculate_merkle_root(transactions, POW_VERSION_MIDSTATE).size();
+                (void)sink;
+                return 1;
+            });
+            for (auto& tx : transactions) {
+                tx.cache_merkle_leaf();  // As admitted through the mempool
+            }
+            measure("merkle_root", {{"transactions", size}, {"leaves", "cached"}}, [&]() {
+                volatile size_t sink = chain._calculate_merkle_root(transactions, POW_VERSION_MIDSTATE).size();
+                (void)sink;
+                return 1;
+            });
+        }
+    }
+
+    static void state_root() {
+        std::vector<size_t> sizes = {1000, 100000};
+        if (!options.quick) {
+            sizes.push_back(1000000);
+        }
+        for (size_t size : sizes) {
+            Blockchain chain;
+            std::mt19937_64 rng(2);
+            AccountBatch accounts;
+            std::vector<std::string> addresses;
+            for (size_t i = 0; i < size; ++i) {
+                addresses.push_back("0x" + hex_id(rng).substr(0, 40));
+                accounts.emplace_back(addresses.back(), AccountRecord{static_cast<double>(rng() % 100000), 0, true, false});
+            }
+            {
+                std::lock_guard<std::mutex> lock(chain.chain_mutex);
+                chain.accounts_->write(accounts);
+            }
+
+            // Whole tree from scratch, as after loading or installing a snapshot
+            measure("state_root", {{"accounts", size}, {"mode", "rebuild"}}, [&]() {
+                std::lock_guard<std::mutex> lock(chain.chain_mutex);
+                chain._rebuild_state_tree();
+                volatile size_t sink = chain._calculate_state_root().size();
+                (void)sink;
+                return 1;
+            });
+
+            // A block's worth of touched accounts on top of a committed tree
+            size_t cursor = 0;
+            measure("state_root", {{"accounts", size}, {"mode", "incremental"}, {"touched", 100}}, [&]() {
+                std::lock_guard<std::mutex> lock(chain.chain_mutex);
+                AccountBatch batch;
+                for (int i = 0; i < 100; ++i) {
+                    const std::string& address = addresses[cursor++ % addresses.size()];
+                    AccountRecord record;
+                    chain.accounts_->get(address, record);
+                    record.balance += 1.0;
+                    batch.emplace_back(address, record);
+                }
+                chain.accounts_->write(batch);
+                for (const auto& [address, _] : batch) {
+                    chain._touch_account(address);
+                }
+                chain.snapshot_dirty_.clear();
+                volatile size_t sink = chain._calculate_state_root().size();
+                (void)sink;
+                return 1;
+            });
+        }
+    }
+
+    static void account_store() {
+        const size_t size = options.quick ? 100000 : 1000000;
+        std::mt19937_64 rng(5);
+        std::vector<std::string> addresses;
+        for (size_t i = 0; i < size; ++i) {
+            addresses.push_back("0x" + hex_id(rng).substr(0, 40));
+        }
+
+        MemoryAccountStore memory;
+        DiskAccountStore disk("./bench_accounts");
+        for (AccountStore* store : {static_cast<AccountStore*>(&memory), static_cast<AccountStore*>(&disk)}) {
+            const char* backend = store == &memory ? "memory" : "disk";
+            // Loaded a block's worth of accounts at a time, as they would have arrived
+            for (size_t i = 0; i < size; i += 1000) {
+                AccountBatch batch;
+                for (size_t j = i; j < std::min(size, i + 1000); ++j) {
+                    batch.emplace_back(addresses[j], AccountRecord{1000.0, 0, true, false});
+                }
+                store->write(batch);
+            }
+
+            std::mt19937_64 pick(6);
+            measure("account_store_get", {{"backend", backend}, {"accounts", size}, {"access", "uniform"}}, [&]() {
+                AccountRecord record;
+                for (int i = 0; i < 1000; ++i) {
+                    store->get(addresses[pick() % size], record);
+                }
+                return 1000;
+            });
+            measure("account_store_write", {{"backend", backend}, {"accounts", size}, {"batch", 100}}, [&]() {
+                AccountBatch batch;
+                for (int i = 0; i < 100; ++i) {
+                    batch.emplace_back(addresses[pick() % size], AccountRecord{1.0, 1, true, true});
+                }
+                store->write(batch);
+                return 100;
+            });
+        }
+    }
+
+    static void mempool() {
+        for (size_t size : {1000, 10000}) {
+            std::vector<Transaction> transactions = make_transactions(size, size / 10, 3);
+            measure("mempool_insert", {{"transactions", size}}, [&]() {
+                Mempool pool(size);
+                for (const auto& tx : transactions) {
+                    pool.add(tx);
+                }
+                return size;
+            });
+
+            Mempool::NonceLookup confirmed = [](const std::string&) { return uint64_t(0); };
+            measure("mempool_take_best", {{"pool", size}, {"take", 1000}}, [&]() {
+                Mempool pool(size);
+                for (const auto& tx : transactions) {
+                    pool.add(tx);
+                }
+                return pool.take_best(1000, confirmed).size();
+            }, {{"includes", "pool fill"}});
+        }
+    }
+
+    static void contract_execute() {
+        struct Program {
+            const char* name;
+            std::vector<Instruction> code;
+        };
+        for (const Program& program : {Program{"counter", ContractCompiler::create_counter_contract()},
+                                       Program{"token", ContractCompiler::create_token_contract()}}) {
+            SmartContract contract("0xcontract", "0xcreator", program.name);
+            for (const auto& instruction : program.code) {
+                contract.add_instruction(instruction);
+            }
+            auto compiled = std::make_shared<const CompiledProgram>(CompiledProgram::compile(program.code));
+            ContractVM vm;
+            bool ok = true;
+            measure("contract_execute", {{"contract", program.name}}, [&]() {
+                for (int i = 0; i < 100; ++i) {
+                    ExecutionContext context;
+                    context.caller = "0xcaller";
+                    context.contract_address = "0xcontract";
+                    context.origin = "0xcaller";
+                    context.timestamp = 0;
+                    context.block_number = 1;
+                    context.gas_remaining = 1000000;
+                    context.gas_cost = 0;
+                    context.balances["0xcaller"] = 1000.0;
+                    ok = vm.execute(&contract, context, compiled) && ok;
+                }
+                return 100;
+            });
+            results.back()["succeeded"] = ok;
+        }
+    }
+
+    static void persistence() {
+        PersistentStore store("./bench_store");
+        Block block;
+        block.index = 1;
+        block.timestamp = "2026-01-01 00:00:00";
+        block.transactions = make_transactions(10, 10, 4);
+        block.proof = 1;
+        block.previous_hash = std::string(64, '0');
+        block.merkle_root = std::string(64, '0');
+        block.state_root = std::string(64, '0');
+
+        // Latency of one append at each chain length; constant if the log appends in place
+        std::vector<size_t> lengths = {100, 1000, 10000};
+        if (options.quick) {
+            lengths.pop_back();
+        }
+        size_t length = 0;
+        for (size_t target : lengths) {
+            while (length + 100 < target) {
+                block.index = static_cast<int>(++length);
+                store.save_block(block.to_json());
+            }
+            double seconds = 0.0;
+            for (int i = 0; i < 100; ++i) {
+                block.index = static_cast<int>(++length);
+                json block_json = block.to_json();
+                Clock::time_point start = Clock::now();
+                store.save_block(block_json);
+                seconds += seconds_since(start);
+            }
+            record("persistent_store_save_block", {{"chain_length", target}, {"transactions", 10}},
+                   {{"operations", 100}, {"seconds", seconds}, {"ns_per_op", seconds * 1e9 / 100}});
+        }
+
+        // Group commit as the persistence writer does it: 10 blocks per append, with and without fsync
+        for (bool sync : {false, true}) {
+            double seconds = 0.0;
+            for (int batch = 0; batch < 10; ++batch) {
+                std::vector<json> blocks_json;
+                for (int i = 0; i < 10; ++i) {
+                    block.index = static_cast<int>(++length);
+                    blocks_json.push_back(block.to_json());
+                }
+                Clock::time_point start = Clock::now();
+                store.append_blocks(blocks_json, sync);
+                seconds += seconds_since(start);
+            }
+            record("persistent_store_append_blocks", {{"batch", 10}, {"transactions", 10}, {"fsync", sync}},
+                   {{"operations", 100}, {"seconds", seconds}, {"ns_per_op", seconds * 1e9 / 100}});
+        }
+
+        // Restart: decode the stored chain and restore the tip checkpoint
+        size_t startup_length = options.quick ? 1000 : 10000;
+        {
+            Blockchain source;
+            for (size_t i = 1; i < startup_length; ++i) {
+                block.index = static_cast<int>(i + 1);
+                block.previous_hash = source.block_hashes_.back();
+                source._append_block(block);
+            }
+            source._publish_snapshot();
+            source.save_blockchain_state();
+        }
+        // All bodies in memory, then only the last 256
+        for (size_t resident : {static_cast<size_t>(0), static_cast<size_t>(256)}) {
+            Clock::time_point start = Clock::now();
+            Blockchain restarted;
+            restarted.set_storage_config({resident, 0});
+            bool loaded = restarted.load_blockchain_state();
+            record("blockchain_startup", {{"chain_length", startup_length}, {"transactions", 10},
+                                          {"resident_blocks", resident}},
+                   {{"seconds", seconds_since(start)}, {"loaded", loaded && restarted.chain.size() == startup_length},
+                    {"resident_bodies", restarted.get_resident_bodies()}});
+            if (resident > 0) {
+                restarted.get_persistent_store().clear_all_data();
+            }
+        }
+    }
+
+    static void rpc_throughput() {
+        Blockchain chain;
+        const uint16_t port = 18645;
+        RPCServer server(port, &chain, nullptr);
+        server.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        // eth_getBlockByNumber is answered from the response cache after the first call
+        const std::vector<std::pair<const char*, const char*>> calls = {
+            {"eth_blockNumber", "[]"}, {"eth_getBalance", "[\"0xsender1\"]"}, {"eth_getBlockByNumber", "[0]"}};
+        for (const auto& [method, params] : calls) {
+            for (size_t pipeline : {1, 32}) {
+                std::string body = std::string("{\"jsonrpc\":\"2.0\",\"method\":\"") + method +
+                                   "\",\"params\":" + params + ",\"id\":1}";
+                std::string request = "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+                                      std::to_string(body.size()) + "\r\n\r\n" + body;
+                std::string burst;
+                for (size_t i = 0; i < pipeline; ++i) {
+                    burst += request;
+                }
+
+                boost::asio::io_service io;
+                tcp::socket socket(io);
+                socket.connect(tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port));
+                socket.set_option(tcp::no_delay(true));
+                std::string pending;
+                char buffer[65536];
+
+                // One keep-alive connection, `pipeline` requests in flight per round trip
+                measure("rpc_throughput", {{"method", method}, {"pipeline", pipeline}, {"connections", 1}}, [&]() {
+                    boost::asio::write(socket, boost::asio::buffer(burst));
+                    size_t answered = 0;
+                    while (answered < pipeline) {
+                        size_t n = socket.read_some(boost::asio::buffer(buffer));
+                        pending.append(buffer, n);
+                        size_t header_end;
+                        while ((header_end = pending.find("\r\n\r\n")) != std::string::npos) {
+                            size_t length_at = pending.find("Content-Length: ");
+                            size_t length = std::stoul(pending.substr(length_at + 16));
+                            if (pending.size() < header_end + 4 + length) {
+                                break;
+                            }
+                            pending.erase(0, header_end + 4 + length);
+                            ++answered;
+                        }
+                    }
+                    return pipeline;
+                });
+            }
+        }
+        server.stop();
+    }
+
+    // Blocks produced on one node, timed until every node has replayed them
+    static void network_end_to_end() {
+        NetworkManager network;
+        const int node_count = 3;
+        std::vector<BlockchainNode*> nodes;
+        for (int i = 0; i < node_count; ++i) {
+            nodes.push_back(network.create_node("bench" + std::to_string(i), static_cast<uint16_t>(18700 + i)));
+        }
+        network.start_all_nodes();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        Blockchain& producer = nodes[0]->get_blockchain();
+        const int blocks = options.quick ? 20 : 100;
+        time_t base = std::time(nullptr) + 10;  // Spaced further apart than the minimum block interval
+        std::vector<Block> crafted;
+        double craft_seconds = 0.0;
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < blocks; ++i) {
+            Clock::time_point craft_start = Clock::now();
+            Block block = _craft_empty_block(producer, base + 5 * i);
+            craft_seconds += seconds_since(craft_start);
+            producer.accept_block(block);
+        }
+        size_t target = producer.get_chain_height();
+        bool synced = false;
+        while (seconds_since(start) < 60) {
+            synced = std::all_of(nodes.begin(), nodes.end(), [&](BlockchainNode* node) {
+                return node->get_blockchain().get_chain_height() == target;
+            });
+            if (synced) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double total = seconds_since(start);
+        network.stop_all_nodes();
+
+        record("network_end_to_end", {{"nodes", node_count}, {"blocks", blocks}, {"difficulty", 4}},
+               {{"synced", synced},
+                {"seconds", total},
+                {"seconds_excluding_pow", total - craft_seconds},
+                {"sync_rounds", network.get_sync_rounds()},
+                {"blocks_per_second", total - craft_seconds > 0 ? blocks / (total - craft_seconds) : 0.0}});
+    }
+
+private:
+    static Block _craft_empty_block(Blockchain& chain, time_t timestamp) {
+        Block previous = chain.get_previous_block();
+        Block block;
+        block.index = previous.index + 1;
+        block.timestamp = format_time(timestamp);
+        block.pow_version = POW_VERSION_MIDSTATE;
+        block.merkle_root = chain._calculate_merkle_root({}, block.pow_version);
+        block.state_root = chain.get_state_root();
+        block.previous_hash = chain.get_block_hash(chain.get_chain_height() - 1);
+        PowKernel kernel(previous.proof, block.index, block.merkle_root);
+        long long nonce = 0;
+        while (!kernel.meets_difficulty(nonce, 4)) {
+            ++nonce;
+        }
+        block.proof = nonce;
+        return block;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg.rfind("--filter=", 0) == 0) {
+            options.filter = arg.substr(9);
+        } else if (arg.rfind("--min-time=", 0) == 0) {
+            options.min_time = std::stod(arg.substr(11));
+        } else if (arg.rfind("--output=", 0) == 0) {
+            options.output = arg.substr(9);
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--quick] [--filter=SUBSTRING] [--min-time=SECONDS] [--output=FILE]" << std::endl;
+            return 2;
+        }
+    }
+    if (!options.output.empty() && options.output[0] != '/') {
+        options.output = (std::filesystem::current_path() / options.output).string();
+    }
+
+    // Nodes and stores write under the working directory; keep that out of the caller's tree
+    char scratch_template[] = "/tmp/blockchain_bench.XXXXXX";
+    const char* scratch = mkdtemp(scratch_template);
+    if (!scratch) {
+        std::cerr << "Cannot create a scratch directory" << std::endl;
+        return 1;
+    }
+    std::filesystem::current_path(scratch);
+
+    Logger::set_level(LogLevel::ERROR);
+    Logger::disable_console_logging();
+    // Node code reports progress on stdout; only the JSON document goes there
+    std::ostringstream discarded;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(discarded.rdbuf());
+
+    struct Suite {
+        const char* name;
+        void (*run)();
+    };
+    const Suite suites[] = {
+        {"sha256", BlockchainBench::sha256},
+        {"proof_of_work", BlockchainBench::proof_of_work},
+        {"merkle_root", BlockchainBench::merkle_root},
+        {"state_root", BlockchainBench::state_root},
+        {"account_store", BlockchainBench::account_store},
+        {"mempool", BlockchainBench::mempool},
+        {"contract_execute", BlockchainBench::contract_execute},
+        {"persistent_store", BlockchainBench::persistence},
+        {"rpc_throughput", BlockchainBench::rpc_throughput},
+        {"network_end_to_end", BlockchainBench::network_end_to_end},
+    };
+    for (const Suite& suite : suites) {
+        if (!selected(suite.name)) {
+            continue;
+        }
+        std::cerr << suite.name << std::endl;
+        try {
+            suite.run();
+        } catch (const std::exception& e) {
+            record(suite.name, json::object(), {{"error", e.what()}});
+        }
+        discarded.str("");
+    }
+
+    std::cout.rdbuf(stdout_buffer);
+    std::filesystem::current_path("/");
+    std::filesystem::remove_all(scratch);
+
+    json report = {
+        {"suite", "blockchain_bench"},
+        {"format_version", 1},
+        {"timestamp", format_time(std::time(nullptr))},
+        {"compiler", __VERSION__},
+#ifdef NDEBUG
+        {"assertions", false},
+#else
+        {"assertions", true},
+#endif
+        {"hardware_threads", std::thread::hardware_concurrency()},
+        {"pow_backend", PowKernel::backend_name()},
+        {"quick", options.quick},
+        {"min_time_seconds", options.min_time},
+        {"results", results}
+    };
+    if (options.output.empty()) {
+        std::cout << report.dump(2) << std::endl;
+    } else {
+        std::ofstream(options.output) << report.dump(2) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,463 @@
+#include "chain_sync.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+
+ChainSync::ChainSync(Blockchain& blockchain, ApplyFn apply)
+    : blockchain_(blockchain), apply_(std::move(apply)) {}
+
+// ============= PEERS =============
+
+void ChainSync::add_peer(const std::string& peer_id, size_t height, SendFn send) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    _drop_peer(peer_id);
+    Peer& peer = peers_[peer_id];
+    peer.height = height;
+    peer.send = std::move(send);
+}
+
+void ChainSync::remove_peer(const std::string& peer_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    _drop_peer(peer_id);
+    _pump();
+}
+
+void ChainSync::update_peer_height(const std::string& peer_id, size_t height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = peers_.find(peer_id);
+    if (it != peers_.end()) {
+        it->second.height = std::max(it->second.height, height);
+    }
+}
+
+void ChainSync::_drop_peer(const std::string& peer_id) {
+    for (auto it = requests_.begin(); it != requests_.end();) {
+        if (it->second.peer_id == peer_id) {
+            retry_[it->first] = it->second.count;
+            it = requests_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    peers_.erase(peer_id);
+    if (headers_source_ == peer_id) {
+        headers_source_.clear();
+    }
+}
+
+// ============= HEADERS =============
+
+void ChainSync::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    _align();
+    _request_headers_if_behind();
+    _pump();
+}
+
+void ChainSync::on_headers(const std::string& peer_id, const std::vector<BlockHeader>& headers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto peer_it = peers_.find(peer_id);
+    if (peer_it == peers_.end()) {
+        return;
+    }
+    Peer& peer = peer_it->second;
+    peer.awaiting_headers = false;
+    peer.headers_stalled = false;
+    headers_received_ += headers.size();
+
+    _align();
+    BlockHeader parent = headers_.empty() ? _tip_header() : headers_.back();
+    size_t accepted = 0;
+    for (const auto& header : headers) {
+        if (header.index <= parent.index) {
+            continue;  // Already queued or applied
+        }
+        if (accepted == 0 && header.index == parent.index + 1 && header.previous_hash != parent.hash) {
+            LOG_INFO("ChainSync", "Peer " + peer_id + " is on a branch that does not extend #" +
+                     std::to_string(parent.index));
+            break;
+        }
+        if (!blockchain_.verify_header(header, parent)) {
+            LOG_WARN("ChainSync", "Dropping peer " + peer_id + ": invalid header #" +
+                     std::to_string(header.index));
+            _drop_peer(peer_id);
+            _pump();
+            return;
+        }
+        headers_.push_back(header);
+        parent = header;
+        ++accepted;
+    }
+
+    if (accepted > 0) {
+        headers_source_ = peer_id;
+        // A full batch means the peer has more to give
+        size_t known = static_cast<size_t>(parent.index) + (headers.size() >= MAX_HEADERS_PER_MESSAGE ? 1 : 0);
+        peer.height = std::max(peer.height, known);
+        LOG_DEBUG("ChainSync", "Queued " + std::to_string(accepted) + " headers from " + peer_id +
+                  " (up to #" + std::to_string(parent.index) + ")");
+    } else {
+        // Nothing usable: stop treating the peer as ahead of us
+        peer.height = std::min(peer.height, static_cast<size_t>(parent.index));
+    }
+
+    _request_headers_if_behind();
+    _pump();
+}
+
+void ChainSync::_request_headers(const std::string& peer_id, Peer& peer) {
+    wire::HeadersRequest request;
+    if (!headers_.empty()) {
+        request.locator.push_back(headers_.back().hash);
+    }
+    for (auto& hash : blockchain_.get_block_locator()) {
+        request.locator.push_back(std::move(hash));
+    }
+    request.max_headers = MAX_HEADERS_PER_MESSAGE;
+
+    peer.awaiting_headers = true;
+    peer.headers_sent = Clock::now();
+    LOG_DEBUG("ChainSync", "Requesting headers from " + peer_id);
+    peer.send(MessageType::GET_HEADERS, wire::encode_headers_request(request));
+}
+
+void ChainSync::_request_headers_if_behind() {
+    // Headers queue up to two batches ahead of the download
+    if (!bodies_held_ && headers_.size() >= 2 * MAX_HEADERS_PER_MESSAGE) {
+        return;
+    }
+    _expire_header_requests(Clock::now());
+    for (const auto& [_, peer] : peers_) {
+        if (peer.awaiting_headers) {
+            return;
+        }
+    }
+
+    size_t last = headers_.empty() ? blockchain_.get_chain_height() : static_cast<size_t>(headers_.back().index);
+    // Stay with the current source while it is ahead; otherwise pick the tallest peer,
+    // falling back to one that let a request time out only if no other is ahead
+    auto best = peers_.find(headers_source_);
+    if (best == peers_.end() || best->second.height <= last || best->second.headers_stalled) {
+        best = peers_.end();
+        for (auto it = peers_.begin(); it != peers_.end(); ++it) {
+            if (it->second.height <= last) {
+                continue;
+            }
+            if (best == peers_.end() ||
+                (it->second.headers_stalled != best->second.headers_stalled
+                    ? !it->second.headers_stalled
+                    : it->second.height > best->second.height)) {
+                best = it;
+            }
+        }
+    }
+    if (best != peers_.end()) {
+        _request_headers(best->first, best->second);
+    }
+}
+
+bool ChainSync::_expire_header_requests(Clock::time_point now) {
+    // A lost or refused HEADERS reply would otherwise hold header sync until the peer leaves
+    bool expired = false;
+    for (auto& [peer_id, peer] : peers_) {
+        if (peer.awaiting_headers && now - peer.headers_sent > std::chrono::seconds(REQUEST_TIMEOUT_SECONDS)) {
+            LOG_DEBUG("ChainSync", "Headers from " + peer_id + " timed out");
+            peer.awaiting_headers = false;
+            peer.headers_stalled = true;
+            if (headers_source_ == peer_id) {
+                headers_source_.clear();
+            }
+            ++header_requests_timed_out_;
+            expired = true;
+        }
+    }
+    return expired;
+}
+
+// ============= BODIES =============
+
+void ChainSync::on_blocks(const std::string& peer_id, const std::vector<Block>& blocks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto peer_it = peers_.find(peer_id);
+    if (peer_it == peers_.end()) {
+        return;
+    }
+
+    auto request_it = requests_.end();
+    if (!blocks.empty()) {
+        request_it = requests_.find(blocks.front().index);
+        if (request_it != requests_.end() && request_it->second.peer_id != peer_id) {
+            request_it = requests_.end();
+        }
+    } else {
+        request_it = std::find_if(requests_.begin(), requests_.end(),
+                                  [&](const auto& entry) { return entry.second.peer_id == peer_id; });
+    }
+    if (request_it == requests_.end()) {
+        LOG_DEBUG("ChainSync", "Ignoring unrequested blocks from " + peer_id);
+        return;
+    }
+
+    int first = request_it->first;
+    uint32_t count = request_it->second.count;
+    requests_.erase(request_it);
+    --peer_it->second.in_flight;
+
+    _align();
+    bool valid = blocks.size() <= count;
+    for (size_t i = 0; valid && i < blocks.size(); ++i) {
+        const Block& block = blocks[i];
+        int index = first + static_cast<int>(i);
+        if (block.index != index) {
+            valid = false;
+            break;
+        }
+        if (headers_.empty() || index < headers_.front().index) {
+            continue;  // Arrived by other means while this range was in flight
+        }
+        size_t offset = static_cast<size_t>(index - headers_.front().index);
+        if (offset >= headers_.size()) {
+            continue;
+        }
+        if (blockchain_.hash_block(block) != headers_[offset].hash) {
+            valid = false;
+            break;
+        }
+        downloaded_.emplace(index, block);
+    }
+
+    if (!valid) {
+        LOG_WARN("ChainSync", "Dropping peer " + peer_id + ": blocks do not match their headers");
+        if (!headers_.empty()) {
+            retry_[first] = count;
+        }
+        _drop_peer(peer_id);
+        _pump();
+        return;
+    }
+
+    if (blocks.size() < count && !headers_.empty()) {
+        retry_[first + static_cast<int>(blocks.size())] = count - static_cast<uint32_t>(blocks.size());
+        ++ranges_retried_;
+        if (blocks.empty()) {
+            // The peer does not have the range after all
+            peer_it->second.height = std::min(peer_it->second.height, static_cast<size_t>(first - 1));
+        }
+    }
+
+    // Keep peers busy before spending time on validation
+    _pump();
+    _apply_ready();
+    _pump();
+    _request_headers_if_behind();
+}
+
+bool ChainSync::_next_range(size_t peer_height, int window_end, int& first, uint32_t& count) {
+    for (auto it = retry_.begin(); it != retry_.end() && it->first <= window_end; ++it) {
+        if (static_cast<size_t>(it->first) + it->second - 1 <= peer_height) {
+            first = it->first;
+            count = it->second;
+            retry_.erase(it);
+            return true;
+        }
+    }
+
+    if (headers_.empty()) {
+        return false;
+    }
+    long long limit = std::min<long long>({headers_.back().index, window_end, static_cast<long long>(peer_height)});
+    if (next_range_ > limit) {
+        return false;
+    }
+    first = next_range_;
+    count = static_cast<uint32_t>(std::min<long long>(BLOCKS_PER_REQUEST, limit - first + 1));
+    next_range_ += static_cast<int>(count);
+    return true;
+}
+
+void ChainSync::_pump() {
+    Clock::time_point now = Clock::now();
+    if (_expire_header_requests(now)) {
+        _request_headers_if_behind();
+    }
+    for (auto it = requests_.begin(); it != requests_.end();) {
+        if (now - it->second.sent > std::chrono::seconds(REQUEST_TIMEOUT_SECONDS)) {
+            auto peer = peers_.find(it->second.peer_id);
+            if (peer != peers_.end()) {
+                --peer->second.in_flight;
+            }
+            LOG_DEBUG("ChainSync", "Range #" + std::to_string(it->first) + " from " +
+                      it->second.peer_id + " timed out");
+            retry_[it->first] = it->second.count;
+            ++ranges_retried_;
+            it = requests_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (bodies_held_) {
+        return;
+    }
+    int window_end = static_cast<int>(blockchain_.get_chain_height() + DOWNLOAD_WINDOW);
+    // Round-robin so every eligible peer carries part of the download
+    bool assigned = true;
+    while (assigned) {
+        assigned = false;
+        for (auto& [peer_id, peer] : peers_) {
+            if (peer.in_flight >= MAX_REQUESTS_PER_PEER) {
+                continue;
+            }
+            wire::BlocksRequest request;
+            int first;
+            if (!_next_range(peer.height, window_end, first, request.count)) {
+                continue;
+            }
+            request.first_index = static_cast<uint64_t>(first);
+            requests_[first] = Request{peer_id, request.count, now};
+            ++peer.in_flight;
+            peer.send(MessageType::GET_BLOCKS, wire::encode_blocks_request(request));
+            assigned = true;
+        }
+    }
+}
+
+void ChainSync::_apply_ready() {
+    while (true) {
+        _align();
+        if (headers_.empty()) {
+            return;
+        }
+        auto it = downloaded_.find(headers_.front().index);
+        if (it == downloaded_.end()) {
+            return;
+        }
+        Block block = std::move(it->second);
+        downloaded_.erase(it);
+
+        if (!apply_(block)) {
+            // The body matched its header, so the header chain itself is bad
+            std::string source = headers_source_;
+            LOG_WARN("ChainSync", "Block #" + std::to_string(block.index) +
+                     " was rejected; abandoning headers from " + source);
+            _reset();
+            if (!source.empty()) {
+                _drop_peer(source);
+            }
+            return;
+        }
+        ++blocks_applied_;
+    }
+}
+
+void ChainSync::hold_bodies(bool hold) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bodies_held_ == hold) {
+        return;
+    }
+    bodies_held_ = hold;
+    if (!hold) {
+        _align();
+        _request_headers_if_behind();
+        _pump();
+    }
+}
+
+bool ChainSync::find_header(int index, BlockHeader& header) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    _align();
+    if (index < 1) {
+        return false;
+    }
+    if (static_cast<size_t>(index) <= blockchain_.get_chain_height()) {
+        return blockchain_.get_header(static_cast<size_t>(index - 1), header);
+    }
+    if (headers_.empty() || index < headers_.front().index || index > headers_.back().index) {
+        return false;
+    }
+    header = headers_[static_cast<size_t>(index - headers_.front().index)];
+    return true;
+}
+
+std::vector<BlockHeader> ChainSync::headers_through(int index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    _align();
+    std::vector<BlockHeader> headers;
+    for (const auto& header : headers_) {
+        if (header.index > index) {
+            break;
+        }
+        headers.push_back(header);
+    }
+    return headers;
+}
+
+// ============= STATE =============
+
+BlockHeader ChainSync::_tip_header() const {
+    std::shared_ptr<const ChainSnapshot> snapshot = blockchain_.get_snapshot();
+    return BlockHeader::from_block(*snapshot->tip, snapshot->tip_hash);
+}
+
+void ChainSync::_align() {
+    // Drop headers the chain has reached, whether through us, gossip or local mining
+    int tip_index = static_cast<int>(blockchain_.get_chain_height());
+    while (!headers_.empty() && headers_.front().index <= tip_index) {
+        if (blockchain_.get_block_hash(static_cast<size_t>(headers_.front().index - 1)) != headers_.front().hash) {
+            LOG_WARN("ChainSync", "Local chain diverged from synced headers at #" +
+                     std::to_string(headers_.front().index));
+            _reset();
+            return;
+        }
+        headers_.pop_front();
+    }
+
+    downloaded_.erase(downloaded_.begin(), downloaded_.upper_bound(tip_index));
+    next_range_ = std::max(next_range_, tip_index + 1);
+    while (!retry_.empty() && retry_.begin()->first <= tip_index) {
+        auto [first, count] = *retry_.begin();
+        retry_.erase(retry_.begin());
+        int end = first + static_cast<int>(count);
+        if (end > tip_index + 1) {
+            retry_[tip_index + 1] = static_cast<uint32_t>(end - tip_index - 1);
+        }
+    }
+}
+
+void ChainSync::_reset() {
+    for (const auto& [_, request] : requests_) {
+        auto peer = peers_.find(request.peer_id);
+        if (peer != peers_.end()) {
+            --peer->second.in_flight;
+        }
+    }
+    requests_.clear();
+    headers_.clear();
+    headers_source_.clear();
+    retry_.clear();
+    downloaded_.clear();
+    next_range_ = 0;
+}
+
+bool ChainSync::is_syncing() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!headers_.empty() || !requests_.empty()) {
+        return true;
+    }
+    return std::any_of(peers_.begin(), peers_.end(),
+                       [](const auto& entry) { return entry.second.awaiting_headers; });
+}
+
+json ChainSync::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json j;
+    j["peers"] = peers_.size();
+    j["queued_headers"] = headers_.size();
+    j["ranges_in_flight"] = requests_.size();
+    j["buffered_blocks"] = downloaded_.size();
+    j["headers_received"] = headers_received_;
+    j["blocks_applied"] = blocks_applied_;
+    j["ranges_retried"] = ranges_retried_;
+    j["header_requests_timed_out"] = header_requests_timed_out_;
+    j["bodies_held"] = bodies_held_;
+    return j;
+}
@@ -0,0 +1,126 @@
+#ifndef CHAIN_SYNC_HPP
+#define CHAIN_SYNC_HPP
+
+#include "blockchain.hpp"
+#include "wire_protocol.hpp"
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * ChainSync - Headers-first, range-based block download
+ *
+ * A node behind its peers sends the tallest one a block locator
+ * (GET_HEADERS) and gets back up to MAX_HEADERS_PER_MESSAGE headers after
+ * the newest hash they share. Each header's link and proof of work are checked
+ * before it is queued; a full batch immediately asks for the next one.
+ *
+ * Bodies are fetched as BLOCKS_PER_REQUEST ranges spread over every peer tall
+ * enough to serve them, with at most MAX_REQUESTS_PER_PEER in flight per peer
+ * and nothing more than DOWNLOAD_WINDOW blocks past the last applied block,
+ * so a slow validator throttles the download instead of buffering the chain.
+ * Every received body is matched against its header hash; the next ranges are
+ * requested before the blocks continuing our tip are validated and applied,
+ * which keeps peers transferring while we validate. Ranges that time out or
+ * come back short are re-queued for any peer. A header request that times
+ * out is sent to another peer, and the silent one is passed over for
+ * headers until it answers again.
+ *
+ * While a state snapshot is being fetched (see StateSync) bodies are held
+ * back and headers are followed without the usual look-ahead limit, so the
+ * header chain reaches the snapshot height.
+ *
+ * Only chains that extend our tip are followed; reorganisations are not.
+ * Callbacks run under the internal mutex: a SendFn must not call back into
+ * ChainSync synchronously.
+ */
+class ChainSync {
+public:
+    // Sends one binary-encoded body to the peer the function was registered for
+    using SendFn = std::function<void(MessageType type, const std::string& body)>;
+    // Validates and appends one block to the local chain
+    using ApplyFn = std::function<bool(const Block& block)>;
+
+    static constexpr uint32_t MAX_HEADERS_PER_MESSAGE = 2000;
+    static constexpr uint32_t BLOCKS_PER_REQUEST = 64;
+    static constexpr uint32_t MAX_BLOCKS_PER_RESPONSE = 256;  // Served per GET_BLOCKS
+    static constexpr size_t MAX_REQUESTS_PER_PEER = 2;
+    static constexpr size_t DOWNLOAD_WINDOW = 1024;
+    static constexpr int REQUEST_TIMEOUT_SECONDS = 15;
+
+    ChainSync(Blockchain& blockchain, ApplyFn apply);
+
+    // Peers are keyed by the id their messages are delivered under
+    void add_peer(const std::string& peer_id, size_t height, SendFn send);
+    void remove_peer(const std::string& peer_id);
+    void update_peer_height(const std::string& peer_id, size_t height);
+
+    // Ask the tallest peer for headers if it is ahead of us
+    void start();
+
+    void on_headers(const std::string& peer_id, const std::vector<BlockHeader>& headers);
+    void on_blocks(const std::string& peer_id, const std::vector<Block>& blocks);
+
+    // Pause body downloads (headers keep coming); releasing resumes them
+    void hold_bodies(bool hold);
+    // Verified header at `index`, from the local chain or the queue past its tip
+    bool find_header(int index, BlockHeader& header);
+    // Queued headers from our tip up to and including `index`
+    std::vector<BlockHeader> headers_through(int index);
+
+    bool is_syncing() const;
+    json stats_json() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Peer {
+        size_t height = 0;
+        SendFn send;
+        size_t in_flight = 0;           // Outstanding GET_BLOCKS
+        bool awaiting_headers = false;
+        Clock::time_point headers_sent;
+        bool headers_stalled = false;   // Last header request timed out; others are asked first
+    };
+
+    struct Request {
+        std::string peer_id;
+        uint32_t count = 0;
+        Clock::time_point sent;
+    };
+
+    Blockchain& blockchain_;
+    ApplyFn apply_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Peer> peers_;
+    std::deque<BlockHeader> headers_;     // Verified headers past our tip, in order
+    std::string headers_source_;          // Peer whose header chain we follow
+    std::map<int, Request> requests_;     // In flight, by first block index
+    std::map<int, uint32_t> retry_;       // Ranges to request again: first index -> count
+    int next_range_ = 0;                  // First header index never requested
+    std::map<int, Block> downloaded_;     // Bodies waiting for their parent
+    bool bodies_held_ = false;
+
+    size_t headers_received_ = 0;
+    size_t blocks_applied_ = 0;
+    size_t ranges_retried_ = 0;
+    size_t header_requests_timed_out_ = 0;
+
+    BlockHeader _tip_header() const;
+    void _align();
+    void _reset();
+    void _drop_peer(const std::string& peer_id);
+    void _request_headers(const std::string& peer_id, Peer& peer);
+    void _request_headers_if_behind();
+    bool _expire_header_requests(Clock::time_point now);
+    bool _next_range(size_t peer_height, int window_end, int& first, uint32_t& count);
+    void _pump();
+    void _apply_ready();
+};
+
+#endif // CHAIN_SYNC_HPP
@@ -1,7 +1,47 @@
 #include "contract.hpp"
+#include "utils/logger.hpp"
 #include <iostream>
 #include <algorithm>
 #include <ctime>
+#include <openssl/sha.h>
+
+namespace {
+
+std::string to_hex(const uint8_t* data, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(length * 2);
+    for (size_t i = 0; i < length; ++i) {
+        hex.push_back(digits[data[i] >> 4]);
+        hex.push_back(digits[data[i] & 0x0F]);
+    }
+    return hex;
+}
+
+bool from_hex(const std::string& hex, std::vector<uint8_t>& out) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    out.clear();
+    out.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int hi = nibble(hex[i]);
+        int lo = nibble(hex[i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out.push_back(static_cast<uint8_t>((hi << 4) | lo));
+    }
+    return true;
+}
+
+}  // namespace
 
 // ============= SmartContract =============
 
@@ -25,6 +65,7 @@ void SmartContract::set_storage(const std::string& key, const StackValue& value)
 
 void SmartContract::add_instruction(const Instruction& instr) {
     bytecode_.push_back(instr);
+    code_hash_.clear();
 }
 
 void SmartContract::load_bytecode(const std::vector<uint8_t>& code) {
@@ -34,6 +75,7 @@ void SmartContract::load_bytecode(const std::vector<uint8_t>& code) {
         Instruction instr = Instruction::deserialize(code, offset);
         bytecode_.push_back(instr);
     }
+    code_hash_.clear();
 }
 
 std::vector<uint8_t> SmartContract::serialize_bytecode() const {
@@ -45,6 +87,13 @@ std::vector<uint8_t> SmartContract::serialize_bytecode() const {
     return result;
 }
 
+const std::string& SmartContract::get_code_hash() const {
+    if (code_hash_.empty()) {
+        code_hash_ = CompiledProgram::hash_bytecode(serialize_bytecode());
+    }
+    return code_hash_;
+}
+
 json SmartContract::to_json() const {
     json j;
     j["address"] = address_;
@@ -57,6 +106,9 @@ json SmartContract::to_json() const {
         j["storage"][key] = value.to_json();
     }
     j["bytecode_size"] = bytecode_.size();
+    auto bytecode = serialize_bytecode();
+    j["bytecode"] = to_hex(bytecode.data(), bytecode.size());
+    j["code_hash"] = get_code_hash();
     j["source_code"] = source_code_;
     return j;
 }
@@ -68,13 +120,332 @@ SmartContract SmartContract::from_json(const json& j) {
         j["name"].get<std::string>(),
         j["language"].get<std::string>()
     );
+    contract.creation_timestamp_ = j.value("creation_timestamp", contract.creation_timestamp_);
+    contract.source_code_ = j.value("source_code", "");
+    for (const auto& [key, value] : j.value("storage", json::object()).items()) {
+        contract.storage_[key] = StackValue::from_json(value);
+    }
+    std::vector<uint8_t> bytecode;
+    if (from_hex(j.value("bytecode", ""), bytecode)) {
+        contract.load_bytecode(bytecode);
+    }
     return contract;
 }
 
+// ============= StackValue =============
+
+StackValue::StackValue(const std::string& value, Type t) : type_(t), integer_(0) {
+    switch (t) {
+        case Type::INTEGER:
+            integer_ = std::stoll(value);
+            break;
+        case Type::BOOLEAN:
+            boolean_ = value == "true";
+            break;
+        default:
+            if (value.size() <= INLINE_CAPACITY) {
+                inline_size_ = static_cast<uint8_t>(value.size());
+                std::memcpy(inline_, value.data(), value.size());
+            } else {
+                heap_ = std::make_shared<const std::string>(value);
+            }
+    }
+}
+
+std::string StackValue::as_string() const {
+    switch (type_) {
+        case Type::INTEGER:
+            return std::to_string(integer_);
+        case Type::BOOLEAN:
+            return boolean_ ? "true" : "false";
+        default:
+            return heap_ ? *heap_ : std::string(inline_, inline_size_);
+    }
+}
+
+// ============= CompiledProgram =============
+
+uint16_t CompiledProgram::gas_cost(OpCode opcode) {
+    // Gas costs for different operations
+    switch (opcode) {
+        case OpCode::STOP:
+        case OpCode::PUSH:
+        case OpCode::POP:
+            return 3;
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MUL:
+        case OpCode::DIV:
+        case OpCode::MOD:
+            return 5;
+        case OpCode::LOAD:
+        case OpCode::STORE:
+            return 20;
+        case OpCode::SLOAD:
+        case OpCode::SSTORE:
+            return 100;
+        case OpCode::TRANSFER:
+            return 50;
+        default:
+            return 10;
+    }
+}
+
+std::string CompiledProgram::hash_bytecode(const std::vector<uint8_t>& serialized) {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(serialized.data(), serialized.size(), digest);
+    return to_hex(digest, sizeof(digest));
+}
+
+CompiledProgram CompiledProgram::compile(const std::vector<Instruction>& bytecode) {
+    CompiledProgram program;
+    program.code.reserve(bytecode.size());
+
+    std::vector<uint8_t> serialized;
+    for (const auto& instr : bytecode) {
+        auto encoded = instr.serialize();
+        serialized.insert(serialized.end(), encoded.begin(), encoded.end());
+    }
+    program.code_hash = hash_bytecode(serialized);
+
+    for (const auto& instr : bytecode) {
+        DecodedInstruction op{};
+        op.opcode = instr.opcode;
+        op.gas = gas_cost(instr.opcode);
+
+        switch (instr.opcode) {
+            case OpCode::STOP:     op.handler = ContractVM::H_STOP; break;
+            case OpCode::PUSH:     op.handler = ContractVM::H_PUSH; break;
+            case OpCode::POP:      op.handler = ContractVM::H_POP; break;
+            case OpCode::DUP:      op.handler = ContractVM::H_DUP; break;
+            case OpCode::SWAP:     op.handler = ContractVM::H_SWAP; break;
+            case OpCode::ADD:      op.handler = ContractVM::H_ADD; break;
+            case OpCode::SUB:      op.handler = ContractVM::H_SUB; break;
+            case OpCode::MUL:      op.handler = ContractVM::H_MUL; break;
+            case OpCode::DIV:      op.handler = ContractVM::H_DIV; break;
+            case OpCode::MOD:      op.handler = ContractVM::H_MOD; break;
+            case OpCode::LOAD:     op.handler = ContractVM::H_LOAD; break;
+            case OpCode::STORE:    op.handler = ContractVM::H_STORE; break;
+            case OpCode::SLOAD:    op.handler = ContractVM::H_SLOAD; break;
+            case OpCode::SSTORE:   op.handler = ContractVM::H_SSTORE; break;
+            case OpCode::CALL:     op.handler = ContractVM::H_CALL; break;
+            case OpCode::RETURN:   op.handler = ContractVM::H_RETURN; break;
+            case OpCode::TRANSFER: op.handler = ContractVM::H_TRANSFER; break;
+            case OpCode::BALANCE:  op.handler = ContractVM::H_BALANCE; break;
+            case OpCode::REVERT:   op.handler = ContractVM::H_REVERT; break;
+            case OpCode::ASSERT:   op.handler = ContractVM::H_ASSERT; break;
+            default:               op.handler = ContractVM::H_UNKNOWN; break;
+        }
+        if (op.handler == ContractVM::H_UNKNOWN && program.valid) {
+            // Still executable: the VM faults when it reaches this instruction
+            program.valid = false;
+            program.first_invalid = program.code.size();
+        }
+        program.max_gas += op.gas;
+
+        if (instr.opcode == OpCode::PUSH && !instr.args.empty()) {
+            // Little-endian operand of up to 8 bytes
+            size_t size = std::min(sizeof(int64_t), instr.args.size());
+            std::memcpy(&op.immediate, instr.args.data(), size);
+        }
+        program.code.push_back(op);
+    }
+
+    // Without jumps, blocks only end where execution can halt
+    size_t leader = 0;
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        uint8_t handler = program.code[i].handler;
+        bool terminator = handler == ContractVM::H_STOP || handler == ContractVM::H_RETURN ||
+                          handler == ContractVM::H_REVERT || handler == ContractVM::H_UNKNOWN;
+        if (!terminator && i + 1 < program.code.size()) {
+            continue;
+        }
+
+        int64_t remaining = 0;
+        for (size_t j = i + 1; j-- > leader;) {
+            program.code[j].gas_after = remaining;
+            remaining += program.code[j].gas;
+        }
+        program.code[leader].block_gas = remaining;
+        program.code[leader].block_end = static_cast<uint32_t>(i + 1);
+        leader = i + 1;
+    }
+    return program;
+}
+
+size_t CompiledProgram::memory_usage() const {
+    return sizeof(CompiledProgram) + code_hash.capacity() + code.capacity() * sizeof(DecodedInstruction);
+}
+
+// ============= ProgramCache =============
+
+std::shared_ptr<const CompiledProgram> ProgramCache::get(const std::string& code_hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(code_hash);
+    if (it == index_.end()) {
+        ++misses_;
+        return nullptr;
+    }
+    ++hits_;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+}
+
+std::shared_ptr<const CompiledProgram> ProgramCache::insert(std::shared_ptr<const CompiledProgram> program) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(program->code_hash);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+    if (program->memory_usage() > memory_budget_) {
+        return program;  // Usable, just too large to keep
+    }
+
+    lru_.emplace_front(program->code_hash, program);
+    index_[program->code_hash] = lru_.begin();
+    memory_used_ += program->memory_usage();
+    evict_to_budget();
+    return program;
+}
+
+void ProgramCache::evict_to_budget() {
+    while (memory_used_ > memory_budget_ && !lru_.empty()) {
+        memory_used_ -= lru_.back().second->memory_usage();
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+        ++evictions_;
+    }
+}
+
+size_t ProgramCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
+}
+
+size_t ProgramCache::memory_used() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_used_;
+}
+
+json ProgramCache::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json j;
+    j["programs"] = lru_.size();
+    j["memory_used"] = memory_used_;
+    j["memory_budget"] = memory_budget_;
+    j["hits"] = hits_;
+    j["misses"] = misses_;
+    j["evictions"] = evictions_;
+    return j;
+}
+
+// ============= StateOverlay =============
+
+double StateOverlay::get_balance(const std::string& address) const {
+    auto it = balances_.find(address);
+    if (it != balances_.end()) {
+        return it->second;
+    }
+    if (base_accounts_) {
+        AccountRecord record;
+        return base_accounts_->get(address, record) && record.has_balance ? record.balance : 0.0;
+    }
+    auto base = base_balances_->find(address);
+    return base == base_balances_->end() ? 0.0 : base->second;
+}
+
+void StateOverlay::set_balance(const std::string& address, double balance) {
+    auto [it, inserted] = balances_.emplace(address, balance);
+    if (!frames_.empty()) {
+        journal_.push_back({false, address, !inserted, inserted ? 0.0 : it->second, StackValue()});
+    }
+    it->second = balance;
+}
+
+StackValue StateOverlay::get_storage(const std::string& key) const {
+    auto it = storage_.find(key);
+    if (it != storage_.end()) {
+        return it->second;
+    }
+    auto base = base_storage_.find(key);
+    return base == base_storage_.end() ? StackValue(0) : base->second;
+}
+
+void StateOverlay::set_storage(const std::string& key, const StackValue& value) {
+    auto [it, inserted] = storage_.emplace(key, value);
+    if (!frames_.empty()) {
+        journal_.push_back({true, key, !inserted, 0.0, inserted ? StackValue() : it->second});
+    }
+    it->second = value;
+}
+
+void StateOverlay::commit_frame() {
+    if (frames_.empty()) {
+        return;
+    }
+    frames_.pop_back();
+    if (frames_.empty()) {
+        journal_.clear();  // Nothing left that could revert these writes
+    }
+}
+
+void StateOverlay::revert_frame() {
+    if (frames_.empty()) {
+        return;
+    }
+    size_t mark = frames_.back();
+    frames_.pop_back();
+    while (journal_.size() > mark) {
+        JournalEntry& entry = journal_.back();
+        if (entry.is_storage) {
+            if (entry.existed) {
+                storage_[entry.key] = std::move(entry.value);
+            } else {
+                storage_.erase(entry.key);
+            }
+        } else {
+            if (entry.existed) {
+                balances_[entry.key] = entry.balance;
+            } else {
+                balances_.erase(entry.key);
+            }
+        }
+        journal_.pop_back();
+    }
+}
+
+void StateOverlay::clear() {
+    balances_.clear();
+    storage_.clear();
+    journal_.clear();
+    frames_.clear();
+}
+
+void StateOverlay::apply(std::map<std::string, double>& balances, SmartContract& contract,
+                         std::vector<std::string>* touched) const {
+    for (const auto& [address, balance] : balances_) {
+        balances[address] = balance;
+        if (touched) {
+            touched->push_back(address);
+        }
+    }
+    for (const auto& [key, value] : storage_) {
+        contract.set_storage(key, value);
+    }
+}
+
+void StateOverlay::apply_storage(SmartContract& contract) const {
+    for (const auto& [key, value] : storage_) {
+        contract.set_storage(key, value);
+    }
+}
+
 // ============= ContractVM =============
 
 ContractVM::ContractVM() : pc_(0), halted_(false), contract_(nullptr) {
     context_.gas_remaining = 1000000;  // 1M gas default
+    stack_.reserve(1024);
 }
 
 void ContractVM::push_stack(const StackValue& value) {
@@ -88,7 +459,7 @@ StackValue ContractVM::pop_stack() {
     if (stack_.empty()) {
         throw std::runtime_error("Stack underflow");
     }
-    StackValue value = stack_.back();
+    StackValue value = std::move(stack_.back());
     stack_.pop_back();
     return value;
 }
@@ -100,53 +471,25 @@ StackValue ContractVM::peek_stack() const {
     return stack_.back();
 }
 
-void ContractVM::calculate_gas_cost(OpCode opcode) {
-    // Gas costs for different operations
-    switch (opcode) {
-        case OpCode::STOP:
-        case OpCode::PUSH:
-        case OpCode::POP:
-            context_.gas_cost = 3;
-            break;
-        case OpCode::ADD:
-        case OpCode::SUB:
-        case OpCode::MUL:
-        case OpCode::DIV:
-        case OpCode::MOD:
-            context_.gas_cost = 5;
-            break;
-        case OpCode::LOAD:
-        case OpCode::STORE:
-            context_.gas_cost = 20;
-            break;
-        case OpCode::SLOAD:
-        case OpCode::SSTORE:
-            context_.gas_cost = 100;
-            break;
-        case OpCode::TRANSFER:
-            context_.gas_cost = 50;
-            break;
-        default:
-            context_.gas_cost = 10;
+int64_t ContractVM::pop_integer() {
+    if (stack_.empty()) {
+        throw std::runtime_error("Stack underflow");
     }
-    
+    int64_t value = stack_.back().as_integer();
+    stack_.pop_back();
+    return value;
+}
+
+void ContractVM::calculate_gas_cost(const DecodedInstruction& instr) {
+    context_.gas_cost = instr.gas;
     context_.gas_remaining -= context_.gas_cost;
     if (context_.gas_remaining < 0) {
         throw std::runtime_error("Out of gas");
     }
 }
 
-void ContractVM::handle_push(const Instruction& instr) {
-    if (instr.args.empty()) {
-        // If no args, push 0 as default
-        push_stack(StackValue(0));
-    } else {
-        // Parse value from args (handle variable length)
-        int64_t value = 0;
-        size_t size = std::min(sizeof(int64_t), instr.args.size());
-        std::memcpy(&value, instr.args.data(), size);
-        push_stack(StackValue(value));
-    }
+void ContractVM::handle_push(const DecodedInstruction& instr) {
+    push_stack(StackValue(instr.immediate));
 }
 
 void ContractVM::handle_pop() {
@@ -163,35 +506,35 @@ void ContractVM::handle_swap() {
 }
 
 void ContractVM::handle_add() {
-    auto b = pop_stack().as_integer();
-    auto a = pop_stack().as_integer();
-    push_stack(StackValue(a + b));
+    auto b = pop_integer();
+    auto a = pop_integer();
+    stack_.emplace_back(a + b);
 }
 
 void ContractVM::handle_sub() {
-    auto b = pop_stack().as_integer();
-    auto a = pop_stack().as_integer();
-    push_stack(StackValue(a - b));
+    auto b = pop_integer();
+    auto a = pop_integer();
+    stack_.emplace_back(a - b);
 }
 
 void ContractVM::handle_mul() {
-    auto b = pop_stack().as_integer();
-    auto a = pop_stack().as_integer();
-    push_stack(StackValue(a * b));
+    auto b = pop_integer();
+    auto a = pop_integer();
+    stack_.emplace_back(a * b);
 }
 
 void ContractVM::handle_div() {
-    auto b = pop_stack().as_integer();
-    auto a = pop_stack().as_integer();
+    auto b = pop_integer();
+    auto a = pop_integer();
     if (b == 0) throw std::runtime_error("Division by zero");
-    push_stack(StackValue(a / b));
+    stack_.emplace_back(a / b);
 }
 
 void ContractVM::handle_mod() {
-    auto b = pop_stack().as_integer();
-    auto a = pop_stack().as_integer();
+    auto b = pop_integer();
+    auto a = pop_integer();
     if (b == 0) throw std::runtime_error("Division by zero");
-    push_stack(StackValue(a % b));
+    stack_.emplace_back(a % b);
 }
 
 void ContractVM::handle_load() {
@@ -200,8 +543,7 @@ void ContractVM::handle_load() {
         push_stack(StackValue(0));
     } else {
         auto key = pop_stack().as_string();
-        auto value = contract_->get_storage(key);
-        push_stack(value);
+        push_stack(state_->get_storage(key));
     }
 }
 
@@ -212,43 +554,43 @@ void ContractVM::handle_store() {
     }
     auto value = pop_stack();
     auto key = pop_stack().as_string();
-    contract_->set_storage(key, value);
+    state_->set_storage(key, value);
 }
 
 void ContractVM::handle_sload() {
     auto key = pop_stack().as_string();
-    auto value = context_.storage[key];
-    push_stack(value);
+    push_stack(context_.storage[key]);
 }
 
 void ContractVM::handle_sstore() {
     auto value = pop_stack();
     auto key = pop_stack().as_string();
-    context_.storage[key] = value;
+    context_.storage[key] = std::move(value);
 }
 
 void ContractVM::handle_transfer() {
     auto amount = pop_stack().as_integer();
     auto to = pop_stack().as_string();
     
-    if (context_.balances[context_.caller] < amount) {
+    double caller_balance = state_->get_balance(context_.caller);
+    if (caller_balance < amount) {
         throw std::runtime_error("Insufficient balance for transfer");
     }
     
-    context_.balances[context_.caller] -= amount;
-    context_.balances[to] += amount;
+    state_->set_balance(context_.caller, caller_balance - amount);
+    state_->set_balance(to, state_->get_balance(to) + amount);
     push_stack(StackValue(1));  // Success
 }
 
 void ContractVM::handle_balance() {
     auto address = pop_stack().as_string();
-    auto balance = context_.balances[address];
+    auto balance = state_->get_balance(address);
     push_stack(StackValue(static_cast<int64_t>(balance)));
 }
 
-void ContractVM::handle_call(const Instruction& instr) {
+void ContractVM::handle_call(const DecodedInstruction& instr) {
     // Simplified call handling
-    auto function_id = pop_stack().as_integer();
+    pop_integer();  // Function id
     push_stack(StackValue(0));  // Placeholder return value
 }
 
@@ -256,109 +598,190 @@ void ContractVM::handle_return() {
     halted_ = true;
 }
 
-bool ContractVM::execute(SmartContract* contract, const ExecutionContext& context) {
-    contract_ = contract;
-    context_ = context;
-    pc_ = 0;
-    halted_ = false;
-    stack_.clear();
-    
+void ContractVM::handle_assert() {
+    if (stack_.empty()) {
+        throw std::runtime_error("Stack underflow");
+    }
+    if (!stack_.back().as_boolean()) {
+        throw std::runtime_error("Assertion failed");
+    }
+    stack_.pop_back();
+}
+
+void ContractVM::dispatch(const DecodedInstruction& instr) {
+    switch (instr.handler) {
+        case H_STOP:     halted_ = true; break;
+        case H_PUSH:     handle_push(instr); break;
+        case H_POP:      handle_pop(); break;
+        case H_DUP:      handle_dup(); break;
+        case H_SWAP:     handle_swap(); break;
+        case H_ADD:      handle_add(); break;
+        case H_SUB:      handle_sub(); break;
+        case H_MUL:      handle_mul(); break;
+        case H_DIV:      handle_div(); break;
+        case H_MOD:      handle_mod(); break;
+        case H_LOAD:     handle_load(); break;
+        case H_STORE:    handle_store(); break;
+        case H_SLOAD:    handle_sload(); break;
+        case H_SSTORE:   handle_sstore(); break;
+        case H_CALL:     handle_call(instr); break;
+        case H_RETURN:   handle_return(); break;
+        case H_TRANSFER: handle_transfer(); break;
+        case H_BALANCE:  handle_balance(); break;
+        case H_REVERT:   throw std::runtime_error("Contract execution reverted");
+        case H_ASSERT:   handle_assert(); break;
+        default:         throw std::runtime_error("Unknown opcode");
+    }
+}
+
+/**
+ * Main interpreter loop. If the leader of a block finds enough gas for the
+ * whole block, the VM charges it once and runs the block with no further gas
+ * checks. Otherwise it falls back to charging per instruction, so running out
+ * of gas happens at exactly the same instruction as before. If an instruction
+ * fails inside a pre-charged block, the gas for the instructions that never
+ * ran is refunded.
+ */
+bool ContractVM::run() {
+    const DecodedInstruction* code = program_->code.data();
+    const size_t size = program_->code.size();
+    bool block_charged = false;
+
     try {
-        while (!halted_ && pc_ < contract_->get_bytecode().size()) {
-            if (!step()) {
-                return false;
+        while (!halted_ && pc_ < size) {
+            const DecodedInstruction& leader = code[pc_];
+            if (leader.block_gas == 0 || context_.gas_remaining < leader.block_gas) {
+                calculate_gas_cost(leader);
+                dispatch(leader);
+                pc_++;
+                continue;
             }
+
+            context_.gas_remaining -= leader.block_gas;
+            block_charged = true;
+            const size_t end = leader.block_end;
+
+#if defined(__GNUC__)
+            // Threaded dispatch: every handler jumps straight to the next one
+            static void* const labels[HANDLER_COUNT] = {
+                &&op_stop, &&op_push, &&op_pop, &&op_dup, &&op_swap, &&op_add, &&op_sub,
+                &&op_mul, &&op_div, &&op_mod, &&op_load, &&op_store, &&op_sload, &&op_sstore,
+                &&op_call, &&op_return, &&op_transfer, &&op_balance, &&op_revert, &&op_assert,
+                &&op_unknown
+            };
+#define VM_NEXT() do { if (++pc_ == end) goto block_done; goto *labels[code[pc_].handler]; } while (0)
+
+            goto *labels[code[pc_].handler];
+        op_stop:     halted_ = true; VM_NEXT();
+        op_push:     push_stack(StackValue(code[pc_].immediate)); VM_NEXT();
+        op_pop:      handle_pop(); VM_NEXT();
+        op_dup:      handle_dup(); VM_NEXT();
+        op_swap:     handle_swap(); VM_NEXT();
+        op_add:      handle_add(); VM_NEXT();
+        op_sub:      handle_sub(); VM_NEXT();
+        op_mul:      handle_mul(); VM_NEXT();
+        op_div:      handle_div(); VM_NEXT();
+        op_mod:      handle_mod(); VM_NEXT();
+        op_load:     handle_load(); VM_NEXT();
+        op_store:    handle_store(); VM_NEXT();
+        op_sload:    handle_sload(); VM_NEXT();
+        op_sstore:   handle_sstore(); VM_NEXT();
+        op_call:     handle_call(code[pc_]); VM_NEXT();
+        op_return:   handle_return(); VM_NEXT();
+        op_transfer: handle_transfer(); VM_NEXT();
+        op_balance:  handle_balance(); VM_NEXT();
+        op_revert:   throw std::runtime_error("Contract execution reverted");
+        op_assert:   handle_assert(); VM_NEXT();
+        op_unknown:  throw std::runtime_error("Unknown opcode");
+#undef VM_NEXT
+        block_done:
+#else
+            for (; pc_ < end; ++pc_) {
+                dispatch(code[pc_]);
+            }
+#endif
+            block_charged = false;
+            context_.gas_cost = code[end - 1].gas;
         }
         return true;
     } catch (const std::exception& e) {
+        if (block_charged) {
+            context_.gas_remaining += code[pc_].gas_after;
+            context_.gas_cost = code[pc_].gas;
+        }
         error_message_ = e.what();
         return false;
     }
 }
 
+bool ContractVM::execute(SmartContract* contract, const ExecutionContext& context,
+                         std::shared_ptr<const CompiledProgram> program) {
+    contract_ = contract;
+    context_ = context;
+    pc_ = 0;
+    halted_ = false;
+    stack_.clear();
+    const SmartContract& code_owner = *contract_;
+    program_ = program ? std::move(program)
+                       : std::make_shared<const CompiledProgram>(CompiledProgram::compile(code_owner.get_bytecode()));
+    
+    // Without a caller-supplied view, buffer against our own copy of the context
+    state_ = context_.state;
+    if (!state_) {
+        owned_state_ = std::make_unique<StateOverlay>(context_.balances, contract_->get_all_storage());
+        state_ = owned_state_.get();
+    }
+    
+    // Everything the call wrote is discarded if it fails or reverts
+    state_->begin_frame();
+    bool ok = run();
+    if (ok) {
+        state_->commit_frame();
+    } else {
+        state_->revert_frame();
+    }
+    
+    if (owned_state_) {
+        owned_state_->apply(context_.balances, *contract_);
+        owned_state_.reset();
+    }
+    state_ = nullptr;
+    return ok;
+}
+
 bool ContractVM::step() {
-    if (pc_ >= contract_->get_bytecode().size()) {
+    const SmartContract& code_owner = *contract_;
+    if (!program_ || program_->code_hash != code_owner.get_code_hash()) {
+        program_ = std::make_shared<const CompiledProgram>(CompiledProgram::compile(code_owner.get_bytecode()));
+    }
+    if (pc_ >= program_->code.size()) {
         halted_ = true;
         return true;
     }
     
+    // A single step has no frame to revert, so its writes are applied directly
+    StateOverlay direct(context_.balances, contract_->get_all_storage());
+    StateOverlay* previous = state_;
+    if (!state_) {
+        state_ = &direct;
+    }
+    
+    bool ok = true;
     try {
-        const auto& instr = contract_->get_bytecode()[pc_];
-        calculate_gas_cost(instr.opcode);
-        
-        switch (instr.opcode) {
-            case OpCode::STOP:
-                halted_ = true;
-                break;
-            case OpCode::PUSH:
-                handle_push(instr);
-                break;
-            case OpCode::POP:
-                handle_pop();
-                break;
-            case OpCode::DUP:
-                handle_dup();
-                break;
-            case OpCode::SWAP:
-                handle_swap();
-                break;
-            case OpCode::ADD:
-                handle_add();
-                break;
-            case OpCode::SUB:
-                handle_sub();
-                break;
-            case OpCode::MUL:
-                handle_mul();
-                break;
-            case OpCode::DIV:
-                handle_div();
-                break;
-            case OpCode::MOD:
-                handle_mod();
-                break;
-            case OpCode::LOAD:
-                handle_load();
-                break;
-            case OpCode::STORE:
-                handle_store();
-                break;
-            case OpCode::SLOAD:
-                handle_sload();
-                break;
-            case OpCode::SSTORE:
-                handle_sstore();
-                break;
-            case OpCode::TRANSFER:
-                handle_transfer();
-                break;
-            case OpCode::BALANCE:
-                handle_balance();
-                break;
-            case OpCode::CALL:
-                handle_call(instr);
-                break;
-            case OpCode::RETURN:
-                handle_return();
-                break;
-            case OpCode::REVERT:
-                throw std::runtime_error("Contract execution reverted");
-            case OpCode::ASSERT:
-                if (!peek_stack().as_boolean()) {
-                    throw std::runtime_error("Assertion failed");
-                }
-                pop_stack();
-                break;
-            default:
-                throw std::runtime_error("Unknown opcode");
-        }
-        
+        const auto& instr = program_->code[pc_];
+        calculate_gas_cost(instr);
+        dispatch(instr);
         pc_++;
-        return true;
     } catch (const std::exception& e) {
         error_message_ = e.what();
-        return false;
+        ok = false;
     }
+    
+    if (state_ == &direct) {
+        direct.apply(context_.balances, *contract_);
+    }
+    state_ = previous;
+    return ok;
 }
 
 StackValue ContractVM::get_result() const {
@@ -391,6 +814,13 @@ std::string ContractManager::deploy_contract(const std::string& creator,
     auto contract = std::make_shared<SmartContract>(address, creator, name, language);
     contract->load_bytecode(bytecode);
     
+    // Decode and validate once here; every call reuses the cached program
+    auto program = get_program(*contract);
+    if (!program->valid) {
+        LOG_WARN("ContractManager", "Contract " + address + " has an unknown opcode at instruction " +
+                 std::to_string(program->first_invalid));
+    }
+    
     // Store contract
     contracts_[address] = contract;
     address_to_creator_[address] = creator;
@@ -398,6 +828,48 @@ std::string ContractManager::deploy_contract(const std::string& creator,
     return address;
 }
 
+std::shared_ptr<const CompiledProgram> ContractManager::get_program(const SmartContract& contract) {
+    const std::string& code_hash = contract.get_code_hash();
+    if (auto program = program_cache_.get(code_hash)) {
+        return program;
+    }
+    return program_cache_.insert(
+        std::make_shared<const CompiledProgram>(CompiledProgram::compile(contract.get_bytecode())));
+}
+
+json ContractManager::export_contract(const std::string& address) {
+    SmartContract* contract = get_contract(address);
+    if (!contract) {
+        return json();
+    }
+    return contract->to_json();
+}
+
+bool ContractManager::restore_contract(const json& contract_json) {
+    try {
+        auto contract = std::make_shared<SmartContract>(SmartContract::from_json(contract_json));
+        const std::string& address = contract->get_address();
+        if (contract_json.contains("code_hash") && contract_json["code_hash"] != contract->get_code_hash()) {
+            LOG_WARN("ContractManager", "Bytecode hash mismatch for contract " + address);
+            return false;
+        }
+
+        // Compiled from the bytecode, never read back from disk: the interpreter
+        // trusts its records, and compiling is cheap next to loading the chain
+        get_program(*contract);
+
+        if (!contracts_.count(address)) {
+            contract_nonces_[contract->get_creator()]++;
+        }
+        address_to_creator_[address] = contract->get_creator();
+        contracts_[address] = std::move(contract);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("ContractManager", "Failed to restore contract: " + std::string(e.what()));
+        return false;
+    }
+}
+
 SmartContract* ContractManager::get_contract(const std::string& address) {
     auto it = contracts_.find(address);
     if (it == contracts_.end()) {
@@ -7,8 +7,13 @@
 #include <cstring>
 #include <stdexcept>
 #include <memory>
+#include <memory_resource>
 #include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
+#include "account_store.hpp"
 
 using json = nlohmann::json;
 
@@ -40,8 +45,15 @@ enum class OpCode : uint8_t {
     ASSERT = 0x17,        // Assert condition
 };
 
-// Stack value - can hold multiple types
-struct StackValue {
+/**
+ * StackValue - Tagged union held on the VM stack and in contract storage
+ *
+ * Integers and booleans are stored natively; strings up to INLINE_CAPACITY
+ * bytes live inline, longer ones in a shared immutable buffer, so pushing,
+ * popping and DUP never allocate for the common cases.
+ */
+class StackValue {
+public:
     enum class Type : uint8_t {
         INTEGER,
         STRING,
@@ -50,62 +62,173 @@ struct StackValue {
         BYTES
     };
 
-    Type type;
-    std::string data;
+    static constexpr size_t INLINE_CAPACITY = 22;
+
+    StackValue() noexcept : type_(Type::INTEGER), integer_(0) {}
+    StackValue(int64_t value) noexcept : type_(Type::INTEGER), integer_(value) {}
+    StackValue(const std::string& value, Type t = Type::STRING);
 
-    StackValue() : type(Type::INTEGER), data("0") {}
-    StackValue(int64_t value) : type(Type::INTEGER), data(std::to_string(value)) {}
-    StackValue(const std::string& value, Type t = Type::STRING) : type(t), data(value) {}
+    Type type() const { return type_; }
+    bool is_integer() const { return type_ == Type::INTEGER; }
 
     int64_t as_integer() const {
-        if (type != Type::INTEGER) throw std::runtime_error("Type mismatch: not an integer");
-        return std::stoll(data);
+        if (type_ != Type::INTEGER) throw std::runtime_error("Type mismatch: not an integer");
+        return integer_;
     }
 
-    std::string as_string() const {
-        return data;
-    }
+    // Integers render in decimal and booleans as "true"/"false"
+    std::string as_string() const;
 
     bool as_boolean() const {
-        if (type != Type::BOOLEAN) throw std::runtime_error("Type mismatch: not a boolean");
-        return data == "true";
+        if (type_ != Type::BOOLEAN) throw std::runtime_error("Type mismatch: not a boolean");
+        return boolean_;
     }
 
     json to_json() const {
         json j;
-        j["type"] = static_cast<int>(type);
-        j["data"] = data;
+        j["type"] = static_cast<int>(type_);
+        j["data"] = as_string();
         return j;
     }
 
     static StackValue from_json(const json& j) {
-        StackValue sv;
-        sv.type = static_cast<Type>(j["type"].get<int>());
-        sv.data = j["data"].get<std::string>();
-        return sv;
+        return StackValue(j["data"].get<std::string>(), static_cast<Type>(j["type"].get<int>()));
     }
+
+private:
+    Type type_;
+    uint8_t inline_size_ = 0;
+    union {
+        int64_t integer_;
+        bool boolean_;
+        char inline_[INLINE_CAPACITY];
+    };
+    std::shared_ptr<const std::string> heap_;  // Strings longer than INLINE_CAPACITY
 };
 
 // Contract bytecode instruction
+//
+// Encoding: one opcode byte, or (opcode | ARGS_FLAG) followed by a LEB128
+// argument length and the arguments, so arguments survive a round trip.
 struct Instruction {
+    static constexpr uint8_t ARGS_FLAG = 0x80;
+
     OpCode opcode;
     std::vector<uint8_t> args;  // Instruction arguments
 
     std::vector<uint8_t> serialize() const {
         std::vector<uint8_t> result;
-        result.push_back(static_cast<uint8_t>(opcode));
+        if (args.empty()) {
+            result.push_back(static_cast<uint8_t>(opcode));
+            return result;
+        }
+        result.push_back(static_cast<uint8_t>(opcode) | ARGS_FLAG);
+        size_t length = args.size();
+        while (length >= 0x80) {
+            result.push_back(static_cast<uint8_t>(length) | 0x80);
+            length >>= 7;
+        }
+        result.push_back(static_cast<uint8_t>(length));
         result.insert(result.end(), args.begin(), args.end());
         return result;
     }
 
     static Instruction deserialize(const std::vector<uint8_t>& data, size_t& offset) {
         Instruction instr;
-        instr.opcode = static_cast<OpCode>(data[offset++]);
-        // Args would be parsed based on opcode type
+        uint8_t byte = data[offset++];
+        instr.opcode = static_cast<OpCode>(byte & ~ARGS_FLAG);
+        if (byte & ARGS_FLAG) {
+            size_t length = 0;
+            for (unsigned shift = 0;; shift += 7) {
+                if (offset >= data.size() || shift > 28) {
+                    throw std::runtime_error("Truncated bytecode");
+                }
+                uint8_t part = data[offset++];
+                length |= static_cast<size_t>(part & 0x7F) << shift;
+                if (!(part & 0x80)) break;
+            }
+            if (length > data.size() - offset) {
+                throw std::runtime_error("Truncated bytecode");
+            }
+            instr.args.assign(data.begin() + offset, data.begin() + offset + length);
+            offset += length;
+        }
         return instr;
     }
 };
 
+/**
+ * CompiledProgram - Contract bytecode pre-decoded for the interpreter
+ *
+ * Instructions are flattened into one array with immediates already parsed
+ * and a dispatch slot resolved. The code is split into basic blocks that end
+ * at STOP/RETURN/REVERT or an unknown opcode; the leader of each block carries
+ * the block's total gas so the VM charges a whole block at once.
+ *
+ * A program is immutable once built and is shared between calls through the
+ * ContractManager's ProgramCache, keyed by the bytecode hash.
+ */
+struct DecodedInstruction {
+    OpCode opcode;
+    uint8_t handler;        // Dispatch slot (see ContractVM::Handler)
+    uint16_t gas;           // Static cost of this instruction
+    uint32_t block_end;     // Leader only: one past the block's last instruction
+    int64_t block_gas;      // Leader only: summed cost of the block, 0 elsewhere
+    int64_t gas_after;      // Cost of the rest of the block after this instruction
+    int64_t immediate;      // PUSH operand
+};
+
+struct CompiledProgram {
+    std::string code_hash;                  // SHA-256 of the serialized bytecode
+    std::vector<DecodedInstruction> code;
+    int64_t max_gas = 0;                    // Upper bound: every instruction runs
+    bool valid = true;                      // False if an unknown opcode is present
+    size_t first_invalid = 0;               // Position of the first unknown opcode
+
+    static CompiledProgram compile(const std::vector<Instruction>& bytecode);
+    static uint16_t gas_cost(OpCode opcode);
+    static std::string hash_bytecode(const std::vector<uint8_t>& serialized);
+
+    size_t memory_usage() const;
+};
+
+/**
+ * ProgramCache - LRU cache of compiled programs under a memory budget
+ *
+ * Contracts that share bytecode share one program. Programs handed out stay
+ * valid after eviction because callers hold a shared_ptr.
+ */
+class ProgramCache {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+    explicit ProgramCache(size_t memory_budget = DEFAULT_MEMORY_BUDGET) : memory_budget_(memory_budget) {}
+
+    std::shared_ptr<const CompiledProgram> get(const std::string& code_hash);
+    std::shared_ptr<const CompiledProgram> insert(std::shared_ptr<const CompiledProgram> program);
+
+    size_t size() const;
+    size_t memory_used() const;
+    size_t memory_budget() const { return memory_budget_; }
+    json stats_json() const;
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const CompiledProgram>>;
+
+    size_t memory_budget_;
+    size_t memory_used_ = 0;
+    std::list<Entry> lru_;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+    mutable std::mutex mutex_;
+
+    void evict_to_budget();
+};
+
+class StateOverlay;
+
 // Contract execution context
 struct ExecutionContext {
     std::string caller;                        // Transaction sender
@@ -117,6 +240,8 @@ struct ExecutionContext {
     std::map<std::string, double> balances;    // Account balances
     int64_t gas_remaining;                     // Gas left for execution
     int64_t gas_cost;                          // Gas cost of current instruction
+    StateOverlay* state = nullptr;             // Committed-state view; if null the VM
+                                               // overlays `balances` and the contract's storage
 
     json to_json() const {
         json j;
@@ -146,6 +271,7 @@ private:
     std::string language_;                     // Source language (Solidity/C/C++)
     int64_t creation_timestamp_;
     std::string source_code_;                  // Original source code
+    mutable std::string code_hash_;            // Cached bytecode hash, empty when stale
 
 public:
     SmartContract(const std::string& address, const std::string& creator,
@@ -156,18 +282,19 @@ public:
     std::string get_creator() const { return creator_; }
     std::string get_name() const { return name_; }
     std::string get_language() const { return language_; }
-    std::vector<Instruction>& get_bytecode() { return bytecode_; }
+    std::vector<Instruction>& get_bytecode() { code_hash_.clear(); return bytecode_; }
     const std::vector<Instruction>& get_bytecode() const { return bytecode_; }
     
     // Storage operations
     StackValue get_storage(const std::string& key) const;
     void set_storage(const std::string& key, const StackValue& value);
-    std::map<std::string, StackValue> get_all_storage() const { return storage_; }
+    const std::map<std::string, StackValue>& get_all_storage() const { return storage_; }
     
     // Bytecode management
     void add_instruction(const Instruction& instr);
     void load_bytecode(const std::vector<uint8_t>& code);
     std::vector<uint8_t> serialize_bytecode() const;
+    const std::string& get_code_hash() const;
     
     // Source code management
     void set_source_code(const std::string& code) { source_code_ = code; }
@@ -177,6 +304,68 @@ public:
     static SmartContract from_json(const json& j);
 };
 
+/**
+ * StateOverlay - Journaled write buffer over committed balances and storage
+ *
+ * Reads fall through to the committed maps, which are never modified here.
+ * Writes land in the overlay and are journaled per call frame:
+ * commit_frame() merges a frame into its parent, and revert_frame() undoes it
+ * in O(writes). apply() writes whatever survives back to the committed state,
+ * so no call ever copies the full balance or storage maps. The write buffer
+ * and journal are allocated from `resource`, which must outlive the overlay.
+ */
+class StateOverlay {
+public:
+    StateOverlay(const std::map<std::string, double>& balances,
+                 const std::map<std::string, StackValue>& storage,
+                 std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : base_balances_(&balances), base_storage_(storage),
+          balances_(resource), storage_(resource), journal_(resource), frames_(resource) {}
+    StateOverlay(const AccountStore& accounts,
+                 const std::map<std::string, StackValue>& storage,
+                 std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : base_accounts_(&accounts), base_storage_(storage),
+          balances_(resource), storage_(resource), journal_(resource), frames_(resource) {}
+
+    double get_balance(const std::string& address) const;
+    void set_balance(const std::string& address, double balance);
+
+    StackValue get_storage(const std::string& key) const;
+    void set_storage(const std::string& key, const StackValue& value);
+
+    // Call frames
+    void begin_frame() { frames_.push_back(journal_.size()); }
+    void commit_frame();
+    void revert_frame();
+    size_t depth() const { return frames_.size(); }
+
+    size_t write_count() const { return balances_.size() + storage_.size(); }
+    void clear();
+
+    // Write surviving changes back; `touched` (optional) receives changed accounts
+    void apply(std::map<std::string, double>& balances, SmartContract& contract,
+               std::vector<std::string>* touched = nullptr) const;
+    // Storage writes only; balance writes are dropped with the overlay
+    void apply_storage(SmartContract& contract) const;
+
+private:
+    struct JournalEntry {
+        bool is_storage;
+        std::string key;
+        bool existed;        // Whether the overlay already held a value
+        double balance;
+        StackValue value;
+    };
+
+    const std::map<std::string, double>* base_balances_ = nullptr;  // Exactly one base is set
+    const AccountStore* base_accounts_ = nullptr;
+    const std::map<std::string, StackValue>& base_storage_;
+    std::pmr::unordered_map<std::string, double> balances_;
+    std::pmr::unordered_map<std::string, StackValue> storage_;
+    std::pmr::vector<JournalEntry> journal_;
+    std::pmr::vector<size_t> frames_;  // Journal size at each frame start
+};
+
 // Smart Contract Execution Engine (VM)
 class ContractVM {
 private:
@@ -188,8 +377,20 @@ private:
     bool halted_;
     std::string error_message_;
 
+    std::shared_ptr<const CompiledProgram> program_;  // Decoded form of contract_'s bytecode
+    StateOverlay* state_ = nullptr;                   // Where LOAD/STORE/TRANSFER/BALANCE go
+    std::unique_ptr<StateOverlay> owned_state_;       // Used when the caller supplies none
+
+    // Dispatch slots; DecodedInstruction::handler indexes these
+    enum Handler : uint8_t {
+        H_STOP, H_PUSH, H_POP, H_DUP, H_SWAP, H_ADD, H_SUB, H_MUL, H_DIV, H_MOD,
+        H_LOAD, H_STORE, H_SLOAD, H_SSTORE, H_CALL, H_RETURN, H_TRANSFER, H_BALANCE,
+        H_REVERT, H_ASSERT, H_UNKNOWN, HANDLER_COUNT
+    };
+    friend struct CompiledProgram;
+
     // VM instruction handlers
-    void handle_push(const Instruction& instr);
+    void handle_push(const DecodedInstruction& instr);
     void handle_pop();
     void handle_dup();
     void handle_swap();
@@ -204,27 +405,33 @@ private:
     void handle_sstore();
     void handle_transfer();
     void handle_balance();
-    void handle_call(const Instruction& instr);
+    void handle_call(const DecodedInstruction& instr);
     void handle_return();
+    void handle_assert();
 
     // Helper functions
     void push_stack(const StackValue& value);
     StackValue pop_stack();
     StackValue peek_stack() const;
-    void calculate_gas_cost(OpCode opcode);
+    int64_t pop_integer();
+    void calculate_gas_cost(const DecodedInstruction& instr);
+    void dispatch(const DecodedInstruction& instr);
+    bool run();
 
 public:
     ContractVM();
     
     // Execution
-    bool execute(SmartContract* contract, const ExecutionContext& context);
+    // Runs `program` if given (it must be compiled from the contract's bytecode)
+    bool execute(SmartContract* contract, const ExecutionContext& context,
+                 std::shared_ptr<const CompiledProgram> program = nullptr);
     bool step();  // Execute single instruction
     
     // Status
     bool is_halted() const { return halted_; }
     std::string get_error() const { return error_message_; }
     const std::vector<StackValue>& get_stack() const { return stack_; }
-    ExecutionContext get_context() const { return context_; }
+    const ExecutionContext& get_context() const { return context_; }
     
     // Gas management
     int64_t get_gas_used() const;
@@ -244,12 +451,21 @@ private:
     std::map<std::string, std::shared_ptr<SmartContract>> contracts_;
     std::map<std::string, std::string> address_to_creator_;  // Quick lookup
     std::map<std::string, int64_t> contract_nonces_;  // Nonce for contract creation
+    ProgramCache program_cache_;                      // Compiled bytecode by hash
 
 public:
     // Contract deployment
     std::string deploy_contract(const std::string& creator, const std::string& name,
                                const std::string& language, const std::vector<uint8_t>& bytecode);
     
+    // Rebuild a contract saved by export_contract(); its program is compiled afresh
+    bool restore_contract(const json& contract_json);
+    json export_contract(const std::string& address);
+    
+    // Compiled program for a contract, compiled and cached on a miss
+    std::shared_ptr<const CompiledProgram> get_program(const SmartContract& contract);
+    const ProgramCache& get_program_cache() const { return program_cache_; }
+    
     // Contract access
     SmartContract* get_contract(const std::string& address);
     const SmartContract* get_contract(const std::string& address) const;
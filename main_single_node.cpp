@@ -226,7 +226,7 @@ int main() {
         std::cout << "Caller balance: " << blockchain.get_balance(caller) << std::endl;
         std::cout << "Recipient balance: " << blockchain.get_balance(recipient) << std::endl;
 
-        std::cout << "\nChain length: " << blockchain.get_chain().size() << " blocks" << std::endl;
+        std::cout << "\nChain length: " << blockchain.get_chain_height() << " blocks" << std::endl;
         std::cout << "Contracts deployed: " << mgr.get_contract_count() << std::endl;
 
         // Save blockchain state
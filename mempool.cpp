@@ -0,0 +1,226 @@
+#include "mempool.hpp"
+#include "blockchain.hpp"
+#include "utils/metrics.hpp"
+#include <algorithm>
+#include <queue>
+
+struct Mempool::Entry {
+    Transaction tx;
+    uint64_t sequence;
+};
+
+Mempool::Mempool(size_t max_size) : max_size_(max_size == 0 ? 1 : max_size) {
+}
+
+Mempool::~Mempool() = default;
+
+// ============= ADMISSION =============
+Mempool::AddResult Mempool::add(Transaction tx) {
+    if (by_id_.count(tx.transaction_id)) {
+        return AddResult::DUPLICATE;
+    }
+
+    bool replaced = false;
+    auto lane_it = lanes_.find(tx.from);
+    if (lane_it != lanes_.end()) {
+        auto slot = lane_it->second.find(tx.nonce);
+        if (slot != lane_it->second.end()) {
+            // Replace-by-fee: only a strictly higher gas price displaces a pending nonce
+            const Entry& existing = *by_id_.at(slot->second);
+            if (tx.gas_price <= existing.tx.gas_price) {
+                return AddResult::NONCE_CONFLICT;
+            }
+            erase_entry(slot->second);
+            replaced = true;
+        }
+    }
+
+    if (!replaced && by_id_.size() >= max_size_ && tx.gas_price <= lowest_fee()) {
+        return AddResult::UNDERPRICED;
+    }
+
+    std::string id = tx.transaction_id;
+    auto entry = std::make_unique<Entry>();
+    entry->sequence = next_sequence_++;
+    by_fee_.insert(FeeKey{tx.gas_price, entry->sequence, id});
+    lanes_[tx.from][tx.nonce] = id;
+    entry->tx = std::move(tx);
+    by_id_.emplace(id, std::move(entry));
+
+    while (by_id_.size() > max_size_) {
+        evict_lowest();
+    }
+
+    // Eviction can take the new entry with it if it depended on the cheapest one
+    if (!by_id_.count(id)) {
+        return AddResult::UNDERPRICED;
+    }
+    return replaced ? AddResult::REPLACED : AddResult::ADDED;
+}
+
+const char* Mempool::describe(AddResult result) {
+    switch (result) {
+        case AddResult::ADDED:          return "Added to mempool";
+        case AddResult::REPLACED:       return "Replaced pending transaction";
+        case AddResult::DUPLICATE:      return "Transaction already in mempool";
+        case AddResult::NONCE_CONFLICT: return "Pending transaction with this nonce has an equal or higher gas price";
+        case AddResult::UNDERPRICED:    return "Mempool full: gas price too low";
+    }
+    return "Unknown mempool result";
+}
+
+bool Mempool::remove(const std::string& transaction_id) {
+    if (!by_id_.count(transaction_id)) {
+        return false;
+    }
+    erase_entry(transaction_id);
+    return true;
+}
+
+bool Mempool::contains(const std::string& transaction_id) const {
+    return by_id_.count(transaction_id) > 0;
+}
+
+bool Mempool::get(const std::string& transaction_id, Transaction& tx) const {
+    auto it = by_id_.find(transaction_id);
+    if (it == by_id_.end()) {
+        return false;
+    }
+    tx = it->second->tx;
+    return true;
+}
+
+// ============= NONCE LANES =============
+uint64_t Mempool::next_pending_nonce(const std::string& sender, uint64_t confirmed_next) const {
+    auto lane_it = lanes_.find(sender);
+    if (lane_it == lanes_.end()) {
+        return confirmed_next;
+    }
+
+    uint64_t next = confirmed_next;
+    const auto& lane = lane_it->second;
+    for (auto it = lane.lower_bound(confirmed_next); it != lane.end() && it->first == next; ++it) {
+        ++next;
+    }
+    return next;
+}
+
+bool Mempool::has_pending_nonce(const std::string& sender, uint64_t nonce) const {
+    auto lane_it = lanes_.find(sender);
+    return lane_it != lanes_.end() && lane_it->second.count(nonce) > 0;
+}
+
+// ============= BLOCK SELECTION =============
+std::vector<Transaction> Mempool::take_best(size_t max_count, const NonceLookup& next_nonce) {
+    std::vector<Transaction> selected;
+    if (max_count == 0 || by_id_.empty()) {
+        return selected;
+    }
+
+    struct Head {
+        double gas_price;
+        uint64_t sequence;
+        std::string sender;
+        uint64_t nonce;
+
+        bool operator<(const Head& other) const {
+            if (gas_price != other.gas_price) return gas_price < other.gas_price;
+            return sequence > other.sequence;  // Earlier arrival wins a fee tie
+        }
+    };
+
+    std::priority_queue<Head> heads;
+    std::vector<std::string> stale;
+
+    for (const auto& [sender, lane] : lanes_) {
+        uint64_t confirmed = next_nonce(sender);
+        auto it = lane.begin();
+        // Nonces already used on chain (e.g. by a block from a peer) can never execute
+        for (; it != lane.end() && it->first < confirmed; ++it) {
+            stale.push_back(it->second);
+        }
+        if (it != lane.end() && it->first == confirmed) {
+            const Entry& entry = *by_id_.at(it->second);
+            heads.push(Head{entry.tx.gas_price, entry.sequence, sender, it->first});
+        }
+    }
+
+    for (const auto& id : stale) {
+        erase_entry(id);
+    }
+
+    selected.reserve(std::min(max_count, by_id_.size()));
+
+    while (!heads.empty() && selected.size() < max_count) {
+        Head head = heads.top();
+        heads.pop();
+
+        auto& lane = lanes_.at(head.sender);
+        std::string id = lane.at(head.nonce);
+        selected.push_back(by_id_.at(id)->tx);
+
+        // Look up the successor before erasing, which may drop the lane
+        auto successor = lane.find(head.nonce + 1);
+        bool has_successor = successor != lane.end();
+        std::string successor_id = has_successor ? successor->second : std::string();
+
+        erase_entry(id);
+
+        if (has_successor) {
+            const Entry& entry = *by_id_.at(successor_id);
+            heads.push(Head{entry.tx.gas_price, entry.sequence, head.sender, head.nonce + 1});
+        }
+    }
+
+    return selected;
+}
+
+// ============= EVICTION =============
+double Mempool::lowest_fee() const {
+    return by_fee_.empty() ? 0.0 : by_fee_.begin()->gas_price;
+}
+
+void Mempool::evict_lowest() {
+    if (by_fee_.empty()) {
+        return;
+    }
+
+    const Transaction& victim = by_id_.at(by_fee_.begin()->id)->tx;
+    std::string sender = victim.from;
+    uint64_t nonce = victim.nonce;
+
+    // Later nonces from the same sender can no longer execute; drop them too
+    std::vector<std::string> doomed;
+    const auto& lane = lanes_.at(sender);
+    for (auto it = lane.lower_bound(nonce); it != lane.end(); ++it) {
+        doomed.push_back(it->second);
+    }
+
+    static metrics::Counter& evictions = metrics::counter("mempool_evictions_total",
+                                                          "Transactions evicted from a full mempool");
+    for (const auto& id : doomed) {
+        erase_entry(id);
+        ++evicted_;
+    }
+    evictions.inc(doomed.size());
+}
+
+void Mempool::erase_entry(const std::string& transaction_id) {
+    auto it = by_id_.find(transaction_id);
+    if (it == by_id_.end()) {
+        return;
+    }
+
+    const Entry& entry = *it->second;
+    by_fee_.erase(FeeKey{entry.tx.gas_price, entry.sequence, transaction_id});
+
+    auto lane_it = lanes_.find(entry.tx.from);
+    if (lane_it != lanes_.end()) {
+        lane_it->second.erase(entry.tx.nonce);
+        if (lane_it->second.empty()) {
+            lanes_.erase(lane_it);
+        }
+    }
+
+    by_id_.erase(it);
+}
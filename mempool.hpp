@@ -0,0 +1,90 @@
+#ifndef MEMPOOL_HPP
+#define MEMPOOL_HPP
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Transaction;
+
+/**
+ * Mempool - Pending transactions indexed by id, fee and sender nonce lane
+ *
+ * - by id: O(1) duplicate rejection and removal
+ * - by fee: ordered set, lowest fee first, for O(log n) eviction
+ * - by sender: nonce -> id lanes so blocks only include transactions that
+ *   are executable in nonce order
+ *
+ * Not internally synchronized; Blockchain guards it with mempool_mutex.
+ */
+class Mempool {
+public:
+    enum class AddResult {
+        ADDED,
+        REPLACED,        // Same sender+nonce, higher gas price (replace-by-fee)
+        DUPLICATE,       // Transaction id already pending
+        NONCE_CONFLICT,  // Same sender+nonce without a higher fee
+        UNDERPRICED      // Pool full and fee not above the cheapest entry
+    };
+
+    // Next executable nonce for a sender given confirmed chain state
+    using NonceLookup = std::function<uint64_t(const std::string& sender)>;
+
+    explicit Mempool(size_t max_size = 10000);
+    ~Mempool();
+    Mempool(const Mempool&) = delete;
+    Mempool& operator=(const Mempool&) = delete;
+
+    AddResult add(Transaction tx);
+    static const char* describe(AddResult result);
+    bool remove(const std::string& transaction_id);
+    bool contains(const std::string& transaction_id) const;
+    bool get(const std::string& transaction_id, Transaction& tx) const;
+
+    // Remove and return up to max_count transactions, highest fee first,
+    // never skipping a nonce within a sender's lane
+    std::vector<Transaction> take_best(size_t max_count, const NonceLookup& next_nonce);
+
+    // Nonce a new transaction from `sender` must carry to extend its lane
+    uint64_t next_pending_nonce(const std::string& sender, uint64_t confirmed_next) const;
+    bool has_pending_nonce(const std::string& sender, uint64_t nonce) const;
+
+    size_t size() const { return by_id_.size(); }
+    bool empty() const { return by_id_.empty(); }
+    size_t max_size() const { return max_size_; }
+    uint64_t evicted_count() const { return evicted_; }
+    double lowest_fee() const;
+
+private:
+    struct Entry;
+
+    struct FeeKey {
+        double gas_price;
+        uint64_t sequence;       // Arrival order; newer entries go first among equal fees
+        std::string id;
+
+        bool operator<(const FeeKey& other) const {
+            if (gas_price != other.gas_price) return gas_price < other.gas_price;
+            if (sequence != other.sequence) return sequence > other.sequence;
+            return id < other.id;
+        }
+    };
+
+    size_t max_size_;
+    uint64_t next_sequence_ = 0;
+    uint64_t evicted_ = 0;
+
+    std::unordered_map<std::string, std::unique_ptr<Entry>> by_id_;
+    std::set<FeeKey> by_fee_;
+    std::unordered_map<std::string, std::map<uint64_t, std::string>> lanes_;  // sender -> nonce -> id
+
+    void erase_entry(const std::string& transaction_id);
+    void evict_lowest();
+};
+
+#endif // MEMPOOL_HPP
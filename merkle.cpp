@@ -0,0 +1,141 @@
+#include "merkle.hpp"
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <openssl/sha.h>
+
+MerkleTree::MerkleTree(std::vector<Hash> leaves) {
+    if (leaves.empty()) {
+        return;
+    }
+
+    levels_.push_back(std::move(leaves));
+    while (levels_.back().size() > 1) {
+        const std::vector<Hash>& below = levels_.back();
+        std::vector<Hash> level;
+        level.reserve((below.size() + 1) / 2);
+        for (size_t i = 0; i < below.size(); i += 2) {
+            level.push_back(hash_pair(below[i], i + 1 < below.size() ? below[i + 1] : below[i]));
+        }
+        levels_.push_back(std::move(level));
+    }
+}
+
+MerkleTree::Hash MerkleTree::root() const {
+    return levels_.empty() ? hash_bytes("") : levels_.back()[0];
+}
+
+std::string MerkleTree::root_hex() const {
+    return to_hex(root());
+}
+
+MerkleTree::Hash MerkleTree::root_in_place(Hash* nodes, size_t count) {
+    if (count == 0) {
+        return hash_bytes("");
+    }
+    // Each level is written over the front of the one below it
+    while (count > 1) {
+        size_t next = 0;
+        for (size_t i = 0; i < count; i += 2) {
+            nodes[next++] = hash_pair(nodes[i], i + 1 < count ? nodes[i + 1] : nodes[i]);
+        }
+        count = next;
+    }
+    return nodes[0];
+}
+
+// ============= PROOFS =============
+bool MerkleTree::prove(size_t index, MerkleProof& proof) const {
+    if (index >= leaf_count()) {
+        return false;
+    }
+
+    proof = MerkleProof();
+    proof.index = index;
+    proof.leaf_count = leaf_count();
+    proof.leaf = levels_[0][index];
+
+    size_t position = index;
+    for (size_t level = 0; level + 1 < levels_.size(); ++level) {
+        const auto& nodes = levels_[level];
+        size_t sibling = position ^ 1;
+        proof.siblings.push_back(sibling < nodes.size() ? nodes[sibling] : nodes[position]);
+        position >>= 1;
+    }
+    return true;
+}
+
+bool MerkleTree::verify(const MerkleProof& proof, const std::string& root_hex) {
+    Hash expected;
+    if (!from_hex(root_hex, expected) || proof.index >= proof.leaf_count) {
+        return false;
+    }
+
+    // Tree height is fixed by the leaf count, so a proof cannot be padded or truncated
+    size_t height = 0;
+    for (size_t width = proof.leaf_count; width > 1; width = (width + 1) / 2) {
+        ++height;
+    }
+    if (proof.siblings.size() != height) {
+        return false;
+    }
+
+    Hash current = proof.leaf;
+    size_t position = proof.index;
+    for (const auto& sibling : proof.siblings) {
+        current = (position & 1) ? hash_pair(sibling, current) : hash_pair(current, sibling);
+        position >>= 1;
+    }
+    return current == expected;
+}
+
+// ============= HASHING =============
+MerkleTree::Hash MerkleTree::hash_pair(const Hash& left, const Hash& right) {
+    uint8_t data[64];
+    std::memcpy(data, left.data(), 32);
+    std::memcpy(data + 32, right.data(), 32);
+    Hash out;
+    SHA256(data, sizeof(data), out.data());
+    return out;
+}
+
+MerkleTree::Hash MerkleTree::hash_bytes(const std::string& data) {
+    Hash out;
+    SHA256(reinterpret_cast<const uint8_t*>(data.data()), data.size(), out.data());
+    return out;
+}
+
+std::string MerkleTree::to_hex(const Hash& hash) {
+    std::stringstream ss;
+    for (uint8_t byte : hash) {
+        ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte);
+    }
+    return ss.str();
+}
+
+bool MerkleTree::from_hex(const std::string& hex, Hash& out) {
+    if (hex.size() != out.size() * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < out.size(); ++i) {
+        unsigned value = 0;
+        std::istringstream ss(hex.substr(i * 2, 2));
+        if (!(ss >> std::hex >> value)) {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>(value);
+    }
+    return true;
+}
+
+json MerkleProof::to_json() const {
+    json j;
+    j["index"] = index;
+    j["leaf_count"] = leaf_count;
+    j["leaf"] = MerkleTree::to_hex(leaf);
+    j["siblings"] = json::array();
+    for (const auto& sibling : siblings) {
+        j["siblings"].push_back(MerkleTree::to_hex(sibling));
+    }
+    return j;
+}
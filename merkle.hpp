@@ -0,0 +1,54 @@
+#ifndef MERKLE_HPP
+#define MERKLE_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Inclusion proof for one leaf: sibling digests from the leaf level up
+struct MerkleProof {
+    size_t index = 0;                              // Leaf position in the block
+    size_t leaf_count = 0;
+    std::array<uint8_t, 32> leaf{};
+    std::vector<std::array<uint8_t, 32>> siblings;
+
+    json to_json() const;
+};
+
+/**
+ * MerkleTree - Binary SHA-256 Merkle tree over 32-byte leaf digests
+ *
+ * Interior nodes are sha256(left || right) over raw digests; an odd node
+ * at the end of a level is paired with itself. All levels are kept so
+ * proofs are a lookup rather than a rebuild.
+ */
+class MerkleTree {
+public:
+    using Hash = std::array<uint8_t, 32>;
+
+    explicit MerkleTree(std::vector<Hash> leaves);
+
+    Hash root() const;
+    std::string root_hex() const;
+    size_t leaf_count() const { return levels_.empty() ? 0 : levels_[0].size(); }
+
+    bool prove(size_t index, MerkleProof& proof) const;
+    static bool verify(const MerkleProof& proof, const std::string& root_hex);
+
+    // Root of `count` leaves without keeping the levels; overwrites the leaves
+    static Hash root_in_place(Hash* nodes, size_t count);
+
+    static Hash hash_pair(const Hash& left, const Hash& right);
+    static Hash hash_bytes(const std::string& data);
+    static std::string to_hex(const Hash& hash);
+    static bool from_hex(const std::string& hex, Hash& out);
+
+private:
+    std::vector<std::vector<Hash>> levels_;  // levels_[0] = leaves, back() = root
+};
+
+#endif // MERKLE_HPP
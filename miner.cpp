@@ -0,0 +1,83 @@
+#include "miner.hpp"
+#include <chrono>
+#include <climits>
+#include <thread>
+#include <vector>
+
+ParallelMiner::ParallelMiner(unsigned threads, long long chunk_size)
+    : threads_(threads == 0 ? default_threads() : threads),
+      chunk_size_(chunk_size > 0 ? chunk_size : DEFAULT_CHUNK_SIZE) {
+}
+
+unsigned ParallelMiner::default_threads() {
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : hw;
+}
+
+void ParallelMiner::set_threads(unsigned threads) {
+    threads_ = threads == 0 ? default_threads() : threads;
+}
+
+ParallelMiner::Result ParallelMiner::search(const RangeKernel& kernel, long long start_nonce) {
+    Result result;
+    result.threads = threads_;
+
+    running_.store(true, std::memory_order_relaxed);
+
+    std::atomic<long long> next_nonce{start_nonce};
+    std::atomic<bool> found{false};
+    std::atomic<long long> found_nonce{LLONG_MAX};
+    std::atomic<uint64_t> hashes{0};
+
+    auto worker = [&]() {
+        uint64_t local_hashes = 0;
+        while (!found.load(std::memory_order_relaxed) &&
+               !cancel_requested_.load(std::memory_order_relaxed)) {
+            long long begin = next_nonce.fetch_add(chunk_size_, std::memory_order_relaxed);
+            if (begin > LLONG_MAX - chunk_size_) {
+                break;  // Nonce space exhausted
+            }
+            long long end = begin + chunk_size_;
+
+            long long nonce = 0;
+            if (kernel(begin, end, nonce)) {
+                local_hashes += static_cast<uint64_t>(nonce - begin + 1);
+                // Keep the lowest proof if two workers succeed in the same window
+                long long current = found_nonce.load(std::memory_order_relaxed);
+                while (nonce < current &&
+                       !found_nonce.compare_exchange_weak(current, nonce, std::memory_order_relaxed)) {
+                }
+                found.store(true, std::memory_order_relaxed);
+                break;
+            }
+            local_hashes += static_cast<uint64_t>(chunk_size_);
+        }
+        hashes.fetch_add(local_hashes, std::memory_order_relaxed);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (threads_ <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> workers;
+        workers.reserve(threads_);
+        for (unsigned i = 0; i < threads_; ++i) {
+            workers.emplace_back(worker);
+        }
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    result.found = found.load();
+    result.nonce = result.found ? found_nonce.load() : 0;
+    result.cancelled = !result.found && cancel_requested_.load();
+    result.hashes = hashes.load();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+
+    running_.store(false, std::memory_order_relaxed);
+    return result;
+}
@@ -0,0 +1,61 @@
+#ifndef MINER_HPP
+#define MINER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+/**
+ * ParallelMiner - Splits the proof-of-work nonce space across worker threads
+ *
+ * Workers claim fixed-size nonce ranges from a shared counter and hand each
+ * range to a caller-supplied search kernel. The first worker to find a proof
+ * stops the others; cancel() aborts the search from any thread (e.g. when a
+ * competing block arrives from the network).
+ */
+class ParallelMiner {
+public:
+    // Search [begin, end) and return true with found_nonce set on success.
+    // Must be safe to call concurrently from several workers.
+    using RangeKernel = std::function<bool(long long begin, long long end, long long& found_nonce)>;
+
+    struct Result {
+        bool found = false;
+        bool cancelled = false;
+        long long nonce = 0;
+        uint64_t hashes = 0;       // Nonces tried across all workers
+        double seconds = 0.0;
+        unsigned threads = 0;
+
+        double hashes_per_second() const {
+            return seconds > 0.0 ? static_cast<double>(hashes) / seconds : 0.0;
+        }
+    };
+
+    static constexpr long long DEFAULT_CHUNK_SIZE = 16384;  // Nonces per claimed range
+
+    explicit ParallelMiner(unsigned threads = 0, long long chunk_size = DEFAULT_CHUNK_SIZE);
+
+    Result search(const RangeKernel& kernel, long long start_nonce = 0);
+
+    // Clear a previous cancellation; call before announcing a new search so
+    // that a cancel arriving before search() starts is not lost
+    void arm() { cancel_requested_.store(false, std::memory_order_relaxed); }
+
+    // Abort the search in progress (or the next one, if armed); safe from any thread
+    void cancel() { cancel_requested_.store(true, std::memory_order_relaxed); }
+    bool is_running() const { return running_.load(std::memory_order_relaxed); }
+
+    void set_threads(unsigned threads);
+    unsigned get_threads() const { return threads_; }
+
+    static unsigned default_threads();
+
+private:
+    unsigned threads_;
+    long long chunk_size_;
+    std::atomic<bool> cancel_requested_{false};
+    std::atomic<bool> running_{false};
+};
+
+#endif // MINER_HPP
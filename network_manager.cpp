@@ -3,6 +3,7 @@
 #include <iostream>
 #include <algorithm>
 #include <chrono>
+#include <deque>
 
 NetworkManager::NetworkManager() {
     LOG_INFO("NetworkManager", "Initializing network manager");
@@ -19,6 +20,9 @@ BlockchainNode* NetworkManager::create_node(const std::string& node_id, uint16_t
     auto node = std::make_unique<BlockchainNode>(node_id, port, difficulty);
     BlockchainNode* node_ptr = node.get();
     nodes_[node_id] = std::move(node);
+    node_ptr->get_blockchain().set_tip_listener([this, node_id](const ChainSnapshot&) {
+        notify_tip_change(node_id);
+    });
     
     LOG_INFO("NetworkManager", "Created node: " + node_id + " on port " + std::to_string(port));
     return node_ptr;
@@ -82,7 +86,11 @@ void NetworkManager::start_all_nodes() {
 }
 
 void NetworkManager::stop_all_nodes() {
-    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        running_ = false;
+    }
+    events_cv_.notify_all();
     
     if (consensus_thread_.joinable()) {
         consensus_thread_.join();
@@ -101,62 +109,136 @@ void NetworkManager::stop_all_nodes() {
     }
 }
 
+void NetworkManager::notify_tip_change(const std::string& node_id) {
+    // Runs under the node's chain lock: record and wake, nothing more
+    {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        changed_nodes_.insert(node_id);
+    }
+    events_cv_.notify_one();
+}
+
+void NetworkManager::set_sync_debounce(std::chrono::milliseconds window) {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    sync_debounce_ = window;
+}
+
+size_t NetworkManager::get_sync_rounds() const {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    return sync_rounds_;
+}
+
 void NetworkManager::run_consensus_monitor() {
     LOG_INFO("NetworkManager", "Consensus monitor started");
     
+    std::unique_lock<std::mutex> lock(events_mutex_);
     while (running_) {
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+        events_cv_.wait(lock, [this] { return !running_ || !changed_nodes_.empty(); });
+        if (!running_) {
+            break;
+        }
+        // Let the rest of a burst (a mined block relayed, a sync applying blocks) land first
+        auto deadline = std::chrono::steady_clock::now() + sync_debounce_;
+        events_cv_.wait_until(lock, deadline, [this] { return !running_; });
+        if (!running_) {
+            break;
+        }
         
+        std::set<std::string> changed;
+        changed.swap(changed_nodes_);
+        lock.unlock();
         try {
-            sync_chains();
-            sync_states();  // Phase 4.2: Synchronize account states
+            sync_chains(changed);
+            sync_states(changed);  // Phase 4.2: Synchronize account states
         } catch (const std::exception& e) {
             LOG_ERROR("NetworkManager", "Error in consensus monitor: " + std::string(e.what()));
         }
+        lock.lock();
+        ++sync_rounds_;
+        rounds_cv_.notify_all();
     }
     
     LOG_INFO("NetworkManager", "Consensus monitor stopped");
 }
 
-void NetworkManager::sync_chains() {
+void NetworkManager::sync_chains(const std::set<std::string>& changed) {
     auto all_nodes = get_all_nodes();
-    if (all_nodes.empty()) return;
-    
-    // Get the chain with the most blocks (longest chain)
-    BlockchainNode* best_node = all_nodes[0];
-    int max_height = best_node->get_blockchain().get_chain().size();
+    if (all_nodes.size() < 2 || changed.empty()) return;
     
+    // Only nodes behind a changed tip have anything to fetch
+    size_t changed_height = 0;
+    std::map<BlockchainNode*, size_t> heights;
     for (auto node : all_nodes) {
-        int height = node->get_blockchain().get_chain().size();
-        if (height > max_height) {
-            max_height = height;
-            best_node = node;
+        size_t height = node->get_blockchain().get_chain_height();
+        heights[node] = height;
+        if (changed.count(node->get_node_id())) {
+            changed_height = std::max(changed_height, height);
         }
     }
-    
-    // Sync other nodes to the best chain
-    const auto& best_chain = best_node->get_blockchain().get_chain();
-    
+    std::vector<BlockchainNode*> lagging;
     for (auto node : all_nodes) {
-        if (node == best_node) continue;
-        
-        const auto& node_chain = node->get_blockchain().get_chain();
-        if (node_chain.size() < best_chain.size()) {
-            // Node is behind - request sync
-            LOG_DEBUG("NetworkManager", "Syncing " + node->get_node_id() + " with " + best_node->get_node_id());
-            node->request_chain_sync(best_node->get_node_id());
-            
-            // Apply the sync
-            std::vector<Block> blocks_to_add(
-                best_chain.begin() + node_chain.size(),
-                best_chain.end()
-            );
-            
-            if (!blocks_to_add.empty()) {
-                node->handle_chain_sync(blocks_to_add);
-            }
+        if (heights[node] < changed_height) {
+            lagging.push_back(node);
+        }
+    }
+    if (lagging.empty()) return;
+    
+    // In-process transport for the headers-first protocol. Messages are queued
+    // and delivered in order, so a reply never re-enters the sender's sync state.
+    struct Envelope {
+        BlockchainNode* to;
+        BlockchainNode* from;
+        NetworkMessage message;
+    };
+    std::deque<Envelope> queue;
+    
+    auto make_message = [](BlockchainNode* from, MessageType type, const std::string& body) {
+        NetworkMessage msg;
+        msg.type = type;
+        msg.sender_id = from->get_node_id();
+        msg.encoding = wire::Encoding::BINARY;
+        msg.payload = body;
+        return msg;
+    };
+    
+    // Each lagging node may download from every node taller than itself
+    std::vector<std::pair<BlockchainNode*, BlockchainNode*>> links;
+    for (auto node : lagging) {
+        for (auto peer : all_nodes) {
+            if (peer == node || heights[peer] <= heights[node]) continue;
+            node->add_sync_peer(peer->get_node_id(), heights[peer],
+                [&queue, &make_message, node, peer](MessageType type, const std::string& body) {
+                    queue.push_back({peer, node, make_message(node, type, body)});
+                });
+            links.emplace_back(node, peer);
         }
     }
+    
+    // Lagging nodes ask the tallest peer for headers, then spread range requests over all taller peers
+    for (auto node : lagging) {
+        node->request_chain_sync("network");
+    }
+    
+    size_t delivered = 0;
+    while (!queue.empty()) {
+        Envelope envelope = std::move(queue.front());
+        queue.pop_front();
+        BlockchainNode* to = envelope.to;
+        BlockchainNode* from = envelope.from;
+        to->deliver_message(from->get_node_id(), envelope.message, [&queue, to, from](const NetworkMessage& reply) {
+            queue.push_back({from, to, reply});
+        });
+        ++delivered;
+    }
+    
+    // The send functions reference this call's queue
+    for (const auto& [node, peer] : links) {
+        node->remove_sync_peer(peer->get_node_id());
+    }
+    
+    if (delivered > 0) {
+        LOG_DEBUG("NetworkManager", "Chain sync round delivered " + std::to_string(delivered) + " messages");
+    }
 }
 
 bool NetworkManager::is_network_synced(int max_height_diff) const {
@@ -167,7 +249,7 @@ bool NetworkManager::is_network_synced(int max_height_diff) const {
     int max_height = 0;
     
     for (auto node : all_nodes) {
-        int height = node->get_blockchain().get_chain().size();
+        int height = node->get_blockchain().get_chain_height();
         min_height = std::min(min_height, height);
         max_height = std::max(max_height, height);
     }
@@ -179,24 +261,14 @@ bool NetworkManager::is_network_synced(int max_height_diff) const {
 void NetworkManager::wait_for_sync(int timeout_seconds) {
     LOG_INFO("NetworkManager", "Waiting for network to sync (timeout: " + std::to_string(timeout_seconds) + "s)");
     
-    auto start = std::chrono::steady_clock::now();
-    
-    while (true) {
-        if (is_network_synced()) {
-            LOG_INFO("NetworkManager", "Network is synced!");
-            return;
-        }
-        
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start).count();
-        
-        if (elapsed > timeout_seconds) {
-            LOG_WARN("NetworkManager", "Sync timeout after " + std::to_string(timeout_seconds) + "s");
-            return;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // Re-checked after every sync round rather than on a timer
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_seconds);
+    std::unique_lock<std::mutex> lock(events_mutex_);
+    if (rounds_cv_.wait_until(lock, deadline, [this] { return is_network_synced(); })) {
+        LOG_INFO("NetworkManager", "Network is synced!");
+        return;
     }
+    LOG_WARN("NetworkManager", "Sync timeout after " + std::to_string(timeout_seconds) + "s");
 }
 
 int NetworkManager::get_network_height() const {
@@ -204,7 +276,7 @@ int NetworkManager::get_network_height() const {
     int max_height = 0;
     
     for (auto node : all_nodes) {
-        int height = node->get_blockchain().get_chain().size();
+        int height = node->get_blockchain().get_chain_height();
         max_height = std::max(max_height, height);
     }
     
@@ -216,7 +288,7 @@ std::map<std::string, int> NetworkManager::get_chain_heights() const {
     auto all_nodes = get_all_nodes();
     
     for (auto node : all_nodes) {
-        int height = node->get_blockchain().get_chain().size();
+        int height = node->get_blockchain().get_chain_height();
         heights[node->get_node_id()] = height;
     }
     
@@ -229,7 +301,7 @@ std::map<std::string, bool> NetworkManager::get_sync_status() const {
     int network_height = get_network_height();
     
     for (auto node : all_nodes) {
-        int height = node->get_blockchain().get_chain().size();
+        int height = node->get_blockchain().get_chain_height();
         bool is_synced = (height == network_height);
         status[node->get_node_id()] = is_synced;
     }
@@ -255,40 +327,42 @@ std::vector<Block> NetworkManager::resolve_fork(const std::vector<std::vector<Bl
 
 // ============= STATE SYNCHRONIZATION (Phase 4.2) =============
 
-void NetworkManager::sync_states() {
+void NetworkManager::sync_states(const std::set<std::string>& changed) {
     auto all_nodes = get_all_nodes();
     if (all_nodes.size() < 2) return;
     
-    // Each node requests state from peers and verifies convergence
+    // Nodes on the same tip must agree on state: check each changed node against one of them
+    std::map<std::string, BlockchainNode*> by_tip;
     for (auto node : all_nodes) {
-        for (auto peer_node : all_nodes) {
-            if (node == peer_node) continue;
-            
-            // Node requests state from peer
-            node->request_state_sync(peer_node->get_node_id());
-            
-            // Immediately handle the response (simulated in-memory)
-            json peer_state = json::object();
-            auto peer_state_data = peer_node->get_blockchain().get_account_state();
-            std::string peer_state_root = peer_node->get_state_root();
-            
-            peer_state["state_root"] = peer_state_root;
-            peer_state["block_height"] = peer_node->get_blockchain().get_chain().size();
-            peer_state["node_id"] = peer_node->get_node_id();
-            
-            json accounts = json::object();
-            for (const auto& [addr, data] : peer_state_data) {
-                const auto& [balance, nonce] = data;
-                accounts[addr] = {
-                    {"balance", balance},
-                    {"nonce", nonce}
-                };
-            }
-            peer_state["accounts"] = accounts;
-            
-            // Node verifies the response
-            node->handle_state_sync_response(peer_state, peer_node->get_node_id());
+        if (!changed.count(node->get_node_id())) {
+            by_tip.emplace(node->get_blockchain().get_snapshot()->tip_hash, node);
+        }
+    }
+    for (auto node : all_nodes) {
+        if (!changed.count(node->get_node_id())) continue;
+        
+        std::string tip_hash = node->get_blockchain().get_snapshot()->tip_hash;
+        auto reference = by_tip.find(tip_hash);
+        if (reference == by_tip.end()) {
+            by_tip.emplace(tip_hash, node);  // First changed node on this tip
+            continue;
         }
+        BlockchainNode* peer_node = reference->second;
+        
+        // Node requests state from peer
+        node->request_state_sync(peer_node->get_node_id());
+        
+        // Immediately handle the response (simulated in-memory)
+        json peer_state = json::object();
+        std::shared_ptr<const ChainSnapshot> snapshot = peer_node->get_blockchain().get_snapshot();
+        
+        peer_state["state_root"] = snapshot->state_root;
+        peer_state["block_height"] = snapshot->height;
+        peer_state["account_count"] = snapshot->account_count;
+        peer_state["node_id"] = peer_node->get_node_id();
+        
+        // Node verifies the response
+        node->handle_state_sync_response(peer_state, peer_node->get_node_id());
     }
 }
 
@@ -7,10 +7,19 @@
 #include <vector>
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <set>
 
 /**
  * NetworkManager - Coordinates multiple blockchain nodes
  * Handles peer discovery, synchronization, and consensus
+ *
+ * Every node's chain reports tip changes to the manager. The consensus
+ * thread sleeps until one arrives, waits out the debounce window so a burst
+ * of blocks becomes a single round, then syncs only the nodes behind the
+ * ones that changed and compares state roots among nodes on the same tip.
  */
 class NetworkManager {
 public:
@@ -35,6 +44,10 @@ public:
     bool is_network_synced(int max_height_diff = 0) const;
     void wait_for_sync(int timeout_seconds = 30);
     
+    // Events arriving within this window of the first are synced together
+    void set_sync_debounce(std::chrono::milliseconds window);
+    size_t get_sync_rounds() const;
+    
     // State synchronization (Phase 4.2)
     bool is_state_synced() const;
     std::map<std::string, std::string> get_state_roots() const;
@@ -45,16 +58,26 @@ public:
     std::map<std::string, bool> get_sync_status() const;
     
 private:
+    // Tip-change events; declared before nodes_ so they outlive the nodes' listeners
+    static constexpr std::chrono::milliseconds DEFAULT_SYNC_DEBOUNCE{50};
+    mutable std::mutex events_mutex_;
+    std::condition_variable events_cv_;       // Tip changed, or shutting down
+    std::condition_variable rounds_cv_;       // A sync round finished
+    std::set<std::string> changed_nodes_;     // Tips moved since the last round
+    std::chrono::milliseconds sync_debounce_{DEFAULT_SYNC_DEBOUNCE};
+    size_t sync_rounds_ = 0;
+    
     std::map<std::string, std::unique_ptr<BlockchainNode>> nodes_;
     mutable std::mutex nodes_mutex_;
     
     std::thread consensus_thread_;
-    bool running_ = false;
+    std::atomic<bool> running_{false};
     
     // Consensus helper
+    void notify_tip_change(const std::string& node_id);
     void run_consensus_monitor();
-    void sync_chains();
-    void sync_states();  // Phase 4.2: Synchronize account states
+    void sync_chains(const std::set<std::string>& changed);
+    void sync_states(const std::set<std::string>& changed);  // Phase 4.2: Synchronize account states
     std::vector<Block> resolve_fork(const std::vector<std::vector<Block>>& competing_chains);
 };
 
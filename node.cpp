@@ -1,5 +1,6 @@
 #include "node.hpp"
 #include "utils/logger.hpp"
+#include "utils/metrics.hpp"
 #include <iostream>
 #include <algorithm>
 
@@ -7,46 +8,148 @@
 
 void PeerConnection::start() {
     LOG_DEBUG("PeerConnection", "Starting to listen for messages");
-    boost::asio::async_read(
-        socket_,
+    pointer self = shared_from_this();
+    socket_.async_read_some(
         boost::asio::buffer(data_, max_length),
-        [this](const boost::system::error_code& error, size_t bytes_transferred) {
-            this->handle_read(error, bytes_transferred);
+        [self](const boost::system::error_code& error, size_t bytes_transferred) {
+            self->handle_read(error, bytes_transferred);
         });
 }
 
 void PeerConnection::handle_read(const boost::system::error_code& error, size_t bytes_transferred) {
-    if (!error) {
-        std::string received_data(data_, bytes_transferred);
-        LOG_DEBUG("PeerConnection", "Received " + std::to_string(bytes_transferred) + " bytes");
-        // Message will be processed by the node
-        start();
-    } else {
+    if (error) {
         LOG_WARN("PeerConnection", "Read error: " + error.message());
+        close();
+        return;
     }
+
+    static metrics::Counter& bytes_in = metrics::counter("p2p_bytes_total", "Peer-to-peer bytes", {{"direction", "in"}});
+    bytes_in.inc(bytes_transferred);
+    LOG_DEBUG("PeerConnection", "Received " + std::to_string(bytes_transferred) + " bytes");
+    parser_.feed(data_, bytes_transferred);
+
+    wire::Frame frame;
+    wire::FrameParser::Status status;
+    while ((status = parser_.next(frame)) == wire::FrameParser::Status::FRAME) {
+        if (frame_handler_) {
+            frame_handler_(shared_from_this(), frame);
+        }
+    }
+
+    if (status == wire::FrameParser::Status::ERROR) {
+        // The stream cannot be resynchronised after a bad frame
+        LOG_WARN("PeerConnection", "Dropping peer " + peer_id_ + ": " + parser_.error());
+        close();
+        return;
+    }
+    start();
 }
 
-void PeerConnection::send_message(const NetworkMessage& msg) {
-    std::string serialized = msg.to_json().dump() + "\n";
-    LOG_DEBUG("PeerConnection", "Sending message of type: " + std::to_string(static_cast<int>(msg.type)));
+bool PeerConnection::send_message(const NetworkMessage& msg) {
+    if (closed_) {
+        return false;
+    }
+    auto frame = std::make_shared<std::string>();
+    if (msg.encoding == encoding_) {
+        *frame = wire::encode_frame(msg.type, msg.encoding, msg.sender_id, msg.payload);
+    } else {
+        std::string body;
+        if (!wire::transcode_body(msg.type, msg.encoding, encoding_, msg.payload, body)) {
+            LOG_ERROR("PeerConnection", "Cannot re-encode message of type: " +
+                      std::to_string(static_cast<int>(msg.type)));
+            return false;
+        }
+        *frame = wire::encode_frame(msg.type, encoding_, msg.sender_id, body);
+    }
+
+    // Reserve queue space up front so concurrent senders cannot overshoot the bound
+    size_t queued = queued_bytes_.fetch_add(frame->size());
+    if (queued + frame->size() > MAX_QUEUED_BYTES && queued > 0) {
+        queued_bytes_ -= frame->size();
+        LOG_WARN("PeerConnection", "Write queue to " + peer_id_ + " is full; dropping message of type " +
+                 std::to_string(static_cast<int>(msg.type)));
+        return false;
+    }
+
+    LOG_DEBUG("PeerConnection", "Sending message of type: " + std::to_string(static_cast<int>(msg.type)) +
+              " (" + std::to_string(frame->size()) + " bytes)");
+    pointer self = shared_from_this();
+    strand_.post([self, frame]() {
+        self->write_queue_.push_back(frame);
+        if (!self->writing_) {
+            self->write_next();
+        }
+    });
+    return true;
+}
+
+void PeerConnection::write_next() {
+    if (closed_) {
+        for (const auto& frame : write_queue_) {
+            queued_bytes_ -= frame->size();
+        }
+        write_queue_.clear();
+        writing_ = false;
+        return;
+    }
+    writing_ = true;
+    pointer self = shared_from_this();
+    // The queue owns the frame until its write completes
+    const std::shared_ptr<const std::string>& frame = write_queue_.front();
     boost::asio::async_write(
         socket_,
-        boost::asio::buffer(serialized),
-        [this](const boost::system::error_code& error, size_t bytes_transferred) {
-            this->handle_write(error);
-        });
+        boost::asio::buffer(*frame),
+        strand_.wrap([self, size = frame->size()](const boost::system::error_code& error, size_t) {
+            self->handle_write(error, size);
+        }));
 }
 
-void PeerConnection::handle_write(const boost::system::error_code& error) {
+void PeerConnection::handle_write(const boost::system::error_code& error, size_t frame_size) {
+    static metrics::Counter& bytes_out = metrics::counter("p2p_bytes_total", "Peer-to-peer bytes", {{"direction", "out"}});
+    write_queue_.pop_front();
+    queued_bytes_ -= frame_size;
     if (error) {
         LOG_ERROR("PeerConnection", "Write error: " + error.message());
+        close();
+    } else {
+        bytes_out.inc(frame_size);
+    }
+    if (write_queue_.empty()) {
+        writing_ = false;
+    } else {
+        write_next();
     }
 }
 
+void PeerConnection::close() {
+    if (closed_.exchange(true)) {
+        return;
+    }
+    // On the strand so the socket is never closed under an in-flight write
+    pointer self = shared_from_this();
+    strand_.dispatch([self]() {
+        boost::system::error_code ignored;
+        self->socket_.close(ignored);
+        if (self->close_handler_) {
+            self->close_handler_(self);
+        }
+    });
+}
+
 // ============= BlockchainNode =============
 
 BlockchainNode::BlockchainNode(const std::string& node_id, uint16_t port, int difficulty)
-    : node_id_(node_id), port_(port), blockchain_() {
+    : node_id_(node_id), port_(port), blockchain_(),
+      sync_(blockchain_, [this](const Block& block) { return receive_block(block); }),
+      state_sync_(blockchain_,
+          [this](int index, BlockHeader& header) { return sync_.find_header(index, header); },
+          [this](const SnapshotManifest& manifest, const std::vector<StateTree::Account>& accounts) {
+              std::vector<BlockHeader> headers = sync_.headers_through(static_cast<int>(manifest.height));
+              return !headers.empty() && headers.back().index == static_cast<int>(manifest.height) &&
+                     blockchain_.install_state_snapshot(headers, accounts, manifest.state_root);
+          },
+          [this](bool) { sync_.hold_bodies(false); }),
+      relay_timer_(io_service_) {
     
     LOG_INFO("BlockchainNode", "Initializing node: " + node_id + " on port " + std::to_string(port));
     // Set initial difficulty in blockchain
@@ -85,6 +188,17 @@ void BlockchainNode::stop() {
     if (network_thread_.joinable()) {
         network_thread_.join();
     }
+    // Handlers no longer run; the sockets close as the connections are released
+    std::map<std::string, PeerConnection::pointer> connections;
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        connections.swap(connections_);
+    }
+    for (auto& [_, connection] : connections) {
+        connection->set_close_handler(nullptr);
+        boost::system::error_code ignored;
+        connection->socket().close(ignored);
+    }
 }
 
 void BlockchainNode::accept_connection() {
@@ -95,6 +209,10 @@ void BlockchainNode::accept_connection() {
         new_connection->socket(),
         [this, new_connection](const boost::system::error_code& error) {
             if (!error) {
+                new_connection->set_frame_handler(
+                    [this](const PeerConnection::pointer& peer, const wire::Frame& frame) {
+                        this->handle_frame(peer, frame);
+                    });
                 new_connection->start();
             }
             this->accept_connection();
@@ -102,22 +220,34 @@ void BlockchainNode::accept_connection() {
 }
 
 void BlockchainNode::connect_to_peer(const std::string& host, uint16_t port) {
+    std::string peer_id = host + ":" + std::to_string(port);
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        auto existing = connections_.find(peer_id);
+        if (existing != connections_.end() && existing->second->is_open()) {
+            LOG_DEBUG("BlockchainNode", "Already connected to " + peer_id);
+            return;
+        }
+    }
     try {
-        tcp::socket socket(io_service_);
+        PeerConnection::pointer connection = PeerConnection::create(io_service_);
         tcp::resolver resolver(io_service_);
         tcp::resolver::query query(host, std::to_string(port));
         tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
         
-        boost::asio::connect(socket, endpoint_iterator);
+        boost::asio::connect(connection->socket(), endpoint_iterator);
         
-        std::string peer_id = host + ":" + std::to_string(port);
         add_peer(peer_id, peer_id);
         
-        // Send handshake
-        NetworkMessage handshake;
-        handshake.type = MessageType::HANDSHAKE;
-        handshake.sender_id = node_id_;
-        handshake.payload = node_id_;
+        // Send handshake; the peer's reply settles the body encoding
+        connection->set_peer_id(peer_id);
+        connection->set_frame_handler(
+            [this](const PeerConnection::pointer& peer, const wire::Frame& frame) {
+                this->handle_frame(peer, frame);
+            });
+        register_connection(connection);
+        connection->send_message(make_handshake());
+        connection->start();
         
         std::cout << "[" << node_id_ << "] Connected to peer: " << peer_id << std::endl;
         
@@ -133,11 +263,78 @@ void BlockchainNode::add_peer(const std::string& peer_id, const std::string& add
 }
 
 void BlockchainNode::remove_peer(const std::string& peer_id) {
-    std::lock_guard<std::mutex> lock(peers_mutex_);
-    peer_map_.erase(peer_id);
+    PeerConnection::pointer connection;
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        peer_map_.erase(peer_id);
+        auto it = connections_.find(peer_id);
+        if (it != connections_.end()) {
+            connection = it->second;
+            connections_.erase(it);
+        }
+    }
+    if (connection) {
+        connection->close();  // Already unregistered, so its close handler is a no-op
+    }
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex_);
+        relay_peers_.erase(peer_id);
+    }
+    sync_.remove_peer(peer_id);
+    state_sync_.remove_peer(peer_id);
     std::cout << "[" << node_id_ << "] Removed peer: " << peer_id << std::endl;
 }
 
+size_t BlockchainNode::get_connection_count() const {
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    return connections_.size();
+}
+
+void BlockchainNode::register_connection(const PeerConnection::pointer& connection) {
+    connection->set_close_handler([this](const PeerConnection::pointer& closed) {
+        handle_connection_closed(closed);
+    });
+    PeerConnection::pointer replaced;
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        PeerConnection::pointer& slot = connections_[connection->peer_id()];
+        if (slot != connection) {
+            replaced = slot;
+            slot = connection;
+        }
+    }
+    if (replaced) {
+        // The peer reconnected; its old socket is no longer written to
+        replaced->close();
+    }
+}
+
+void BlockchainNode::handle_connection_closed(const PeerConnection::pointer& connection) {
+    const std::string& peer_id = connection->peer_id();
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        auto it = connections_.find(peer_id);
+        if (it == connections_.end() || it->second != connection) {
+            return;  // Never registered, or already replaced
+        }
+        connections_.erase(it);
+    }
+    LOG_INFO("BlockchainNode", "Connection to " + peer_id + " closed");
+    remove_peer(peer_id);
+}
+
+std::vector<PeerConnection::pointer> BlockchainNode::open_connections() const {
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    std::vector<PeerConnection::pointer> connections;
+    connections.reserve(connections_.size());
+    for (const auto& [_, connection] : connections_) {
+        if (connection->is_open()) {
+            connections.push_back(connection);
+        }
+    }
+    return connections;
+}
+
 std::set<std::string> BlockchainNode::get_peers() const {
     std::lock_guard<std::mutex> lock(peers_mutex_);
     std::set<std::string> peers;
@@ -148,14 +345,18 @@ std::set<std::string> BlockchainNode::get_peers() const {
 }
 
 void BlockchainNode::broadcast_transaction(const Transaction& tx) {
-    NetworkMessage msg;
-    msg.type = MessageType::NEW_TRANSACTION;
-    msg.sender_id = node_id_;
-    msg.payload = tx.to_json().dump();
+    // Peers fetch the body from our mempool once they see the announcement
+    if (!blockchain_.has_pending_transaction(tx.transaction_id) && !validate_and_add_transaction(tx)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex_);
+        seen_transactions_.insert(tx.transaction_id);
+    }
     
     LOG_INFO("BlockchainNode", "Broadcasting transaction: " + tx.transaction_id.substr(0, 16) + 
              "... amount: " + std::to_string(tx.amount));
-    broadcast_message(msg);
+    announce_transactions({tx.transaction_id});
     std::cout << "[" << node_id_ << "] Broadcast transaction: " << tx.transaction_id << std::endl;
 }
 
@@ -206,25 +407,48 @@ bool BlockchainNode::validate_and_add_transaction(const Transaction& tx) {
     }
 }
 
+std::vector<TransactionVerdict> BlockchainNode::validate_and_add_transactions(const std::vector<Transaction>& transactions) {
+    std::vector<TransactionVerdict> verdicts = blockchain_.add_transactions(transactions);
+
+    size_t accepted = 0;
+    for (const auto& verdict : verdicts) {
+        if (verdict.accepted) {
+            ++accepted;
+        } else {
+            LOG_DEBUG("BlockchainNode", "Rejected transaction " + verdict.transaction_id.substr(0, 16) +
+                      ": " + verdict.error);
+        }
+    }
+
+    std::cout << "[" << node_id_ << "] Batch validated: " << accepted << "/" << transactions.size()
+              << " transactions added" << std::endl;
+    return verdicts;
+}
+
 void BlockchainNode::broadcast_block(const Block& block) {
     NetworkMessage msg;
     msg.type = MessageType::NEW_BLOCK;
     msg.sender_id = node_id_;
-    msg.payload = block.to_json().dump();
+    msg.encoding = wire::Encoding::BINARY;
+    msg.payload = wire::encode_block(block);
     
     broadcast_message(msg);
     std::cout << "[" << node_id_ << "] Broadcast block: " << block.index << std::endl;
 }
 
-void BlockchainNode::receive_block(const Block& block) {
+bool BlockchainNode::receive_block(const Block& block) {
+    // A competing block at our height makes the local PoW search pointless
+    blockchain_.cancel_mining(block.index);
+    
     std::lock_guard<std::mutex> lock(blockchain_mutex_);
     
-    // Verify block
-    if (blockchain_.is_chain_valid()) {
+    // Verify against the current tip only; history is covered by the checkpoint
+    if (blockchain_.accept_block(block)) {
         std::cout << "[" << node_id_ << "] Received valid block: " << block.index << std::endl;
-    } else {
-        std::cout << "[" << node_id_ << "] Received invalid block: " << block.index << std::endl;
+        return true;
     }
+    std::cout << "[" << node_id_ << "] Received invalid block: " << block.index << std::endl;
+    return false;
 }
 
 void BlockchainNode::mine_pending_transactions() {
@@ -257,25 +481,32 @@ void BlockchainNode::mine_pending_transactions() {
 }
 
 void BlockchainNode::request_chain_sync(const std::string& peer_id) {
-    NetworkMessage msg;
-    msg.type = MessageType::SYNC_REQUEST;
-    msg.sender_id = node_id_;
-    msg.payload = node_id_;
-    
-    std::cout << "[" << node_id_ << "] Requesting chain sync from peer: " << peer_id << std::endl;
+    LOG_DEBUG("BlockchainNode", "Starting headers-first sync (announced by " + peer_id + ")");
+    start_sync();
 }
 
-void BlockchainNode::handle_chain_sync(const std::vector<Block>& incoming_chain) {
-    std::lock_guard<std::mutex> lock(blockchain_mutex_);
-    
-    auto current_chain = blockchain_.get_chain();
-    
-    // Simple longest chain rule
-    if (incoming_chain.size() > current_chain.size()) {
-        // In production, verify the entire chain before replacing
-        std::cout << "[" << node_id_ << "] Accepting longer chain: " 
-                  << incoming_chain.size() << " blocks" << std::endl;
+void BlockchainNode::start_sync() {
+    if (blockchain_.is_catching_up()) {
+        // Our tip is still moving along the stored chain; the next announcement restarts sync
+        LOG_DEBUG("BlockchainNode", "Replaying stored blocks - sync deferred");
+        return;
+    }
+    // Far behind: bodies wait while a state snapshot is fetched, then only later blocks replay
+    sync_.hold_bodies(true);
+    if (!state_sync_.start()) {
+        sync_.hold_bodies(false);
     }
+    sync_.start();
+}
+
+void BlockchainNode::add_sync_peer(const std::string& peer_id, size_t height, ChainSync::SendFn send) {
+    state_sync_.add_peer(peer_id, height, send);
+    sync_.add_peer(peer_id, height, std::move(send));
+}
+
+void BlockchainNode::remove_sync_peer(const std::string& peer_id) {
+    sync_.remove_peer(peer_id);
+    state_sync_.remove_peer(peer_id);
 }
 
 // ============= STATE SYNCHRONIZATION (Phase 4.2) =============
@@ -291,37 +522,25 @@ void BlockchainNode::request_state_sync(const std::string& peer_id) {
 }
 
 void BlockchainNode::handle_state_sync_request(const std::string& peer_id) {
-    // Get current state snapshot and send to peer
-    std::lock_guard<std::mutex> lock(blockchain_mutex_);
-    
-    auto state = blockchain_.get_account_state();
-    std::string state_root = blockchain_.get_state_root();
+    // Roots are compared for convergence; accounts themselves travel as snapshot chunks
+    std::shared_ptr<const ChainSnapshot> snapshot = blockchain_.get_snapshot();
+    const std::string& state_root = snapshot->state_root;
     
     json state_json = json::object();
     state_json["state_root"] = state_root;
-    state_json["block_height"] = blockchain_.get_chain().size();
+    state_json["block_height"] = snapshot->height;
+    state_json["account_count"] = snapshot->account_count;
     state_json["node_id"] = node_id_;
     
-    // Serialize account state
-    json accounts = json::object();
-    for (const auto& [addr, data] : state) {
-        const auto& [balance, nonce] = data;
-        accounts[addr] = {
-            {"balance", balance},
-            {"nonce", nonce}
-        };
-    }
-    state_json["accounts"] = accounts;
-    
     NetworkMessage response;
     response.type = MessageType::STATE_SYNC_RESPONSE;
     response.sender_id = node_id_;
     response.payload = state_json.dump();
     
     LOG_INFO("BlockchainNode", "Responding to state sync request from " + peer_id + 
-             " with " + std::to_string(state.size()) + " accounts, state_root: " + state_root.substr(0, 16));
+             " with " + std::to_string(snapshot->account_count) + " accounts, state_root: " + state_root.substr(0, 16));
     std::cout << "[" << node_id_ << "] STATE SYNC RESPONSE -> " << peer_id 
-              << " (" << state.size() << " accounts, root: " << state_root.substr(0, 16) << "...)" << std::endl;
+              << " (" << snapshot->account_count << " accounts, root: " << state_root.substr(0, 16) << "...)" << std::endl;
 }
 
 void BlockchainNode::handle_state_sync_response(const json& state_data, const std::string& peer_id) {
@@ -334,8 +553,7 @@ void BlockchainNode::handle_state_sync_response(const json& state_data, const st
     
     // Get local state
     std::string local_state_root = blockchain_.get_state_root();
-    auto local_state = blockchain_.get_account_state();
-    int local_block_height = blockchain_.get_chain().size();
+    int local_block_height = blockchain_.get_chain_height();
     
     // Compare state roots
     if (peer_state_root == local_state_root) {
@@ -352,82 +570,584 @@ void BlockchainNode::handle_state_sync_response(const json& state_data, const st
     }
 }
 
+void BlockchainNode::handle_frame(const PeerConnection::pointer& peer, const wire::Frame& frame) {
+    NetworkMessage msg;
+    msg.type = frame.header.type;
+    msg.sender_id = std::string(frame.sender_id);
+    msg.encoding = frame.header.encoding;
+    msg.payload = std::string(frame.body);
+
+    if (msg.type == MessageType::HANDSHAKE) {
+        handle_handshake(peer, msg);
+        return;
+    }
+    deliver_message(peer->peer_id(), msg, [peer](const NetworkMessage& reply) {
+        peer->send_message(reply);
+    });
+}
+
+void BlockchainNode::deliver_message(const std::string& peer_id, const NetworkMessage& msg, const Reply& reply) {
+    switch (msg.type) {
+        case MessageType::NEW_TRANSACTION:
+            handle_new_transaction(peer_id, msg);
+            break;
+        case MessageType::INV_TRANSACTIONS:
+            handle_inventory(peer_id, msg, reply);
+            break;
+        case MessageType::GET_TRANSACTIONS:
+            handle_get_transactions(msg, reply);
+            break;
+        case MessageType::TRANSACTIONS:
+            handle_transactions(peer_id, msg);
+            break;
+        case MessageType::NEW_BLOCK:
+            handle_new_block(peer_id, msg);
+            break;
+        case MessageType::GET_HEADERS:
+            handle_get_headers(msg, reply);
+            break;
+        case MessageType::HEADERS:
+            handle_headers(peer_id, msg);
+            break;
+        case MessageType::GET_BLOCKS:
+            handle_get_blocks(msg, reply);
+            break;
+        case MessageType::BLOCKS:
+            handle_blocks(peer_id, msg);
+            break;
+        case MessageType::GET_SNAPSHOT_MANIFEST:
+            handle_get_snapshot_manifest(msg, reply);
+            break;
+        case MessageType::SNAPSHOT_MANIFEST:
+            handle_snapshot_manifest(peer_id, msg);
+            break;
+        case MessageType::GET_SNAPSHOT_CHUNK:
+            handle_get_snapshot_chunk(msg, reply);
+            break;
+        case MessageType::SNAPSHOT_CHUNK:
+            handle_snapshot_chunk(peer_id, msg);
+            break;
+        case MessageType::SYNC_REQUEST:
+            handle_sync_request(msg);
+            break;
+        case MessageType::SYNC_RESPONSE:
+            handle_sync_response(msg);
+            break;
+        case MessageType::STATE_SYNC_REQUEST:
+            handle_state_sync_request(msg.sender_id);
+            break;
+        case MessageType::STATE_SYNC_RESPONSE:
+            try {
+                handle_state_sync_response(json::parse(msg.payload), msg.sender_id);
+            } catch (const std::exception& e) {
+                std::cerr << "[" << node_id_ << "] Error handling state sync: " << e.what() << std::endl;
+            }
+            break;
+        default:
+            // Includes the whole-chain REQUEST_CHAIN/RESPONSE_CHAIN exchange, superseded by GET_HEADERS
+            LOG_DEBUG("BlockchainNode", "Ignoring message type " +
+                      std::to_string(static_cast<int>(msg.type)) + " from " + msg.sender_id);
+            break;
+    }
+}
+
+NetworkMessage BlockchainNode::make_handshake() const {
+    NetworkMessage handshake;
+    handshake.type = MessageType::HANDSHAKE;
+    handshake.sender_id = node_id_;
+    handshake.payload = json{
+        {"node_id", node_id_},
+        {"wire_version", static_cast<int>(wire::PROTOCOL_VERSION)},
+        {"encodings", json::array({"binary", "json"})},
+        {"height", blockchain_.get_chain_height()}
+    }.dump();
+    return handshake;
+}
+
 void BlockchainNode::handle_handshake(const NetworkMessage& msg, const std::string& peer_address) {
     std::cout << "[" << node_id_ << "] Received handshake from: " << msg.sender_id << std::endl;
     add_peer(msg.sender_id, peer_address);
 }
 
-void BlockchainNode::handle_new_transaction(const NetworkMessage& msg) {
+void BlockchainNode::handle_handshake(const PeerConnection::pointer& peer, const NetworkMessage& msg) {
+    // Older peers send their bare node id and only understand JSON bodies
+    bool supports_binary = false;
+    size_t height = 0;
+    try {
+        json hello = json::parse(msg.payload);
+        for (const auto& encoding : hello.value("encodings", json::array())) {
+            supports_binary = supports_binary || encoding == "binary";
+        }
+        height = hello.value("height", static_cast<size_t>(0));
+    } catch (const std::exception&) {
+    }
+    peer->set_encoding(supports_binary ? wire::Encoding::BINARY : wire::Encoding::JSON);
+
+    // An inbound connection has no id yet and still owes its handshake reply
+    bool inbound = peer->peer_id().empty();
+    std::string peer_address = msg.sender_id;
+    if (inbound) {
+        boost::system::error_code ec;
+        auto endpoint = peer->socket().remote_endpoint(ec);
+        if (!ec) {
+            peer_address = endpoint.address().to_string() + ":" + std::to_string(endpoint.port());
+        }
+        peer->set_peer_id(msg.sender_id);
+        register_connection(peer);
+        peer->send_message(make_handshake());
+    }
+
+    LOG_DEBUG("BlockchainNode", "Peer " + msg.sender_id + " uses " +
+              (supports_binary ? "binary" : "JSON") + " message bodies");
+    if (inbound) {
+        handle_handshake(msg, peer_address);  // Outbound peers were added by connect_to_peer
+    }
+
+    // Every connected peer can serve headers and block ranges
+    boost::weak_ptr<PeerConnection> weak_peer = peer;
+    add_sync_peer(peer->peer_id(), height, [this, weak_peer](MessageType type, const std::string& body) {
+        if (PeerConnection::pointer connection = weak_peer.lock()) {
+            connection->send_message(make_message(type, body));
+        }
+    });
+    start_sync();
+}
+
+void BlockchainNode::handle_new_transaction(const std::string& peer_id, const NetworkMessage& msg) {
     try {
-        json tx_json = json::parse(msg.payload);
         Transaction tx;
-        tx.from = tx_json["from"];
-        tx.to = tx_json["to"];
-        tx.amount = tx_json["amount"];
-        tx.gas_price = tx_json["gas_price"];
-        tx.timestamp = tx_json["timestamp"];
-        tx.signature = tx_json["signature"];
-        tx.public_key = tx_json["public_key"];
-        tx.transaction_id = tx_json["transaction_id"];
+        if (!wire::decode_transaction_body(msg.encoding, msg.payload, tx)) {
+            std::cerr << "[" << node_id_ << "] Malformed transaction from: " << msg.sender_id << std::endl;
+            return;
+        }
         
+        {
+            std::lock_guard<std::mutex> lock(relay_mutex_);
+            relay_peers_[peer_id].known.insert(tx.transaction_id);
+            requested_transactions_.erase(tx.transaction_id);
+            if (seen_transactions_.contains(tx.transaction_id)) {
+                return;
+            }
+        }
         if (validate_and_add_transaction(tx)) {
-            // Relay to other peers
-            broadcast_message(msg, msg.sender_id);
+            {
+                std::lock_guard<std::mutex> lock(relay_mutex_);
+                seen_transactions_.insert(tx.transaction_id);
+            }
+            // Relay to other peers as an announcement
+            announce_transactions({tx.transaction_id}, peer_id);
         }
     } catch (const std::exception& e) {
         std::cerr << "[" << node_id_ << "] Error handling transaction: " << e.what() << std::endl;
     }
 }
 
-void BlockchainNode::handle_new_block(const NetworkMessage& msg) {
+// ============= TRANSACTION RELAY =============
+
+void BlockchainNode::announce_transactions(const std::vector<std::string>& transaction_ids,
+                                           const std::string& exclude_peer) {
+    std::vector<PeerConnection::pointer> connections = open_connections();
+    std::vector<std::pair<PeerConnection::pointer, std::vector<std::string>>> full;
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex_);
+        for (const auto& connection : connections) {
+            if (connection->peer_id() == exclude_peer) {
+                continue;
+            }
+            RelayPeer& relay = relay_peers_[connection->peer_id()];
+            for (const auto& id : transaction_ids) {
+                if (!relay.known.insert(id)) {
+                    continue;  // The peer already has it, or an announcement of it
+                }
+                relay.queued.push_back(id);
+                if (relay.queued.size() >= MAX_INVENTORY_PER_MESSAGE) {
+                    full.emplace_back(connection, std::move(relay.queued));
+                    relay.queued.clear();
+                }
+            }
+        }
+
+        bool queued = std::any_of(relay_peers_.begin(), relay_peers_.end(),
+                                  [](const auto& entry) { return !entry.second.queued.empty(); });
+        if (queued) {
+            // Announcements made within one interval share a message
+            arm_relay_timer();
+        }
+    }
+
+    for (const auto& [connection, ids] : full) {
+        connection->send_message(make_message(MessageType::INV_TRANSACTIONS, wire::encode_inventory(ids)));
+    }
+}
+
+void BlockchainNode::arm_relay_timer() {
+    if (relay_timer_armed_) {
+        return;
+    }
+    relay_timer_armed_ = true;
+    relay_timer_.expires_after(std::chrono::milliseconds(RELAY_INTERVAL_MS));
+    relay_timer_.async_wait([this](const boost::system::error_code& error) {
+        if (error != boost::asio::error::operation_aborted) {
+            flush_relay();
+        }
+    });
+}
+
+void BlockchainNode::flush_relay() {
+    std::vector<PeerConnection::pointer> connections = open_connections();
+    std::vector<std::pair<PeerConnection::pointer, std::vector<std::string>>> batches;
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex_);
+        relay_timer_armed_ = false;
+        for (const auto& connection : connections) {
+            auto it = relay_peers_.find(connection->peer_id());
+            if (it != relay_peers_.end() && !it->second.queued.empty()) {
+                batches.emplace_back(connection, std::move(it->second.queued));
+                it->second.queued.clear();
+            }
+        }
+    }
+
+    size_t announced = 0;
+    for (const auto& [connection, ids] : batches) {
+        if (connection->send_message(make_message(MessageType::INV_TRANSACTIONS, wire::encode_inventory(ids)))) {
+            announced += ids.size();
+        }
+    }
+    if (announced > 0) {
+        LOG_DEBUG("BlockchainNode", "Announced " + std::to_string(announced) + " transaction ids to " +
+                  std::to_string(batches.size()) + " peers");
+    }
+    retry_transaction_requests();
+}
+
+void BlockchainNode::retry_transaction_requests() {
+    std::vector<PeerConnection::pointer> connections = open_connections();
+    std::map<std::string, std::vector<std::string>> retries;  // Peer -> ids to ask it for
+    auto now = std::chrono::steady_clock::now();
+    size_t abandoned = 0;
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex_);
+        for (auto it = requested_transactions_.begin(); it != requested_transactions_.end();) {
+            TransactionRequest& request = it->second;
+            bool connected = relay_peers_.count(request.peer_id) > 0;
+            if (connected && now - request.sent <= std::chrono::seconds(TRANSACTION_REQUEST_TIMEOUT_SECONDS)) {
+                ++it;
+                continue;
+            }
+            // The peer asked went silent or away; move on to the next one that announced it
+            while (!request.announcers.empty() && relay_peers_.count(request.announcers.front()) == 0) {
+                request.announcers.pop_front();
+            }
+            if (request.announcers.empty()) {
+                ++abandoned;
+                it = requested_transactions_.erase(it);  // A later announcement starts over
+                continue;
+            }
+            request.peer_id = std::move(request.announcers.front());
+            request.announcers.pop_front();
+            request.sent = now;
+            retries[request.peer_id].push_back(it->first);
+            ++it;
+        }
+        if (!requested_transactions_.empty()) {
+            arm_relay_timer();  // Keep checking while bodies are outstanding
+        }
+    }
+
+    size_t retried = 0;
+    for (const auto& connection : connections) {
+        auto it = retries.find(connection->peer_id());
+        if (it == retries.end()) {
+            continue;
+        }
+        for (size_t first = 0; first < it->second.size(); first += MAX_INVENTORY_PER_MESSAGE) {
+            size_t last = std::min(it->second.size(), first + MAX_INVENTORY_PER_MESSAGE);
+            std::vector<std::string> ids(it->second.begin() + first, it->second.begin() + last);
+            connection->send_message(make_message(MessageType::GET_TRANSACTIONS, wire::encode_inventory(ids)));
+        }
+        retried += it->second.size();
+    }
+    if (retried > 0 || abandoned > 0) {
+        LOG_DEBUG("BlockchainNode", "Transaction requests timed out: " + std::to_string(retried) +
+                  " re-requested from other announcers, " + std::to_string(abandoned) + " dropped");
+    }
+}
+
+void BlockchainNode::handle_inventory(const std::string& peer_id, const NetworkMessage& msg, const Reply& reply) {
+    std::vector<std::string> transaction_ids;
+    if (!wire::decode_inventory_body(msg.encoding, msg.payload, transaction_ids)) {
+        std::cerr << "[" << node_id_ << "] Malformed transaction inventory from: " << msg.sender_id << std::endl;
+        return;
+    }
+    if (transaction_ids.size() > MAX_INVENTORY_PER_MESSAGE) {
+        transaction_ids.resize(MAX_INVENTORY_PER_MESSAGE);
+    }
+
+    retry_transaction_requests();
+
+    std::vector<std::string> wanted;
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex_);
+        RelayPeer& relay = relay_peers_[peer_id];
+        for (const auto& id : transaction_ids) {
+            relay.known.insert(id);
+            if (seen_transactions_.contains(id)) {
+                continue;
+            }
+            // Fetch each transaction from one peer at a time; the other announcers are asked on timeout
+            auto it = requested_transactions_.find(id);
+            if (it != requested_transactions_.end()) {
+                TransactionRequest& request = it->second;
+                if (request.peer_id != peer_id && request.announcers.size() < MAX_ANNOUNCERS_PER_TRANSACTION &&
+                    std::find(request.announcers.begin(), request.announcers.end(), peer_id) == request.announcers.end()) {
+                    request.announcers.push_back(peer_id);
+                }
+                continue;
+            }
+            requested_transactions_[id] = TransactionRequest{peer_id, now, {}};
+            wanted.push_back(id);
+        }
+        if (!wanted.empty()) {
+            arm_relay_timer();
+        }
+    }
+
+    if (!wanted.empty()) {
+        LOG_DEBUG("BlockchainNode", "Requesting " + std::to_string(wanted.size()) + " of " +
+                  std::to_string(transaction_ids.size()) + " announced transactions from " + peer_id);
+        reply(make_message(MessageType::GET_TRANSACTIONS, wire::encode_inventory(wanted)));
+    }
+}
+
+void BlockchainNode::handle_get_transactions(const NetworkMessage& msg, const Reply& reply) {
+    std::vector<std::string> transaction_ids;
+    if (!wire::decode_inventory_body(msg.encoding, msg.payload, transaction_ids)) {
+        std::cerr << "[" << node_id_ << "] Malformed transaction request from: " << msg.sender_id << std::endl;
+        return;
+    }
+
+    // Anything mined or evicted since it was announced is simply left out
+    std::vector<Transaction> transactions;
+    for (size_t i = 0; i < transaction_ids.size() && i < MAX_INVENTORY_PER_MESSAGE; ++i) {
+        Transaction tx;
+        if (blockchain_.get_pending_transaction(transaction_ids[i], tx)) {
+            transactions.push_back(std::move(tx));
+        }
+    }
+    if (!transactions.empty()) {
+        reply(make_message(MessageType::TRANSACTIONS, wire::encode_transactions(transactions)));
+    }
+}
+
+void BlockchainNode::handle_transactions(const std::string& peer_id, const NetworkMessage& msg) {
+    std::vector<Transaction> transactions;
+    if (!wire::decode_transactions_body(msg.encoding, msg.payload, transactions)) {
+        std::cerr << "[" << node_id_ << "] Malformed transactions from: " << msg.sender_id << std::endl;
+        return;
+    }
+
+    std::vector<Transaction> fresh;
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex_);
+        RelayPeer& relay = relay_peers_[peer_id];
+        for (auto& tx : transactions) {
+            relay.known.insert(tx.transaction_id);
+            requested_transactions_.erase(tx.transaction_id);
+            if (!seen_transactions_.contains(tx.transaction_id)) {
+                fresh.push_back(std::move(tx));
+            }
+        }
+    }
+    if (fresh.empty()) {
+        return;
+    }
+
+    std::vector<TransactionVerdict> verdicts = validate_and_add_transactions(fresh);
+    std::vector<std::string> accepted;
+    {
+        // Transient rejections (a nonce gap, a balance still to arrive) stay fetchable
+        std::lock_guard<std::mutex> lock(relay_mutex_);
+        for (const auto& verdict : verdicts) {
+            if (verdict.accepted || verdict.permanent) {
+                seen_transactions_.insert(verdict.transaction_id);
+            }
+            if (verdict.accepted) {
+                accepted.push_back(verdict.transaction_id);
+            }
+        }
+    }
+    announce_transactions(accepted, peer_id);
+}
+
+void BlockchainNode::handle_new_block(const std::string& peer_id, const NetworkMessage& msg) {
     try {
-        json block_json = json::parse(msg.payload);
         Block block;
-        block.index = block_json["index"];
-        block.timestamp = block_json["timestamp"];
-        block.merkle_root = block_json["merkle_root"];
-        block.proof = block_json["proof"];
-        block.previous_hash = block_json["previous_hash"];
-        
-        receive_block(block);
+        if (!wire::decode_block_body(msg.encoding, msg.payload, block)) {
+            std::cerr << "[" << node_id_ << "] Malformed block from: " << msg.sender_id << std::endl;
+            return;
+        }
         
-        // Relay to other peers
-        broadcast_message(msg, msg.sender_id);
+        // Relay only blocks that extend our chain
+        if (receive_block(block)) {
+            broadcast_message(msg, peer_id);
+        } else if (static_cast<size_t>(block.index) > blockchain_.get_chain_height() + 1) {
+            // We are behind the announcing peer: fetch what is missing
+            sync_.update_peer_height(peer_id, block.index);
+            state_sync_.update_peer_height(peer_id, block.index);
+            start_sync();
+        }
     } catch (const std::exception& e) {
         std::cerr << "[" << node_id_ << "] Error handling block: " << e.what() << std::endl;
     }
 }
 
-void BlockchainNode::handle_request_chain(const NetworkMessage& msg) {
-    NetworkMessage response;
-    response.type = MessageType::RESPONSE_CHAIN;
-    response.sender_id = node_id_;
+void BlockchainNode::handle_get_headers(const NetworkMessage& msg, const Reply& reply) {
+    wire::HeadersRequest request;
+    if (!wire::decode_headers_request_body(msg.encoding, msg.payload, request)) {
+        std::cerr << "[" << node_id_ << "] Malformed header request from: " << msg.sender_id << std::endl;
+        return;
+    }
     
-    json chain_json = blockchain_.get_chain_json();
-    response.payload = chain_json.dump();
+    size_t max_headers = std::min<size_t>(request.max_headers, ChainSync::MAX_HEADERS_PER_MESSAGE);
+    std::vector<BlockHeader> headers = blockchain_.get_headers_after(request.locator, max_headers);
+    LOG_DEBUG("BlockchainNode", "Serving " + std::to_string(headers.size()) + " headers to " + msg.sender_id);
+    reply(make_message(MessageType::HEADERS, wire::encode_headers(headers)));
+}
+
+void BlockchainNode::handle_headers(const std::string& peer_id, const NetworkMessage& msg) {
+    try {
+        std::vector<BlockHeader> headers;
+        if (!wire::decode_headers_body(msg.encoding, msg.payload, headers)) {
+            std::cerr << "[" << node_id_ << "] Malformed headers from: " << msg.sender_id << std::endl;
+            sync_.remove_peer(peer_id);
+            return;
+        }
+        sync_.on_headers(peer_id, headers);
+        state_sync_.poll();  // A pending snapshot may now be checkable against the headers
+    } catch (const std::exception& e) {
+        std::cerr << "[" << node_id_ << "] Error handling headers: " << e.what() << std::endl;
+    }
+}
+
+void BlockchainNode::handle_get_blocks(const NetworkMessage& msg, const Reply& reply) {
+    wire::BlocksRequest request;
+    if (!wire::decode_blocks_request_body(msg.encoding, msg.payload, request)) {
+        std::cerr << "[" << node_id_ << "] Malformed block request from: " << msg.sender_id << std::endl;
+        return;
+    }
     
-    std::cout << "[" << node_id_ << "] Sending chain to peer: " << msg.sender_id << std::endl;
+    // Block indices start at 1 for genesis; chain positions at 0
+    std::vector<Block> blocks;
+    if (request.first_index > 0) {
+        size_t count = std::min<size_t>(request.count, ChainSync::MAX_BLOCKS_PER_RESPONSE);
+        blocks = blockchain_.get_blocks(static_cast<size_t>(request.first_index - 1), count);
+        // History below an installed snapshot has no bodies to serve
+        auto header_only = std::find_if(blocks.begin(), blocks.end(),
+                                        [](const Block& block) { return block.is_header_only(); });
+        blocks.erase(header_only, blocks.end());
+    }
+    LOG_DEBUG("BlockchainNode", "Serving " + std::to_string(blocks.size()) + " blocks from #" +
+              std::to_string(request.first_index) + " to " + msg.sender_id);
+    reply(make_message(MessageType::BLOCKS, wire::encode_blocks(blocks)));
 }
 
-void BlockchainNode::handle_response_chain(const NetworkMessage& msg) {
+void BlockchainNode::handle_blocks(const std::string& peer_id, const NetworkMessage& msg) {
     try {
-        json chain_json = json::parse(msg.payload);
-        std::vector<Block> incoming_chain;
-        
-        for (const auto& block_json : chain_json) {
-            Block block;
-            block.index = block_json["index"];
-            block.timestamp = block_json["timestamp"];
-            block.merkle_root = block_json["merkle_root"];
-            block.proof = block_json["proof"];
-            block.previous_hash = block_json["previous_hash"];
-            incoming_chain.push_back(block);
+        std::vector<Block> blocks;
+        if (!wire::decode_blocks_body(msg.encoding, msg.payload, blocks)) {
+            std::cerr << "[" << node_id_ << "] Malformed blocks from: " << msg.sender_id << std::endl;
+            sync_.remove_peer(peer_id);
+            return;
         }
-        
-        handle_chain_sync(incoming_chain);
+        sync_.on_blocks(peer_id, blocks);
     } catch (const std::exception& e) {
-        std::cerr << "[" << node_id_ << "] Error handling chain response: " << e.what() << std::endl;
+        std::cerr << "[" << node_id_ << "] Error handling blocks: " << e.what() << std::endl;
+    }
+}
+
+// ============= STATE SNAPSHOTS =============
+
+std::shared_ptr<const StateSnapshot> BlockchainNode::current_state_snapshot() {
+    std::shared_ptr<const ChainSnapshot> checkpoint = blockchain_.get_state_checkpoint();
+    if (!checkpoint) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(served_snapshots_mutex_);
+    if (served_snapshots_.empty() || served_snapshots_.back()->manifest().height != checkpoint->height ||
+        served_snapshots_.back()->manifest().block_hash != checkpoint->tip_hash) {
+        served_snapshots_.push_back(StateSnapshot::build(*checkpoint));
+        if (served_snapshots_.size() > SERVED_SNAPSHOTS) {
+            served_snapshots_.pop_front();
+        }
+        LOG_INFO("BlockchainNode", "Built state snapshot at #" + std::to_string(checkpoint->height) +
+                 " (" + std::to_string(checkpoint->account_count) + " accounts)");
+    }
+    return served_snapshots_.back();
+}
+
+std::shared_ptr<const StateSnapshot> BlockchainNode::find_state_snapshot(const std::string& state_root) const {
+    std::lock_guard<std::mutex> lock(served_snapshots_mutex_);
+    for (const auto& snapshot : served_snapshots_) {
+        if (snapshot->manifest().state_root == state_root) {
+            return snapshot;
+        }
     }
+    return nullptr;
+}
+
+void BlockchainNode::handle_get_snapshot_manifest(const NetworkMessage& msg, const Reply& reply) {
+    SnapshotManifest manifest;
+    try {
+        if (std::shared_ptr<const StateSnapshot> snapshot = current_state_snapshot()) {
+            manifest = snapshot->manifest();
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("BlockchainNode", "Cannot build state snapshot: " + std::string(e.what()));
+    }
+    LOG_DEBUG("BlockchainNode", "Serving snapshot manifest #" + std::to_string(manifest.height) +
+              " to " + msg.sender_id);
+    reply(make_message(MessageType::SNAPSHOT_MANIFEST, wire::encode_snapshot_manifest(manifest)));
+}
+
+void BlockchainNode::handle_snapshot_manifest(const std::string& peer_id, const NetworkMessage& msg) {
+    SnapshotManifest manifest;
+    if (!wire::decode_snapshot_manifest_body(msg.encoding, msg.payload, manifest)) {
+        std::cerr << "[" << node_id_ << "] Malformed snapshot manifest from: " << msg.sender_id << std::endl;
+        state_sync_.remove_peer(peer_id);
+        return;
+    }
+    state_sync_.on_manifest(peer_id, manifest);
+}
+
+void BlockchainNode::handle_get_snapshot_chunk(const NetworkMessage& msg, const Reply& reply) {
+    wire::ChunkRequest request;
+    if (!wire::decode_chunk_request_body(msg.encoding, msg.payload, request)) {
+        std::cerr << "[" << node_id_ << "] Malformed chunk request from: " << msg.sender_id << std::endl;
+        return;
+    }
+    
+    std::shared_ptr<const StateSnapshot> snapshot = find_state_snapshot(request.state_root);
+    if (!snapshot || request.index >= SnapshotManifest::CHUNK_COUNT) {
+        SnapshotChunk missing;
+        missing.state_root = request.state_root;
+        missing.index = request.index;
+        missing.available = false;
+        reply(make_message(MessageType::SNAPSHOT_CHUNK, wire::encode_snapshot_chunk(missing)));
+        return;
+    }
+    reply(make_message(MessageType::SNAPSHOT_CHUNK, wire::encode_snapshot_chunk(snapshot->chunk(request.index))));
+}
+
+void BlockchainNode::handle_snapshot_chunk(const std::string& peer_id, const NetworkMessage& msg) {
+    SnapshotChunk chunk;
+    if (!wire::decode_snapshot_chunk_body(msg.encoding, msg.payload, chunk)) {
+        std::cerr << "[" << node_id_ << "] Malformed snapshot chunk from: " << msg.sender_id << std::endl;
+        state_sync_.remove_peer(peer_id);
+        return;
+    }
+    state_sync_.on_chunk(peer_id, std::move(chunk));
 }
 
 void BlockchainNode::handle_sync_request(const NetworkMessage& msg) {
@@ -439,26 +1159,51 @@ void BlockchainNode::handle_sync_response(const NetworkMessage& msg) {
 }
 
 void BlockchainNode::broadcast_message(const NetworkMessage& msg, const std::string& exclude_peer) {
-    std::lock_guard<std::mutex> lock(peers_mutex_);
-    
-    for (const auto& [peer_id, address] : peer_map_) {
-        if (!exclude_peer.empty() && peer_id == exclude_peer) {
+    size_t sent = 0;
+    std::vector<PeerConnection::pointer> connections = open_connections();
+    for (const auto& connection : connections) {
+        if (!exclude_peer.empty() && connection->peer_id() == exclude_peer) {
             continue;
         }
-        // In production, maintain persistent connections and send directly
-        std::cout << "[" << node_id_ << "] Broadcasting to peer: " << peer_id << std::endl;
+        if (connection->send_message(msg)) {
+            ++sent;
+        }
     }
+    LOG_DEBUG("BlockchainNode", "Broadcast message of type " + std::to_string(static_cast<int>(msg.type)) +
+              " to " + std::to_string(sent) + " peers");
+}
+
+NetworkMessage BlockchainNode::make_message(MessageType type, std::string payload) const {
+    NetworkMessage msg;
+    msg.type = type;
+    msg.sender_id = node_id_;
+    msg.encoding = wire::Encoding::BINARY;
+    msg.payload = std::move(payload);
+    return msg;
 }
 
 std::string BlockchainNode::serialize_message(const NetworkMessage& msg) {
-    return msg.to_json().dump();
+    return wire::encode_frame(msg.type, msg.encoding, msg.sender_id, msg.payload);
 }
 
 NetworkMessage BlockchainNode::deserialize_message(const std::string& data) {
-    json j = json::parse(data);
-    return NetworkMessage::from_json(j);
+    wire::FrameParser parser;
+    parser.feed(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+
+    wire::Frame frame;
+    if (parser.next(frame) != wire::FrameParser::Status::FRAME) {
+        throw BlockchainException("Malformed network frame: " +
+                                  (parser.error().empty() ? std::string("truncated") : parser.error()));
+    }
+
+    NetworkMessage msg;
+    msg.type = frame.header.type;
+    msg.sender_id = std::string(frame.sender_id);
+    msg.encoding = frame.header.encoding;
+    msg.payload = std::string(frame.body);
+    return msg;
 }
 
 bool BlockchainNode::is_chain_longer(const std::vector<Block>& other_chain) const {
-    return other_chain.size() > blockchain_.get_chain().size();
+    return other_chain.size() > blockchain_.get_chain_height();
 }
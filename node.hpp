@@ -2,9 +2,19 @@
 #define NODE_HPP
 
 #include "blockchain.hpp"
+#include "chain_sync.hpp"
+#include "state_sync.hpp"
+#include "wire_protocol.hpp"
+#include "utils/recent_filter.hpp"
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <thread>
 #include <set>
@@ -12,26 +22,12 @@
 
 using boost::asio::ip::tcp;
 
-// Message types for network communication
-enum class MessageType : uint8_t {
-    HANDSHAKE = 0,
-    NEW_TRANSACTION = 1,
-    NEW_BLOCK = 2,
-    REQUEST_CHAIN = 3,
-    RESPONSE_CHAIN = 4,
-    SYNC_REQUEST = 5,
-    SYNC_RESPONSE = 6,
-    PEER_LIST = 7,
-    ACK = 8,
-    STATE_SYNC_REQUEST = 9,    // Phase 4.2: Request account state snapshot
-    STATE_SYNC_RESPONSE = 10   // Phase 4.2: Response with account state
-};
-
 // Network message structure
 struct NetworkMessage {
     MessageType type;
     std::string payload;
     std::string sender_id;
+    wire::Encoding encoding = wire::Encoding::JSON;  // How `payload` is encoded
     
     json to_json() const {
         json j;
@@ -51,9 +47,18 @@ struct NetworkMessage {
 };
 
 // Connection handler for individual peers
+//
+// Writes are queued and issued one at a time on the connection's strand, so
+// any thread may send. A peer that stops reading fills its queue; once
+// MAX_QUEUED_BYTES are waiting, further messages are refused rather than
+// buffered without bound.
 class PeerConnection : public boost::enable_shared_from_this<PeerConnection> {
 public:
     typedef boost::shared_ptr<PeerConnection> pointer;
+    typedef std::function<void(const pointer&, const wire::Frame&)> FrameHandler;
+    typedef std::function<void(const pointer&)> CloseHandler;
+
+    static constexpr size_t MAX_QUEUED_BYTES = 8 * 1024 * 1024;
 
     static pointer create(boost::asio::io_service& io_service) {
         return pointer(new PeerConnection(io_service));
@@ -64,42 +69,81 @@ public:
     }
 
     void start();
-    void send_message(const NetworkMessage& msg);
+    // False if the message was dropped: unencodable, closed, or the write queue is full
+    bool send_message(const NetworkMessage& msg);
+    void close();
+
+    // Called for every complete frame read from the socket
+    void set_frame_handler(FrameHandler handler) { frame_handler_ = std::move(handler); }
+    // Called once when the connection fails or is closed
+    void set_close_handler(CloseHandler handler) { close_handler_ = std::move(handler); }
+
+    // Body encoding agreed at handshake; JSON until the peer advertises binary
+    wire::Encoding encoding() const { return encoding_; }
+    void set_encoding(wire::Encoding encoding) { encoding_ = encoding; }
+
+    const std::string& peer_id() const { return peer_id_; }
+    void set_peer_id(const std::string& peer_id) { peer_id_ = peer_id; }
+
+    bool is_open() const { return !closed_; }
+    size_t queued_bytes() const { return queued_bytes_; }
 
 private:
-    PeerConnection(boost::asio::io_service& io_service) : socket_(io_service) {}
+    PeerConnection(boost::asio::io_service& io_service) : socket_(io_service), strand_(io_service) {}
 
     void handle_read(const boost::system::error_code& error, size_t bytes_transferred);
-    void handle_write(const boost::system::error_code& error);
+    void write_next();  // On the strand
+    void handle_write(const boost::system::error_code& error, size_t frame_size);
 
     tcp::socket socket_;
+    boost::asio::io_service::strand strand_;
     enum { max_length = 65536 };
-    char data_[max_length];
+    uint8_t data_[max_length];
     std::string peer_id_;
+    wire::FrameParser parser_;
+    wire::Encoding encoding_ = wire::Encoding::JSON;
+    FrameHandler frame_handler_;
+    CloseHandler close_handler_;
+
+    std::deque<std::shared_ptr<const std::string>> write_queue_;  // Strand only
+    bool writing_ = false;                                        // Strand only
+    std::atomic<size_t> queued_bytes_{0};
+    std::atomic<bool> closed_{false};
 };
 
 // Main node class managing the blockchain network
 class BlockchainNode {
 public:
+    // Sends a message back to whoever delivered the one being handled
+    using Reply = std::function<void(const NetworkMessage&)>;
+
     BlockchainNode(const std::string& node_id, uint16_t port, int difficulty = 4);
     ~BlockchainNode();
 
     // Node operations
     void start();
     void stop();
+    // Reuses the open connection to host:port if there is one
     void connect_to_peer(const std::string& host, uint16_t port);
     
     // Transaction operations
+    // Announces a transaction in the local mempool (added first if need be) to every peer
     void broadcast_transaction(const Transaction& tx);
     void receive_transaction(const Transaction& tx);
     
     // Block operations
     void broadcast_block(const Block& block);
-    void receive_block(const Block& block);
+    bool receive_block(const Block& block);
     
-    // Synchronization
+    // Headers-first synchronization (see ChainSync)
     void request_chain_sync(const std::string& peer_id);
-    void handle_chain_sync(const std::vector<Block>& incoming_chain);
+    void add_sync_peer(const std::string& peer_id, size_t height, ChainSync::SendFn send);
+    void remove_sync_peer(const std::string& peer_id);
+    ChainSync& get_chain_sync() { return sync_; }
+    StateSync& get_state_sync() { return state_sync_; }
+    
+    // Handle a message from `peer_id`, whatever transport carried it
+    void deliver_message(const std::string& peer_id, const NetworkMessage& msg, const Reply& reply);
     
     // State Synchronization (Phase 4.2)
     void request_state_sync(const std::string& peer_id);
@@ -111,6 +155,7 @@ public:
     void add_peer(const std::string& peer_id, const std::string& address);
     void remove_peer(const std::string& peer_id);
     std::set<std::string> get_peers() const;
+    size_t get_connection_count() const;
     
     // Getters
     std::string get_node_id() const { return node_id_; }
@@ -121,11 +166,19 @@ public:
     // Consensus & Mining
     void mine_pending_transactions();
     bool validate_and_add_transaction(const Transaction& tx);
+    std::vector<TransactionVerdict> validate_and_add_transactions(const std::vector<Transaction>& transactions);
     
 private:
     std::string node_id_;
     uint16_t port_;
     Blockchain blockchain_;
+    ChainSync sync_;
+    StateSync state_sync_;
+    
+    // Built snapshots of recent checkpoints, newest last (peers may still be fetching the older one)
+    static constexpr size_t SERVED_SNAPSHOTS = 2;
+    std::deque<std::shared_ptr<const StateSnapshot>> served_snapshots_;
+    mutable std::mutex served_snapshots_mutex_;
     
     boost::asio::io_service io_service_;
     std::unique_ptr<tcp::acceptor> acceptor_;
@@ -133,6 +186,7 @@ private:
     
     // Peer management
     std::map<std::string, std::string> peer_map_;  // peer_id -> address
+    std::map<std::string, PeerConnection::pointer> connections_;  // One open socket per peer
     mutable std::mutex peers_mutex_;
     mutable std::mutex blockchain_mutex_;
     
@@ -154,20 +208,68 @@ private:
     mutable std::mutex pending_msg_mutex_;
     static constexpr size_t MAX_PENDING_MESSAGES = 1000;
     
+    // Transaction relay: ids are announced in batches (INV_TRANSACTIONS) and
+    // peers fetch only those they have not seen (GET_TRANSACTIONS). A request
+    // that times out is sent to the next peer that announced the id.
+    static constexpr size_t SEEN_TRANSACTIONS = 50000;
+    static constexpr size_t KNOWN_TRANSACTIONS_PER_PEER = 20000;
+    static constexpr size_t MAX_INVENTORY_PER_MESSAGE = 1000;
+    static constexpr int RELAY_INTERVAL_MS = 100;
+    static constexpr int TRANSACTION_REQUEST_TIMEOUT_SECONDS = 10;
+    static constexpr size_t MAX_ANNOUNCERS_PER_TRANSACTION = 8;
+    struct RelayPeer {
+        RecentFilter known{KNOWN_TRANSACTIONS_PER_PEER};  // Sent to or announced by the peer
+        std::vector<std::string> queued;                   // Announcements not yet flushed
+    };
+    struct TransactionRequest {
+        std::string peer_id;                   // Asked for the body
+        std::chrono::steady_clock::time_point sent;
+        std::deque<std::string> announcers;    // Also announced it; asked in turn on timeout
+    };
+    std::map<std::string, RelayPeer> relay_peers_;
+    RecentFilter seen_transactions_{SEEN_TRANSACTIONS};  // Accepted, or invalid for good
+    std::map<std::string, TransactionRequest> requested_transactions_;
+    boost::asio::steady_timer relay_timer_;
+    bool relay_timer_armed_ = false;
+    std::mutex relay_mutex_;
+    
     // Message handlers
+    void handle_frame(const PeerConnection::pointer& peer, const wire::Frame& frame);
     void handle_handshake(const NetworkMessage& msg, const std::string& peer_address);
-    void handle_new_transaction(const NetworkMessage& msg);
-    void handle_new_block(const NetworkMessage& msg);
-    void handle_request_chain(const NetworkMessage& msg);
-    void handle_response_chain(const NetworkMessage& msg);
+    void handle_handshake(const PeerConnection::pointer& peer, const NetworkMessage& msg);
+    NetworkMessage make_handshake() const;
+    void handle_new_transaction(const std::string& peer_id, const NetworkMessage& msg);
+    void handle_inventory(const std::string& peer_id, const NetworkMessage& msg, const Reply& reply);
+    void handle_get_transactions(const NetworkMessage& msg, const Reply& reply);
+    void handle_transactions(const std::string& peer_id, const NetworkMessage& msg);
+    void announce_transactions(const std::vector<std::string>& transaction_ids, const std::string& exclude_peer = "");
+    void flush_relay();
+    void arm_relay_timer();  // With relay_mutex_ held
+    void retry_transaction_requests();
+    void handle_new_block(const std::string& peer_id, const NetworkMessage& msg);
+    void handle_get_headers(const NetworkMessage& msg, const Reply& reply);
+    void handle_headers(const std::string& peer_id, const NetworkMessage& msg);
+    void handle_get_blocks(const NetworkMessage& msg, const Reply& reply);
+    void handle_blocks(const std::string& peer_id, const NetworkMessage& msg);
+    void handle_get_snapshot_manifest(const NetworkMessage& msg, const Reply& reply);
+    void handle_snapshot_manifest(const std::string& peer_id, const NetworkMessage& msg);
+    void handle_get_snapshot_chunk(const NetworkMessage& msg, const Reply& reply);
+    void handle_snapshot_chunk(const std::string& peer_id, const NetworkMessage& msg);
+    std::shared_ptr<const StateSnapshot> current_state_snapshot();
+    std::shared_ptr<const StateSnapshot> find_state_snapshot(const std::string& state_root) const;
+    void start_sync();  // Snapshot first when far behind, then blocks
     void handle_sync_request(const NetworkMessage& msg);
     void handle_sync_response(const NetworkMessage& msg);
     
     // Utility functions
+    NetworkMessage make_message(MessageType type, std::string payload) const;
     void broadcast_message(const NetworkMessage& msg, const std::string& exclude_peer = "");
     std::string serialize_message(const NetworkMessage& msg);
     NetworkMessage deserialize_message(const std::string& data);
     void accept_connection();
+    void register_connection(const PeerConnection::pointer& connection);
+    void handle_connection_closed(const PeerConnection::pointer& connection);
+    std::vector<PeerConnection::pointer> open_connections() const;
     bool is_chain_longer(const std::vector<Block>& other_chain) const;
 };
 
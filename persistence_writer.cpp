@@ -0,0 +1,275 @@
+#include "persistence_writer.hpp"
+#include "utils/logger.hpp"
+#include "utils/metrics.hpp"
+#include <algorithm>
+
+namespace {
+
+metrics::Gauge& queue_depth() {
+    static metrics::Gauge& gauge = metrics::gauge("persistence_queue_depth",
+        "Writes waiting for the persistence writer");
+    return gauge;
+}
+
+} // namespace
+
+PersistenceWriter::PersistenceWriter(PersistentStore& store) : store_(store) {}
+
+PersistenceWriter::~PersistenceWriter() {
+    stop();
+}
+
+// ============= QUEUEING =============
+
+void PersistenceWriter::enqueue_block(size_t height, Producer record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.blocks.emplace_back(height, std::move(record));
+    queue_depth().add(1);
+    wake();
+}
+
+bool PersistenceWriter::Batch::add_contract(json contract_json) {
+    // A newer export of the same contract replaces the queued one
+    std::string address = contract_json.value("address", "");
+    auto slot = contract_slots.find(address);
+    if (slot != contract_slots.end()) {
+        contracts[slot->second] = std::move(contract_json);
+        return false;
+    }
+    contract_slots[address] = contracts.size();
+    contracts.push_back(std::move(contract_json));
+    return true;
+}
+
+void PersistenceWriter::Batch::drop_blocks_below(size_t height) {
+    blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+                                [height](const auto& block) { return block.first < height; }),
+                 blocks.end());
+}
+
+void PersistenceWriter::enqueue_contract(json contract_json) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.add_contract(std::move(contract_json))) {
+        queue_depth().add(1);
+    }
+    wake();
+}
+
+void PersistenceWriter::enqueue_checkpoint(Producer checkpoint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Only the newest state is worth writing
+    if (!pending_.checkpoint) {
+        queue_depth().add(1);
+    }
+    pending_.checkpoint = std::move(checkpoint);
+    wake();
+}
+
+void PersistenceWriter::enqueue_rewrite(std::vector<json> blocks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double before = static_cast<double>(pending_.size());
+    pending_.drop_blocks_below(blocks.size());
+    pending_.rewrite = std::move(blocks);
+    queue_depth().add(static_cast<double>(pending_.size()) - before);
+    wake();
+}
+
+void PersistenceWriter::enqueue_task(Task task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.tasks.push_back(std::move(task));
+    queue_depth().add(1);
+    wake();
+}
+
+void PersistenceWriter::wake() {
+    ++queued_sequence_;
+    if (!thread_.joinable()) {
+        // Started on first use, and again after stop()
+        stopping_ = false;
+        thread_ = std::thread([this]() { run(); });
+    }
+    work_cv_.notify_one();
+}
+
+bool PersistenceWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = queued_sequence_;
+    done_cv_.wait(lock, [&]() { return committed_sequence_ >= target; });
+    bool ok = !failed_;
+    failed_ = false;
+    return ok;
+}
+
+void PersistenceWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void PersistenceWriter::set_committed_blocks(size_t blocks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    committed_blocks_ = blocks;
+    double before = static_cast<double>(pending_.size());
+    pending_.drop_blocks_below(blocks);
+    queue_depth().add(static_cast<double>(pending_.size()) - before);
+}
+
+size_t PersistenceWriter::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+// ============= WRITER THREAD =============
+
+void PersistenceWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+        if (retry_delay_.count() > 0 && !stopping_) {
+            // Back off after a failure; anything queued meanwhile joins the retry
+            work_cv_.wait_for(lock, retry_delay_, [this]() { return stopping_; });
+        }
+        if (pending_.empty()) {
+            break;  // Stopping with nothing left to write
+        }
+        Batch batch = std::move(pending_);
+        pending_ = Batch();
+        uint64_t sequence = queued_sequence_;
+        queue_depth().add(-static_cast<double>(batch.size()));
+        lock.unlock();
+
+        bool ok = commit(batch);
+
+        lock.lock();
+        if (ok) {
+            retry_delay_ = std::chrono::milliseconds(0);
+        } else if (stopping_) {
+            LOG_ERROR("PersistenceWriter", "Stopping with " + std::to_string(batch.size()) +
+                      " unwritten records (" + std::to_string(batch.blocks.size()) + " blocks)");
+        } else {
+            requeue(batch);
+            retry_delay_ = std::min(MAX_RETRY_DELAY, std::max(MIN_RETRY_DELAY, retry_delay_ * 2));
+        }
+        failed_ = failed_ || !ok;
+        committed_sequence_ = sequence;
+        done_cv_.notify_all();
+    }
+}
+
+void PersistenceWriter::requeue(Batch& failed) {
+    // The failed work is older than anything queued since, so it goes first
+    double before = static_cast<double>(pending_.size());
+    Batch merged;
+    merged.rewrite = pending_.rewrite ? std::move(pending_.rewrite) : std::move(failed.rewrite);
+    merged.blocks = std::move(failed.blocks);
+    merged.blocks.insert(merged.blocks.end(), std::make_move_iterator(pending_.blocks.begin()),
+                         std::make_move_iterator(pending_.blocks.end()));
+    merged.drop_blocks_below(pending_.rewrite ? merged.rewrite->size() : committed_blocks_.load());
+    for (auto& contract_json : failed.contracts) {
+        merged.add_contract(std::move(contract_json));
+    }
+    for (auto& contract_json : pending_.contracts) {
+        merged.add_contract(std::move(contract_json));
+    }
+    merged.checkpoint = pending_.checkpoint ? std::move(pending_.checkpoint) : std::move(failed.checkpoint);
+    merged.tasks = std::move(failed.tasks);
+    merged.tasks.insert(merged.tasks.end(), std::make_move_iterator(pending_.tasks.begin()),
+                        std::make_move_iterator(pending_.tasks.end()));
+    pending_ = std::move(merged);
+    queue_depth().add(static_cast<double>(pending_.size()) - before);
+}
+
+bool PersistenceWriter::commit(Batch& batch) {
+    static metrics::Histogram& latency = metrics::histogram("storage_write_seconds",
+        "Latency of durable writes", {{"kind", "batch"}});
+    static metrics::Counter& batches = metrics::counter("persistence_batches_total",
+        "Batches committed by the persistence writer");
+    metrics::ScopedTimer timer(latency);
+    bool sync = durability_ == PersistDurability::FSYNC_BATCH;
+
+    try {
+        // 0. A rewrite replaces whatever the log held; queued blocks continue it
+        bool blocks_ok = true;
+        if (batch.rewrite) {
+            blocks_ok = store_.save_blocks(*batch.rewrite);
+            if (blocks_ok) {
+                committed_blocks_ = batch.rewrite->size();
+                batch.drop_blocks_below(batch.rewrite->size());
+                batch.rewrite.reset();
+                gap_logged_ = false;
+            }
+        }
+
+        // 1. Block records; they must continue the stored chain
+        if (blocks_ok && !batch.blocks.empty()) {
+            size_t first = batch.blocks.front().first;
+            size_t stored = static_cast<size_t>(store_.get_block_count());
+            if (stored > first) {
+                // Everything below `first` is ours; the records past it are not
+                LOG_WARN("PersistenceWriter", "Block log holds " + std::to_string(stored) +
+                         " blocks, expected " + std::to_string(first) + " - replacing the records past it");
+                if (!store_.truncate_blocks(first)) {
+                    blocks_ok = false;
+                }
+                stored = static_cast<size_t>(store_.get_block_count());
+            }
+            if (blocks_ok && stored < first) {
+                // Missing records only the chain can supply; kept until save_blockchain_state() rewrites the log
+                if (!gap_logged_) {
+                    LOG_WARN("PersistenceWriter", "Block log holds " + std::to_string(stored) +
+                             " blocks, expected " + std::to_string(first) + " - new blocks wait for a rewrite");
+                    gap_logged_ = true;
+                }
+                blocks_ok = false;
+            } else if (blocks_ok) {
+                std::vector<json> records;
+                records.reserve(batch.blocks.size());
+                for (auto& [height, record] : batch.blocks) {
+                    records.push_back(record());
+                }
+                blocks_ok = store_.append_blocks(records, sync);
+                if (blocks_ok) {
+                    committed_blocks_ = first + records.size();
+                    gap_logged_ = false;
+                    batch.blocks.clear();
+                }
+            }
+        }
+
+        // 2. Contracts
+        bool contracts_ok = batch.contracts.empty() || store_.update_contracts(batch.contracts, sync);
+        if (contracts_ok) {
+            batch.contracts.clear();
+            batch.contract_slots.clear();
+        }
+
+        // 3. The checkpoint, never ahead of the blocks it names
+        bool checkpoint_ok = true;
+        if (batch.checkpoint) {
+            checkpoint_ok = blocks_ok && store_.save_state_checkpoint(batch.checkpoint(), sync);
+            if (checkpoint_ok) {
+                batch.checkpoint = nullptr;
+            }
+        }
+
+        // 4. Follow-up work that relies on everything above being on disk
+        if (blocks_ok && checkpoint_ok) {
+            for (auto& task : batch.tasks) {
+                task();
+            }
+            batch.tasks.clear();
+        }
+
+        batches.inc();
+        ++batches_;
+        return blocks_ok && contracts_ok && checkpoint_ok;
+    } catch (const std::exception& e) {
+        LOG_ERROR("PersistenceWriter", "Batch failed: " + std::string(e.what()));
+        return false;
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef PERSISTENCE_WRITER_HPP
+#define PERSISTENCE_WRITER_HPP
+
+#include "persistent_store.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// How far a committed batch is pushed before the next one starts
+enum class PersistDurability {
+    NONE,         // Written to the OS; survives a process crash, not a power loss
+    FSYNC_BATCH   // Each step of a batch fsynced before the next is written
+};
+
+/**
+ * PersistenceWriter - Background thread that group-commits writes to a PersistentStore
+ *
+ * Mining, block acceptance and contract deployment queue their writes here
+ * and return without touching the disk. The writer takes everything queued
+ * since its last commit as one batch and writes it in crash-consistent order:
+ *
+ *   0. a queued rewrite of the whole block log, if any
+ *   1. block records, one append to the block log
+ *   2. contracts, one atomic rewrite of contracts.json
+ *   3. the state checkpoint, atomically replaced
+ *   4. follow-up tasks (pruning), only if the steps above succeeded
+ *
+ * A checkpoint therefore never names a block that is not on disk, and a crash
+ * between steps leaves blocks past the checkpoint, which loading replays.
+ * Queued contracts are coalesced by address and only the newest queued
+ * checkpoint is written. Records are serialised on the writer thread.
+ *
+ * Work a batch could not write stays queued, ahead of anything newer, and is
+ * retried with a growing delay. If the block log holds more records than
+ * the first queued block expects, the extra records are not ours (another
+ * chain, or a tail the loader could not decode) and are truncated before
+ * the append. Records are only given up at stop(). The writer is the only
+ * thread that writes blocks, so a rewrite cannot race a retried append.
+ */
+class PersistenceWriter {
+public:
+    using Producer = std::function<json()>;  // Builds a record on the writer thread
+    using Task = std::function<void()>;
+
+    explicit PersistenceWriter(PersistentStore& store);
+    ~PersistenceWriter();  // Commits everything queued, then stops
+
+    PersistenceWriter(const PersistenceWriter&) = delete;
+    PersistenceWriter& operator=(const PersistenceWriter&) = delete;
+
+    // Record of the block at `height` (0-based); blocks are queued in chain order
+    void enqueue_block(size_t height, Producer record);
+    void enqueue_contract(json contract_json);
+    void enqueue_checkpoint(Producer checkpoint);
+    // Replace the block log with `blocks`; queued blocks below its end are dropped
+    void enqueue_rewrite(std::vector<json> blocks);
+    void enqueue_task(Task task);
+
+    // Wait until everything queued so far is committed; false if a batch failed since the last flush
+    bool flush();
+    void stop();
+
+    void set_durability(PersistDurability durability) { durability_ = durability; }
+    PersistDurability get_durability() const { return durability_; }
+
+    // Blocks known to be in the store, in chain order. Setting it drops queued
+    // blocks below `blocks`, which the caller has written itself.
+    size_t committed_blocks() const { return committed_blocks_; }
+    void set_committed_blocks(size_t blocks);
+
+    uint64_t batches_committed() const { return batches_; }
+    size_t queued() const;
+
+private:
+    struct Batch {
+        std::optional<std::vector<json>> rewrite;
+        std::vector<std::pair<size_t, Producer>> blocks;
+        std::vector<json> contracts;
+        std::unordered_map<std::string, size_t> contract_slots;  // Address -> position in contracts
+        Producer checkpoint;
+        std::vector<Task> tasks;
+
+        bool empty() const { return !rewrite && blocks.empty() && contracts.empty() && !checkpoint && tasks.empty(); }
+        size_t size() const {
+            return (rewrite ? 1 : 0) + blocks.size() + contracts.size() + (checkpoint ? 1 : 0) + tasks.size();
+        }
+        bool add_contract(json contract_json);  // False if it replaced a queued export
+        void drop_blocks_below(size_t height);
+    };
+
+    static constexpr std::chrono::milliseconds MIN_RETRY_DELAY{100};
+    static constexpr std::chrono::milliseconds MAX_RETRY_DELAY{5000};
+
+    PersistentStore& store_;
+    std::atomic<PersistDurability> durability_{PersistDurability::NONE};
+    std::atomic<size_t> committed_blocks_{0};
+    std::atomic<uint64_t> batches_{0};
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    Batch pending_;
+    uint64_t queued_sequence_ = 0;     // Bumped by every enqueue
+    uint64_t committed_sequence_ = 0;  // Last enqueue covered by a finished batch
+    bool failed_ = false;              // A batch failed since the last flush()
+    bool gap_logged_ = false;          // Writer thread only
+    std::chrono::milliseconds retry_delay_{0};  // Writer thread only; zero while batches succeed
+    bool stopping_ = false;
+    std::thread thread_;
+
+    void wake();  // After queueing, with mutex_ held
+    void run();
+    // Whatever was written is removed from `batch`; the rest is left for a retry
+    bool commit(Batch& batch);
+    void requeue(Batch& failed);  // With mutex_ held
+};
+
+#endif // PERSISTENCE_WRITER_HPP
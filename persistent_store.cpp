@@ -1,9 +1,14 @@
 #include "persistent_store.hpp"
 #include "utils/logger.hpp"
+#include "utils/metrics.hpp"
+#include "utils/crc32.hpp"
+#include "utils/file_sync.hpp"
+#include <cstdio>
 #include <iostream>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <cstring>
+#include <unordered_map>
 
 PersistentStore::PersistentStore(const std::string& storage_dir)
     : storage_dir_(storage_dir) {
@@ -11,12 +16,16 @@ PersistentStore::PersistentStore(const std::string& storage_dir)
     blocks_file_ = storage_dir_ + "/blocks.json";
     contracts_file_ = storage_dir_ + "/contracts.json";
     state_file_ = storage_dir_ + "/state.json";
+    checkpoint_file_ = storage_dir_ + "/checkpoint.dat";
     
     if (!ensure_directory_exists()) {
         std::cerr << "Warning: Failed to create storage directory: " << storage_dir_ << std::endl;
     } else {
         std::cerr << "Storage initialized at: " << storage_dir_ << std::endl;
     }
+    
+    block_log_ = std::make_unique<BlockLog>(storage_dir_);
+    migrate_legacy_blocks();
 }
 
 PersistentStore::~PersistentStore() {
@@ -42,28 +51,83 @@ bool PersistentStore::file_exists(const std::string& path) const {
     return (stat(path.c_str(), &buffer) == 0);
 }
 
-bool PersistentStore::save_block(const json& block_json) {
+void PersistentStore::migrate_legacy_blocks() {
+    // One-time import of a pre-existing blocks.json into the block log. The marker
+    // exists while an import is under way, so one cut short is redone from scratch.
+    std::string marker = blocks_file_ + ".importing";
+    bool interrupted = file_exists(marker);
+    if ((!block_log_->empty() && !interrupted) || !file_exists(blocks_file_)) {
+        return;
+    }
+    
     try {
-        std::vector<json> blocks = load_blocks();
-        blocks.push_back(block_json);
-        
-        std::ofstream f(blocks_file_);
-        f << json(blocks).dump(4);
+        std::ifstream f(blocks_file_);
+        json data;
+        f >> data;
         f.close();
         
-        // Block saved successfully
-        return true;
+        if (!data.is_array()) {
+            return;
+        }
+        std::ofstream(marker).close();
+        if (!sync_path(marker) || !sync_path(storage_dir_)) {
+            LOG_WARN("PersistentStore", "Could not create import marker: " + marker);
+            return;
+        }
+        if (interrupted) {
+            LOG_WARN("PersistentStore", "Previous import of legacy blocks.json did not finish - importing again");
+            block_log_->reset();
+        }
+        std::vector<std::vector<uint8_t>> records;
+        records.reserve(data.size());
+        for (const auto& block_json : data) {
+            records.push_back(json::to_cbor(block_json));
+        }
+        if (!block_log_->append_batch(records, true)) {
+            LOG_WARN("PersistentStore", "Could not migrate legacy blocks file; retrying on next start");
+            return;
+        }
+        std::remove(marker.c_str());
+        sync_path(storage_dir_);
+        LOG_INFO("PersistentStore", "Migrated " + std::to_string(data.size()) + 
+                 " blocks from legacy blocks.json into the block log");
+    } catch (const std::exception& e) {
+        LOG_WARN("PersistentStore", "Could not migrate legacy blocks file: " + std::string(e.what()));
+    }
+}
+
+bool PersistentStore::save_block(const json& block_json) {
+    try {
+        return block_log_->append(json::to_cbor(block_json));
     } catch (const std::exception& e) {
         std::cerr << "Error saving block: " << e.what() << std::endl;
         return false;
     }
 }
 
+bool PersistentStore::append_blocks(const std::vector<json>& blocks_json, bool sync) {
+    try {
+        std::vector<std::vector<uint8_t>> records;
+        records.reserve(blocks_json.size());
+        for (const auto& block_json : blocks_json) {
+            records.push_back(json::to_cbor(block_json));
+        }
+        return block_log_->append_batch(records, sync);
+    } catch (const std::exception& e) {
+        LOG_WARN("PersistentStore", "Error saving blocks: " + std::string(e.what()));
+        return false;
+    }
+}
+
 bool PersistentStore::save_blocks(const std::vector<json>& blocks_json) {
     try {
-        std::ofstream f(blocks_file_);
-        f << json(blocks_json).dump(4);
-        f.close();
+        // Full replacement of the stored chain
+        block_log_->reset();
+        for (const auto& block_json : blocks_json) {
+            if (!block_log_->append(json::to_cbor(block_json))) {
+                return false;
+            }
+        }
         
         std::cerr << "Saved " << blocks_json.size() << " blocks to storage" << std::endl;
         return true;
@@ -76,19 +140,16 @@ bool PersistentStore::save_blocks(const std::vector<json>& blocks_json) {
 std::vector<json> PersistentStore::load_blocks() const {
     std::vector<json> blocks;
     
-    if (!file_exists(blocks_file_)) {
-        LOG_DEBUG("PersistentStore", "No blocks file found - starting fresh");
+    if (block_log_->empty()) {
+        LOG_DEBUG("PersistentStore", "No stored blocks found - starting fresh");
         return blocks;
     }
     
     try {
-        std::ifstream f(blocks_file_);
-        json data;
-        f >> data;
-        f.close();
-        
-        if (data.is_array()) {
-            blocks = data.get<std::vector<json>>();
+        auto records = block_log_->read_all();
+        blocks.reserve(records.size());
+        for (const auto& record : records) {
+            blocks.push_back(json::from_cbor(record));
         }
         
         LOG_INFO("PersistentStore", "Loaded " + std::to_string(blocks.size()) + 
@@ -100,6 +161,99 @@ std::vector<json> PersistentStore::load_blocks() const {
     return blocks;
 }
 
+bool PersistentStore::load_block(size_t height, json& block_json) const {
+    std::vector<uint8_t> record;
+    if (!block_log_->read(height, record)) {
+        return false;
+    }
+    
+    try {
+        block_json = json::from_cbor(record);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("PersistentStore", "Error decoding block " + std::to_string(height) + 
+                 ": " + std::string(e.what()));
+        return false;
+    }
+}
+
+std::vector<std::vector<uint8_t>> PersistentStore::load_block_records(size_t first, size_t count) const {
+    return block_log_->read_range(first, count);
+}
+
+bool PersistentStore::truncate_blocks(size_t count) {
+    return block_log_->truncate(count);
+}
+
+std::string PersistentStore::set_aside_blocks(size_t count) {
+    std::string base = storage_dir_ + "/unreplayed_blocks_" + std::to_string(count);
+    std::string path = base + ".json";
+    for (int n = 1; file_exists(path); ++n) {
+        path = base + "_" + std::to_string(n) + ".json";  // Never replace an earlier side file
+    }
+    try {
+        json blocks = json::array();
+        for (const auto& record : block_log_->read_range(count, SIZE_MAX)) {
+            blocks.push_back(json::from_cbor(record));
+        }
+        
+        // The side file is on disk before the records leave the log
+        std::string temp_file = path + ".tmp";
+        std::ofstream f(temp_file, std::ios::trunc);
+        f << blocks.dump(4);
+        f.close();
+        if (!f || !sync_path(temp_file) || std::rename(temp_file.c_str(), path.c_str()) != 0 ||
+            !sync_path(storage_dir_)) {
+            LOG_WARN("PersistentStore", "Failed to write " + path);
+            return std::string();
+        }
+        if (!block_log_->truncate(count)) {
+            return std::string();
+        }
+        LOG_WARN("PersistentStore", "Moved " + std::to_string(blocks.size()) + " stored blocks past #" +
+                 std::to_string(count) + " to " + path);
+        return path;
+    } catch (const std::exception& e) {
+        LOG_WARN("PersistentStore", "Error setting aside blocks: " + std::string(e.what()));
+        return std::string();
+    }
+}
+
+size_t PersistentStore::rewrite_blocks(size_t first, size_t end, const BlockRewrite& rewrite) {
+    return block_log_->rewrite_sealed(first, end,
+        [&rewrite](size_t record, const std::vector<uint8_t>& payload, std::vector<uint8_t>& replacement) {
+            try {
+                json block_json = json::from_cbor(payload);
+                if (!rewrite(record, block_json)) {
+                    return false;
+                }
+                replacement = json::to_cbor(block_json);
+                return true;
+            } catch (const std::exception& e) {
+                LOG_WARN("PersistentStore", "Error rewriting block " + std::to_string(record) +
+                         ": " + std::string(e.what()));
+                return false;
+            }
+        });
+}
+
+bool PersistentStore::export_blocks_json(const std::string& path) const {
+    std::string target = path.empty() ? blocks_file_ : path;
+    try {
+        std::vector<json> blocks = load_blocks();
+        
+        std::ofstream f(target);
+        f << json(blocks).dump(4);
+        f.close();
+        
+        std::cerr << "Exported " << blocks.size() << " blocks to: " << target << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error exporting blocks: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 bool PersistentStore::save_contract(const json& contract_json) {
     try {
         std::vector<json> contracts = load_contracts();
@@ -131,6 +285,51 @@ bool PersistentStore::save_contracts(const std::vector<json>& contracts_json) {
     }
 }
 
+bool PersistentStore::update_contracts(const std::vector<json>& contracts_json, bool sync) {
+    static metrics::Histogram& latency = metrics::histogram("storage_write_seconds",
+        "Latency of durable writes", {{"kind", "contracts"}});
+    metrics::ScopedTimer timer(latency);
+    try {
+        // Replace stored entries by address, keeping the file's order
+        json stored = json::array();
+        if (file_exists(contracts_file_)) {
+            std::ifstream in(contracts_file_);
+            in >> stored;
+            if (!stored.is_array()) {
+                stored = json::array();
+            }
+        }
+        std::unordered_map<std::string, size_t> positions;
+        for (size_t i = 0; i < stored.size(); ++i) {
+            positions[stored[i].value("address", "")] = i;
+        }
+        for (const auto& contract_json : contracts_json) {
+            auto it = positions.find(contract_json.value("address", ""));
+            if (it != positions.end()) {
+                stored[it->second] = contract_json;
+            } else {
+                positions[contract_json.value("address", "")] = stored.size();
+                stored.push_back(contract_json);
+            }
+        }
+        
+        std::string temp_file = contracts_file_ + ".tmp";
+        std::ofstream f(temp_file, std::ios::trunc);
+        f << stored.dump(4);
+        f.close();
+        if (!f || (sync && !sync_path(temp_file)) ||
+            std::rename(temp_file.c_str(), contracts_file_.c_str()) != 0 ||
+            (sync && !sync_path(storage_dir_))) {
+            LOG_WARN("PersistentStore", "Failed to write contracts");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("PersistentStore", "Error saving contracts: " + std::string(e.what()));
+        return false;
+    }
+}
+
 std::vector<json> PersistentStore::load_contracts() const {
     std::vector<json> contracts;
     
@@ -158,6 +357,9 @@ std::vector<json> PersistentStore::load_contracts() const {
 }
 
 bool PersistentStore::save_account_state(const json& state_json) {
+    static metrics::Histogram& latency = metrics::histogram("storage_write_seconds",
+        "Latency of durable writes", {{"kind", "account_state"}});
+    metrics::ScopedTimer timer(latency);
     try {
         std::ofstream f(state_file_);
         f << state_json.dump(4);
@@ -191,6 +393,76 @@ json PersistentStore::load_account_state() {
     }
 }
 
+bool PersistentStore::save_state_checkpoint(const json& checkpoint, bool sync) {
+    static metrics::Histogram& latency = metrics::histogram("storage_write_seconds",
+        "Latency of durable writes", {{"kind", "checkpoint"}});
+    metrics::ScopedTimer timer(latency);
+    try {
+        // [u32 length][u32 crc32][CBOR], written beside the old file and renamed over it
+        std::vector<uint8_t> payload = json::to_cbor(checkpoint);
+        uint8_t header[8];
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        uint32_t checksum = crc32(payload.data(), payload.size());
+        for (int i = 0; i < 4; ++i) {
+            header[i] = static_cast<uint8_t>(length >> (8 * i));
+            header[4 + i] = static_cast<uint8_t>(checksum >> (8 * i));
+        }
+        
+        std::string temp_file = checkpoint_file_ + ".tmp";
+        std::ofstream f(temp_file, std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char*>(header), sizeof(header));
+        f.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+        f.close();
+        if (!f || (sync && !sync_path(temp_file)) ||
+            std::rename(temp_file.c_str(), checkpoint_file_.c_str()) != 0 ||
+            (sync && !sync_path(storage_dir_))) {
+            LOG_WARN("PersistentStore", "Failed to write state checkpoint");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("PersistentStore", "Error saving state checkpoint: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool PersistentStore::load_state_checkpoint(json& checkpoint) const {
+    std::ifstream f(checkpoint_file_, std::ios::binary);
+    if (!f.is_open()) {
+        return false;
+    }
+    
+    uint8_t header[8];
+    f.read(reinterpret_cast<char*>(header), sizeof(header));
+    uint32_t length = 0;
+    uint32_t checksum = 0;
+    for (int i = 0; i < 4; ++i) {
+        length |= static_cast<uint32_t>(header[i]) << (8 * i);
+        checksum |= static_cast<uint32_t>(header[4 + i]) << (8 * i);
+    }
+    // The length is unverified until the checksum matches; it must fit the file
+    struct stat st = {};
+    if (!f || stat(checkpoint_file_.c_str(), &st) != 0 ||
+        static_cast<uint64_t>(st.st_size) < sizeof(header) + static_cast<uint64_t>(length)) {
+        LOG_WARN("PersistentStore", "State checkpoint is damaged - ignoring it");
+        return false;
+    }
+    std::vector<uint8_t> payload(length);
+    f.read(reinterpret_cast<char*>(payload.data()), payload.size());
+    if (!f || crc32(payload.data(), payload.size()) != checksum) {
+        LOG_WARN("PersistentStore", "State checkpoint is damaged - ignoring it");
+        return false;
+    }
+    
+    try {
+        checkpoint = json::from_cbor(payload);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("PersistentStore", "Error decoding state checkpoint: " + std::string(e.what()));
+        return false;
+    }
+}
+
 bool PersistentStore::export_blockchain_state(const json& full_state) {
     try {
         std::string export_file = storage_dir_ + "/blockchain_export.json";
@@ -230,9 +502,12 @@ json PersistentStore::import_blockchain_state() {
 
 void PersistentStore::clear_all_data() {
     try {
+        block_log_->reset();
         std::remove(blocks_file_.c_str());
+        std::remove((blocks_file_ + ".importing").c_str());
         std::remove(contracts_file_.c_str());
         std::remove(state_file_.c_str());
+        std::remove(checkpoint_file_.c_str());
         std::cerr << "All data cleared from storage" << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "Error clearing data: " << e.what() << std::endl;
@@ -240,25 +515,25 @@ void PersistentStore::clear_all_data() {
 }
 
 bool PersistentStore::has_saved_data() const {
-    return file_exists(blocks_file_) || file_exists(contracts_file_) || 
-           file_exists(state_file_);
+    return !block_log_->empty() || file_exists(contracts_file_) || 
+           file_exists(state_file_) || file_exists(checkpoint_file_);
 }
 
-int PersistentStore::get_block_count() {
-    return load_blocks().size();
+int PersistentStore::get_block_count() const {
+    return static_cast<int>(block_log_->count());
 }
 
 int PersistentStore::get_contract_count() {
     return load_contracts().size();
 }
 
-size_t PersistentStore::get_total_storage_size() {
-    size_t total = 0;
+size_t PersistentStore::get_total_storage_size() const {
+    size_t total = block_log_->disk_bytes();
     struct stat st = {};
     
-    if (stat(blocks_file_.c_str(), &st) == 0) total += st.st_size;
     if (stat(contracts_file_.c_str(), &st) == 0) total += st.st_size;
     if (stat(state_file_.c_str(), &st) == 0) total += st.st_size;
+    if (stat(checkpoint_file_.c_str(), &st) == 0) total += st.st_size;
     
     return total;
 }
@@ -5,7 +5,10 @@
 #include <vector>
 #include <memory>
 #include <fstream>
+#include <functional>
+#include <cstdint>
 #include <nlohmann/json.hpp>
+#include "block_log.hpp"
 
 using json = nlohmann::json;
 
@@ -17,31 +20,57 @@ class SmartContract;
 class PersistentStore {
 private:
     std::string storage_dir_;
-    std::string blocks_file_;
+    std::string blocks_file_;      // Legacy JSON chain (import on first open, export target)
     std::string contracts_file_;
     std::string state_file_;
+    std::string checkpoint_file_;  // Account state tagged with the height it belongs to
+    std::unique_ptr<BlockLog> block_log_;  // Append-only binary block storage
     
     bool ensure_directory_exists();
     bool file_exists(const std::string& path) const;
+    void migrate_legacy_blocks();
 
 public:
     PersistentStore(const std::string& storage_dir = "./blockchain_data");
     ~PersistentStore();
     
-    // Block operations
+    // Block operations (O(1) append to the block log)
     bool save_block(const json& block_json);
+    // Append several blocks in one write; `sync` fsyncs them before returning
+    bool append_blocks(const std::vector<json>& blocks_json, bool sync = false);
     bool save_blocks(const std::vector<json>& blocks_json);
     std::vector<json> load_blocks() const;
+    bool load_block(size_t height, json& block_json) const;
+    // Undecoded CBOR records in chain order, for callers that decode in parallel
+    std::vector<std::vector<uint8_t>> load_block_records(size_t first = 0, size_t count = SIZE_MAX) const;
+    // Drop every stored block after the first `count`
+    bool truncate_blocks(size_t count);
+    // Move the stored blocks after the first `count` into a JSON side file, then
+    // truncate them from the log; returns the file's path, empty if nothing moved
+    std::string set_aside_blocks(size_t count);
+    // Rewrite stored blocks below `end` through `rewrite`, whole sealed segments
+    // at a time; returns the height below which all have been rewritten
+    using BlockRewrite = std::function<bool(size_t height, json& block_json)>;
+    size_t rewrite_blocks(size_t first, size_t end, const BlockRewrite& rewrite);
+    
+    // Export the block log as the legacy JSON array (blocks.json by default)
+    bool export_blocks_json(const std::string& path = "") const;
     
     // Contract operations
     bool save_contract(const json& contract_json);
     bool save_contracts(const std::vector<json>& contracts_json);
+    // Insert or replace contracts by address with one atomic rewrite of the file
+    bool update_contracts(const std::vector<json>& contracts_json, bool sync = false);
     std::vector<json> load_contracts() const;
     
     // Account state
     bool save_account_state(const json& state_json);
     json load_account_state();
     
+    // State checkpoint: replaced atomically, checksummed, false if absent or damaged
+    bool save_state_checkpoint(const json& checkpoint, bool sync = false);
+    bool load_state_checkpoint(json& checkpoint) const;
+    
     // General export/import
     bool export_blockchain_state(const json& full_state);
     json import_blockchain_state();
@@ -52,9 +81,9 @@ public:
     std::string get_storage_dir() const { return storage_dir_; }
     
     // Statistics
-    int get_block_count();
+    int get_block_count() const;
     int get_contract_count();
-    size_t get_total_storage_size();
+    size_t get_total_storage_size() const;
 };
 
 #endif // PERSISTENT_STORE_HPP
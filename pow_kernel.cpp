@@ -0,0 +1,340 @@
+#include "pow_kernel.hpp"
+#include <openssl/sha.h>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define POW_KERNEL_X86 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+namespace {
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+constexpr uint32_t MESSAGE_BITS = 72 * 8;  // Total digest input length
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t load_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline void store_le64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+inline void store_le32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+// Per-nonce second block: nonce, then padding for a 72-byte message
+inline void build_nonce_block(long long nonce, uint8_t block[64]) {
+    std::memset(block, 0, 64);
+    store_le64(block, static_cast<uint64_t>(nonce));
+    block[8] = 0x80;
+    block[62] = static_cast<uint8_t>(MESSAGE_BITS >> 8);
+    block[63] = static_cast<uint8_t>(MESSAGE_BITS & 0xFF);
+}
+
+void compress_scalar(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = load_be32(block + 4 * i);
+    }
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; ++i) {
+        uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + S1 + ch + K[i] + w[i];
+        uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = S0 + maj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+#ifdef POW_KERNEL_X86
+
+__attribute__((target("sha,sse4.1,ssse3")))
+void compress_shani(uint32_t state[8], const uint8_t block[64]) {
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);                 // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);           // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);   // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);        // CDGH
+
+    const __m128i abef_save = state0;
+    const __m128i cdgh_save = state1;
+
+    __m128i msg[4];
+    for (int i = 0; i < 4; ++i) {
+        msg[i] = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i)), MASK);
+    }
+
+    // 16 groups of four rounds; msg[] holds a rolling window of the schedule
+    for (int i = 0; i < 16; ++i) {
+        __m128i w;
+        if (i < 4) {
+            w = msg[i];
+        } else {
+            __m128i prev1 = msg[(i - 1) & 3];
+            __m128i prev2 = msg[(i - 2) & 3];
+            w = _mm_sha256msg1_epu32(msg[i & 3], msg[(i - 3) & 3]);
+            w = _mm_add_epi32(w, _mm_alignr_epi8(prev1, prev2, 4));
+            w = _mm_sha256msg2_epu32(w, prev1);
+            msg[i & 3] = w;
+        }
+
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[4 * i]));
+        __m128i m = _mm_add_epi32(w, k);
+        state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+        m = _mm_shuffle_epi32(m, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, m);
+    }
+
+    state0 = _mm_add_epi32(state0, abef_save);
+    state1 = _mm_add_epi32(state1, cdgh_save);
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);              // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);           // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);        // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);           // HGFE
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+#define AVX2_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+
+// Eight nonce blocks from one shared midstate; out[word][lane]
+__attribute__((target("avx2")))
+void compress_nonces_x8_avx2(const uint32_t midstate[8], const long long nonces[8], uint32_t out[8][8]) {
+    alignas(32) uint32_t lo[8];
+    alignas(32) uint32_t hi[8];
+    for (int lane = 0; lane < 8; ++lane) {
+        uint8_t bytes[8];
+        store_le64(bytes, static_cast<uint64_t>(nonces[lane]));
+        lo[lane] = load_be32(bytes);
+        hi[lane] = load_be32(bytes + 4);
+    }
+
+    __m256i w[64];
+    w[0] = _mm256_load_si256(reinterpret_cast<const __m256i*>(lo));
+    w[1] = _mm256_load_si256(reinterpret_cast<const __m256i*>(hi));
+    w[2] = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    for (int i = 3; i < 15; ++i) {
+        w[i] = _mm256_setzero_si256();
+    }
+    w[15] = _mm256_set1_epi32(static_cast<int>(MESSAGE_BITS));
+
+    for (int i = 16; i < 64; ++i) {
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(w[i - 15], 7), AVX2_ROTR(w[i - 15], 18)),
+                                      _mm256_srli_epi32(w[i - 15], 3));
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(w[i - 2], 17), AVX2_ROTR(w[i - 2], 19)),
+                                      _mm256_srli_epi32(w[i - 2], 10));
+        w[i] = _mm256_add_epi32(_mm256_add_epi32(w[i - 16], s0), _mm256_add_epi32(w[i - 7], s1));
+    }
+
+    __m256i a = _mm256_set1_epi32(static_cast<int>(midstate[0]));
+    __m256i b = _mm256_set1_epi32(static_cast<int>(midstate[1]));
+    __m256i c = _mm256_set1_epi32(static_cast<int>(midstate[2]));
+    __m256i d = _mm256_set1_epi32(static_cast<int>(midstate[3]));
+    __m256i e = _mm256_set1_epi32(static_cast<int>(midstate[4]));
+    __m256i f = _mm256_set1_epi32(static_cast<int>(midstate[5]));
+    __m256i g = _mm256_set1_epi32(static_cast<int>(midstate[6]));
+    __m256i h = _mm256_set1_epi32(static_cast<int>(midstate[7]));
+
+    for (int i = 0; i < 64; ++i) {
+        __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(e, 6), AVX2_ROTR(e, 11)), AVX2_ROTR(e, 25));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, S1),
+                                      _mm256_add_epi32(ch, _mm256_add_epi32(
+                                          _mm256_set1_epi32(static_cast<int>(K[i])), w[i])));
+        __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(a, 2), AVX2_ROTR(a, 13)), AVX2_ROTR(a, 22));
+        __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)),
+                                       _mm256_and_si256(b, c));
+        __m256i t2 = _mm256_add_epi32(S0, maj);
+        h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+    }
+
+    __m256i result[8] = {a, b, c, d, e, f, g, h};
+    for (int word = 0; word < 8; ++word) {
+        __m256i sum = _mm256_add_epi32(result[word], _mm256_set1_epi32(static_cast<int>(midstate[word])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out[word]), sum);
+    }
+}
+
+#undef AVX2_ROTR
+
+#endif // POW_KERNEL_X86
+
+enum class Backend { SCALAR, SHANI, AVX2 };
+
+Backend detect_backend() {
+#ifdef POW_KERNEL_X86
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    bool has_sha = false;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        has_sha = (ebx & (1u << 29)) != 0;
+    }
+    __builtin_cpu_init();
+    if (has_sha && __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3")) {
+        return Backend::SHANI;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return Backend::AVX2;
+    }
+#endif
+    return Backend::SCALAR;
+}
+
+const Backend BACKEND = detect_backend();
+
+inline void compress(uint32_t state[8], const uint8_t block[64]) {
+#ifdef POW_KERNEL_X86
+    if (BACKEND == Backend::SHANI) {
+        compress_shani(state, block);
+        return;
+    }
+#endif
+    compress_scalar(state, block);
+}
+
+} // namespace
+
+PowKernel::PowKernel(long long previous_proof, int index, const std::string& data) {
+    uint8_t header[64] = {0};
+    std::memcpy(header, "VKPW", 4);
+    store_le32(header + 4, static_cast<uint32_t>(POW_VERSION_MIDSTATE));
+    store_le64(header + 8, static_cast<uint64_t>(static_cast<int64_t>(index)));
+    store_le64(header + 16, static_cast<uint64_t>(previous_proof));
+    SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), header + 24);
+    // header[56..63] reserved (zero)
+
+    std::memcpy(midstate_, IV, sizeof(midstate_));
+    compress(midstate_, header);
+}
+
+const char* PowKernel::backend_name() {
+    switch (BACKEND) {
+        case Backend::SHANI: return "sha-ni";
+        case Backend::AVX2: return "avx2-x8";
+        default: return "scalar";
+    }
+}
+
+void PowKernel::compress_nonce(long long nonce, uint32_t state[8]) const {
+    uint8_t block[64];
+    build_nonce_block(nonce, block);
+    std::memcpy(state, midstate_, sizeof(midstate_));
+    compress(state, block);
+}
+
+bool PowKernel::leading_zero_digits(const uint32_t state[8], int difficulty) {
+    // State words are the big-endian digest, so hex digits read from the top nibble down
+    int word = 0;
+    while (difficulty >= 8) {
+        if (word >= 8 || state[word] != 0) return false;
+        ++word;
+        difficulty -= 8;
+    }
+    if (difficulty == 0) return true;
+    if (word >= 8) return false;
+    return (state[word] >> (32 - 4 * difficulty)) == 0;
+}
+
+bool PowKernel::search(long long begin, long long end, int difficulty, long long& found_nonce) const {
+    long long nonce = begin;
+
+#ifdef POW_KERNEL_X86
+    if (BACKEND == Backend::AVX2) {
+        long long nonces[8];
+        uint32_t out[8][8];
+        uint32_t lane_state[8];
+        for (; nonce + 8 <= end; nonce += 8) {
+            for (int lane = 0; lane < 8; ++lane) nonces[lane] = nonce + lane;
+            compress_nonces_x8_avx2(midstate_, nonces, out);
+            for (int lane = 0; lane < 8; ++lane) {
+                for (int word = 0; word < 8; ++word) lane_state[word] = out[word][lane];
+                if (leading_zero_digits(lane_state, difficulty)) {
+                    found_nonce = nonce + lane;
+                    return true;
+                }
+            }
+        }
+    }
+#endif
+
+    uint32_t state[8];
+    for (; nonce < end; ++nonce) {
+        compress_nonce(nonce, state);
+        if (leading_zero_digits(state, difficulty)) {
+            found_nonce = nonce;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PowKernel::meets_difficulty(long long nonce, int difficulty) const {
+    uint32_t state[8];
+    compress_nonce(nonce, state);
+    return leading_zero_digits(state, difficulty);
+}
+
+void PowKernel::digest(long long nonce, uint8_t out[32]) const {
+    uint32_t state[8];
+    compress_nonce(nonce, state);
+    for (int i = 0; i < 8; ++i) {
+        out[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+        out[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+        out[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+        out[4 * i + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+
+std::string PowKernel::digest_hex(long long nonce) const {
+    static const char HEX[] = "0123456789abcdef";
+    uint8_t raw[32];
+    digest(nonce, raw);
+    std::string hex(64, '0');
+    for (int i = 0; i < 32; ++i) {
+        hex[2 * i] = HEX[raw[i] >> 4];
+        hex[2 * i + 1] = HEX[raw[i] & 0x0F];
+    }
+    return hex;
+}
@@ -0,0 +1,46 @@
+#ifndef POW_KERNEL_HPP
+#define POW_KERNEL_HPP
+
+#include <cstdint>
+#include <string>
+
+// Proof-of-work digest layouts (stored per block as Block::pow_version)
+constexpr int POW_VERSION_LEGACY = 1;    // sha256(to_string(f(nonce)) + data), hex prefix compare
+constexpr int POW_VERSION_MIDSTATE = 2;  // Fixed 72-byte header, cached midstate, raw digest compare
+
+/**
+ * PowKernel - Allocation-free proof-of-work hashing for POW_VERSION_MIDSTATE
+ *
+ * Digest input (72 bytes, a single SHA-256 over two compression blocks):
+ *   block 1 (constant, 64 bytes):
+ *     "VKPW" | u32 version | i64 index | i64 previous_proof | sha256(data) | 8 zero bytes
+ *   block 2 (per nonce):
+ *     i64 nonce | SHA-256 padding (message length 576 bits)
+ * All integers are little endian. Block 1 is compressed once into a midstate;
+ * each attempt only compresses block 2 from a stack buffer. Difficulty is the
+ * number of leading zero hex digits, checked on the raw state words.
+ *
+ * The compression backend is picked at startup: SHA-NI single stream, AVX2
+ * eight nonces per instruction stream, or portable scalar code.
+ */
+class PowKernel {
+public:
+    PowKernel(long long previous_proof, int index, const std::string& data);
+
+    // Scan [begin, end) for a nonce meeting `difficulty`; used as a ParallelMiner range kernel
+    bool search(long long begin, long long end, int difficulty, long long& found_nonce) const;
+
+    bool meets_difficulty(long long nonce, int difficulty) const;
+    void digest(long long nonce, uint8_t out[32]) const;
+    std::string digest_hex(long long nonce) const;
+
+    static const char* backend_name();
+
+private:
+    uint32_t midstate_[8];
+
+    void compress_nonce(long long nonce, uint32_t state[8]) const;
+    static bool leading_zero_digits(const uint32_t state[8], int difficulty);
+};
+
+#endif // POW_KERNEL_HPP
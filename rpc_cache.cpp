@@ -0,0 +1,161 @@
+#include "rpc_cache.hpp"
+#include "utils/metrics.hpp"
+#include <cstdio>
+
+namespace {
+
+metrics::Counter& lookups(const char* result) {
+    return metrics::counter("rpc_cache_lookups_total", "RPC response cache lookups", {{"result", result}});
+}
+
+}  // namespace
+
+RPCResponseCache::Result::Result(std::string serialized) : body(std::move(serialized)) {
+    // Only has to tell two serializations of the same request apart
+    char digest[17];
+    std::snprintf(digest, sizeof(digest), "%016llx",
+                  static_cast<unsigned long long>(std::hash<std::string>()(body)));
+    etag = digest;
+}
+
+RPCResponseCache::RPCResponseCache(size_t memory_budget) : memory_budget_(memory_budget) {}
+
+std::shared_ptr<const RPCResponseCache::Result> RPCResponseCache::get(const std::string& key, const Tag& current) {
+    static metrics::Counter& hit_counter = lookups("hit");
+    static metrics::Counter& miss_counter = lookups("miss");
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    advance(shard, current);
+
+    auto it = shard.index.find(key);
+    bool valid = it != shard.index.end() &&
+        (it->second->lifetime == Lifetime::HISTORICAL
+            ? it->second->tag.chain_epoch == current.chain_epoch
+            : it->second->tag.tip_version == current.tip_version);
+    if (!valid) {
+        // A reader still on an older snapshot misses rather than evicting newer entries
+        ++shard.misses;
+        miss_counter.inc();
+        return nullptr;
+    }
+    ++shard.hits;
+    hit_counter.inc();
+    if (it->second->lifetime == Lifetime::HISTORICAL) {
+        shard.historical.splice(shard.historical.begin(), shard.historical, it->second);
+    }
+    return it->second->result;
+}
+
+void RPCResponseCache::put(const std::string& key, Lifetime lifetime, const Tag& built_at,
+                           std::shared_ptr<const Result> result) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    advance(shard, built_at);
+
+    // Built from state the shard has already moved past
+    if (built_at.chain_epoch != shard.seen.chain_epoch ||
+        (lifetime == Lifetime::TIP && built_at.tip_version != shard.seen.tip_version)) {
+        return;
+    }
+
+    Entry entry{key, lifetime, built_at, std::move(result)};
+    size_t size = entry_size(entry);
+    size_t shard_budget = memory_budget_ / SHARD_COUNT;
+    if (size > shard_budget) {
+        return;  // Served, just too large to keep
+    }
+
+    auto existing = shard.index.find(key);
+    if (existing != shard.index.end()) {
+        erase(shard, existing->second->lifetime == Lifetime::HISTORICAL ? shard.historical : shard.tip,
+              existing->second);
+    }
+    std::list<Entry>& list = lifetime == Lifetime::HISTORICAL ? shard.historical : shard.tip;
+    list.push_front(std::move(entry));
+    shard.index[key] = list.begin();
+    shard.memory_used += size;
+
+    // Historical entries go first; tip entries are dropped wholesale at the next block anyway
+    while (shard.memory_used > shard_budget && !shard.historical.empty()) {
+        erase(shard, shard.historical, std::prev(shard.historical.end()));
+        ++shard.evictions;
+    }
+    while (shard.memory_used > shard_budget && !shard.tip.empty()) {
+        erase(shard, shard.tip, std::prev(shard.tip.end()));
+        ++shard.evictions;
+    }
+}
+
+void RPCResponseCache::clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        drop_all(shard, shard.historical);
+        drop_all(shard, shard.tip);
+    }
+}
+
+void RPCResponseCache::advance(Shard& shard, const Tag& current) {
+    if (current.chain_epoch > shard.seen.chain_epoch) {
+        // Chain positions were rewritten; no block held here can be trusted
+        drop_all(shard, shard.historical);
+        shard.seen.chain_epoch = current.chain_epoch;
+    }
+    if (current.tip_version > shard.seen.tip_version) {
+        drop_all(shard, shard.tip);
+        shard.seen.tip_version = current.tip_version;
+    }
+}
+
+void RPCResponseCache::erase(Shard& shard, std::list<Entry>& list, std::list<Entry>::iterator it) {
+    shard.memory_used -= entry_size(*it);
+    shard.index.erase(it->key);
+    list.erase(it);
+}
+
+void RPCResponseCache::drop_all(Shard& shard, std::list<Entry>& list) {
+    for (const Entry& entry : list) {
+        shard.memory_used -= entry_size(entry);
+        shard.index.erase(entry.key);
+    }
+    list.clear();
+}
+
+// ============= STATS =============
+size_t RPCResponseCache::size() const {
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.index.size();
+    }
+    return total;
+}
+
+size_t RPCResponseCache::memory_used() const {
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.memory_used;
+    }
+    return total;
+}
+
+json RPCResponseCache::stats_json() const {
+    size_t entries = 0, memory_used = 0;
+    uint64_t hits = 0, misses = 0, evictions = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        entries += shard.index.size();
+        memory_used += shard.memory_used;
+        hits += shard.hits;
+        misses += shard.misses;
+        evictions += shard.evictions;
+    }
+    json j;
+    j["entries"] = entries;
+    j["memory_used"] = memory_used;
+    j["memory_budget"] = memory_budget_;
+    j["hits"] = hits;
+    j["misses"] = misses;
+    j["evictions"] = evictions;
+    return j;
+}
@@ -0,0 +1,107 @@
+#ifndef RPC_CACHE_HPP
+#define RPC_CACHE_HPP
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+/**
+ * RPCResponseCache - Serialized JSON-RPC results keyed by method and params
+ *
+ * Results are stored as the bytes sent to clients, so a hit skips both the
+ * handler and json::dump. Each entry is tagged with the chain state it was
+ * built from:
+ *
+ *   HISTORICAL - blocks and proofs; valid until the chain itself is replaced
+ *                (ChainSnapshot::chain_epoch changes), never by a new block
+ *   TIP        - anything read from the latest state; valid for one
+ *                ChainSnapshot::version and dropped as soon as a newer one is seen
+ *
+ * The cache is split into shards, each with its own lock and LRU memory
+ * budget, so RPC I/O threads rarely contend. Results handed out stay valid
+ * after eviction because callers hold a shared_ptr.
+ *
+ * Nothing is invalidated eagerly: a lookup or store carrying a newer tag
+ * drops the shard's stale entries, so committing a block costs the chain
+ * nothing beyond publishing its snapshot.
+ */
+class RPCResponseCache {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 32 * 1024 * 1024;
+    static constexpr size_t SHARD_COUNT = 16;
+
+    enum class Lifetime { HISTORICAL, TIP };
+
+    // Chain state a result was built from, or that a lookup is made against
+    struct Tag {
+        uint64_t chain_epoch = 0;
+        uint64_t tip_version = 0;
+    };
+
+    // Serialized result and a digest of it, computed once when stored
+    struct Result {
+        std::string body;
+        std::string etag;
+
+        explicit Result(std::string serialized);
+    };
+
+    explicit RPCResponseCache(size_t memory_budget = DEFAULT_MEMORY_BUDGET);
+
+    // nullptr unless the entry for `key` is still valid at `current`
+    std::shared_ptr<const Result> get(const std::string& key, const Tag& current);
+    void put(const std::string& key, Lifetime lifetime, const Tag& built_at,
+             std::shared_ptr<const Result> result);
+    void clear();
+
+    size_t size() const;
+    size_t memory_used() const;
+    size_t memory_budget() const { return memory_budget_; }
+    json stats_json() const;
+
+private:
+    struct Entry {
+        std::string key;
+        Lifetime lifetime;
+        Tag tag;
+        std::shared_ptr<const Result> result;
+    };
+
+    struct Shard {
+        std::list<Entry> historical;  // Most recently used first
+        std::list<Entry> tip;         // All built at `seen`; dropped together
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        Tag seen;                     // Newest state looked up or stored against
+        size_t memory_used = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        mutable std::mutex mutex;
+    };
+
+    static constexpr size_t ENTRY_OVERHEAD = 96;  // List node, index slot and control block, roughly
+
+    size_t memory_budget_;
+    std::array<Shard, SHARD_COUNT> shards_;
+
+    Shard& shard_for(const std::string& key) {
+        return shards_[std::hash<std::string>()(key) % SHARD_COUNT];
+    }
+    static size_t entry_size(const Entry& entry) {
+        return entry.key.size() + entry.result->body.size() + entry.result->etag.size() + ENTRY_OVERHEAD;
+    }
+
+    // With the shard's mutex held
+    void advance(Shard& shard, const Tag& current);
+    void erase(Shard& shard, std::list<Entry>& list, std::list<Entry>::iterator it);
+    void drop_all(Shard& shard, std::list<Entry>& list);
+};
+
+#endif // RPC_CACHE_HPP
@@ -1,137 +1,503 @@
 #include "rpc_server.hpp"
 #include "utils/logger.hpp"
+#include "utils/metrics.hpp"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <unordered_map>
 
 // ============= RPC SESSION =============
 
+namespace {
+
+const char* status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 413: return "Payload Too Large";
+        default:  return "Internal Server Error";
+    }
+}
+
+std::string to_lower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+// Latency histogram per RPC method; each thread resolves a method once
+metrics::Histogram& method_latency(const std::string& method) {
+    thread_local std::unordered_map<std::string, metrics::Histogram*> cache;
+    auto it = cache.find(method);
+    if (it == cache.end()) {
+        it = cache.emplace(method, &metrics::histogram("rpc_request_seconds", "JSON-RPC call latency by method",
+                                                       {{"method", method}})).first;
+    }
+    return *it->second;
+}
+
+std::string trim(const std::string& value) {
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == std::string::npos) return "";
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+// A cached result object with the caller's id added, without re-parsing it
+std::string with_id(const std::string& result, const json& id) {
+    if (result == "{}") {
+        return "{\"id\":" + id.dump() + "}";
+    }
+    return result.substr(0, result.size() - 1) + ",\"id\":" + id.dump() + "}";
+}
+
+// The response body also carries the id, so two ids never share a tag
+std::string response_etag(const std::string& result_etag, const json& id) {
+    char digest[17];
+    std::snprintf(digest, sizeof(digest), "%016llx",
+                  static_cast<unsigned long long>(std::hash<std::string>()(id.dump())));
+    return "\"" + result_etag + "-" + digest + "\"";
+}
+
+bool etag_matches(const std::string& if_none_match, const std::string& etag) {
+    if (trim(if_none_match) == "*") {
+        return true;
+    }
+    std::istringstream candidates(if_none_match);
+    std::string candidate;
+    while (std::getline(candidates, candidate, ',')) {
+        candidate = trim(candidate);
+        if (candidate.compare(0, 2, "W/") == 0) {
+            candidate.erase(0, 2);  // Weak comparison is all If-None-Match needs
+        }
+        if (candidate == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+bool RPCSession::is_slow_method(const std::string& method) {
+    // Anything that serialises blocks, builds proofs or verifies signatures
+    return method == "eth_getBlockByNumber" || method == "eth_getBlockByHash" ||
+           method == "eth_getTransactionProof" || method == "eth_getStateProof" ||
+           method == "eth_sendTransaction";
+}
+
+bool RPCSession::cache_lifetime(const std::string& method, RPCResponseCache::Lifetime& lifetime) {
+    // Blocks and their proofs stay put until the chain is replaced
+    if (method == "eth_getBlockByNumber" || method == "eth_getBlockByHash" ||
+        method == "eth_getTransactionProof") {
+        lifetime = RPCResponseCache::Lifetime::HISTORICAL;
+        return true;
+    }
+    // Read from the latest snapshot; peer_count in network stats may lag by a block
+    if (method == "eth_getAccountState" || method == "eth_getStateProof" ||
+        method == "eth_getNetworkStats") {
+        lifetime = RPCResponseCache::Lifetime::TIP;
+        return true;
+    }
+    return false;
+}
+
 void RPCSession::start() {
     LOG_DEBUG("RPCSession", "Starting RPC session");
-    boost::asio::async_read(
-        socket_,
+    do_read();
+}
+
+void RPCSession::do_read() {
+    reading_ = true;
+    pointer self = shared_from_this();
+    socket_.async_read_some(
         boost::asio::buffer(data_, max_length),
-        [this](const boost::system::error_code& error, size_t bytes_transferred) {
-            this->handle_read(error, bytes_transferred);
-        });
+        strand_.wrap([self](const boost::system::error_code& error, size_t bytes_transferred) {
+            self->handle_read(error, bytes_transferred);
+        }));
 }
 
 void RPCSession::handle_read(const boost::system::error_code& error, size_t bytes_transferred) {
-    if (!error) {
-        read_buffer_.append(data_, bytes_transferred);
-
-        // Look for complete HTTP request (ends with \r\n\r\n)
-        size_t pos = read_buffer_.find("\r\n\r\n");
-        if (pos == std::string::npos) {
-            // Incomplete request, read more
-            boost::asio::async_read(
-                socket_,
-                boost::asio::buffer(data_, max_length),
-                [this](const boost::system::error_code& error, size_t bytes) {
-                    this->handle_read(error, bytes);
-                });
+    reading_ = false;
+    if (error) {
+        if (error != boost::asio::error::eof) {
+            LOG_WARN("RPCSession", "Read error: " + error.message());
+        }
+        // Finish answering what was already received, then close
+        closing_ = true;
+        flush_responses();
+        return;
+    }
+
+    read_buffer_.append(data_, bytes_transferred);
+
+    // Several pipelined requests may have arrived in one read
+    while (!closing_) {
+        HttpRequest request;
+        ParseStatus status = parse_request(request);
+        if (status == ParseStatus::INCOMPLETE) {
+            break;
+        }
+        if (status != ParseStatus::COMPLETE) {
+            bool too_large = status == ParseStatus::TOO_LARGE;
+            json response = make_error(too_large ? "Request too large" : "Malformed HTTP request", -32600, -1);
+            complete(next_sequence_++, too_large ? 413 : 400, response, false);
             return;
         }
+        process_request(std::move(request));
+    }
 
-        // Parse HTTP request
-        std::istringstream request_stream(read_buffer_);
-        std::string method, path, http_version;
-        request_stream >> method >> path >> http_version;
+    flush_responses();
+}
 
-        LOG_DEBUG("RPCSession", "Received " + method + " " + path);
+RPCSession::ParseStatus RPCSession::parse_request(HttpRequest& request) {
+    size_t header_end = read_buffer_.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        return read_buffer_.size() > MAX_HEADER_SIZE ? ParseStatus::TOO_LARGE : ParseStatus::INCOMPLETE;
+    }
+    if (header_end > MAX_HEADER_SIZE) {
+        return ParseStatus::TOO_LARGE;
+    }
+
+    size_t line_end = read_buffer_.find("\r\n");
+    std::istringstream request_line(read_buffer_.substr(0, line_end));
+    request_line >> request.method >> request.path >> request.version;
+    if (request.method.empty() || request.path.empty() || request.version.compare(0, 5, "HTTP/") != 0) {
+        return ParseStatus::BAD_REQUEST;
+    }
+    request.keep_alive = request.version != "HTTP/1.0";
+
+    size_t content_length = 0;
+    size_t pos = line_end + 2;
+    while (pos < header_end) {
+        size_t eol = read_buffer_.find("\r\n", pos);
+        std::string line = read_buffer_.substr(pos, eol - pos);
+        pos = eol + 2;
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            return ParseStatus::BAD_REQUEST;
+        }
+        std::string name = to_lower(trim(line.substr(0, colon)));
+        std::string value = trim(line.substr(colon + 1));
 
-        json response = json::object();
+        if (name == "content-length") {
+            if (value.empty() || value.size() > 12 ||
+                !std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); })) {
+                return ParseStatus::BAD_REQUEST;
+            }
+            content_length = std::stoull(value);
+        } else if (name == "connection") {
+            std::string option = to_lower(value);
+            if (option.find("close") != std::string::npos) {
+                request.keep_alive = false;
+            } else if (option.find("keep-alive") != std::string::npos) {
+                request.keep_alive = true;
+            }
+        } else if (name == "if-none-match") {
+            request.if_none_match = value;
+        } else if (name == "transfer-encoding") {
+            return ParseStatus::BAD_REQUEST;  // Clients must send Content-Length
+        }
+    }
+
+    if (content_length > MAX_BODY_SIZE) {
+        return ParseStatus::TOO_LARGE;
+    }
+    size_t total = header_end + 4 + content_length;
+    if (read_buffer_.size() < total) {
+        return ParseStatus::INCOMPLETE;
+    }
 
+    request.body = read_buffer_.substr(header_end + 4, content_length);
+    read_buffer_.erase(0, total);
+    return ParseStatus::COMPLETE;
+}
+
+void RPCSession::process_request(HttpRequest request) {
+    uint64_t sequence = next_sequence_++;
+    bool keep_alive = request.keep_alive;
+
+    LOG_DEBUG("RPCSession", "Received " + request.method + " " + request.path);
+
+    if (request.method == "POST" && request.path == "/") {
+        json body;
         try {
-            if (method == "POST" && path == "/") {
-                // Parse JSON-RPC 2.0 request
-                size_t body_start = read_buffer_.find("\r\n\r\n") + 4;
-                std::string body = read_buffer_.substr(body_start);
-                
-                json request = json::parse(body);
-                std::string rpc_method = request["method"].get<std::string>();
-                json params = request.contains("params") ? request["params"] : json::object();
-                int id = request.contains("id") ? request["id"].get<int>() : -1;
-
-                LOG_DEBUG("RPCSession", "RPC Method: " + rpc_method);
-
-                // Route to appropriate handler
-                if (rpc_method == "eth_getBalance") {
-                    response = handle_getBalance(params);
-                } else if (rpc_method == "eth_getAccountState") {
-                    response = handle_getAccountState(params);
-                } else if (rpc_method == "eth_getAccountNonce") {
-                    response = handle_getAccountNonce(params);
-                } else if (rpc_method == "eth_sendTransaction") {
-                    response = handle_sendTransaction(params);
-                } else if (rpc_method == "eth_getBlockByNumber") {
-                    response = handle_getBlock(params);
-                } else if (rpc_method == "eth_blockNumber") {
-                    response = handle_getLatestBlockNumber(params);
-                } else if (rpc_method == "eth_getBlockByHash") {
-                    response = handle_getBlockByHash(params);
-                } else if (rpc_method == "eth_getNetworkStats") {
-                    response = handle_getNetworkStats(params);
-                } else if (rpc_method == "net_peerCount") {
-                    response = handle_getPeerCount(params);
-                } else if (rpc_method == "eth_chainHeight") {
-                    response = handle_getChainHeight(params);
-                } else if (rpc_method == "eth_startMining") {
-                    response = handle_startMining(params);
-                } else if (rpc_method == "eth_stopMining") {
-                    response = handle_stopMining(params);
+            body = json::parse(request.body);
+        } catch (const std::exception& e) {
+            LOG_ERROR("RPCSession", "Error handling request: " + std::string(e.what()));
+            complete(sequence, 200, make_error("Invalid request: " + std::string(e.what()), -32600, -1), keep_alive);
+            return;
+        }
+
+        bool slow = false;
+        auto check = [&slow](const json& call) {
+            if (call.is_object() && call.contains("method") && call["method"].is_string()) {
+                slow = slow || is_slow_method(call["method"].get<std::string>());
+            }
+        };
+        if (body.is_array()) {
+            for (const auto& call : body) check(call);
+        } else {
+            check(body);
+        }
+
+        if (slow && slow_executor_) {
+            // Keep the I/O threads free for cheap calls
+            pointer self = shared_from_this();
+            slow_executor_->submit([self, sequence, keep_alive, body = std::move(body),
+                                    if_none_match = std::move(request.if_none_match)]() {
+                std::string etag;
+                std::string response = self->dispatch_body(body, &etag);
+                self->strand_.post([self, sequence, keep_alive, response = std::move(response),
+                                    etag = std::move(etag), if_none_match]() {
+                    self->complete_rpc(sequence, response, etag, if_none_match, keep_alive);
+                    self->flush_responses();
+                });
+            });
+            return;
+        }
+        std::string etag;
+        std::string response = dispatch_body(body, &etag);
+        complete_rpc(sequence, response, etag, request.if_none_match, keep_alive);
+    } else if (request.method == "GET" && request.path == "/metrics") {
+        // Prometheus text exposition
+        refresh_gauges();
+        complete(sequence, 200, metrics::Registry::instance().to_prometheus(),
+                 "text/plain; version=0.0.4", keep_alive);
+    } else if (request.method == "GET" && request.path == "/health") {
+        // Health check endpoint
+        json response;
+        response["status"] = "ok";
+        response["timestamp"] = std::to_string(std::time(nullptr));
+        response["height"] = blockchain_->get_chain_height();
+        response["catching_up"] = blockchain_->is_catching_up();
+        complete(sequence, 200, response, keep_alive);
+    } else {
+        json response;
+        response["error"] = "Not found";
+        response["status"] = 404;
+        complete(sequence, 404, response, keep_alive);
+    }
+}
+
+std::string RPCSession::dispatch_body(const json& body, std::string* etag) {
+    if (!body.is_array()) {
+        return dispatch_call(body, etag);
+    }
+    if (body.empty()) {
+        return make_error("Invalid request: empty batch", -32600, -1).dump();
+    }
+    // Elements are already serialized; join them rather than rebuilding a json array
+    std::string responses = "[";
+    for (const auto& call : body) {
+        if (responses.size() > 1) {
+            responses += ',';
+        }
+        responses += dispatch_call(call);
+    }
+    responses += ']';
+    return responses;
+}
+
+std::string RPCSession::dispatch_call(const json& request, std::string* etag) {
+    try {
+        std::string rpc_method = request["method"].get<std::string>();
+        json params = request.contains("params") ? request["params"] : json::object();
+        json id = request.contains("id") ? request["id"] : json(-1);
+
+        LOG_DEBUG("RPCSession", "RPC Method: " + rpc_method);
+        auto started = std::chrono::steady_clock::now();
+        bool known = true;
+        std::string payload;
+
+        RPCResponseCache::Lifetime lifetime;
+        if (response_cache_ && cache_lifetime(rpc_method, lifetime)) {
+            // Tagged before the handler runs, so a result never claims newer state than it read
+            auto snapshot = blockchain_->get_snapshot();
+            RPCResponseCache::Tag tag{snapshot->chain_epoch, snapshot->version};
+            std::string key = rpc_method + '\n' + params.dump();
+
+            std::shared_ptr<const RPCResponseCache::Result> cached = response_cache_->get(key, tag);
+            if (!cached) {
+                json result = call_handler(rpc_method, params, known);
+                if (result.is_object() && !result.contains("error")) {
+                    cached = std::make_shared<const RPCResponseCache::Result>(result.dump());
+                    response_cache_->put(key, lifetime, tag, cached);
                 } else {
-                    response = make_error("Method not found", -32601, id);
+                    // Errors such as "Block not found" can change before the tag does
+                    result["id"] = id;
+                    payload = result.dump();
                 }
-
-                response["id"] = id;
-            } else if (method == "GET" && path == "/health") {
-                // Health check endpoint
-                response["status"] = "ok";
-                response["timestamp"] = std::to_string(std::time(nullptr));
-                response["height"] = blockchain_->get_chain().size();
-            } else {
-                response["error"] = "Not found";
-                response["status"] = 404;
             }
-        } catch (const std::exception& e) {
-            LOG_ERROR("RPCSession", "Error handling request: " + std::string(e.what()));
-            response = make_error("Invalid request: " + std::string(e.what()), -32600, -1);
+            if (cached) {
+                payload = with_id(cached->body, id);
+                if (etag) {
+                    *etag = response_etag(cached->etag, id);
+                }
+            }
+        } else {
+            json response = call_handler(rpc_method, params, known);
+            response["id"] = id;
+            payload = response.dump();
         }
 
-        send_response(response);
+        // Unknown names share one series so clients cannot grow the registry
+        method_latency(known ? rpc_method : "unknown").observe(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+        return payload;
+    } catch (const std::exception& e) {
+        LOG_ERROR("RPCSession", "Error handling request: " + std::string(e.what()));
+        return make_error("Invalid request: " + std::string(e.what()), -32600, -1).dump();
+    }
+}
 
+json RPCSession::call_handler(const std::string& rpc_method, const json& params, bool& known) {
+    json response = json::object();
+    if (rpc_method == "eth_getBalance") {
+        response = handle_getBalance(params);
+    } else if (rpc_method == "eth_getAccountState") {
+        response = handle_getAccountState(params);
+    } else if (rpc_method == "eth_getAccountNonce") {
+        response = handle_getAccountNonce(params);
+    } else if (rpc_method == "eth_getStateProof") {
+        response = handle_getStateProof(params);
+    } else if (rpc_method == "eth_sendTransaction") {
+        response = handle_sendTransaction(params);
+    } else if (rpc_method == "eth_getBlockByNumber") {
+        response = handle_getBlock(params);
+    } else if (rpc_method == "eth_blockNumber") {
+        response = handle_getLatestBlockNumber(params);
+    } else if (rpc_method == "eth_getBlockByHash") {
+        response = handle_getBlockByHash(params);
+    } else if (rpc_method == "eth_getTransactionProof") {
+        response = handle_getTransactionProof(params);
+    } else if (rpc_method == "eth_getNetworkStats") {
+        response = handle_getNetworkStats(params);
+    } else if (rpc_method == "net_peerCount") {
+        response = handle_getPeerCount(params);
+    } else if (rpc_method == "eth_chainHeight") {
+        response = handle_getChainHeight(params);
+    } else if (rpc_method == "eth_syncing") {
+        response = handle_syncing(params);
+    } else if (rpc_method == "eth_startMining") {
+        response = handle_startMining(params);
+    } else if (rpc_method == "eth_stopMining") {
+        response = handle_stopMining(params);
+    } else if (rpc_method == "eth_getMetrics") {
+        response = handle_getMetrics(params);
     } else {
-        LOG_WARN("RPCSession", "Read error: " + error.message());
+        response = make_error("Method not found", -32601, -1);
+        known = false;
     }
+    return response;
+}
+
+void RPCSession::complete(uint64_t sequence, int status, const json& body, bool keep_alive) {
+    complete(sequence, status, body.dump(), "application/json", keep_alive);
 }
 
-void RPCSession::send_response(const json& response) {
-    std::string body = response.dump();
+void RPCSession::complete(uint64_t sequence, int status, const std::string& payload,
+                          const char* content_type, bool keep_alive, const std::string& etag) {
+    if (!socket_.is_open()) {
+        return;
+    }
     
     std::ostringstream http_response;
-    http_response << "HTTP/1.1 200 OK\r\n"
-                  << "Content-Type: application/json\r\n"
-                  << "Content-Length: " << body.length() << "\r\n"
-                  << "Connection: close\r\n"
-                  << "\r\n"
-                  << body;
-
-    std::string response_str = http_response.str();
-    LOG_DEBUG("RPCSession", "Sending response: " + body.substr(0, 100));
-
-    boost::asio::async_write(
-        socket_,
-        boost::asio::buffer(response_str),
-        [this](const boost::system::error_code& error, size_t bytes) {
-            this->handle_write(error);
-        });
+    http_response << "HTTP/1.1 " << status << " " << status_text(status) << "\r\n";
+    if (!etag.empty()) {
+        http_response << "ETag: " << etag << "\r\n";
+    }
+    if (status != 304) {
+        // A 304 has no body, and the client keeps the one it already has
+        http_response << "Content-Type: " << content_type << "\r\n"
+                      << "Content-Length: " << payload.length() << "\r\n";
+    }
+    http_response << "Connection: " << (keep_alive ? "keep-alive" : "close") << "\r\n"
+                  << "\r\n";
+    if (status != 304) {
+        http_response << payload;
+    }
+
+    LOG_DEBUG("RPCSession", "Sending response: " + payload.substr(0, 100));
+    ready_[sequence] = {http_response.str(), !keep_alive};
+}
+
+void RPCSession::complete_rpc(uint64_t sequence, const std::string& payload, const std::string& etag,
+                              const std::string& if_none_match, bool keep_alive) {
+    static metrics::Counter& not_modified = metrics::counter(
+        "rpc_not_modified_total", "JSON-RPC calls answered 304 from If-None-Match");
+    if (!etag.empty() && !if_none_match.empty() && etag_matches(if_none_match, etag)) {
+        not_modified.inc();
+        complete(sequence, 304, "", "application/json", keep_alive, etag);
+        return;
+    }
+    complete(sequence, 200, payload, "application/json", keep_alive, etag);
+}
+
+void RPCSession::flush_responses() {
+    if (!socket_.is_open()) {
+        return;
+    }
+
+    // Queue responses strictly in request order
+    for (auto it = ready_.find(next_to_send_); it != ready_.end(); it = ready_.find(next_to_send_)) {
+        write_queue_.push_back(std::move(it->second.first));
+        bool close_after = it->second.second;
+        ready_.erase(it);
+        ++next_to_send_;
+        if (close_after) {
+            // Nothing after a "Connection: close" response is answered
+            closing_ = true;
+            ready_.clear();
+            next_sequence_ = next_to_send_;
+            break;
+        }
+    }
+
+    if (!writing_ && !write_queue_.empty()) {
+        writing_ = true;
+        pointer self = shared_from_this();
+        boost::asio::async_write(
+            socket_,
+            boost::asio::buffer(write_queue_.front()),
+            strand_.wrap([self](const boost::system::error_code& error, size_t) {
+                self->handle_write(error);
+            }));
+        return;
+    }
+
+    size_t in_flight = next_sequence_ - next_to_send_;
+    if (closing_) {
+        if (!writing_ && in_flight == 0) {
+            close();
+        }
+    } else if (!reading_ && in_flight < MAX_PIPELINED_REQUESTS) {
+        do_read();
+    }
 }
 
 void RPCSession::handle_write(const boost::system::error_code& error) {
+    writing_ = false;
     if (error) {
         LOG_ERROR("RPCSession", "Write error: " + error.message());
+        close();
+        return;
     }
+    write_queue_.pop_front();
+    flush_responses();
+}
+
+void RPCSession::close() {
+    boost::system::error_code ignored;
+    socket_.shutdown(tcp::socket::shutdown_both, ignored);
+    socket_.close(ignored);
+    ready_.clear();
+    write_queue_.clear();
 }
 
 // ============= JSON-RPC METHOD HANDLERS =============
@@ -155,16 +521,17 @@ json RPCSession::handle_getBalance(const json& params) {
 json RPCSession::handle_getAccountState(const json& params) {
     try {
         std::string address = params[0].get<std::string>();
-        double balance = blockchain_->get_balance(address);
-        uint64_t nonce = blockchain_->get_account_nonce(address);
+        // Balance, nonce and root all come from the same published state
+        auto snapshot = blockchain_->get_snapshot();
+        const ChainSnapshot::Account* account = snapshot->find_account(address);
         
         LOG_INFO("RPCSession", "getAccountState(" + address + ")");
         
         json result;
         result["address"] = address;
-        result["balance"] = balance;
-        result["nonce"] = nonce;
-        result["state_root"] = blockchain_->get_state_root().substr(0, 32);
+        result["balance"] = account ? account->balance : 0.0;
+        result["nonce"] = account ? account->nonce : 0;
+        result["state_root"] = snapshot->state_root.substr(0, 32);
         return result;
     } catch (const std::exception& e) {
         return make_error("Invalid address", -32602, -1);
@@ -187,6 +554,25 @@ json RPCSession::handle_getAccountNonce(const json& params) {
     }
 }
 
+json RPCSession::handle_getStateProof(const json& params) {
+    try {
+        std::string address = params[0].get<std::string>();
+        StateTree::Proof proof;
+        std::string state_root;
+        if (!blockchain_->get_state_proof(address, proof, state_root)) {
+            return make_error("Account not found", -32602, -1);
+        }
+        
+        LOG_INFO("RPCSession", "getStateProof(" + address + ")");
+        
+        json result = proof.to_json();
+        result["state_root"] = state_root;
+        return result;
+    } catch (const std::exception& e) {
+        return make_error("Invalid address", -32602, -1);
+    }
+}
+
 json RPCSession::handle_sendTransaction(const json& params) {
     try {
         std::string from = params["from"].get<std::string>();
@@ -217,14 +603,12 @@ json RPCSession::handle_sendTransaction(const json& params) {
 json RPCSession::handle_getBlock(const json& params) {
     try {
         int block_number = params[0].get<int>();
-        const auto& chain = blockchain_->get_chain();
         
-        if (block_number < 0 || block_number >= (int)chain.size()) {
+        Block block;
+        if (block_number < 0 || !blockchain_->get_block(block_number, block)) {
             return make_error("Block not found", -32602, -1);
         }
         
-        const Block& block = chain[block_number];
-        
         LOG_INFO("RPCSession", "getBlock(" + std::to_string(block_number) + ")");
         
         return block.to_json();
@@ -234,7 +618,7 @@ json RPCSession::handle_getBlock(const json& params) {
 }
 
 json RPCSession::handle_getLatestBlockNumber(const json& params) {
-    int height = blockchain_->get_chain().size();
+    int height = blockchain_->get_chain_height();
     
     LOG_INFO("RPCSession", "blockNumber() = " + std::to_string(height));
     
@@ -247,14 +631,12 @@ json RPCSession::handle_getLatestBlockNumber(const json& params) {
 json RPCSession::handle_getBlockByHash(const json& params) {
     try {
         std::string hash = params[0].get<std::string>();
-        const auto& chain = blockchain_->get_chain();
         
-        // Simple linear search (in production, would use index)
-        for (size_t i = 0; i < chain.size(); ++i) {
-            if (blockchain_->hash_block(chain[i]).substr(0, hash.length()) == hash) {
-                LOG_INFO("RPCSession", "getBlockByHash(" + hash + ") = block #" + std::to_string(i));
-                return chain[i].to_json();
-            }
+        Block block;
+        size_t position = 0;
+        if (blockchain_->get_block_by_hash(hash, block, &position)) {
+            LOG_INFO("RPCSession", "getBlockByHash(" + hash + ") = block #" + std::to_string(position));
+            return block.to_json();
         }
         
         return make_error("Block not found", -32602, -1);
@@ -263,22 +645,62 @@ json RPCSession::handle_getBlockByHash(const json& params) {
     }
 }
 
+json RPCSession::handle_getTransactionProof(const json& params) {
+    try {
+        size_t block_number = params[0].get<size_t>();
+        std::string transaction_id = params[1].get<std::string>();
+        
+        MerkleProof proof;
+        std::string merkle_root;
+        if (!blockchain_->get_transaction_proof(block_number, transaction_id, proof, merkle_root)) {
+            return make_error("Transaction not found in block", -32602, -1);
+        }
+        
+        LOG_INFO("RPCSession", "getTransactionProof(" + std::to_string(block_number) + ", " +
+                 transaction_id.substr(0, 16) + ")");
+        
+        json result = proof.to_json();
+        result["block_number"] = block_number;
+        result["merkle_root"] = merkle_root;
+        return result;
+    } catch (const std::exception& e) {
+        return make_error("Invalid parameters", -32602, -1);
+    }
+}
+
 json RPCSession::handle_getNetworkStats(const json& params) {
-    const auto& chain = blockchain_->get_chain();
-    auto state = blockchain_->get_account_state();
+    auto snapshot = blockchain_->get_snapshot();
     int peer_count = network_mgr_ ? network_mgr_->get_all_nodes().size() : 1;
     
     LOG_INFO("RPCSession", "getNetworkStats()");
     
     json result;
-    result["total_blocks"] = chain.size();
-    result["total_transactions"] = chain.size() > 0 ? 
-        std::accumulate(chain.begin(), chain.end(), 0,
-                       [](int sum, const Block& b) { return sum + b.transactions.size(); }) : 0;
-    result["total_accounts"] = state.size();
+    result["total_blocks"] = snapshot->height;
+    result["total_transactions"] = snapshot->total_transactions;
+    result["total_accounts"] = snapshot->account_count;
     result["peer_count"] = peer_count;
-    result["difficulty"] = blockchain_->get_difficulty();
-    result["state_root"] = blockchain_->get_state_root().substr(0, 32);
+    result["difficulty"] = snapshot->difficulty;
+    result["state_root"] = snapshot->state_root.substr(0, 32);
+    return result;
+}
+
+void RPCSession::refresh_gauges() {
+    // Per-node state is sampled at scrape time rather than on every change
+    static metrics::Gauge& height = metrics::gauge("chain_height", "Blocks in the served chain");
+    static metrics::Gauge& mempool_depth = metrics::gauge("mempool_depth", "Transactions waiting in the mempool");
+    static metrics::Gauge& nodes = metrics::gauge("network_nodes", "Nodes known to the network manager");
+    height.set(static_cast<double>(blockchain_->get_chain_height()));
+    mempool_depth.set(static_cast<double>(blockchain_->get_mempool_size()));
+    nodes.set(network_mgr_ ? static_cast<double>(network_mgr_->get_all_nodes().size()) : 1.0);
+}
+
+json RPCSession::handle_getMetrics(const json&) {
+    refresh_gauges();
+    json result;
+    result["metrics"] = metrics::Registry::instance().to_json();
+    if (response_cache_) {
+        result["response_cache"] = response_cache_->stats_json();
+    }
     return result;
 }
 
@@ -293,7 +715,7 @@ json RPCSession::handle_getPeerCount(const json& params) {
 }
 
 json RPCSession::handle_getChainHeight(const json& params) {
-    int height = blockchain_->get_chain().size();
+    int height = blockchain_->get_chain_height();
     
     LOG_INFO("RPCSession", "chainHeight() = " + std::to_string(height));
     
@@ -302,6 +724,15 @@ json RPCSession::handle_getChainHeight(const json& params) {
     return result;
 }
 
+json RPCSession::handle_syncing(const json&) {
+    // Replay of locally stored blocks after a restart; served before it finishes
+    CatchUpStatus status = blockchain_->get_catch_up_status();
+    
+    json result = status.to_json();
+    result["syncing"] = status.catching_up;
+    return result;
+}
+
 json RPCSession::handle_startMining(const json& params) {
     try {
         std::string miner_address = params[0].get<std::string>();
@@ -344,8 +775,13 @@ json RPCSession::make_error(const std::string& message, int code, int id) {
 
 // ============= RPC SERVER =============
 
-RPCServer::RPCServer(uint16_t port, Blockchain* blockchain, NetworkManager* network_mgr)
-    : port_(port), running_(false), blockchain_(blockchain), network_mgr_(network_mgr) {
+RPCServer::RPCServer(uint16_t port, Blockchain* blockchain, NetworkManager* network_mgr,
+                     unsigned io_threads, unsigned handler_threads, size_t response_cache_budget)
+    : port_(port),
+      io_threads_(io_threads ? io_threads : std::max(1u, std::thread::hardware_concurrency())),
+      handler_threads_(handler_threads ? handler_threads : std::max(1u, std::thread::hardware_concurrency())),
+      running_(false), response_cache_(response_cache_budget),
+      blockchain_(blockchain), network_mgr_(network_mgr) {
     LOG_INFO("RPCServer", "Initializing JSON-RPC server on port " + std::to_string(port));
 }
 
@@ -356,32 +792,54 @@ RPCServer::~RPCServer() {
 void RPCServer::start() {
     if (running_) return;
     
+    try {
+        tcp::endpoint endpoint(tcp::v4(), port_);
+        acceptor_ = std::make_unique<tcp::acceptor>(io_service_, endpoint);
+    } catch (const std::exception& e) {
+        LOG_ERROR("RPCServer", "Server error: " + std::string(e.what()));
+        return;
+    }
+    
     running_ = true;
-    server_thread_ = std::thread(&RPCServer::run_server, this);
-    LOG_INFO("RPCServer", "JSON-RPC server started on port " + std::to_string(port_));
+    io_service_.restart();
+    work_ = std::make_unique<boost::asio::io_service::work>(io_service_);
+    slow_executor_ = std::make_unique<ThreadPool>(handler_threads_);
+    
+    LOG_INFO("RPCServer", "Listening for JSON-RPC requests on port " + std::to_string(port_));
+    start_accept();
+    
+    for (unsigned i = 0; i < io_threads_; ++i) {
+        io_threads_pool_.emplace_back(&RPCServer::run_server, this);
+    }
+    LOG_INFO("RPCServer", "JSON-RPC server started on port " + std::to_string(port_) + " (" +
+             std::to_string(io_threads_) + " I/O threads, " + std::to_string(handler_threads_) +
+             " handler threads)");
 }
 
 void RPCServer::stop() {
     if (!running_) return;
     
     running_ = false;
+    work_.reset();
+    if (acceptor_) {
+        boost::system::error_code ignored;
+        acceptor_->close(ignored);
+    }
     io_service_.stop();
     
-    if (server_thread_.joinable()) {
-        server_thread_.join();
+    for (auto& thread : io_threads_pool_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
     }
+    io_threads_pool_.clear();
+    slow_executor_.reset();
     
     LOG_INFO("RPCServer", "JSON-RPC server stopped");
 }
 
 void RPCServer::run_server() {
     try {
-        tcp::endpoint endpoint(tcp::v4(), port_);
-        acceptor_ = std::make_unique<tcp::acceptor>(io_service_, endpoint);
-        
-        LOG_INFO("RPCServer", "Listening for JSON-RPC requests on port " + std::to_string(port_));
-        
-        start_accept();
         io_service_.run();
     } catch (const std::exception& e) {
         LOG_ERROR("RPCServer", "Server error: " + std::string(e.what()));
@@ -389,7 +847,8 @@ void RPCServer::run_server() {
 }
 
 void RPCServer::start_accept() {
-    RPCSession::pointer new_session = RPCSession::create(io_service_, blockchain_, network_mgr_);
+    RPCSession::pointer new_session = RPCSession::create(io_service_, blockchain_, network_mgr_,
+                                                         slow_executor_.get(), &response_cache_);
     
     acceptor_->async_accept(
         new_session->socket(),
@@ -399,6 +858,9 @@ void RPCServer::start_accept() {
 }
 
 void RPCServer::handle_accept(RPCSession::pointer new_session, const boost::system::error_code& error) {
+    if (!running_) {
+        return;
+    }
     if (!error) {
         LOG_DEBUG("RPCServer", "New connection accepted");
         new_session->start();
@@ -3,12 +3,18 @@
 
 #include "blockchain.hpp"
 #include "network_manager.hpp"
+#include "rpc_cache.hpp"
 #include <boost/asio.hpp>
 #include <boost/bind/bind.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
+#include "utils/thread_pool.hpp"
+#include <atomic>
+#include <deque>
+#include <map>
 #include <memory>
 #include <thread>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -16,7 +22,18 @@ using boost::asio::ip::tcp;
 
 /**
  * RPCSession - Handles individual HTTP connections
- * Parses JSON-RPC 2.0 requests and returns responses
+ * Parses JSON-RPC 2.0 requests (single or batched) and returns responses
+ *
+ * Connections are HTTP/1.1 keep-alive and may pipeline requests. Bodies are
+ * framed by Content-Length and parsed as bytes arrive. Fast methods are
+ * answered on the I/O thread. Slow ones (see is_slow_method) run on the
+ * server's handler pool. Responses are always written in request order.
+ * GET /metrics serves the process metrics in Prometheus text format.
+ *
+ * Results of cacheable methods (see cache_lifetime) come from the server's
+ * RPCResponseCache when it holds them for the current chain state. A single
+ * call answered that way carries an ETag, and a request whose If-None-Match
+ * lists it gets 304 Not Modified with no body.
  */
 class RPCSession : public boost::enable_shared_from_this<RPCSession> {
 public:
@@ -24,8 +41,10 @@ public:
 
     static pointer create(boost::asio::io_service& io_service, 
                          Blockchain* blockchain,
-                         NetworkManager* network_mgr) {
-        return pointer(new RPCSession(io_service, blockchain, network_mgr));
+                         NetworkManager* network_mgr,
+                         ThreadPool* slow_executor = nullptr,
+                         RPCResponseCache* response_cache = nullptr) {
+        return pointer(new RPCSession(io_service, blockchain, network_mgr, slow_executor, response_cache));
     }
 
     tcp::socket::lowest_layer_type& socket() {
@@ -34,41 +53,96 @@ public:
 
     void start();
 
+    static bool is_slow_method(const std::string& method);
+    // false for methods whose results are never cached
+    static bool cache_lifetime(const std::string& method, RPCResponseCache::Lifetime& lifetime);
+
 private:
     RPCSession(boost::asio::io_service& io_service,
               Blockchain* blockchain,
-              NetworkManager* network_mgr)
-        : socket_(io_service), blockchain_(blockchain), network_mgr_(network_mgr) {}
-
+              NetworkManager* network_mgr,
+              ThreadPool* slow_executor,
+              RPCResponseCache* response_cache)
+        : socket_(io_service), strand_(io_service), blockchain_(blockchain),
+          network_mgr_(network_mgr), slow_executor_(slow_executor), response_cache_(response_cache) {}
+
+    struct HttpRequest {
+        std::string method;
+        std::string path;
+        std::string version;
+        std::string body;
+        std::string if_none_match;
+        bool keep_alive = true;
+    };
+
+    enum class ParseStatus { COMPLETE, INCOMPLETE, BAD_REQUEST, TOO_LARGE };
+
+    static constexpr size_t MAX_HEADER_SIZE = 16 * 1024;
+    static constexpr size_t MAX_BODY_SIZE = 8 * 1024 * 1024;
+    static constexpr size_t MAX_PIPELINED_REQUESTS = 64;  // Reading pauses beyond this
+
+    void do_read();
     void handle_read(const boost::system::error_code& error, size_t bytes_transferred);
-    void send_response(const json& response);
+    ParseStatus parse_request(HttpRequest& request);
+    void process_request(HttpRequest request);
+
+    // JSON-RPC dispatch to serialized responses: a single call, or a whole
+    // body (object or batch array). `etag` is set for a single cached call.
+    std::string dispatch_call(const json& request, std::string* etag = nullptr);
+    std::string dispatch_body(const json& body, std::string* etag = nullptr);
+    json call_handler(const std::string& rpc_method, const json& params, bool& known);
+
+    void complete(uint64_t sequence, int status, const json& body, bool keep_alive);
+    void complete(uint64_t sequence, int status, const std::string& payload,
+                  const char* content_type, bool keep_alive, const std::string& etag = "");
+    void complete_rpc(uint64_t sequence, const std::string& payload, const std::string& etag,
+                      const std::string& if_none_match, bool keep_alive);
+    void flush_responses();
     void handle_write(const boost::system::error_code& error);
+    void close();
 
     // JSON-RPC request handlers
     json handle_getBalance(const json& params);
     json handle_getAccountState(const json& params);
     json handle_getAccountNonce(const json& params);
+    json handle_getStateProof(const json& params);
     json handle_sendTransaction(const json& params);
     json handle_getBlock(const json& params);
     json handle_getLatestBlockNumber(const json& params);
     json handle_getBlockByHash(const json& params);
+    json handle_getTransactionProof(const json& params);
     json handle_getNetworkStats(const json& params);
     json handle_getPeerCount(const json& params);
     json handle_getChainHeight(const json& params);
+    json handle_syncing(const json& params);
     json handle_startMining(const json& params);
     json handle_stopMining(const json& params);
+    json handle_getMetrics(const json& params);
+    void refresh_gauges();
 
     // Response builders
     json make_response(const json& result, int id);
     json make_error(const std::string& message, int code, int id);
 
     tcp::socket socket_;
+    boost::asio::io_service::strand strand_;  // Serialises this session's handlers
     enum { max_length = 65536 };
     char data_[max_length];
     std::string read_buffer_;
 
+    // Pipelining: responses are parked until every earlier one has been queued
+    uint64_t next_sequence_ = 0;
+    uint64_t next_to_send_ = 0;
+    std::map<uint64_t, std::pair<std::string, bool>> ready_;  // sequence -> (response, close after)
+    std::deque<std::string> write_queue_;
+    bool writing_ = false;
+    bool reading_ = false;
+    bool closing_ = false;
+
     Blockchain* blockchain_;
     NetworkManager* network_mgr_;
+    ThreadPool* slow_executor_;
+    RPCResponseCache* response_cache_;
 };
 
 /**
@@ -77,13 +151,17 @@ private:
  */
 class RPCServer {
 public:
-    RPCServer(uint16_t port, Blockchain* blockchain, NetworkManager* network_mgr);
+    // 0 threads means one per core, for both the I/O and slow-handler pools
+    RPCServer(uint16_t port, Blockchain* blockchain, NetworkManager* network_mgr,
+              unsigned io_threads = 0, unsigned handler_threads = 0,
+              size_t response_cache_budget = RPCResponseCache::DEFAULT_MEMORY_BUDGET);
     ~RPCServer();
 
     void start();
     void stop();
     bool is_running() const { return running_; }
     uint16_t get_port() const { return port_; }
+    RPCResponseCache& get_response_cache() { return response_cache_; }
 
 private:
     void run_server();
@@ -91,10 +169,15 @@ private:
     void handle_accept(RPCSession::pointer new_session, const boost::system::error_code& error);
 
     uint16_t port_;
+    unsigned io_threads_;
+    unsigned handler_threads_;
     boost::asio::io_service io_service_;
+    std::unique_ptr<boost::asio::io_service::work> work_;
     std::unique_ptr<tcp::acceptor> acceptor_;
-    std::thread server_thread_;
-    bool running_;
+    std::vector<std::thread> io_threads_pool_;
+    std::unique_ptr<ThreadPool> slow_executor_;  // Declared after io_service_: destroyed first
+    std::atomic<bool> running_;
+    RPCResponseCache response_cache_;  // Shared by all sessions
     
     Blockchain* blockchain_;
     NetworkManager* network_mgr_;
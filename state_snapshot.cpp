@@ -0,0 +1,117 @@
+#include "state_snapshot.hpp"
+#include "merkle.hpp"
+
+// ============= MANIFEST =============
+
+bool SnapshotManifest::verify() const {
+    if (chunk_hashes.size() != CHUNK_COUNT) {
+        return false;
+    }
+    return StateTree::to_hex(StateTree::root_of_subtrees(chunk_hashes)) == state_root;
+}
+
+json SnapshotManifest::to_json() const {
+    json j;
+    j["height"] = height;
+    j["block_hash"] = block_hash;
+    j["state_root"] = state_root;
+    j["account_count"] = account_count;
+    j["chunk_hashes"] = json::array();
+    for (const auto& hash : chunk_hashes) {
+        j["chunk_hashes"].push_back(StateTree::to_hex(hash));
+    }
+    return j;
+}
+
+SnapshotManifest SnapshotManifest::from_json(const json& j) {
+    SnapshotManifest manifest;
+    manifest.height = j.at("height").get<uint64_t>();
+    manifest.block_hash = j.value("block_hash", "");
+    manifest.state_root = j.value("state_root", "");
+    manifest.account_count = j.value("account_count", static_cast<uint64_t>(0));
+    for (const auto& hex : j.value("chunk_hashes", json::array())) {
+        StateTree::Hash hash;
+        if (!MerkleTree::from_hex(hex.get<std::string>(), hash)) {
+            throw BlockchainException("Malformed snapshot chunk hash");
+        }
+        manifest.chunk_hashes.push_back(hash);
+    }
+    return manifest;
+}
+
+// ============= CHUNKS =============
+
+bool SnapshotChunk::verify(const SnapshotManifest& manifest) const {
+    if (state_root != manifest.state_root || index >= manifest.chunk_hashes.size()) {
+        return false;
+    }
+    StateTree::Hash root;
+    return StateTree::subtree_root(SnapshotManifest::CHUNK_LEVEL, index, accounts, root) &&
+           root == manifest.chunk_hashes[index];
+}
+
+json SnapshotChunk::to_json() const {
+    json j;
+    j["state_root"] = state_root;
+    j["index"] = index;
+    j["available"] = available;
+    j["accounts"] = json::array();
+    for (const auto& account : accounts) {
+        j["accounts"].push_back({
+            {"address", account.address},
+            {"balance", account.balance},
+            {"nonce", account.nonce}
+        });
+    }
+    return j;
+}
+
+SnapshotChunk SnapshotChunk::from_json(const json& j) {
+    SnapshotChunk chunk;
+    chunk.state_root = j.at("state_root").get<std::string>();
+    chunk.index = j.at("index").get<uint32_t>();
+    chunk.available = j.value("available", true);
+    for (const auto& account_json : j.value("accounts", json::array())) {
+        StateTree::Account account;
+        account.address = account_json.at("address").get<std::string>();
+        account.balance = account_json.at("balance").get<double>();
+        account.nonce = account_json.value("nonce", static_cast<uint64_t>(0));
+        chunk.accounts.push_back(std::move(account));
+    }
+    return chunk;
+}
+
+// ============= BUILDING =============
+
+std::shared_ptr<const StateSnapshot> StateSnapshot::build(const ChainSnapshot& state) {
+    auto snapshot = std::make_shared<StateSnapshot>();
+    SnapshotManifest& manifest = snapshot->manifest_;
+    manifest.height = state.height;
+    manifest.block_hash = state.tip_hash;
+    manifest.state_root = state.state_root;
+    manifest.account_count = state.account_count;
+
+    snapshot->chunks_.resize(SnapshotManifest::CHUNK_COUNT);
+    for (size_t i = 0; i < snapshot->chunks_.size(); ++i) {
+        snapshot->chunks_[i].state_root = state.state_root;
+        snapshot->chunks_[i].index = static_cast<uint32_t>(i);
+    }
+    for (const auto& shard : state.shards) {
+        for (const auto& [address, account] : *shard) {
+            snapshot->chunks_[SnapshotManifest::chunk_of(address)].accounts.push_back(
+                StateTree::Account{address, account.balance, account.nonce});
+        }
+    }
+
+    // Hashed the way a client will check them, so a served chunk always verifies
+    manifest.chunk_hashes.resize(SnapshotManifest::CHUNK_COUNT);
+    for (size_t i = 0; i < snapshot->chunks_.size(); ++i) {
+        StateTree::subtree_root(SnapshotManifest::CHUNK_LEVEL, i, snapshot->chunks_[i].accounts,
+                                manifest.chunk_hashes[i]);
+    }
+    if (!manifest.verify()) {
+        throw BlockchainException("State snapshot at #" + std::to_string(state.height) +
+                                  " does not reproduce its state root");
+    }
+    return snapshot;
+}
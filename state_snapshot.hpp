@@ -0,0 +1,76 @@
+#ifndef STATE_SNAPSHOT_HPP
+#define STATE_SNAPSHOT_HPP
+
+#include "blockchain.hpp"
+#include "state_tree.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * State snapshots - Account state in independently verifiable chunks
+ *
+ * A snapshot is the account state after block `height`, which block
+ * height + 1 commits to as its state_root. Chunk i holds every account in
+ * StateTree buckets [i << CHUNK_LEVEL, (i + 1) << CHUNK_LEVEL) and its hash is
+ * the root of that StateTree subtree, so the manifest's CHUNK_COUNT chunk
+ * hashes fold up to the state root. A client checks the manifest against a
+ * verified header, then each chunk against the manifest, in any order and
+ * from any peer.
+ *
+ * Only balances and nonces are covered; contract storage is not part of the
+ * state root and does not travel in snapshots.
+ */
+struct SnapshotManifest {
+    static constexpr unsigned CHUNK_BITS = 8;
+    static constexpr size_t CHUNK_COUNT = size_t(1) << CHUNK_BITS;
+    static constexpr unsigned CHUNK_LEVEL = StateTree::BUCKET_BITS - CHUNK_BITS;
+
+    uint64_t height = 0;        // 0 when the peer has no snapshot to offer
+    std::string block_hash;     // Hash of block `height`
+    std::string state_root;     // Committed by block height + 1
+    uint64_t account_count = 0;
+    std::vector<StateTree::Hash> chunk_hashes;
+
+    bool empty() const { return height == 0; }
+    // All CHUNK_COUNT hashes are present and fold up to state_root
+    bool verify() const;
+
+    static size_t chunk_of(const std::string& address) {
+        return StateTree::bucket_of(address) >> CHUNK_LEVEL;
+    }
+
+    json to_json() const;
+    static SnapshotManifest from_json(const json& j);
+};
+
+struct SnapshotChunk {
+    std::string state_root;     // Snapshot the chunk belongs to
+    uint32_t index = 0;
+    bool available = true;      // False when the peer no longer serves this snapshot
+    std::vector<StateTree::Account> accounts;
+
+    // Holds exactly the accounts of its subtree, matching the manifest's hash
+    bool verify(const SnapshotManifest& manifest) const;
+
+    json to_json() const;
+    static SnapshotChunk from_json(const json& j);
+};
+
+/**
+ * StateSnapshot - A manifest and its chunks, built once from a checkpointed
+ * ChainSnapshot and then served read-only to any number of peers.
+ */
+class StateSnapshot {
+public:
+    static std::shared_ptr<const StateSnapshot> build(const ChainSnapshot& state);
+
+    const SnapshotManifest& manifest() const { return manifest_; }
+    const SnapshotChunk& chunk(size_t index) const { return chunks_.at(index); }
+
+private:
+    SnapshotManifest manifest_;
+    std::vector<SnapshotChunk> chunks_;
+};
+
+#endif // STATE_SNAPSHOT_HPP
@@ -0,0 +1,320 @@
+#include "state_sync.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+
+StateSync::StateSync(Blockchain& blockchain, HeaderFn find_header, InstallFn install, DoneFn done)
+    : blockchain_(blockchain), find_header_(std::move(find_header)),
+      install_(std::move(install)), done_(std::move(done)) {}
+
+// ============= PEERS =============
+
+void StateSync::add_peer(const std::string& peer_id, size_t height, SendFn send) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    _drop_peer(peer_id);
+    Peer& peer = peers_[peer_id];
+    peer.height = height;
+    peer.send = std::move(send);
+    if (phase_ != Phase::IDLE) {
+        // Joined mid-sync: it may serve the snapshot too
+        peer.send(MessageType::GET_SNAPSHOT_MANIFEST, std::string());
+    }
+}
+
+void StateSync::remove_peer(const std::string& peer_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    _drop_peer(peer_id);
+    if (phase_ == Phase::DISCOVERING) {
+        _choose();
+    } else if (phase_ == Phase::DOWNLOADING) {
+        _pump();
+    }
+}
+
+void StateSync::update_peer_height(const std::string& peer_id, size_t height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = peers_.find(peer_id);
+    if (it != peers_.end()) {
+        it->second.height = std::max(it->second.height, height);
+    }
+}
+
+void StateSync::_drop_peer(const std::string& peer_id) {
+    for (auto it = requests_.begin(); it != requests_.end();) {
+        if (it->second.peer_id == peer_id) {
+            pending_.push_back(it->first);
+            it = requests_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    peers_.erase(peer_id);
+}
+
+// ============= MANIFESTS =============
+
+bool StateSync::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (phase_ != Phase::IDLE) {
+        return true;
+    }
+    size_t height = blockchain_.get_chain_height();
+    bool far_behind = std::any_of(peers_.begin(), peers_.end(), [&](const auto& entry) {
+        return entry.second.height >= height + min_distance_;
+    });
+    if (!far_behind) {
+        return false;
+    }
+
+    phase_ = Phase::DISCOVERING;
+    started_ = Clock::now();
+    offers_.clear();
+    LOG_INFO("StateSync", "Looking for a state snapshot past #" + std::to_string(height + min_distance_));
+    for (auto& [_, peer] : peers_) {
+        peer.answered = false;
+        peer.offer.clear();
+        peer.send(MessageType::GET_SNAPSHOT_MANIFEST, std::string());
+    }
+    return true;
+}
+
+void StateSync::on_manifest(const std::string& peer_id, const SnapshotManifest& manifest) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto peer_it = peers_.find(peer_id);
+    if (peer_it == peers_.end() || phase_ == Phase::IDLE) {
+        return;
+    }
+    Peer& peer = peer_it->second;
+    peer.answered = true;
+    if (manifest.empty()) {
+        peer.offer.clear();
+    } else if (!manifest.verify()) {
+        LOG_WARN("StateSync", "Dropping peer " + peer_id + ": manifest does not match its state root");
+        _drop_peer(peer_id);
+    } else {
+        peer.offer = manifest.state_root;
+        offers_.emplace(manifest.state_root, manifest);
+    }
+
+    if (phase_ == Phase::DISCOVERING) {
+        _choose();
+    } else {
+        _pump();  // Possibly one more source for the snapshot being fetched
+    }
+}
+
+void StateSync::_drop_offer(const std::string& state_root) {
+    offers_.erase(state_root);
+    std::vector<std::string> liars;
+    for (const auto& [peer_id, peer] : peers_) {
+        if (peer.offer == state_root) {
+            liars.push_back(peer_id);
+        }
+    }
+    for (const auto& peer_id : liars) {
+        _drop_peer(peer_id);
+    }
+}
+
+void StateSync::_choose() {
+    size_t height = blockchain_.get_chain_height();
+    const SnapshotManifest* best = nullptr;
+    bool waiting = false;  // Some offer is ahead of the synced headers
+    std::vector<std::string> rejected;
+
+    for (const auto& [state_root, manifest] : offers_) {
+        if (manifest.height < height + min_distance_) {
+            continue;
+        }
+        BlockHeader at, next;
+        if (!find_header_(static_cast<int>(manifest.height), at) ||
+            !find_header_(static_cast<int>(manifest.height + 1), next)) {
+            waiting = true;
+            continue;
+        }
+        if (at.hash != manifest.block_hash || next.state_root != manifest.state_root) {
+            rejected.push_back(state_root);
+            continue;
+        }
+        if (!best || manifest.height > best->height) {
+            best = &manifest;
+        }
+    }
+
+    if (best) {
+        _begin_download(*best);
+        return;
+    }
+    for (const auto& state_root : rejected) {
+        LOG_WARN("StateSync", "Snapshot " + state_root.substr(0, 16) + " is not on the header chain");
+        _drop_offer(state_root);
+    }
+
+    bool all_answered = std::all_of(peers_.begin(), peers_.end(),
+                                    [](const auto& entry) { return entry.second.answered; });
+    if ((all_answered && !waiting) || Clock::now() - started_ > std::chrono::seconds(DISCOVERY_TIMEOUT_SECONDS)) {
+        LOG_INFO("StateSync", "No usable state snapshot; falling back to full block download");
+        _finish(false);
+    }
+}
+
+// ============= CHUNKS =============
+
+void StateSync::_begin_download(const SnapshotManifest& manifest) {
+    target_ = manifest;
+    phase_ = Phase::DOWNLOADING;
+    pending_.clear();
+    for (uint32_t i = 0; i < SnapshotManifest::CHUNK_COUNT; ++i) {
+        pending_.push_back(i);
+    }
+    received_.assign(SnapshotManifest::CHUNK_COUNT, false);
+    received_count_ = 0;
+    staged_.clear();
+
+    size_t sources = std::count_if(peers_.begin(), peers_.end(),
+                                   [&](const auto& entry) { return entry.second.offer == target_.state_root; });
+    LOG_INFO("StateSync", "Fetching snapshot at #" + std::to_string(target_.height) + " (" +
+             std::to_string(target_.account_count) + " accounts) from " + std::to_string(sources) + " peers");
+    _pump();
+}
+
+void StateSync::on_chunk(const std::string& peer_id, SnapshotChunk chunk) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto peer_it = peers_.find(peer_id);
+    if (peer_it == peers_.end() || phase_ != Phase::DOWNLOADING) {
+        return;
+    }
+    auto request_it = requests_.find(chunk.index);
+    if (request_it == requests_.end() || request_it->second.peer_id != peer_id) {
+        LOG_DEBUG("StateSync", "Ignoring unrequested chunk from " + peer_id);
+        return;
+    }
+    requests_.erase(request_it);
+    --peer_it->second.in_flight;
+
+    if (!chunk.available || chunk.state_root != target_.state_root) {
+        // The peer moved on to a newer snapshot; others may still serve this one
+        peer_it->second.offer.clear();
+        pending_.push_back(chunk.index);
+        _pump();
+        return;
+    }
+    if (!chunk.verify(target_)) {
+        ++chunks_rejected_;
+        LOG_WARN("StateSync", "Dropping peer " + peer_id + ": chunk " + std::to_string(chunk.index) +
+                 " does not match the manifest");
+        pending_.push_back(chunk.index);
+        _drop_peer(peer_id);
+        _pump();
+        return;
+    }
+
+    ++chunks_received_;
+    if (!received_[chunk.index]) {
+        received_[chunk.index] = true;
+        ++received_count_;
+        staged_.insert(staged_.end(), std::make_move_iterator(chunk.accounts.begin()),
+                       std::make_move_iterator(chunk.accounts.end()));
+    }
+
+    if (received_count_ < SnapshotManifest::CHUNK_COUNT) {
+        _pump();
+        return;
+    }
+    bool installed = install_(target_, staged_);
+    if (installed) {
+        ++snapshots_installed_;
+        LOG_INFO("StateSync", "Installed state snapshot at #" + std::to_string(target_.height));
+    } else {
+        LOG_WARN("StateSync", "Snapshot at #" + std::to_string(target_.height) + " could not be installed");
+    }
+    _finish(installed);
+}
+
+void StateSync::_pump() {
+    Clock::time_point now = Clock::now();
+    for (auto it = requests_.begin(); it != requests_.end();) {
+        if (now - it->second.sent > std::chrono::seconds(REQUEST_TIMEOUT_SECONDS)) {
+            auto peer = peers_.find(it->second.peer_id);
+            if (peer != peers_.end()) {
+                --peer->second.in_flight;
+            }
+            pending_.push_back(it->first);
+            it = requests_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Round-robin so every peer serving the snapshot carries part of it
+    bool assigned = true;
+    while (assigned && !pending_.empty()) {
+        assigned = false;
+        for (auto& [peer_id, peer] : peers_) {
+            if (pending_.empty()) {
+                break;
+            }
+            if (peer.offer != target_.state_root || peer.in_flight >= MAX_CHUNKS_PER_PEER) {
+                continue;
+            }
+            wire::ChunkRequest request{target_.state_root, pending_.front()};
+            pending_.pop_front();
+            requests_[request.index] = Request{peer_id, now};
+            ++peer.in_flight;
+            peer.send(MessageType::GET_SNAPSHOT_CHUNK, wire::encode_chunk_request(request));
+            assigned = true;
+        }
+    }
+
+    if (!pending_.empty() && requests_.empty()) {
+        LOG_INFO("StateSync", "No peer serves snapshot " + target_.state_root.substr(0, 16) +
+                 " any more; falling back to full block download");
+        _finish(false);
+    }
+}
+
+// ============= STATE =============
+
+void StateSync::poll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (phase_ == Phase::DISCOVERING) {
+        _choose();
+    } else if (phase_ == Phase::DOWNLOADING) {
+        _pump();
+    }
+}
+
+void StateSync::_finish(bool installed) {
+    for (auto& [_, peer] : peers_) {
+        peer.in_flight = 0;
+    }
+    phase_ = Phase::IDLE;
+    requests_.clear();
+    pending_.clear();
+    offers_.clear();
+    received_.clear();
+    std::vector<StateTree::Account>().swap(staged_);
+    target_ = SnapshotManifest();
+    done_(installed);
+}
+
+bool StateSync::is_active() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return phase_ != Phase::IDLE;
+}
+
+json StateSync::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json j;
+    j["phase"] = phase_ == Phase::IDLE ? "idle" : phase_ == Phase::DISCOVERING ? "discovering" : "downloading";
+    j["peers"] = peers_.size();
+    j["offers"] = offers_.size();
+    if (phase_ == Phase::DOWNLOADING) {
+        j["target_height"] = target_.height;
+        j["chunks_done"] = received_count_;
+        j["chunks_in_flight"] = requests_.size();
+    }
+    j["chunks_received"] = chunks_received_;
+    j["chunks_rejected"] = chunks_rejected_;
+    j["snapshots_installed"] = snapshots_installed_;
+    return j;
+}
@@ -0,0 +1,119 @@
+#ifndef STATE_SYNC_HPP
+#define STATE_SYNC_HPP
+
+#include "blockchain.hpp"
+#include "chain_sync.hpp"
+#include "state_snapshot.hpp"
+#include "wire_protocol.hpp"
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * StateSync - Fast bootstrap from a chunked state snapshot
+ *
+ * A node more than min_snapshot_distance() blocks behind a peer asks every
+ * peer for its newest snapshot manifest (GET_SNAPSHOT_MANIFEST). A manifest
+ * is used only once the synced header chain has reached it: the header at
+ * its height must carry its block hash and the next header its state root.
+ * The tallest such snapshot wins.
+ *
+ * Chunks are then requested from every peer offering that snapshot, at most
+ * MAX_CHUNKS_PER_PEER in flight per peer, and checked against the manifest
+ * as they arrive; a bad chunk drops its peer and is fetched elsewhere.
+ * Verified accounts are staged as they stream in and installed in one step
+ * with the headers up to the snapshot height, after which ChainSync replays
+ * only the blocks above it. If no usable snapshot turns up, or every peer
+ * serving it goes away, the sync gives up and ChainSync downloads the whole
+ * chain as before.
+ *
+ * Callbacks run under the internal mutex, as in ChainSync.
+ */
+class StateSync {
+public:
+    using SendFn = ChainSync::SendFn;
+    // Verified header for block `index`, if the header chain has reached it
+    using HeaderFn = std::function<bool(int index, BlockHeader& header)>;
+    // Installs verified state for the manifest's height (and the headers leading to it)
+    using InstallFn = std::function<bool(const SnapshotManifest& manifest,
+                                         const std::vector<StateTree::Account>& accounts)>;
+    // Called when a sync ends, installed or not
+    using DoneFn = std::function<void(bool installed)>;
+
+    static constexpr size_t MAX_CHUNKS_PER_PEER = 4;
+    static constexpr int REQUEST_TIMEOUT_SECONDS = 15;
+    static constexpr int DISCOVERY_TIMEOUT_SECONDS = 60;
+
+    StateSync(Blockchain& blockchain, HeaderFn find_header, InstallFn install, DoneFn done);
+
+    void add_peer(const std::string& peer_id, size_t height, SendFn send);
+    void remove_peer(const std::string& peer_id);
+    void update_peer_height(const std::string& peer_id, size_t height);
+
+    // Snapshots are only worth fetching this far behind the tallest peer
+    void set_min_snapshot_distance(size_t blocks) { min_distance_ = blocks; }
+    size_t min_snapshot_distance() const { return min_distance_; }
+
+    // Ask peers for manifests if one is far enough ahead; true while a sync is running
+    bool start();
+
+    void on_manifest(const std::string& peer_id, const SnapshotManifest& manifest);
+    void on_chunk(const std::string& peer_id, SnapshotChunk chunk);
+    // Re-check pending manifests against newly synced headers, and request timeouts
+    void poll();
+
+    bool is_active() const;
+    json stats_json() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    enum class Phase { IDLE, DISCOVERING, DOWNLOADING };
+
+    struct Peer {
+        size_t height = 0;
+        SendFn send;
+        bool answered = false;          // Replied to this sync's manifest request
+        std::string offer;              // State root of the snapshot it serves
+        size_t in_flight = 0;
+    };
+
+    struct Request {
+        std::string peer_id;
+        Clock::time_point sent;
+    };
+
+    Blockchain& blockchain_;
+    HeaderFn find_header_;
+    InstallFn install_;
+    DoneFn done_;
+    size_t min_distance_ = Blockchain::DEFAULT_STATE_SNAPSHOT_INTERVAL;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Peer> peers_;
+    Phase phase_ = Phase::IDLE;
+    Clock::time_point started_;
+    std::map<std::string, SnapshotManifest> offers_;  // Self-consistent manifests by state root
+    SnapshotManifest target_;
+    std::deque<uint32_t> pending_;                    // Chunks not yet requested
+    std::map<uint32_t, Request> requests_;            // In flight, by chunk index
+    std::vector<bool> received_;
+    size_t received_count_ = 0;
+    std::vector<StateTree::Account> staged_;          // Accounts of every verified chunk
+
+    size_t chunks_received_ = 0;
+    size_t chunks_rejected_ = 0;
+    size_t snapshots_installed_ = 0;
+
+    void _drop_peer(const std::string& peer_id);
+    void _drop_offer(const std::string& state_root);
+    void _choose();
+    void _begin_download(const SnapshotManifest& manifest);
+    void _pump();
+    void _finish(bool installed);
+};
+
+#endif // STATE_SYNC_HPP
@@ -0,0 +1,303 @@
+#include "state_tree.hpp"
+#include "merkle.hpp"
+#include <algorithm>
+#include <cstring>
+#include <openssl/sha.h>
+
+namespace {
+
+constexpr uint8_t LEAF_TAG = 0x00;
+constexpr uint8_t BUCKET_TAG = 0x01;
+constexpr uint8_t NODE_TAG = 0x02;
+
+uint8_t* put_u32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) *out++ = static_cast<uint8_t>(value >> (8 * i));
+    return out;
+}
+
+uint8_t* put_u64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) *out++ = static_cast<uint8_t>(value >> (8 * i));
+    return out;
+}
+
+}  // namespace
+
+StateTree::StateTree() {
+    clear();
+}
+
+void StateTree::clear() {
+    buckets_.assign(BUCKET_COUNT, {});
+    bucket_dirty_.assign(BUCKET_COUNT, false);
+    dirty_buckets_.clear();
+    account_count_ = 0;
+
+    // Empty subtrees hash to a per-level default, so a fresh tree needs no work per bucket
+    levels_.assign(BUCKET_BITS + 1, {});
+    Hash empty{};
+    for (unsigned level = 0; level <= BUCKET_BITS; ++level) {
+        levels_[level].assign(BUCKET_COUNT >> level, empty);
+        empty = node_hash(empty, empty);
+    }
+}
+
+// ============= HASHING =============
+uint32_t StateTree::bucket_of(const std::string& address) {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const uint8_t*>(address.data()), address.size(), digest);
+    uint32_t prefix = (uint32_t(digest[0]) << 24) | (uint32_t(digest[1]) << 16) |
+                      (uint32_t(digest[2]) << 8) | uint32_t(digest[3]);
+    return prefix >> (32 - BUCKET_BITS);
+}
+
+StateTree::Hash StateTree::leaf_hash(const std::string& address, double balance, uint64_t nonce) {
+    // Addresses are short; only an unusually long one needs the heap
+    uint8_t stack_buffer[256];
+    std::vector<uint8_t> heap_buffer;
+    size_t size = 1 + 4 + address.size() + 16;
+    uint8_t* data = stack_buffer;
+    if (size > sizeof(stack_buffer)) {
+        heap_buffer.resize(size);
+        data = heap_buffer.data();
+    }
+
+    uint8_t* out = data;
+    *out++ = LEAF_TAG;
+    out = put_u32(out, static_cast<uint32_t>(address.size()));
+    std::memcpy(out, address.data(), address.size());
+    out += address.size();
+    uint64_t balance_bits;
+    std::memcpy(&balance_bits, &balance, sizeof(balance_bits));
+    out = put_u64(out, balance_bits);
+    put_u64(out, nonce);
+
+    Hash hash;
+    SHA256(data, size, hash.data());
+    return hash;
+}
+
+StateTree::Hash StateTree::bucket_hash(const Hash* leaves, size_t count, std::pmr::memory_resource* scratch) {
+    if (count == 0) {
+        return Hash{};
+    }
+    std::pmr::vector<uint8_t> data(1 + count * 32, scratch);
+    data[0] = BUCKET_TAG;
+    for (size_t i = 0; i < count; ++i) {
+        std::memcpy(data.data() + 1 + i * 32, leaves[i].data(), 32);
+    }
+    Hash hash;
+    SHA256(data.data(), data.size(), hash.data());
+    return hash;
+}
+
+StateTree::Hash StateTree::node_hash(const Hash& left, const Hash& right) {
+    uint8_t data[1 + 64];
+    data[0] = NODE_TAG;
+    std::memcpy(data + 1, left.data(), 32);
+    std::memcpy(data + 33, right.data(), 32);
+    Hash out;
+    SHA256(data, sizeof(data), out.data());
+    return out;
+}
+
+std::string StateTree::to_hex(const Hash& hash) {
+    return MerkleTree::to_hex(hash);
+}
+
+// ============= UPDATES =============
+void StateTree::set(const std::string& address, double balance, uint64_t nonce) {
+    uint32_t bucket = bucket_of(address);
+    auto& leaves = buckets_[bucket];
+    Hash leaf = leaf_hash(address, balance, nonce);
+
+    auto it = leaves.find(address);
+    if (it == leaves.end()) {
+        leaves.emplace(address, leaf);
+        ++account_count_;
+    } else if (it->second == leaf) {
+        return;  // Unchanged; keep cached hashes
+    } else {
+        it->second = leaf;
+    }
+    mark_dirty(bucket);
+}
+
+void StateTree::erase(const std::string& address) {
+    uint32_t bucket = bucket_of(address);
+    if (buckets_[bucket].erase(address) > 0) {
+        --account_count_;
+        mark_dirty(bucket);
+    }
+}
+
+void StateTree::mark_dirty(uint32_t bucket) {
+    if (!bucket_dirty_[bucket]) {
+        bucket_dirty_[bucket] = true;
+        dirty_buckets_.push_back(bucket);
+    }
+}
+
+void StateTree::commit(std::pmr::memory_resource* scratch) {
+    if (dirty_buckets_.empty()) {
+        return;
+    }
+
+    // dirty_buckets_ keeps its capacity for the next block
+    std::pmr::vector<uint32_t> dirty(dirty_buckets_.begin(), dirty_buckets_.end(), scratch);
+    dirty_buckets_.clear();
+    std::sort(dirty.begin(), dirty.end());
+
+    std::pmr::vector<Hash> leaves(scratch);
+    for (uint32_t bucket : dirty) {
+        bucket_dirty_[bucket] = false;
+        leaves.clear();
+        for (const auto& [_, leaf] : buckets_[bucket]) {
+            leaves.push_back(leaf);
+        }
+        levels_[0][bucket] = bucket_hash(leaves.data(), leaves.size(), scratch);
+    }
+
+    // Walk up only the paths above dirty buckets; siblings stay cached
+    for (unsigned level = 1; level <= BUCKET_BITS; ++level) {
+        size_t out = 0;
+        for (size_t i = 0; i < dirty.size(); ++i) {
+            uint32_t parent = dirty[i] >> 1;
+            if (out > 0 && dirty[out - 1] == parent) {
+                continue;
+            }
+            const auto& below = levels_[level - 1];
+            levels_[level][parent] = node_hash(below[parent * 2], below[parent * 2 + 1]);
+            dirty[out++] = parent;
+        }
+        dirty.resize(out);
+    }
+}
+
+StateTree::Hash StateTree::root(std::pmr::memory_resource* scratch) {
+    commit(scratch);
+    return levels_[BUCKET_BITS][0];
+}
+
+std::string StateTree::root_hex(std::pmr::memory_resource* scratch) {
+    return to_hex(root(scratch));
+}
+
+// ============= PROOFS =============
+bool StateTree::prove(const std::string& address, double balance, uint64_t nonce, Proof& proof) {
+    commit();
+
+    uint32_t bucket = bucket_of(address);
+    const auto& leaves = buckets_[bucket];
+    auto it = leaves.find(address);
+    if (it == leaves.end() || it->second != leaf_hash(address, balance, nonce)) {
+        return false;
+    }
+
+    proof = Proof();
+    proof.address = address;
+    proof.balance = balance;
+    proof.nonce = nonce;
+    proof.bucket = bucket;
+    proof.leaf_position = std::distance(leaves.begin(), it);
+    for (const auto& [_, leaf] : leaves) {
+        proof.bucket_leaves.push_back(leaf);
+    }
+
+    uint32_t index = bucket;
+    for (unsigned level = 0; level < BUCKET_BITS; ++level) {
+        proof.siblings.push_back(levels_[level][index ^ 1]);
+        index >>= 1;
+    }
+    return true;
+}
+
+bool StateTree::verify(const Proof& proof, const std::string& root_hex) {
+    Hash expected_root;
+    if (!MerkleTree::from_hex(root_hex, expected_root) ||
+        proof.siblings.size() != BUCKET_BITS ||
+        proof.leaf_position >= proof.bucket_leaves.size() ||
+        proof.bucket != bucket_of(proof.address)) {
+        return false;
+    }
+
+    if (proof.bucket_leaves[proof.leaf_position] != leaf_hash(proof.address, proof.balance, proof.nonce)) {
+        return false;
+    }
+
+    Hash current = bucket_hash(proof.bucket_leaves);
+    uint32_t index = proof.bucket;
+    for (const auto& sibling : proof.siblings) {
+        current = (index & 1) ? node_hash(sibling, current) : node_hash(current, sibling);
+        index >>= 1;
+    }
+    return current == expected_root;
+}
+
+// ============= SUBTREES =============
+bool StateTree::subtree_root(unsigned level, size_t index, const std::vector<Account>& accounts, Hash& root) {
+    if (level > BUCKET_BITS || index >= (BUCKET_COUNT >> level)) {
+        return false;
+    }
+    size_t first_bucket = index << level;
+    size_t width = size_t(1) << level;
+
+    // Same leaf order as buckets_: address order within each bucket
+    std::vector<std::map<std::string, Hash>> buckets(width);
+    for (const auto& account : accounts) {
+        size_t bucket = bucket_of(account.address);
+        if (bucket < first_bucket || bucket >= first_bucket + width ||
+            !buckets[bucket - first_bucket].emplace(account.address,
+                leaf_hash(account.address, account.balance, account.nonce)).second) {
+            return false;
+        }
+    }
+
+    std::vector<Hash> hashes(width);
+    std::vector<Hash> leaves;
+    for (size_t i = 0; i < width; ++i) {
+        leaves.clear();
+        for (const auto& [_, leaf] : buckets[i]) {
+            leaves.push_back(leaf);
+        }
+        hashes[i] = bucket_hash(leaves);
+    }
+    while (hashes.size() > 1) {
+        for (size_t i = 0; i < hashes.size() / 2; ++i) {
+            hashes[i] = node_hash(hashes[2 * i], hashes[2 * i + 1]);
+        }
+        hashes.resize(hashes.size() / 2);
+    }
+    root = hashes[0];
+    return true;
+}
+
+StateTree::Hash StateTree::root_of_subtrees(std::vector<Hash> subtrees) {
+    if (subtrees.empty()) {
+        return Hash{};
+    }
+    while (subtrees.size() > 1) {
+        for (size_t i = 0; i < subtrees.size() / 2; ++i) {
+            subtrees[i] = node_hash(subtrees[2 * i], subtrees[2 * i + 1]);
+        }
+        subtrees.resize(subtrees.size() / 2);
+    }
+    return subtrees[0];
+}
+
+json StateTree::Proof::to_json() const {
+    json j;
+    j["address"] = address;
+    j["balance"] = balance;
+    j["nonce"] = nonce;
+    j["bucket"] = bucket;
+    j["leaf_position"] = leaf_position;
+    j["bucket_leaves"] = json::array();
+    for (const auto& leaf : bucket_leaves) {
+        j["bucket_leaves"].push_back(to_hex(leaf));
+    }
+    j["siblings"] = json::array();
+    for (const auto& sibling : siblings) {
+        j["siblings"].push_back(to_hex(sibling));
+    }
+    return j;
+}
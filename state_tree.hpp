@@ -0,0 +1,100 @@
+#ifndef STATE_TREE_HPP
+#define STATE_TREE_HPP
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+/**
+ * StateTree - Authenticated account state with incremental root updates
+ *
+ * Accounts are spread over 2^BUCKET_BITS buckets by the leading bits of
+ * sha256(address). A bucket hashes its leaves in address order; a binary
+ * Merkle tree of fixed depth BUCKET_BITS sits on top of the bucket hashes.
+ *
+ *   leaf   = sha256(0x00 | u32 len | address | f64 balance | u64 nonce)
+ *   bucket = sha256(0x01 | leaf...)            (all-zero hash when empty)
+ *   node   = sha256(0x02 | left | right)
+ *
+ * set()/erase() only rehash the account's leaf and mark its bucket dirty;
+ * root() rehashes dirty buckets and their paths, leaving every other
+ * subtree hash cached. Cost per block is O(touched accounts * BUCKET_BITS).
+ * The scratch space that rehashing needs comes from the resource given to
+ * root(), typically the caller's block arena.
+ */
+class StateTree {
+public:
+    using Hash = std::array<uint8_t, 32>;
+
+    static constexpr unsigned BUCKET_BITS = 16;
+    static constexpr size_t BUCKET_COUNT = size_t(1) << BUCKET_BITS;
+
+    // Inclusion proof for a single account against root()
+    struct Proof {
+        std::string address;
+        double balance = 0.0;
+        uint64_t nonce = 0;
+        uint32_t bucket = 0;
+        size_t leaf_position = 0;          // Index of this account within bucket_leaves
+        std::vector<Hash> bucket_leaves;   // Every leaf hash in the bucket, address order
+        std::vector<Hash> siblings;        // BUCKET_BITS sibling hashes, bottom up
+
+        json to_json() const;
+    };
+
+    // One account as carried in a state snapshot chunk
+    struct Account {
+        std::string address;
+        double balance = 0.0;
+        uint64_t nonce = 0;
+    };
+
+    StateTree();
+
+    void set(const std::string& address, double balance, uint64_t nonce);
+    void erase(const std::string& address);
+    void clear();
+
+    Hash root(std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+    std::string root_hex(std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+    bool prove(const std::string& address, double balance, uint64_t nonce, Proof& proof);
+    static bool verify(const Proof& proof, const std::string& root_hex);
+
+    size_t size() const { return account_count_; }
+
+    static std::string to_hex(const Hash& hash);
+    static uint32_t bucket_of(const std::string& address);
+
+    // Root of the subtree `level` steps above the buckets, covering buckets
+    // [index << level, (index + 1) << level), computed from the accounts it
+    // holds alone. False if an account falls outside it or appears twice.
+    static bool subtree_root(unsigned level, size_t index, const std::vector<Account>& accounts, Hash& root);
+    // Fold one level's subtree hashes (all of them, left to right) up to the root
+    static Hash root_of_subtrees(std::vector<Hash> subtrees);
+
+private:
+    std::vector<std::map<std::string, Hash>> buckets_;  // address -> leaf hash
+    std::vector<std::vector<Hash>> levels_;             // levels_[0] = bucket hashes, levels_[BUCKET_BITS] = root
+    std::vector<uint32_t> dirty_buckets_;
+    std::vector<bool> bucket_dirty_;
+    size_t account_count_ = 0;
+
+    void commit(std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+    void mark_dirty(uint32_t bucket);
+
+    static Hash leaf_hash(const std::string& address, double balance, uint64_t nonce);
+    static Hash bucket_hash(const Hash* leaves, size_t count, std::pmr::memory_resource* scratch);
+    static Hash bucket_hash(const std::vector<Hash>& leaves) {
+        return bucket_hash(leaves.data(), leaves.size(), std::pmr::get_default_resource());
+    }
+    static Hash node_hash(const Hash& left, const Hash& right);
+};
+
+#endif // STATE_TREE_HPP
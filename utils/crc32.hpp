@@ -0,0 +1,31 @@
+#ifndef CRC32_HPP
+#define CRC32_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * CRC-32 (IEEE 802.3, reflected) used to checksum log records and wire frames
+ */
+inline uint32_t crc32(const uint8_t* data, size_t length) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+#endif // CRC32_HPP
@@ -0,0 +1,23 @@
+#ifndef FILE_SYNC_HPP
+#define FILE_SYNC_HPP
+
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+/**
+ * Flush a file (or a directory, after a rename into it) to stable storage.
+ * Linux syncs every dirty page of the inode, whichever descriptor wrote it,
+ * so this also covers data written through an std::ofstream.
+ */
+inline bool sync_path(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+#endif // FILE_SYNC_HPP
@@ -1,13 +1,92 @@
 #include "logger.hpp"
+#include <algorithm>
 
 // Static member initialization
 std::mutex Logger::mutex_;
+std::atomic<int> Logger::level_{static_cast<int>(LogLevel::INFO)};
 
-Logger::Logger() : current_level_(LogLevel::INFO), file_enabled_(false), 
-                   console_enabled_(true) {
+// ============= PER-THREAD RINGS =============
+
+struct Logger::Ring {
+    static constexpr size_t CAPACITY = 4096;
+
+    struct Record {
+        LogLevel level;
+        std::chrono::system_clock::time_point time;
+        uint64_t sequence;
+        std::string module;
+        std::string message;
+    };
+
+    std::vector<Record> slots = std::vector<Record>(CAPACITY);
+    alignas(64) std::atomic<size_t> head{0};  // Next slot the owning thread fills
+    alignas(64) std::atomic<size_t> tail{0};  // Next slot the writer drains
+    std::atomic<bool> orphaned{false};        // Owning thread has exited
+
+    bool push(LogLevel level, uint64_t sequence, const std::string& module, const std::string& message) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == CAPACITY) {
+            return false;
+        }
+        Record& record = slots[h % CAPACITY];
+        record.level = level;
+        record.time = std::chrono::system_clock::now();
+        record.sequence = sequence;
+        record.module = module;
+        record.message = message;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void pop_all(std::vector<Record>& out) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        for (; t != h; ++t) {
+            out.push_back(std::move(slots[t % CAPACITY]));
+        }
+        tail.store(t, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+    }
+};
+
+Logger::Ring& Logger::thread_ring() {
+    // Marks the ring for collection once its thread exits
+    struct Owner {
+        std::shared_ptr<Ring> ring;
+        ~Owner() {
+            if (ring) {
+                ring->orphaned.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Owner owner;
+
+    if (!owner.ring) {
+        owner.ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(owner.ring);
+    }
+    return *owner.ring;
+}
+
+// ============= WRITER =============
+
+Logger::Logger() : file_enabled_(false), console_enabled_(true) {
+    writer_ = std::thread([this]() { run_writer(); });
 }
 
 Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        stopping_ = true;
+    }
+    writer_cv_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
     if (file_stream_.is_open()) {
         file_stream_.close();
     }
@@ -18,8 +97,104 @@ Logger& Logger::getInstance() {
     return instance;
 }
 
-std::string Logger::get_timestamp() {
-    auto now = std::chrono::system_clock::now();
+void Logger::run_writer() {
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    while (true) {
+        // Everything logged before this ticket was requested is in a ring by now
+        uint64_t ticket = flush_requested_;
+        bool stopping = stopping_;
+        lock.unlock();
+        size_t drained = drain();
+        lock.lock();
+
+        flush_done_ = ticket;
+        flushed_cv_.notify_all();
+        if (stopping) {
+            break;
+        }
+        if (drained < Ring::CAPACITY / 2) {
+            writer_cv_.wait_for(lock, std::chrono::milliseconds(10),
+                                [&]() { return stopping_ || flush_requested_ != ticket; });
+        }
+    }
+}
+
+size_t Logger::drain() {
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings = rings_;
+    }
+
+    std::vector<Ring::Record> records;
+    std::vector<Ring*> finished;
+    for (const auto& ring : rings) {
+        // Read before draining: an orphaned ring gets no more records
+        bool orphaned = ring->orphaned.load(std::memory_order_acquire);
+        ring->pop_all(records);
+        if (orphaned) {
+            finished.push_back(ring.get());
+        }
+    }
+    if (!finished.empty()) {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [&](const std::shared_ptr<Ring>& ring) {
+            return std::find(finished.begin(), finished.end(), ring.get()) != finished.end();
+        }), rings_.end());
+    }
+
+    static uint64_t reported_drops = 0;  // Writer thread only
+    uint64_t drops = dropped_.load(std::memory_order_relaxed);
+    if (records.empty() && drops == reported_drops) {
+        return 0;
+    }
+    std::sort(records.begin(), records.end(), [](const Ring::Record& a, const Ring::Record& b) {
+        return a.sequence < b.sequence;
+    });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto write_line = [&](LogLevel level, const std::string& log_line) {
+        // Console output with colors
+        if (console_enabled_) {
+            std::cout << get_color_code(level) << log_line << reset_color() << '\n';
+        }
+        // File output
+        if (file_enabled_ && file_stream_.is_open()) {
+            file_stream_ << log_line << '\n';
+        }
+    };
+    if (drops != reported_drops) {
+        write_line(LogLevel::WARN, "[" + get_timestamp(std::chrono::system_clock::now()) + "] [WARN] [Logger] " +
+                   std::to_string(drops - reported_drops) + " log records dropped (ring full)");
+        reported_drops = drops;
+    }
+    for (const auto& record : records) {
+        write_line(record.level, "[" + get_timestamp(record.time) + "] [" + level_to_string(record.level) +
+                   "] [" + record.module + "] " + record.message);
+    }
+    // One flush per batch rather than per line
+    if (console_enabled_) {
+        std::cout.flush();
+    }
+    if (file_enabled_ && file_stream_.is_open()) {
+        file_stream_.flush();
+    }
+    return records.size();
+}
+
+void Logger::flush() {
+    Logger& logger = getInstance();
+    std::unique_lock<std::mutex> lock(logger.writer_mutex_);
+    uint64_t ticket = ++logger.flush_requested_;
+    logger.writer_cv_.notify_one();
+    logger.flushed_cv_.wait(lock, [&]() { return logger.flush_done_ >= ticket || logger.stopping_; });
+}
+
+uint64_t Logger::dropped_count() {
+    return getInstance().dropped_.load(std::memory_order_relaxed);
+}
+
+std::string Logger::get_timestamp(std::chrono::system_clock::time_point now) {
     auto time = std::chrono::system_clock::to_time_t(now);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         now.time_since_epoch()) % 1000;
@@ -96,43 +271,28 @@ void Logger::disable_console_logging() {
 }
 
 void Logger::set_level(LogLevel level) {
-    Logger& logger = getInstance();
-    std::lock_guard<std::mutex> lock(mutex_);
-    logger.current_level_ = level;
+    level_.store(static_cast<int>(level), std::memory_order_relaxed);
 }
 
 LogLevel Logger::get_level() {
-    Logger& logger = getInstance();
-    std::lock_guard<std::mutex> lock(mutex_);
-    return logger.current_level_;
+    return static_cast<LogLevel>(level_.load(std::memory_order_relaxed));
 }
 
 void Logger::log(LogLevel level, const std::string& module, 
                  const std::string& message) {
-    Logger& logger = getInstance();
-    
     // Check if we should log this level
-    if (level < logger.current_level_) {
+    if (!enabled(level)) {
         return;
     }
     
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::string timestamp = get_timestamp();
-    std::string level_str = level_to_string(level);
-    std::string log_line = "[" + timestamp + "] [" + level_str + "] [" + 
-                          module + "] " + message;
-    
-    // Console output with colors
-    if (logger.console_enabled_) {
-        std::string color = get_color_code(level);
-        std::cout << color << log_line << reset_color() << std::endl;
+    Logger& logger = getInstance();
+    uint64_t sequence = logger.sequence_.fetch_add(1, std::memory_order_relaxed);
+    if (!logger.thread_ring().push(level, sequence, module, message)) {
+        logger.dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
-    
-    // File output
-    if (logger.file_enabled_ && logger.file_stream_.is_open()) {
-        logger.file_stream_ << log_line << std::endl;
-        logger.file_stream_.flush();
+    if (level >= LogLevel::ERROR) {
+        logger.writer_cv_.notify_one();  // Don't let errors sit in a ring
     }
 }
 
@@ -8,6 +8,11 @@
 #include <mutex>
 #include <chrono>
 #include <iomanip>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <vector>
 
 enum class LogLevel {
     DEBUG = 0,
@@ -17,29 +22,67 @@ enum class LogLevel {
     CRITICAL = 4
 };
 
+// Calls below this level compile out entirely. Defaults to INFO in release
+// (NDEBUG) builds; override with -DLOG_MIN_LEVEL=<0..4>.
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL 1
+#else
+#define LOG_MIN_LEVEL 0
+#endif
+#endif
+
+/**
+ * Logger - Asynchronous process-wide log
+ *
+ * A logging thread appends its record to its own fixed-size ring, without
+ * locks or formatting; a background writer drains every ring, orders the
+ * records and does the timestamping and I/O. When a ring is full the record
+ * is dropped and counted rather than blocking the caller. flush() returns
+ * once everything logged before it has been written.
+ */
 class Logger {
 private:
-    static std::mutex mutex_;
-    
-    LogLevel current_level_;
+    struct Ring;  // Per-thread single-producer queue (logger.cpp)
+
+    static std::mutex mutex_;              // Output configuration
+    static std::atomic<int> level_;
+
     std::ofstream file_stream_;
     bool file_enabled_;
     bool console_enabled_;
     std::string log_file_;
-    
+
+    std::vector<std::shared_ptr<Ring>> rings_;
+    std::mutex rings_mutex_;
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::thread writer_;
+    std::mutex writer_mutex_;
+    std::condition_variable writer_cv_;
+    std::condition_variable flushed_cv_;
+    uint64_t flush_requested_ = 0;
+    uint64_t flush_done_ = 0;
+    bool stopping_ = false;
+
     Logger();
-    
+
     static std::string level_to_string(LogLevel level);
-    static std::string get_timestamp();
+    static std::string get_timestamp(std::chrono::system_clock::time_point now);
     static std::string get_color_code(LogLevel level);
     static std::string reset_color();
 
+    Ring& thread_ring();
+    void run_writer();
+    size_t drain();
+
 public:
     ~Logger();
-    
+
     // Singleton access
     static Logger& getInstance();
-    
+
     // Configuration
     static void enable_file_logging(const std::string& filepath);
     static void disable_file_logging();
@@ -47,24 +90,41 @@ public:
     static void disable_console_logging();
     static void set_level(LogLevel level);
     static LogLevel get_level();
-    
+
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    // Block until every record logged so far has been written
+    static void flush();
+    // Records lost to full rings since startup
+    static uint64_t dropped_count();
+
     // Logging methods
     static void debug(const std::string& module, const std::string& message);
     static void info(const std::string& module, const std::string& message);
     static void warn(const std::string& module, const std::string& message);
     static void error(const std::string& module, const std::string& message);
     static void critical(const std::string& module, const std::string& message);
-    
+
     // Internal logging (with level parameter)
-    static void log(LogLevel level, const std::string& module, 
+    static void log(LogLevel level, const std::string& module,
                    const std::string& message);
 };
 
-// Convenience macros
-#define LOG_DEBUG(module, msg) Logger::debug(module, msg)
-#define LOG_INFO(module, msg) Logger::info(module, msg)
-#define LOG_WARN(module, msg) Logger::warn(module, msg)
-#define LOG_ERROR(module, msg) Logger::error(module, msg)
-#define LOG_CRITICAL(module, msg) Logger::critical(module, msg)
+// Convenience macros. `msg` is only evaluated when the level is enabled, so
+// building the message costs nothing for filtered calls.
+#define LOG_AT(level, module, msg)                                                        \
+    do {                                                                                  \
+        if (static_cast<int>(level) >= LOG_MIN_LEVEL && Logger::enabled(level)) {         \
+            Logger::log(level, module, msg);                                              \
+        }                                                                                 \
+    } while (0)
+
+#define LOG_DEBUG(module, msg) LOG_AT(LogLevel::DEBUG, module, msg)
+#define LOG_INFO(module, msg) LOG_AT(LogLevel::INFO, module, msg)
+#define LOG_WARN(module, msg) LOG_AT(LogLevel::WARN, module, msg)
+#define LOG_ERROR(module, msg) LOG_AT(LogLevel::ERROR, module, msg)
+#define LOG_CRITICAL(module, msg) LOG_AT(LogLevel::CRITICAL, module, msg)
 
 #endif // LOGGER_HPP
@@ -1,28 +1,59 @@
 #ifndef MEMORY_MONITOR_HPP
 #define MEMORY_MONITOR_HPP
 
+#include "metrics.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <iostream>
 #include <string>
 #include <map>
 #include <mutex>
+#include <unordered_map>
 
 /**
  * Memory monitoring and profiling utilities
  * Tracks allocation sizes and patterns without runtime overhead in production
+ *
+ * Totals are atomics and per-category bytes are metrics counters
+ * ("memory_allocated_bytes_total"), so recording takes no lock once a thread
+ * has seen a category; the mutex only guards the category list.
  */
 class MemoryMonitor {
 private:
     static constexpr bool ENABLED = true;  // Can be disabled for production
     
-    size_t total_allocated_ = 0;
-    size_t total_freed_ = 0;
-    size_t peak_usage_ = 0;
-    size_t current_usage_ = 0;
-    std::map<std::string, size_t> category_usage_;
+    std::atomic<size_t> total_allocated_{0};
+    std::atomic<size_t> total_freed_{0};
+    std::atomic<size_t> peak_usage_{0};
+    std::atomic<size_t> current_usage_{0};
+    std::map<std::string, metrics::Counter*> categories_;
     mutable std::mutex mutex_;
     
     MemoryMonitor() = default;
     
+    metrics::Counter& category_counter(const std::string& category) {
+        thread_local std::unordered_map<std::string, metrics::Counter*> cache;
+        auto it = cache.find(category);
+        if (it != cache.end()) {
+            return *it->second;
+        }
+        metrics::Counter& counter = metrics::counter("memory_allocated_bytes_total",
+                                                     "Bytes recorded by MemoryMonitor, by category",
+                                                     {{"category", category}});
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            categories_[category] = &counter;
+        }
+        cache.emplace(category, &counter);
+        return counter;
+    }
+    
+    static metrics::Gauge& usage_gauge() {
+        static metrics::Gauge& gauge = metrics::gauge("memory_current_bytes", "Bytes tracked by MemoryMonitor");
+        return gauge;
+    }
+    
 public:
     static MemoryMonitor& instance() {
         static MemoryMonitor monitor;
@@ -32,22 +63,26 @@ public:
     void record_allocation(const std::string& category, size_t bytes) {
         if (!ENABLED) return;
         
-        std::lock_guard<std::mutex> lock(mutex_);
-        total_allocated_ += bytes;
-        current_usage_ += bytes;
-        category_usage_[category] += bytes;
+        total_allocated_.fetch_add(bytes, std::memory_order_relaxed);
+        size_t usage = current_usage_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        category_counter(category).inc(bytes);
         
-        if (current_usage_ > peak_usage_) {
-            peak_usage_ = current_usage_;
+        size_t peak = peak_usage_.load(std::memory_order_relaxed);
+        while (usage > peak && !peak_usage_.compare_exchange_weak(peak, usage, std::memory_order_relaxed)) {
         }
+        usage_gauge().set(static_cast<double>(usage));
     }
     
     void record_deallocation(size_t bytes) {
         if (!ENABLED) return;
         
-        std::lock_guard<std::mutex> lock(mutex_);
-        total_freed_ += bytes;
-        current_usage_ = (current_usage_ > bytes) ? current_usage_ - bytes : 0;
+        total_freed_.fetch_add(bytes, std::memory_order_relaxed);
+        size_t usage = current_usage_.load(std::memory_order_relaxed);
+        size_t next;
+        do {
+            next = (usage > bytes) ? usage - bytes : 0;
+        } while (!current_usage_.compare_exchange_weak(usage, next, std::memory_order_relaxed));
+        usage_gauge().set(static_cast<double>(next));
     }
     
     struct MemoryStats {
@@ -59,41 +94,45 @@ public:
     };
     
     MemoryStats get_stats() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return {
-            total_allocated_,
-            total_freed_,
-            current_usage_,
-            peak_usage_,
-            category_usage_
+        MemoryStats stats{
+            total_allocated_.load(std::memory_order_relaxed),
+            total_freed_.load(std::memory_order_relaxed),
+            current_usage_.load(std::memory_order_relaxed),
+            peak_usage_.load(std::memory_order_relaxed),
+            {}
         };
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [category, counter] : categories_) {
+            stats.by_category[category] = counter->value();
+        }
+        return stats;
     }
     
     void print_summary() const {
         if (!ENABLED) return;
         
-        std::lock_guard<std::mutex> lock(mutex_);
+        MemoryStats stats = get_stats();
         
         std::cout << "\n=== Memory Usage Summary ===\n";
-        std::cout << "Total Allocated: " << (total_allocated_ / 1024) << " KB\n";
-        std::cout << "Total Freed: " << (total_freed_ / 1024) << " KB\n";
-        std::cout << "Current Usage: " << (current_usage_ / 1024) << " KB\n";
-        std::cout << "Peak Usage: " << (peak_usage_ / 1024) << " KB\n";
+        std::cout << "Total Allocated: " << (stats.total_allocated / 1024) << " KB\n";
+        std::cout << "Total Freed: " << (stats.total_freed / 1024) << " KB\n";
+        std::cout << "Current Usage: " << (stats.current_usage / 1024) << " KB\n";
+        std::cout << "Peak Usage: " << (stats.peak_usage / 1024) << " KB\n";
         
         std::cout << "\nUsage by Category:\n";
-        for (const auto& [category, bytes] : category_usage_) {
+        for (const auto& [category, bytes] : stats.by_category) {
             std::cout << "  " << category << ": " << (bytes / 1024) << " KB\n";
         }
         std::cout << std::endl;
     }
     
+    // Category totals are process metrics and are not cleared
     void reset() {
-        std::lock_guard<std::mutex> lock(mutex_);
         total_allocated_ = 0;
         total_freed_ = 0;
         peak_usage_ = 0;
         current_usage_ = 0;
-        category_usage_.clear();
+        usage_gauge().set(0.0);
     }
 };
 
@@ -2,6 +2,14 @@
 #define MEMORY_UTILS_HPP
 
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
 #include <vector>
 #include <string>
 
@@ -11,7 +19,7 @@ using json = nlohmann::json;
  * Memory optimization utilities for efficient allocation and moves
  */
 namespace memory_utils {
-    
+
     /**
      * Reserve capacity for vector to avoid reallocations
      * Usage: auto vec = reserve_vector<MyType>(expected_size);
@@ -22,7 +30,7 @@ namespace memory_utils {
         v.reserve(capacity);
         return v;
     }
-    
+
     /**
      * Efficiently move JSON to string (avoids copies)
      */
@@ -30,7 +38,7 @@ namespace memory_utils {
         // Move string from JSON dump (C++17 move semantics)
         return j.dump();
     }
-    
+
     /**
      * Clear vector and free memory
      */
@@ -38,56 +46,309 @@ namespace memory_utils {
     inline void clear_and_shrink(std::vector<T>& v) {
         std::vector<T>().swap(v);  // Clear and free memory
     }
-    
+
     /**
-     * Memory pool allocator for frequently allocated small objects
+     * MonotonicArena - Bump allocator for block-scoped temporaries
+     *
+     * A std::pmr::memory_resource, so std::pmr containers can sit on it.
+     * allocate() is one atomic add in the current chunk and may be called
+     * from several threads at once (parallel_for workers); deallocate() does
+     * nothing. Memory is reclaimed all at once when the last Scope on the
+     * arena closes: the chunks are then replaced by a single one as large as
+     * everything used since the previous reset, so a steady workload stops
+     * allocating from the heap after its first block.
+     *
+     * Memory taken from the arena is valid only while its caller holds a Scope.
+     */
+    class MonotonicArena : public std::pmr::memory_resource {
+    public:
+        static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+        static constexpr size_t MAX_RETAINED = 64 * 1024 * 1024;  // Larger peaks go back to the heap
+
+        // Keeps the arena from being reset; the outermost one resets it on close
+        class Scope {
+        public:
+            explicit Scope(MonotonicArena& arena) : arena_(arena) { arena_.enter(); }
+            ~Scope() { arena_.leave(); }
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+            std::pmr::memory_resource* resource() const { return &arena_; }
+
+        private:
+            MonotonicArena& arena_;
+        };
+
+        explicit MonotonicArena(size_t chunk_size = DEFAULT_CHUNK_SIZE) : chunk_size_(chunk_size) {
+            chunks_.push_back(make_chunk(chunk_size_));
+            current_ = chunks_.back().get();
+        }
+
+        MonotonicArena(const MonotonicArena&) = delete;
+        MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+        size_t capacity() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t total = 0;
+            for (const auto& chunk : chunks_) total += chunk->capacity;
+            return total;
+        }
+        size_t resets() const { return resets_.load(std::memory_order_relaxed); }
+        size_t peak_bytes() const { return peak_.load(std::memory_order_relaxed); }  // Most used between two resets
+
+    private:
+        static constexpr size_t GRAIN = alignof(std::max_align_t);
+
+        struct Chunk {
+            std::unique_ptr<std::byte[]> data;
+            size_t capacity = 0;
+            std::atomic<size_t> used{0};
+        };
+
+        size_t chunk_size_;
+        std::vector<std::unique_ptr<Chunk>> chunks_;  // mutex_; only the last takes allocations
+        std::atomic<Chunk*> current_{nullptr};
+        size_t scopes_ = 0;                           // mutex_
+        std::atomic<size_t> resets_{0};
+        std::atomic<size_t> peak_{0};
+        mutable std::mutex mutex_;
+
+        static std::unique_ptr<Chunk> make_chunk(size_t capacity) {
+            auto chunk = std::make_unique<Chunk>();
+            chunk->data.reset(new std::byte[capacity]);  // operator new[] aligns to max_align_t
+            chunk->capacity = capacity;
+            return chunk;
+        }
+
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            // Rounding every request to GRAIN keeps each bump aligned without a CAS loop
+            size_t size = (bytes + alignment - 1 + GRAIN - 1) / GRAIN * GRAIN;
+            while (true) {
+                Chunk* chunk = current_.load(std::memory_order_acquire);
+                size_t offset = chunk->used.fetch_add(size, std::memory_order_relaxed);
+                if (offset + size <= chunk->capacity) {
+                    void* p = chunk->data.get() + offset;
+                    size_t space = size;
+                    return std::align(alignment, bytes, p, space);
+                }
+                grow(chunk, size);
+            }
+        }
+
+        void do_deallocate(void*, size_t, size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        void grow(Chunk* full, size_t size) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (current_.load(std::memory_order_relaxed) != full) {
+                return;  // Another thread already moved on
+            }
+            size_t capacity = std::max(size, std::max(chunk_size_, full->capacity * 2));
+            chunks_.push_back(make_chunk(capacity));
+            current_.store(chunks_.back().get(), std::memory_order_release);
+        }
+
+        void enter() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++scopes_;
+        }
+
+        void leave() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--scopes_ > 0) {
+                return;
+            }
+            // Nothing holds arena memory now
+            size_t used = 0;
+            for (const auto& chunk : chunks_) {
+                used += std::min(chunk->used.load(std::memory_order_relaxed), chunk->capacity);
+            }
+            peak_.store(std::max(peak_.load(std::memory_order_relaxed), used), std::memory_order_relaxed);
+            if (chunks_.size() > 1) {
+                size_t capacity = std::min(std::max(used, chunk_size_), std::max(MAX_RETAINED, chunk_size_));
+                chunks_.clear();
+                chunks_.push_back(make_chunk(capacity));
+                current_.store(chunks_.back().get(), std::memory_order_release);
+            }
+            chunks_.back()->used.store(0, std::memory_order_relaxed);
+            resets_.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * ObjectPool - Fixed-capacity pool of reusable objects, lock-free
+     *
+     * Objects are constructed on first use inside one preallocated block and
+     * handed out again as they are (not reset). Free objects sit on a
+     * Treiber stack of slot indices whose head carries a version tag against
+     * ABA, so acquire() and release() are O(1) and lock-free from any thread.
+     * With `thread_cache` > 0 each thread also keeps up to that many free
+     * objects of its own, returned to the pool when the thread exits.
      */
     template<typename T>
     class ObjectPool {
     private:
-        std::vector<T*> available_;
-        std::vector<T*> in_use_;
-        size_t max_size_;
-        
-    public:
-        explicit ObjectPool(size_t max_size = 1000) : max_size_(max_size) {
-            available_.reserve(max_size);
+        struct Slot {
+            T object;
+            std::atomic<uint32_t> next{0};     // Free-list link, index + 1
+            std::atomic<bool> in_use{false};
+        };
+
+        struct State {
+            uint64_t serial;
+            size_t max_size;
+            size_t thread_cache;
+            Slot* slots = nullptr;
+            std::atomic<size_t> constructed{0};  // Slots [0, constructed) hold objects
+            std::atomic<uint64_t> head{0};       // (tag << 32) | (index + 1); 0 = empty
+            std::atomic<size_t> in_use{0};
+
+            // Outlives the pool while a thread cache still refers to it
+            ~State() {
+                size_t count = std::min(constructed.load(), max_size);
+                for (size_t i = 0; i < count; ++i) {
+                    slots[i].~Slot();
+                }
+                ::operator delete(slots, std::align_val_t(alignof(Slot)));
+            }
+
+            void push(uint32_t index) {
+                uint64_t head_value = head.load(std::memory_order_relaxed);
+                do {
+                    slots[index].next.store(static_cast<uint32_t>(head_value), std::memory_order_relaxed);
+                } while (!head.compare_exchange_weak(head_value,
+                             ((head_value >> 32) + 1) << 32 | (index + 1),
+                             std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            bool pop(uint32_t& index) {
+                uint64_t head_value = head.load(std::memory_order_acquire);
+                while (static_cast<uint32_t>(head_value) != 0) {
+                    uint32_t top = static_cast<uint32_t>(head_value) - 1;
+                    uint32_t next = slots[top].next.load(std::memory_order_relaxed);
+                    if (head.compare_exchange_weak(head_value, ((head_value >> 32) + 1) << 32 | next,
+                                                   std::memory_order_acquire, std::memory_order_acquire)) {
+                        index = top;
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+
+        // One per thread and element type; bound to whichever pool used it last
+        struct ThreadCache {
+            uint64_t serial = 0;
+            std::weak_ptr<State> owner;
+            std::vector<uint32_t> free;
+
+            void unbind() {
+                if (auto state = owner.lock()) {
+                    for (uint32_t index : free) state->push(index);
+                }
+                free.clear();
+                owner.reset();
+                serial = 0;
+            }
+            ~ThreadCache() { unbind(); }
+        };
+
+        std::shared_ptr<State> state_;
+
+        static uint64_t next_serial() {
+            static std::atomic<uint64_t> serial{0};
+            return serial.fetch_add(1, std::memory_order_relaxed) + 1;
         }
-        
-        ~ObjectPool() {
-            for (auto obj : available_) delete obj;
-            for (auto obj : in_use_) delete obj;
+
+        ThreadCache* cache() const {
+            if (state_->thread_cache == 0) {
+                return nullptr;
+            }
+            thread_local ThreadCache cache;
+            if (cache.serial != state_->serial) {
+                cache.unbind();
+                cache.serial = state_->serial;
+                cache.owner = state_;
+                cache.free.reserve(state_->thread_cache);
+            }
+            return &cache;
+        }
+
+        T* hand_out(uint32_t index) {
+            state_->slots[index].in_use.store(true, std::memory_order_relaxed);
+            state_->in_use.fetch_add(1, std::memory_order_relaxed);
+            return &state_->slots[index].object;
         }
-        
+
+    public:
+        explicit ObjectPool(size_t max_size = 1000, size_t thread_cache = 0)
+            : state_(std::make_shared<State>()) {
+            state_->serial = next_serial();
+            state_->max_size = std::min<size_t>(max_size, UINT32_MAX - 1);
+            state_->thread_cache = thread_cache;
+            state_->slots = static_cast<Slot*>(::operator new(sizeof(Slot) * std::max<size_t>(state_->max_size, 1),
+                                                              std::align_val_t(alignof(Slot))));
+        }
+
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        // nullptr once max_size objects are in use
         T* acquire() {
-            if (!available_.empty()) {
-                T* obj = available_.back();
-                available_.pop_back();
-                in_use_.push_back(obj);
-                return obj;
-            }
-            
-            if (in_use_.size() < max_size_) {
-                T* obj = new T();
-                in_use_.push_back(obj);
-                return obj;
-            }
-            
-            return nullptr;
+            uint32_t index;
+            if (ThreadCache* cache = this->cache(); cache && !cache->free.empty()) {
+                index = cache->free.back();
+                cache->free.pop_back();
+                return hand_out(index);
+            }
+            if (state_->pop(index)) {
+                return hand_out(index);
+            }
+            size_t fresh = state_->constructed.fetch_add(1, std::memory_order_relaxed);
+            if (fresh >= state_->max_size) {
+                state_->constructed.fetch_sub(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            new (&state_->slots[fresh]) Slot();
+            return hand_out(static_cast<uint32_t>(fresh));
         }
-        
+
+        // Pointers the pool does not own, or already holds, are ignored
         void release(T* obj) {
-            auto it = std::find(in_use_.begin(), in_use_.end(), obj);
-            if (it != in_use_.end()) {
-                in_use_.erase(it);
-                available_.push_back(obj);
+            auto address = reinterpret_cast<uintptr_t>(obj);
+            auto base = reinterpret_cast<uintptr_t>(&state_->slots[0].object);
+            if (address < base || (address - base) % sizeof(Slot) != 0 ||
+                (address - base) / sizeof(Slot) >= std::min(state_->constructed.load(), state_->max_size)) {
+                return;
+            }
+            uint32_t index = static_cast<uint32_t>((address - base) / sizeof(Slot));
+            if (!state_->slots[index].in_use.exchange(false, std::memory_order_relaxed)) {
+                return;
             }
+            state_->in_use.fetch_sub(1, std::memory_order_relaxed);
+            if (ThreadCache* cache = this->cache()) {
+                if (cache->free.size() >= state_->thread_cache) {
+                    // Hand half back so other threads can reuse them
+                    while (cache->free.size() > state_->thread_cache / 2) {
+                        state_->push(cache->free.back());
+                        cache->free.pop_back();
+                    }
+                }
+                cache->free.push_back(index);
+                return;
+            }
+            state_->push(index);
+        }
+
+        size_t available_count() const {
+            return std::min(state_->constructed.load(), state_->max_size) - in_use_count();
         }
-        
-        size_t available_count() const { return available_.size(); }
-        size_t in_use_count() const { return in_use_.size(); }
+        size_t in_use_count() const { return state_->in_use.load(std::memory_order_relaxed); }
     };
-    
+
 } // namespace memory_utils
 
 #endif // MEMORY_UTILS_HPP
@@ -0,0 +1,201 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace metrics {
+
+namespace {
+
+std::string render_labels(const Labels& labels) {
+    std::string out;
+    for (const auto& [key, value] : labels) {
+        if (!out.empty()) out += ",";
+        out += key + "=\"";
+        for (char c : value) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') {
+                out += "\\n";
+                continue;
+            }
+            out += c;
+        }
+        out += "\"";
+    }
+    return out;
+}
+
+std::string series(const std::string& name, const std::string& labels, const std::string& extra = "") {
+    std::string all = labels;
+    if (!extra.empty()) {
+        all += (all.empty() ? "" : ",") + extra;
+    }
+    return all.empty() ? name : name + "{" + all + "}";
+}
+
+std::string format_number(double value) {
+    std::ostringstream ss;
+    ss << std::setprecision(12) << value;
+    return ss.str();
+}
+
+}  // namespace
+
+size_t shard_index() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return index;
+}
+
+// ============= METRIC TYPES =============
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Gauge::add(double delta) {
+    double current = value_.load(std::memory_order_relaxed);
+    while (!value_.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+    }
+}
+
+constexpr std::array<double, 13> Histogram::BOUNDS;
+
+void Histogram::observe(double seconds) {
+    size_t bucket = std::lower_bound(BOUNDS.begin(), BOUNDS.end(), seconds) - BOUNDS.begin();
+    Shard& shard = shards_[shard_index()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum_ns.fetch_add(static_cast<uint64_t>(std::max(seconds, 0.0) * 1e9), std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snapshot;
+    uint64_t sum_ns = 0;
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < shard.buckets.size(); ++i) {
+            uint64_t n = shard.buckets[i].load(std::memory_order_relaxed);
+            snapshot.buckets[i] += n;
+            snapshot.count += n;
+        }
+        sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+    }
+    snapshot.sum = static_cast<double>(sum_ns) / 1e9;
+    return snapshot;
+}
+
+// ============= REGISTRY =============
+
+Registry& Registry::instance() {
+    static Registry registry;
+    return registry;
+}
+
+Registry::Family& Registry::family(const std::string& name, const std::string& help, Type type) {
+    auto it = families_.find(name);
+    if (it == families_.end()) {
+        it = families_.emplace(name, Family{type, help, {}, {}, {}}).first;
+    }
+    return it->second;
+}
+
+Counter& Registry::counter(const std::string& name, const std::string& help, const Labels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = family(name, help, Type::COUNTER).counters[render_labels(labels)];
+    if (!entry.metric) {
+        entry.labels = labels;
+        entry.metric = std::make_unique<Counter>();
+    }
+    return *entry.metric;
+}
+
+Gauge& Registry::gauge(const std::string& name, const std::string& help, const Labels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = family(name, help, Type::GAUGE).gauges[render_labels(labels)];
+    if (!entry.metric) {
+        entry.labels = labels;
+        entry.metric = std::make_unique<Gauge>();
+    }
+    return *entry.metric;
+}
+
+Histogram& Registry::histogram(const std::string& name, const std::string& help, const Labels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = family(name, help, Type::HISTOGRAM).histograms[render_labels(labels)];
+    if (!entry.metric) {
+        entry.labels = labels;
+        entry.metric = std::make_unique<Histogram>();
+    }
+    return *entry.metric;
+}
+
+std::string Registry::to_prometheus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+    for (const auto& [name, family] : families_) {
+        const char* type = family.type == Type::COUNTER ? "counter" :
+                           family.type == Type::GAUGE ? "gauge" : "histogram";
+        out << "# HELP " << name << " " << family.help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+        for (const auto& [labels, entry] : family.counters) {
+            out << series(name, labels) << " " << entry.metric->value() << "\n";
+        }
+        for (const auto& [labels, entry] : family.gauges) {
+            out << series(name, labels) << " " << format_number(entry.metric->value()) << "\n";
+        }
+        for (const auto& [labels, entry] : family.histograms) {
+            Histogram::Snapshot snapshot = entry.metric->snapshot();
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < Histogram::BOUNDS.size(); ++i) {
+                cumulative += snapshot.buckets[i];
+                out << series(name + "_bucket", labels, "le=\"" + format_number(Histogram::BOUNDS[i]) + "\"")
+                    << " " << cumulative << "\n";
+            }
+            out << series(name + "_bucket", labels, "le=\"+Inf\"") << " " << snapshot.count << "\n";
+            out << series(name + "_sum", labels) << " " << format_number(snapshot.sum) << "\n";
+            out << series(name + "_count", labels) << " " << snapshot.count << "\n";
+        }
+    }
+    return out.str();
+}
+
+json Registry::to_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json out = json::object();
+    for (const auto& [name, family] : families_) {
+        json entries = json::array();
+        for (const auto& [_, entry] : family.counters) {
+            entries.push_back({{"labels", entry.labels}, {"value", entry.metric->value()}});
+        }
+        for (const auto& [_, entry] : family.gauges) {
+            entries.push_back({{"labels", entry.labels}, {"value", entry.metric->value()}});
+        }
+        for (const auto& [_, entry] : family.histograms) {
+            Histogram::Snapshot snapshot = entry.metric->snapshot();
+            // Upper bound and count of each bucket, in order; not cumulative
+            json buckets = json::array();
+            for (size_t i = 0; i < Histogram::BOUNDS.size(); ++i) {
+                buckets.push_back({{"le", Histogram::BOUNDS[i]}, {"count", snapshot.buckets[i]}});
+            }
+            buckets.push_back({{"le", "+Inf"}, {"count", snapshot.buckets.back()}});
+            entries.push_back({
+                {"labels", entry.labels},
+                {"count", snapshot.count},
+                {"sum", snapshot.sum},
+                {"mean", snapshot.count ? snapshot.sum / snapshot.count : 0.0},
+                {"buckets", buckets}
+            });
+        }
+        out[name] = {
+            {"type", family.type == Type::COUNTER ? "counter" : family.type == Type::GAUGE ? "gauge" : "histogram"},
+            {"help", family.help},
+            {"series", entries}
+        };
+    }
+    return out;
+}
+
+}  // namespace metrics
@@ -0,0 +1,155 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+/**
+ * Metrics - Process-wide counters, gauges and latency histograms
+ *
+ * Counters and histograms are sharded: each thread adds to one of SHARDS
+ * cache-line-sized slots with a relaxed atomic, and readers sum the shards.
+ * No lock or lookup is taken on the recording path; a call site resolves
+ * its metric once, into a function-local static:
+ *
+ *     static metrics::Counter& hashes = metrics::counter("pow_hashes_total", "...");
+ *     hashes.inc(n);
+ *
+ * The registry renders everything as Prometheus text exposition or JSON.
+ */
+namespace metrics {
+
+using Labels = std::map<std::string, std::string>;
+
+constexpr size_t SHARDS = 16;
+
+// Slot of the calling thread, fixed at its first use
+size_t shard_index();
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) {
+        shards_[shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, SHARDS> shards_;
+};
+
+class Gauge {
+public:
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    void add(double delta);
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// Fixed buckets of latency in seconds, from 10us to 10s
+class Histogram {
+public:
+    static constexpr std::array<double, 13> BOUNDS = {
+        0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0, 10.0
+    };
+
+    struct Snapshot {
+        std::array<uint64_t, BOUNDS.size() + 1> buckets{};  // Per bucket, not cumulative; last is +Inf
+        uint64_t count = 0;
+        double sum = 0.0;                                  // Seconds
+    };
+
+    void observe(double seconds);
+    Snapshot snapshot() const;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, BOUNDS.size() + 1> buckets{};
+        std::atomic<uint64_t> sum_ns{0};
+    };
+    std::array<Shard, SHARDS> shards_;
+};
+
+// Records the lifetime of the scope into a histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        histogram_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+class Registry {
+public:
+    static Registry& instance();
+
+    // Returns the series for (name, labels), creating it on first use. The
+    // reference stays valid for the life of the process.
+    Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, const Labels& labels = {});
+
+    std::string to_prometheus() const;
+    json to_json() const;
+
+private:
+    enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+    template <typename Metric>
+    struct Series {
+        Labels labels;
+        std::unique_ptr<Metric> metric;
+    };
+
+    struct Family {
+        Type type;
+        std::string help;
+        std::map<std::string, Series<Counter>> counters;  // By rendered label set
+        std::map<std::string, Series<Gauge>> gauges;
+        std::map<std::string, Series<Histogram>> histograms;
+    };
+
+    Registry() = default;
+    Family& family(const std::string& name, const std::string& help, Type type);
+
+    mutable std::mutex mutex_;  // Registration and rendering only
+    std::map<std::string, Family> families_;
+};
+
+inline Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {}) {
+    return Registry::instance().counter(name, help, labels);
+}
+
+inline Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = {}) {
+    return Registry::instance().gauge(name, help, labels);
+}
+
+inline Histogram& histogram(const std::string& name, const std::string& help, const Labels& labels = {}) {
+    return Registry::instance().histogram(name, help, labels);
+}
+
+}  // namespace metrics
+
+#endif // METRICS_HPP
@@ -0,0 +1,44 @@
+#ifndef RECENT_FILTER_HPP
+#define RECENT_FILTER_HPP
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_set>
+
+/**
+ * RecentFilter - Bounded set of recently seen keys (not thread-safe)
+ *
+ * Remembers the last `capacity` distinct keys inserted; older ones are
+ * forgotten first-in first-out. Used to deduplicate gossip.
+ */
+class RecentFilter {
+public:
+    explicit RecentFilter(size_t capacity) : capacity_(capacity == 0 ? 1 : capacity) {}
+
+    // True if `key` was not already remembered
+    bool insert(const std::string& key) {
+        if (!keys_.insert(key).second) {
+            return false;
+        }
+        order_.push_back(key);
+        if (order_.size() > capacity_) {
+            keys_.erase(order_.front());
+            order_.pop_front();
+        }
+        return true;
+    }
+
+    bool contains(const std::string& key) const {
+        return keys_.count(key) > 0;
+    }
+
+    size_t size() const { return keys_.size(); }
+
+private:
+    size_t capacity_;
+    std::unordered_set<std::string> keys_;
+    std::deque<std::string> order_;
+};
+
+#endif // RECENT_FILTER_HPP
@@ -0,0 +1,141 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * ThreadPool - Fixed set of worker threads draining a shared task queue
+ *
+ * submit() returns a future for a single task; parallel_for() splits an
+ * index range into contiguous chunks and blocks until every chunk is done,
+ * with the calling thread working on a chunk too. A pool with one thread
+ * runs parallel_for() inline, as does a parallel_for() issued from one of
+ * the pool's own workers (so nested use cannot deadlock the pool).
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        workers_.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) {
+            workers_.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    template<typename F>
+    auto submit(F&& task) -> std::future<decltype(task())> {
+        using R = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+        std::future<R> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace([packaged]() { (*packaged)(); });
+        }
+        cv_.notify_one();
+        return result;
+    }
+
+    // Run fn(i) for every i in [0, count); returns once all calls have finished.
+    // Exceptions thrown by fn are rethrown on the calling thread.
+    template<typename F>
+    void parallel_for(size_t count, F&& fn, size_t min_chunk = 1) {
+        if (count == 0) {
+            return;
+        }
+
+        size_t chunks = std::min(count / std::max<size_t>(min_chunk, 1), workers_.size() + 1);
+        if (chunks <= 1 || workers_.size() <= 1 || current_pool_ == this) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        size_t chunk_size = (count + chunks - 1) / chunks;
+        auto run_chunk = [&fn, count, chunk_size](size_t chunk) {
+            size_t begin = chunk * chunk_size;
+            size_t end = std::min(count, begin + chunk_size);
+            for (size_t i = begin; i < end; ++i) {
+                fn(i);
+            }
+        };
+
+        std::vector<std::future<void>> pending;
+        pending.reserve(chunks - 1);
+        for (size_t chunk = 1; chunk < chunks; ++chunk) {
+            pending.push_back(submit([&run_chunk, chunk]() { run_chunk(chunk); }));
+        }
+
+        std::exception_ptr error;
+        try {
+            run_chunk(0);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // Always wait for every chunk: they reference this stack frame
+        for (auto& f : pending) {
+            try {
+                f.get();
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+
+    static inline thread_local const ThreadPool* current_pool_ = nullptr;  // Pool owning this worker
+
+    void worker_loop() {
+        current_pool_ = this;
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+                if (stopping_ && tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,897 @@
+#include "wire_protocol.hpp"
+#include "utils/crc32.hpp"
+#include <cstring>
+
+namespace wire {
+
+namespace {
+
+// ============= PRIMITIVES =============
+class Writer {
+public:
+    explicit Writer(std::string& out) : out_(out) {}
+
+    void u8(uint8_t v) { out_.push_back(static_cast<char>(v)); }
+
+    void varint(uint64_t v) {
+        while (v >= 0x80) {
+            u8(static_cast<uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        u8(static_cast<uint8_t>(v));
+    }
+
+    void svarint(int64_t v) {
+        varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));  // Zigzag
+    }
+
+    void f64(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        for (int i = 0; i < 8; ++i) u8(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+
+    void bytes(std::string_view v) {
+        varint(v.size());
+        out_.append(v.data(), v.size());
+    }
+
+    // Tag 1: even-length lower-case hex packed two digits per byte; tag 0: raw
+    void hex(const std::string& v) {
+        if (!is_packable_hex(v)) {
+            u8(0);
+            bytes(v);
+            return;
+        }
+        u8(1);
+        varint(v.size() / 2);
+        for (size_t i = 0; i < v.size(); i += 2) {
+            u8(static_cast<uint8_t>((nibble(v[i]) << 4) | nibble(v[i + 1])));
+        }
+    }
+
+private:
+    std::string& out_;
+
+    static bool is_packable_hex(const std::string& v) {
+        if (v.empty() || v.size() % 2 != 0) {
+            return false;
+        }
+        for (char c : v) {
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static uint8_t nibble(char c) {
+        return static_cast<uint8_t>(c <= '9' ? c - '0' : c - 'a' + 10);
+    }
+};
+
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    bool ok() const { return ok_; }
+    bool at_end() const { return pos_ == data_.size(); }
+    size_t remaining() const { return data_.size() - pos_; }
+
+    uint8_t u8() {
+        if (pos_ >= data_.size()) {
+            ok_ = false;
+            return 0;
+        }
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64 && ok_; shift += 7) {
+            uint8_t byte = u8();
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return v;
+            }
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    int64_t svarint() {
+        uint64_t v = varint();
+        return static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+    }
+
+    double f64() {
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) bits |= static_cast<uint64_t>(u8()) << (8 * i);
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    std::string bytes() {
+        uint64_t length = varint();
+        if (!ok_ || length > data_.size() - pos_) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string v(data_.substr(pos_, length));
+        pos_ += length;
+        return v;
+    }
+
+    std::string hex() {
+        uint8_t tag = u8();
+        if (tag == 0) {
+            return bytes();
+        }
+        uint64_t length = varint();
+        if (tag != 1 || !ok_ || length > data_.size() - pos_) {
+            ok_ = false;
+            return std::string();
+        }
+        static const char digits[] = "0123456789abcdef";
+        std::string v;
+        v.reserve(length * 2);
+        for (uint64_t i = 0; i < length; ++i) {
+            uint8_t byte = static_cast<uint8_t>(data_[pos_++]);
+            v.push_back(digits[byte >> 4]);
+            v.push_back(digits[byte & 0x0F]);
+        }
+        return v;
+    }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+void put_u16(uint8_t* out, uint16_t v) {
+    out[0] = static_cast<uint8_t>(v);
+    out[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void put_u32(uint8_t* out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint16_t get_u16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+uint32_t get_u32(const uint8_t* in) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(in[i]) << (8 * i);
+    return v;
+}
+
+constexpr uint8_t TX_FLAG_DEPLOYMENT = 0x01;
+constexpr uint8_t TX_FLAG_EXTENDED = 0x02;  // Carries data/contract fields
+
+void write_transaction(Writer& w, const Transaction& tx) {
+    bool extended = !tx.data.empty() || !tx.contract_address.empty() || tx.deployment;
+    uint8_t flags = (tx.is_contract_deployment ? TX_FLAG_DEPLOYMENT : 0) | (extended ? TX_FLAG_EXTENDED : 0);
+
+    w.u8(flags);
+    w.hex(tx.from);
+    w.hex(tx.to);
+    w.f64(tx.amount);
+    w.f64(tx.gas_price);
+    w.bytes(tx.timestamp);
+    w.hex(tx.signature);
+    w.hex(tx.public_key);
+    w.hex(tx.transaction_id);
+    w.varint(tx.nonce);
+    if (extended) {
+        w.bytes(tx.data);
+        w.hex(tx.contract_address);
+        w.hex(tx.contract_bytecode());
+        w.bytes(tx.contract_name());
+        w.bytes(tx.contract_language());
+    }
+}
+
+bool read_transaction(Reader& r, Transaction& tx) {
+    uint8_t flags = r.u8();
+    tx.is_contract_deployment = (flags & TX_FLAG_DEPLOYMENT) != 0;
+    tx.from = r.hex();
+    tx.to = r.hex();
+    tx.amount = r.f64();
+    tx.gas_price = r.f64();
+    tx.timestamp = r.bytes();
+    tx.signature = r.hex();
+    tx.public_key = r.hex();
+    tx.transaction_id = r.hex();
+    tx.nonce = r.varint();
+    if (flags & TX_FLAG_EXTENDED) {
+        tx.data = r.bytes();
+        tx.contract_address = r.hex();
+        std::string bytecode = r.hex();
+        std::string name = r.bytes();
+        std::string language = r.bytes();
+        tx.set_deployment(std::move(bytecode), std::move(name), std::move(language));
+    }
+    return r.ok();
+}
+
+void write_block(Writer& w, const Block& block) {
+    w.svarint(block.index);
+    w.bytes(block.timestamp);
+    w.hex(block.merkle_root);
+    w.hex(block.state_root);
+    w.svarint(block.proof);
+    w.hex(block.previous_hash);
+    w.varint(static_cast<uint64_t>(block.pow_version));
+    w.varint(block.transactions.size());
+    for (const auto& tx : block.transactions) {
+        write_transaction(w, tx);
+    }
+}
+
+void write_header(Writer& w, const BlockHeader& header) {
+    w.svarint(header.index);
+    w.bytes(header.timestamp);
+    w.hex(header.merkle_root);
+    w.hex(header.state_root);
+    w.svarint(header.proof);
+    w.hex(header.previous_hash);
+    w.varint(static_cast<uint64_t>(header.pow_version));
+    w.hex(header.hash);
+    w.varint(header.transaction_count);
+}
+
+bool read_header(Reader& r, BlockHeader& header) {
+    header.index = static_cast<int>(r.svarint());
+    header.timestamp = r.bytes();
+    header.merkle_root = r.hex();
+    header.state_root = r.hex();
+    header.proof = r.svarint();
+    header.previous_hash = r.hex();
+    header.pow_version = static_cast<int>(r.varint());
+    header.hash = r.hex();
+    header.transaction_count = static_cast<size_t>(r.varint());
+    return r.ok();
+}
+
+bool read_block(Reader& r, Block& block) {
+    block.index = static_cast<int>(r.svarint());
+    block.timestamp = r.bytes();
+    block.time_seconds = parse_block_timestamp(block.timestamp);
+    block.merkle_root = r.hex();
+    block.state_root = r.hex();
+    block.proof = r.svarint();
+    block.previous_hash = r.hex();
+    block.pow_version = static_cast<int>(r.varint());
+
+    uint64_t count = r.varint();
+    // Every transaction takes well over one byte; reject absurd counts before reserving
+    if (!r.ok() || count > r.remaining()) {
+        return false;
+    }
+    block.transactions.clear();
+    block.transactions.reserve(static_cast<size_t>(count));
+    for (uint64_t i = 0; i < count && r.ok(); ++i) {
+        Transaction tx;
+        if (!read_transaction(r, tx)) {
+            return false;
+        }
+        block.transactions.push_back(std::move(tx));
+    }
+    return r.ok();
+}
+
+json parse_body(std::string_view body) {
+    return json::parse(body.begin(), body.end());
+}
+
+}  // namespace
+
+// ============= FRAMING =============
+std::string encode_frame(MessageType type, Encoding encoding,
+                         const std::string& sender_id, std::string_view body) {
+    size_t sender_length = std::min<size_t>(sender_id.size(), 0xFFFF);
+    size_t payload_length = 2 + sender_length + body.size();
+
+    std::string frame(HEADER_SIZE + payload_length, '\0');
+    uint8_t* out = reinterpret_cast<uint8_t*>(&frame[0]);
+
+    uint8_t* payload = out + HEADER_SIZE;
+    put_u16(payload, static_cast<uint16_t>(sender_length));
+    std::memcpy(payload + 2, sender_id.data(), sender_length);
+    std::memcpy(payload + 2 + sender_length, body.data(), body.size());
+
+    put_u16(out, MAGIC);
+    out[2] = PROTOCOL_VERSION;
+    out[3] = static_cast<uint8_t>(encoding);
+    out[4] = static_cast<uint8_t>(type);
+    put_u32(out + 8, static_cast<uint32_t>(payload_length));
+    put_u32(out + 12, crc32(payload, payload_length));
+    return frame;
+}
+
+void FrameParser::feed(const uint8_t* data, size_t length) {
+    if (!error_.empty()) {
+        return;
+    }
+    // Drop consumed frames before growing the buffer
+    if (read_offset_ > 0) {
+        buffer_.erase(buffer_.begin(), buffer_.begin() + read_offset_);
+        read_offset_ = 0;
+    }
+    buffer_.insert(buffer_.end(), data, data + length);
+}
+
+FrameParser::Status FrameParser::next(Frame& frame) {
+    if (!error_.empty()) {
+        return Status::ERROR;
+    }
+    if (buffered() < HEADER_SIZE) {
+        return Status::NEED_MORE;
+    }
+
+    const uint8_t* header = buffer_.data() + read_offset_;
+    if (get_u16(header) != MAGIC) {
+        return fail("bad frame magic");
+    }
+    if (header[2] != PROTOCOL_VERSION) {
+        return fail("unsupported protocol version " + std::to_string(header[2]));
+    }
+    if (header[3] > static_cast<uint8_t>(Encoding::BINARY)) {
+        return fail("unknown encoding " + std::to_string(header[3]));
+    }
+
+    uint32_t length = get_u32(header + 8);
+    if (length > MAX_PAYLOAD_SIZE || length < 2) {
+        return fail("bad payload length " + std::to_string(length));
+    }
+    if (buffered() < HEADER_SIZE + length) {
+        return Status::NEED_MORE;
+    }
+
+    const uint8_t* payload = header + HEADER_SIZE;
+    uint32_t checksum = get_u32(header + 12);
+    if (crc32(payload, length) != checksum) {
+        return fail("payload checksum mismatch");
+    }
+
+    uint16_t sender_length = get_u16(payload);
+    if (sender_length > length - 2) {
+        return fail("bad sender length");
+    }
+
+    frame.header.version = header[2];
+    frame.header.encoding = static_cast<Encoding>(header[3]);
+    frame.header.type = static_cast<MessageType>(header[4]);
+    frame.header.length = length;
+    frame.header.checksum = checksum;
+    const char* chars = reinterpret_cast<const char*>(payload);
+    frame.sender_id = std::string_view(chars + 2, sender_length);
+    frame.body = std::string_view(chars + 2 + sender_length, length - 2 - sender_length);
+
+    read_offset_ += HEADER_SIZE + length;
+    return Status::FRAME;
+}
+
+FrameParser::Status FrameParser::fail(const std::string& reason) {
+    error_ = reason;
+    return Status::ERROR;
+}
+
+// ============= COMPACT ENCODINGS =============
+std::string encode_transaction(const Transaction& tx) {
+    std::string out;
+    out.reserve(256);
+    Writer w(out);
+    write_transaction(w, tx);
+    return out;
+}
+
+bool decode_transaction(std::string_view data, Transaction& tx) {
+    Reader r(data);
+    return read_transaction(r, tx) && r.at_end();
+}
+
+std::string encode_block(const Block& block) {
+    std::string out;
+    out.reserve(128 + block.transactions.size() * 256);
+    Writer w(out);
+    write_block(w, block);
+    return out;
+}
+
+bool decode_block(std::string_view data, Block& block) {
+    Reader r(data);
+    return read_block(r, block) && r.at_end();
+}
+
+std::string encode_blocks(const std::vector<Block>& blocks) {
+    std::string out;
+    Writer w(out);
+    w.varint(blocks.size());
+    for (const auto& block : blocks) {
+        write_block(w, block);
+    }
+    return out;
+}
+
+bool decode_blocks(std::string_view data, std::vector<Block>& blocks) {
+    Reader r(data);
+    uint64_t count = r.varint();
+    if (!r.ok() || count > r.remaining()) {
+        return false;
+    }
+    blocks.clear();
+    blocks.reserve(static_cast<size_t>(count));
+    for (uint64_t i = 0; i < count; ++i) {
+        Block block;
+        if (!read_block(r, block)) {
+            return false;
+        }
+        blocks.push_back(std::move(block));
+    }
+    return r.at_end();
+}
+
+std::string encode_transactions(const std::vector<Transaction>& transactions) {
+    std::string out;
+    Writer w(out);
+    w.varint(transactions.size());
+    for (const auto& tx : transactions) {
+        write_transaction(w, tx);
+    }
+    return out;
+}
+
+std::string encode_inventory(const std::vector<std::string>& transaction_ids) {
+    std::string out;
+    Writer w(out);
+    w.varint(transaction_ids.size());
+    for (const auto& id : transaction_ids) {
+        w.hex(id);
+    }
+    return out;
+}
+
+std::string encode_headers_request(const HeadersRequest& request) {
+    std::string out;
+    Writer w(out);
+    w.varint(request.locator.size());
+    for (const auto& hash : request.locator) {
+        w.hex(hash);
+    }
+    w.varint(request.max_headers);
+    return out;
+}
+
+std::string encode_headers(const std::vector<BlockHeader>& headers) {
+    std::string out;
+    Writer w(out);
+    w.varint(headers.size());
+    for (const auto& header : headers) {
+        write_header(w, header);
+    }
+    return out;
+}
+
+std::string encode_blocks_request(const BlocksRequest& request) {
+    std::string out;
+    Writer w(out);
+    w.varint(request.first_index);
+    w.varint(request.count);
+    return out;
+}
+
+std::string encode_snapshot_manifest(const SnapshotManifest& manifest) {
+    std::string out;
+    Writer w(out);
+    w.varint(manifest.height);
+    w.hex(manifest.block_hash);
+    w.hex(manifest.state_root);
+    w.varint(manifest.account_count);
+    w.varint(manifest.chunk_hashes.size());
+    for (const auto& hash : manifest.chunk_hashes) {
+        out.append(reinterpret_cast<const char*>(hash.data()), hash.size());
+    }
+    return out;
+}
+
+std::string encode_chunk_request(const ChunkRequest& request) {
+    std::string out;
+    Writer w(out);
+    w.hex(request.state_root);
+    w.varint(request.index);
+    return out;
+}
+
+std::string encode_snapshot_chunk(const SnapshotChunk& chunk) {
+    std::string out;
+    Writer w(out);
+    w.hex(chunk.state_root);
+    w.varint(chunk.index);
+    w.u8(chunk.available ? 1 : 0);
+    w.varint(chunk.accounts.size());
+    for (const auto& account : chunk.accounts) {
+        w.hex(account.address);
+        w.f64(account.balance);
+        w.varint(account.nonce);
+    }
+    return out;
+}
+
+namespace {
+
+json headers_request_to_json(const HeadersRequest& request) {
+    return json{{"locator", request.locator}, {"max_headers", request.max_headers}};
+}
+
+json headers_to_json(const std::vector<BlockHeader>& headers) {
+    json headers_json = json::array();
+    for (const auto& header : headers) {
+        headers_json.push_back(header.to_json());
+    }
+    return headers_json;
+}
+
+json transactions_to_json(const std::vector<Transaction>& transactions) {
+    json transactions_json = json::array();
+    for (const auto& tx : transactions) {
+        transactions_json.push_back(tx.to_json());
+    }
+    return transactions_json;
+}
+
+json blocks_to_json(const std::vector<Block>& blocks) {
+    json blocks_json = json::array();
+    for (const auto& block : blocks) {
+        blocks_json.push_back(block.to_json());
+    }
+    return blocks_json;
+}
+
+}  // namespace
+
+bool decode_transaction_body(Encoding encoding, std::string_view body, Transaction& tx) {
+    if (encoding == Encoding::BINARY) {
+        return decode_transaction(body, tx);
+    }
+    try {
+        tx = Transaction::from_json(parse_body(body));
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_block_body(Encoding encoding, std::string_view body, Block& block) {
+    if (encoding == Encoding::BINARY) {
+        return decode_block(body, block);
+    }
+    try {
+        block = Block::from_json(parse_body(body));
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_blocks_body(Encoding encoding, std::string_view body, std::vector<Block>& blocks) {
+    if (encoding == Encoding::BINARY) {
+        return decode_blocks(body, blocks);
+    }
+    try {
+        blocks.clear();
+        for (const auto& block_json : parse_body(body)) {
+            blocks.push_back(Block::from_json(block_json));
+        }
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_transactions_body(Encoding encoding, std::string_view body, std::vector<Transaction>& transactions) {
+    transactions.clear();
+    if (encoding == Encoding::BINARY) {
+        Reader r(body);
+        uint64_t count = r.varint();
+        if (!r.ok() || count > body.size()) {
+            return false;
+        }
+        transactions.reserve(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count; ++i) {
+            Transaction tx;
+            if (!read_transaction(r, tx)) {
+                return false;
+            }
+            transactions.push_back(std::move(tx));
+        }
+        return r.at_end();
+    }
+    try {
+        for (const auto& tx_json : parse_body(body)) {
+            transactions.push_back(Transaction::from_json(tx_json));
+        }
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_inventory_body(Encoding encoding, std::string_view body, std::vector<std::string>& transaction_ids) {
+    transaction_ids.clear();
+    if (encoding == Encoding::BINARY) {
+        Reader r(body);
+        uint64_t count = r.varint();
+        if (!r.ok() || count > body.size()) {
+            return false;
+        }
+        transaction_ids.reserve(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count && r.ok(); ++i) {
+            transaction_ids.push_back(r.hex());
+        }
+        return r.ok() && r.at_end();
+    }
+    try {
+        transaction_ids = parse_body(body).get<std::vector<std::string>>();
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_headers_request_body(Encoding encoding, std::string_view body, HeadersRequest& request) {
+    if (encoding == Encoding::BINARY) {
+        Reader r(body);
+        uint64_t count = r.varint();
+        if (!r.ok() || count > body.size()) {
+            return false;
+        }
+        request.locator.clear();
+        request.locator.reserve(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count && r.ok(); ++i) {
+            request.locator.push_back(r.hex());
+        }
+        request.max_headers = static_cast<uint32_t>(r.varint());
+        return r.ok() && r.at_end();
+    }
+    try {
+        json j = parse_body(body);
+        request.locator = j.at("locator").get<std::vector<std::string>>();
+        request.max_headers = j.at("max_headers").get<uint32_t>();
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_headers_body(Encoding encoding, std::string_view body, std::vector<BlockHeader>& headers) {
+    headers.clear();
+    if (encoding == Encoding::BINARY) {
+        Reader r(body);
+        uint64_t count = r.varint();
+        if (!r.ok() || count > body.size()) {
+            return false;
+        }
+        headers.reserve(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count; ++i) {
+            BlockHeader header;
+            if (!read_header(r, header)) {
+                return false;
+            }
+            headers.push_back(std::move(header));
+        }
+        return r.at_end();
+    }
+    try {
+        for (const auto& header_json : parse_body(body)) {
+            headers.push_back(BlockHeader::from_json(header_json));
+        }
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_blocks_request_body(Encoding encoding, std::string_view body, BlocksRequest& request) {
+    if (encoding == Encoding::BINARY) {
+        Reader r(body);
+        request.first_index = r.varint();
+        request.count = static_cast<uint32_t>(r.varint());
+        return r.ok() && r.at_end();
+    }
+    try {
+        json j = parse_body(body);
+        request.first_index = j.at("first_index").get<uint64_t>();
+        request.count = j.at("count").get<uint32_t>();
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_snapshot_manifest_body(Encoding encoding, std::string_view body, SnapshotManifest& manifest) {
+    if (encoding == Encoding::BINARY) {
+        Reader r(body);
+        manifest.height = r.varint();
+        manifest.block_hash = r.hex();
+        manifest.state_root = r.hex();
+        manifest.account_count = r.varint();
+        uint64_t count = r.varint();
+        if (!r.ok() || count > SnapshotManifest::CHUNK_COUNT) {
+            return false;
+        }
+        manifest.chunk_hashes.assign(static_cast<size_t>(count), StateTree::Hash{});
+        for (auto& hash : manifest.chunk_hashes) {
+            for (auto& byte : hash) {
+                byte = r.u8();
+            }
+        }
+        return r.ok() && r.at_end();
+    }
+    try {
+        manifest = SnapshotManifest::from_json(parse_body(body));
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_chunk_request_body(Encoding encoding, std::string_view body, ChunkRequest& request) {
+    if (encoding == Encoding::BINARY) {
+        Reader r(body);
+        request.state_root = r.hex();
+        request.index = static_cast<uint32_t>(r.varint());
+        return r.ok() && r.at_end();
+    }
+    try {
+        json j = parse_body(body);
+        request.state_root = j.at("state_root").get<std::string>();
+        request.index = j.at("index").get<uint32_t>();
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool decode_snapshot_chunk_body(Encoding encoding, std::string_view body, SnapshotChunk& chunk) {
+    if (encoding == Encoding::BINARY) {
+        Reader r(body);
+        chunk.state_root = r.hex();
+        chunk.index = static_cast<uint32_t>(r.varint());
+        chunk.available = r.u8() != 0;
+        uint64_t count = r.varint();
+        // An account takes at least ten bytes
+        if (!r.ok() || count > body.size() / 10) {
+            return false;
+        }
+        chunk.accounts.clear();
+        chunk.accounts.reserve(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count && r.ok(); ++i) {
+            StateTree::Account account;
+            account.address = r.hex();
+            account.balance = r.f64();
+            account.nonce = r.varint();
+            chunk.accounts.push_back(std::move(account));
+        }
+        return r.ok() && r.at_end();
+    }
+    try {
+        chunk = SnapshotChunk::from_json(parse_body(body));
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool has_binary_body(MessageType type) {
+    switch (type) {
+        case MessageType::NEW_TRANSACTION:
+        case MessageType::NEW_BLOCK:
+        case MessageType::RESPONSE_CHAIN:
+        case MessageType::GET_HEADERS:
+        case MessageType::HEADERS:
+        case MessageType::GET_BLOCKS:
+        case MessageType::BLOCKS:
+        case MessageType::SNAPSHOT_MANIFEST:
+        case MessageType::GET_SNAPSHOT_CHUNK:
+        case MessageType::SNAPSHOT_CHUNK:
+        case MessageType::INV_TRANSACTIONS:
+        case MessageType::GET_TRANSACTIONS:
+        case MessageType::TRANSACTIONS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool transcode_body(MessageType type, Encoding from, Encoding to,
+                    const std::string& body, std::string& out) {
+    if (from == to || !has_binary_body(type)) {
+        out = body;
+        return true;
+    }
+
+    switch (type) {
+        case MessageType::NEW_TRANSACTION: {
+            Transaction tx;
+            if (!decode_transaction_body(from, body, tx)) return false;
+            out = to == Encoding::BINARY ? encode_transaction(tx) : tx.to_json().dump();
+            return true;
+        }
+        case MessageType::NEW_BLOCK: {
+            Block block;
+            if (!decode_block_body(from, body, block)) return false;
+            out = to == Encoding::BINARY ? encode_block(block) : block.to_json().dump();
+            return true;
+        }
+        case MessageType::RESPONSE_CHAIN:
+        case MessageType::BLOCKS: {
+            std::vector<Block> blocks;
+            if (!decode_blocks_body(from, body, blocks)) return false;
+            out = to == Encoding::BINARY ? encode_blocks(blocks) : blocks_to_json(blocks).dump();
+            return true;
+        }
+        case MessageType::GET_HEADERS: {
+            HeadersRequest request;
+            if (!decode_headers_request_body(from, body, request)) return false;
+            out = to == Encoding::BINARY ? encode_headers_request(request) : headers_request_to_json(request).dump();
+            return true;
+        }
+        case MessageType::HEADERS: {
+            std::vector<BlockHeader> headers;
+            if (!decode_headers_body(from, body, headers)) return false;
+            out = to == Encoding::BINARY ? encode_headers(headers) : headers_to_json(headers).dump();
+            return true;
+        }
+        case MessageType::GET_BLOCKS: {
+            BlocksRequest request;
+            if (!decode_blocks_request_body(from, body, request)) return false;
+            out = to == Encoding::BINARY
+                ? encode_blocks_request(request)
+                : json{{"first_index", request.first_index}, {"count", request.count}}.dump();
+            return true;
+        }
+        case MessageType::INV_TRANSACTIONS:
+        case MessageType::GET_TRANSACTIONS: {
+            std::vector<std::string> transaction_ids;
+            if (!decode_inventory_body(from, body, transaction_ids)) return false;
+            out = to == Encoding::BINARY ? encode_inventory(transaction_ids) : json(transaction_ids).dump();
+            return true;
+        }
+        case MessageType::TRANSACTIONS: {
+            std::vector<Transaction> transactions;
+            if (!decode_transactions_body(from, body, transactions)) return false;
+            out = to == Encoding::BINARY ? encode_transactions(transactions) : transactions_to_json(transactions).dump();
+            return true;
+        }
+        case MessageType::SNAPSHOT_MANIFEST: {
+            SnapshotManifest manifest;
+            if (!decode_snapshot_manifest_body(from, body, manifest)) return false;
+            out = to == Encoding::BINARY ? encode_snapshot_manifest(manifest) : manifest.to_json().dump();
+            return true;
+        }
+        case MessageType::GET_SNAPSHOT_CHUNK: {
+            ChunkRequest request;
+            if (!decode_chunk_request_body(from, body, request)) return false;
+            out = to == Encoding::BINARY
+                ? encode_chunk_request(request)
+                : json{{"state_root", request.state_root}, {"index", request.index}}.dump();
+            return true;
+        }
+        case MessageType::SNAPSHOT_CHUNK: {
+            SnapshotChunk chunk;
+            if (!decode_snapshot_chunk_body(from, body, chunk)) return false;
+            out = to == Encoding::BINARY ? encode_snapshot_chunk(chunk) : chunk.to_json().dump();
+            return true;
+        }
+        default:
+            out = body;
+            return true;
+    }
+}
+
+}  // namespace wire
@@ -0,0 +1,169 @@
+#ifndef WIRE_PROTOCOL_HPP
+#define WIRE_PROTOCOL_HPP
+
+#include "blockchain.hpp"
+#include "state_snapshot.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Message types for network communication
+enum class MessageType : uint8_t {
+    HANDSHAKE = 0,
+    NEW_TRANSACTION = 1,
+    NEW_BLOCK = 2,
+    REQUEST_CHAIN = 3,
+    RESPONSE_CHAIN = 4,
+    SYNC_REQUEST = 5,
+    SYNC_RESPONSE = 6,
+    PEER_LIST = 7,
+    ACK = 8,
+    STATE_SYNC_REQUEST = 9,    // Phase 4.2: Request account state snapshot
+    STATE_SYNC_RESPONSE = 10,  // Phase 4.2: Response with account state
+    GET_HEADERS = 11,          // Block locator; answered with HEADERS
+    HEADERS = 12,              // Headers following the locator's fork point
+    GET_BLOCKS = 13,           // Range of block indices; answered with BLOCKS
+    BLOCKS = 14,               // Block bodies for a GET_BLOCKS range
+    GET_SNAPSHOT_MANIFEST = 15,  // Empty body; answered with SNAPSHOT_MANIFEST
+    SNAPSHOT_MANIFEST = 16,      // Newest state snapshot the peer serves (height 0: none)
+    GET_SNAPSHOT_CHUNK = 17,     // State root and chunk index; answered with SNAPSHOT_CHUNK
+    SNAPSHOT_CHUNK = 18,         // Accounts of one snapshot chunk
+    INV_TRANSACTIONS = 19,       // Ids of transactions the sender can supply
+    GET_TRANSACTIONS = 20,       // Ids wanted from an INV_TRANSACTIONS; answered with TRANSACTIONS
+    TRANSACTIONS = 21            // Batch of transactions
+};
+
+/**
+ * Wire protocol - Length-prefixed, checksummed frames for P2P messages
+ *
+ * Frame layout (little endian):
+ *   u16 magic "VK" | u8 version | u8 encoding | u8 type | 3 reserved bytes |
+ *   u32 payload length | u32 crc32(payload) | payload
+ * The payload is u16 sender length | sender id | body. The body is either a
+ * JSON document or the compact binary encoding below, as the header's
+ * encoding byte says; the encoding used towards a peer is agreed at HANDSHAKE.
+ *
+ * Compact encodings use LEB128 varints for integers and lengths, raw IEEE
+ * doubles, and pack lower-case hex strings (hashes, keys, signatures) to
+ * half their size.
+ */
+namespace wire {
+
+enum class Encoding : uint8_t {
+    JSON = 0,    // Body is a JSON document (fallback, and every handshake)
+    BINARY = 1   // Body uses the compact encoders below
+};
+
+constexpr uint16_t MAGIC = 0x4B56;          // "VK"
+constexpr uint8_t PROTOCOL_VERSION = 1;
+constexpr size_t HEADER_SIZE = 16;
+constexpr uint32_t MAX_PAYLOAD_SIZE = 32u * 1024 * 1024;
+
+struct FrameHeader {
+    uint8_t version = PROTOCOL_VERSION;
+    Encoding encoding = Encoding::JSON;
+    MessageType type = MessageType::ACK;
+    uint32_t length = 0;
+    uint32_t checksum = 0;
+};
+
+// A parsed frame; the views point into the parser's buffer and stay valid
+// until the next call to FrameParser::feed() or next()
+struct Frame {
+    FrameHeader header;
+    std::string_view sender_id;
+    std::string_view body;
+};
+
+std::string encode_frame(MessageType type, Encoding encoding,
+                         const std::string& sender_id, std::string_view body);
+
+/**
+ * FrameParser - Incremental decoder for a byte stream of frames
+ *
+ * feed() appends whatever the socket delivered; next() yields complete
+ * frames without copying their payloads. A malformed frame (bad magic,
+ * version, size or checksum) puts the parser in a sticky error state.
+ */
+class FrameParser {
+public:
+    enum class Status { FRAME, NEED_MORE, ERROR };
+
+    void feed(const uint8_t* data, size_t length);
+    Status next(Frame& frame);
+
+    const std::string& error() const { return error_; }
+    size_t buffered() const { return buffer_.size() - read_offset_; }
+
+private:
+    std::vector<uint8_t> buffer_;
+    size_t read_offset_ = 0;
+    std::string error_;
+
+    Status fail(const std::string& reason);
+};
+
+// ============= COMPACT ENCODINGS =============
+std::string encode_transaction(const Transaction& tx);
+bool decode_transaction(std::string_view data, Transaction& tx);
+
+std::string encode_block(const Block& block);
+bool decode_block(std::string_view data, Block& block);
+
+std::string encode_blocks(const std::vector<Block>& blocks);
+bool decode_blocks(std::string_view data, std::vector<Block>& blocks);
+
+std::string encode_transactions(const std::vector<Transaction>& transactions);
+
+// Transaction ids, for INV_TRANSACTIONS and GET_TRANSACTIONS
+std::string encode_inventory(const std::vector<std::string>& transaction_ids);
+
+// Headers-first sync messages
+struct HeadersRequest {
+    std::vector<std::string> locator;  // Tip-first block hashes
+    uint32_t max_headers = 0;
+};
+
+struct BlocksRequest {
+    uint64_t first_index = 0;          // Block index (genesis is 1)
+    uint32_t count = 0;
+};
+
+std::string encode_headers_request(const HeadersRequest& request);
+std::string encode_headers(const std::vector<BlockHeader>& headers);
+std::string encode_blocks_request(const BlocksRequest& request);
+
+// State snapshot messages
+struct ChunkRequest {
+    std::string state_root;
+    uint32_t index = 0;
+};
+
+std::string encode_snapshot_manifest(const SnapshotManifest& manifest);
+std::string encode_chunk_request(const ChunkRequest& request);
+std::string encode_snapshot_chunk(const SnapshotChunk& chunk);
+
+// Body helpers that accept either encoding
+bool decode_transaction_body(Encoding encoding, std::string_view body, Transaction& tx);
+bool decode_block_body(Encoding encoding, std::string_view body, Block& block);
+bool decode_blocks_body(Encoding encoding, std::string_view body, std::vector<Block>& blocks);
+bool decode_headers_request_body(Encoding encoding, std::string_view body, HeadersRequest& request);
+bool decode_headers_body(Encoding encoding, std::string_view body, std::vector<BlockHeader>& headers);
+bool decode_blocks_request_body(Encoding encoding, std::string_view body, BlocksRequest& request);
+bool decode_transactions_body(Encoding encoding, std::string_view body, std::vector<Transaction>& transactions);
+bool decode_inventory_body(Encoding encoding, std::string_view body, std::vector<std::string>& transaction_ids);
+bool decode_snapshot_manifest_body(Encoding encoding, std::string_view body, SnapshotManifest& manifest);
+bool decode_chunk_request_body(Encoding encoding, std::string_view body, ChunkRequest& request);
+bool decode_snapshot_chunk_body(Encoding encoding, std::string_view body, SnapshotChunk& chunk);
+
+// Whether `type` has a compact encoding (others always travel as JSON)
+bool has_binary_body(MessageType type);
+
+// Re-encode a body for a peer that negotiated a different encoding
+bool transcode_body(MessageType type, Encoding from, Encoding to,
+                    const std::string& body, std::string& out);
+
+}  // namespace wire
+
+#endif // WIRE_PROTOCOL_HPP